@@ -0,0 +1,201 @@
+// PriorityQueue.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/Move.h"
+#include "Core/Containers/Sort.h"
+#include "Core/Env/Assert.h"
+#include "Core/Env/Types.h"
+
+// PriorityQueueNoIndex
+//  - Default INDEX policy for PriorityQueue: the position of items in the heap
+//    is not tracked, so only the top item can be removed
+//------------------------------------------------------------------------------
+class PriorityQueueNoIndex
+{
+public:
+    template < class T >
+    inline void SetIndex( const T & /*item*/, size_t /*index*/ ) const {}
+};
+
+// PriorityQueue
+//  - Binary heap, with the "largest" item (as defined by COMPARE) at the top
+//  - Push and Pop are O(log n)
+//  - If INDEX maps items to their position in the heap, Remove is also O(log n)
+//    INDEX must provide:
+//      void   SetIndex( const T & item, size_t index ) const; // INVALID_INDEX when removed
+//      size_t GetIndex( const T & item ) const;
+//------------------------------------------------------------------------------
+template < class T, class COMPARE = AscendingCompare, class INDEX = PriorityQueueNoIndex >
+class PriorityQueue
+{
+public:
+    static const size_t INVALID_INDEX = (size_t)-1;
+
+    explicit PriorityQueue( size_t initialCapacity = 0, const COMPARE & compare = COMPARE(), const INDEX & index = INDEX() );
+    ~PriorityQueue() = default;
+
+    // access
+    inline const T &    Top() const     { return m_Items[ 0 ]; }
+    inline size_t       GetSize() const { return m_Items.GetSize(); }
+    inline bool         IsEmpty() const { return m_Items.IsEmpty(); }
+
+    // add/remove items
+    void Push( const T & item );
+    void Pop();
+    void Remove( const T & item ); // requires an INDEX which tracks positions
+    void Clear();
+
+private:
+    void RemoveAt( size_t index );
+    void Place( T && item, size_t index );
+    void SiftUp( size_t index );
+    void SiftDown( size_t index );
+
+    Array< T >  m_Items;
+    COMPARE     m_Compare;
+    INDEX       m_Index;
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+PriorityQueue< T, COMPARE, INDEX >::PriorityQueue( size_t initialCapacity, const COMPARE & compare, const INDEX & index )
+    : m_Items( initialCapacity, true )
+    , m_Compare( compare )
+    , m_Index( index )
+{
+}
+
+// Push
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+void PriorityQueue< T, COMPARE, INDEX >::Push( const T & item )
+{
+    m_Items.Append( item );
+    SiftUp( m_Items.GetSize() - 1 );
+}
+
+// Pop
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+void PriorityQueue< T, COMPARE, INDEX >::Pop()
+{
+    ASSERT( m_Items.IsEmpty() == false );
+    RemoveAt( 0 );
+}
+
+// Remove
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+void PriorityQueue< T, COMPARE, INDEX >::Remove( const T & item )
+{
+    const size_t index = m_Index.GetIndex( item );
+    ASSERT( index < m_Items.GetSize() );
+    ASSERT( m_Items[ index ] == item );
+    RemoveAt( index );
+}
+
+// Clear
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+void PriorityQueue< T, COMPARE, INDEX >::Clear()
+{
+    for ( const T & item : m_Items )
+    {
+        m_Index.SetIndex( item, INVALID_INDEX );
+    }
+    m_Items.Clear();
+}
+
+// RemoveAt
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+void PriorityQueue< T, COMPARE, INDEX >::RemoveAt( size_t index )
+{
+    m_Index.SetIndex( m_Items[ index ], INVALID_INDEX );
+
+    // move last item into the gap and restore heap order
+    const size_t last = ( m_Items.GetSize() - 1 );
+    if ( index == last )
+    {
+        m_Items.Pop();
+        return;
+    }
+    Place( Move( m_Items[ last ] ), index );
+    m_Items.Pop();
+
+    // the moved item may belong above or below the gap
+    if ( ( index > 0 ) && m_Compare( m_Items[ ( index - 1 ) / 2 ], m_Items[ index ] ) )
+    {
+        SiftUp( index );
+    }
+    else
+    {
+        SiftDown( index );
+    }
+}
+
+// Place
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+void PriorityQueue< T, COMPARE, INDEX >::Place( T && item, size_t index )
+{
+    m_Items[ index ] = Move( item );
+    m_Index.SetIndex( m_Items[ index ], index );
+}
+
+// SiftUp
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+void PriorityQueue< T, COMPARE, INDEX >::SiftUp( size_t index )
+{
+    T item( Move( m_Items[ index ] ) );
+    while ( index > 0 )
+    {
+        const size_t parent = ( ( index - 1 ) / 2 );
+        if ( m_Compare( m_Items[ parent ], item ) == false )
+        {
+            break; // parent is not smaller
+        }
+        Place( Move( m_Items[ parent ] ), index );
+        index = parent;
+    }
+    Place( Move( item ), index );
+}
+
+// SiftDown
+//------------------------------------------------------------------------------
+template < class T, class COMPARE, class INDEX >
+void PriorityQueue< T, COMPARE, INDEX >::SiftDown( size_t index )
+{
+    const size_t size = m_Items.GetSize();
+    T item( Move( m_Items[ index ] ) );
+    for ( ;; )
+    {
+        size_t child = ( ( index * 2 ) + 1 );
+        if ( child >= size )
+        {
+            break; // leaf
+        }
+
+        // pick the larger of the children
+        if ( ( ( child + 1 ) < size ) && m_Compare( m_Items[ child ], m_Items[ child + 1 ] ) )
+        {
+            ++child;
+        }
+
+        if ( m_Compare( item, m_Items[ child ] ) == false )
+        {
+            break; // item is not smaller than either child
+        }
+        Place( Move( m_Items[ child ] ), index );
+        index = child;
+    }
+    Place( Move( item ), index );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,103 @@
+// Main.cpp - Timings for Core containers
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/PriorityQueue.h"
+#include "Core/Math/Random.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// BenchmarkPriorityQueue
+//  - Compare the heap with the append-then-sort approach the JobQueue used
+//    previously. Items are queued in several batches (as nodes become ready
+//    over multiple build passes) and then drained.
+//------------------------------------------------------------------------------
+static bool BenchmarkPriorityQueue( uint32_t numItems )
+{
+    const uint32_t numBatches = 10;
+    const uint32_t batchSize = ( numItems / numBatches );
+
+    // use pseudo-random (but deterministic) costs
+    Array< uint32_t > costs( numItems, false );
+    Random r( 0xB1234567 );
+    for ( uint32_t i = 0; i < numItems; ++i )
+    {
+        costs.Append( r.GetRand() );
+    }
+
+    // Sorted Array
+    float sortedTime;
+    uint64_t sortedSum = 0;
+    {
+        Timer t;
+        Array< uint32_t > items( numItems, false );
+        for ( uint32_t batch = 0; batch < numBatches; ++batch )
+        {
+            Array< uint32_t > batchItems( batchSize, false );
+            for ( uint32_t i = 0; i < batchSize; ++i )
+            {
+                batchItems.Append( costs[ ( batch * batchSize ) + i ] );
+            }
+            batchItems.Sort();
+
+            const bool wasEmpty = items.IsEmpty();
+            items.Append( batchItems );
+            if ( wasEmpty == false )
+            {
+                items.Sort(); // sort merged lists
+            }
+        }
+        while ( items.IsEmpty() == false )
+        {
+            sortedSum += items.Top();
+            items.Pop();
+        }
+        sortedTime = t.GetElapsed();
+    }
+
+    // PriorityQueue
+    float heapTime;
+    uint64_t heapSum = 0;
+    {
+        Timer t;
+        PriorityQueue< uint32_t > items( numItems );
+        for ( uint32_t batch = 0; batch < numBatches; ++batch )
+        {
+            for ( uint32_t i = 0; i < batchSize; ++i )
+            {
+                items.Push( costs[ ( batch * batchSize ) + i ] );
+            }
+        }
+        while ( items.IsEmpty() == false )
+        {
+            heapSum += items.Top();
+            items.Pop();
+        }
+        heapTime = t.GetElapsed();
+    }
+
+    OUTPUT( "PriorityQueue - Items: %6u - Sorted Array: %2.3fs - PriorityQueue: %2.3fs\n", numItems, (double)sortedTime, (double)heapTime );
+
+    // both must have drained the same items
+    if ( sortedSum != heapSum )
+    {
+        OUTPUT( "PriorityQueue - Mismatched results!\n" );
+        return false;
+    }
+    return true;
+}
+
+// main
+//------------------------------------------------------------------------------
+int main( int, char *[] )
+{
+    bool ok = true;
+    ok &= BenchmarkPriorityQueue( 1000 );
+    ok &= BenchmarkPriorityQueue( 10000 );
+    ok &= BenchmarkPriorityQueue( 100000 );
+    return ok ? 0 : -1;
+}
+
+//------------------------------------------------------------------------------
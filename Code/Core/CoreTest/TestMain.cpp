@@ -21,6 +21,7 @@ int main(int , char * [])
     REGISTER_TESTGROUP( TestMemPoolBlock )
     REGISTER_TESTGROUP( TestMutex )
     REGISTER_TESTGROUP( TestPathUtils )
+    REGISTER_TESTGROUP( TestPriorityQueue )
     REGISTER_TESTGROUP( TestReflection )
     REGISTER_TESTGROUP( TestSemaphore )
     REGISTER_TESTGROUP( TestSharedMemory )
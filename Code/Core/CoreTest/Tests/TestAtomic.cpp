@@ -5,6 +5,7 @@
 //------------------------------------------------------------------------------
 #include "TestFramework/UnitTest.h"
 
+#include "Core/Containers/Array.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
 
@@ -88,6 +89,11 @@ private:
     void SubU32() const;
     void Sub64() const;
     void SubU64() const;
+
+    // Pointers
+    void ExchangePointer() const;
+    void CompareExchangePointer() const;
+    void CompareExchangePointerThreaded() const;
 };
 
 // Register Tests
@@ -112,6 +118,11 @@ REGISTER_TESTS_BEGIN( TestAtomic )
     // Sub
     REGISTER_TEST( Sub32 )
     REGISTER_TEST( Sub64 )
+
+    // Pointers
+    REGISTER_TEST( ExchangePointer )
+    REGISTER_TEST( CompareExchangePointer )
+    REGISTER_TEST( CompareExchangePointerThreaded )
 REGISTER_TESTS_END
 
 // Add32
@@ -186,4 +197,108 @@ void TestAtomic::SubU64() const
     TEST_ASSERT( AtomicSubU64( &u64, 9876543210 ) == 0 );
 }
 
+// ExchangePointer
+//------------------------------------------------------------------------------
+void TestAtomic::ExchangePointer() const
+{
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t * volatile p = &a;
+
+    // Ensure return result is the previous value
+    TEST_ASSERT( AtomicExchange( &p, &b ) == &a );
+    TEST_ASSERT( p == &b );
+    TEST_ASSERT( AtomicExchange( &p, (uint32_t *)nullptr ) == &b );
+    TEST_ASSERT( p == nullptr );
+}
+
+// CompareExchangePointer
+//------------------------------------------------------------------------------
+void TestAtomic::CompareExchangePointer() const
+{
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t * volatile p = &a;
+
+    // Mismatched comparand - no change
+    TEST_ASSERT( AtomicCompareExchange( &p, &b, (uint32_t *)nullptr ) == &a );
+    TEST_ASSERT( p == &a );
+
+    // Matching comparand - exchanged
+    TEST_ASSERT( AtomicCompareExchange( &p, &b, &a ) == &a );
+    TEST_ASSERT( p == &b );
+}
+
+// CompareExchangePointerThreaded
+//  - Push nodes onto a shared linked list from two threads
+//------------------------------------------------------------------------------
+struct TestAtomicListNode
+{
+    TestAtomicListNode * m_Next;
+};
+struct TestAtomicListUserData
+{
+    TestAtomicListNode * volatile   m_Head;
+    TestAtomicListNode *            m_Nodes;
+    volatile uint32_t               m_BarrierCounter;
+};
+static void TestAtomicListPush( TestAtomicListUserData & data, TestAtomicListNode * nodes, size_t numNodes )
+{
+    AtomicIncU32( &data.m_BarrierCounter );
+    while ( AtomicLoadAcquire( &data.m_BarrierCounter ) != 2 ) {}
+
+    for ( size_t i=0; i<numNodes; ++i )
+    {
+        TestAtomicListNode * node = &nodes[ i ];
+        TestAtomicListNode * head = AtomicLoadRelaxed( &data.m_Head );
+        for ( ;; )
+        {
+            node->m_Next = head;
+            TestAtomicListNode * prev = AtomicCompareExchange( &data.m_Head, node, head );
+            if ( prev == head )
+            {
+                break;
+            }
+            head = prev;
+        }
+    }
+}
+static uint32_t TestAtomicListThreadEntryFunction( void * userData )
+{
+    TestAtomicListUserData & data = *( static_cast< TestAtomicListUserData * >( userData ) );
+    TestAtomicListPush( data, data.m_Nodes, 100000 );
+    return 0;
+}
+void TestAtomic::CompareExchangePointerThreaded() const
+{
+    const size_t numNodesPerThread = 100000;
+    Array< TestAtomicListNode > nodes;
+    nodes.SetSize( numNodesPerThread * 2 );
+
+    TestAtomicListUserData data;
+    data.m_Head = nullptr;
+    data.m_Nodes = nodes.Begin() + numNodesPerThread;
+    data.m_BarrierCounter = 0;
+
+    Thread::ThreadHandle h = Thread::CreateThread( TestAtomicListThreadEntryFunction,
+                                                   "CompareExchangePointerThreaded",
+                                                   ( 64 * KILOBYTE ),
+                                                   static_cast< void * >( &data ) );
+    TestAtomicListPush( data, nodes.Begin(), numNodesPerThread );
+
+    bool timedOut = false;
+    Thread::WaitForThread( h, 1000, timedOut );
+    TEST_ASSERT( timedOut == false );
+    Thread::CloseHandle( h );
+
+    // Every node should be in the list exactly once
+    size_t count = 0;
+    for ( TestAtomicListNode * node = AtomicExchange( &data.m_Head, (TestAtomicListNode *)nullptr ); node; node = node->m_Next )
+    {
+        ++count;
+    }
+    TEST_ASSERT( count == ( numNodesPerThread * 2 ) );
+    TEST_ASSERT( data.m_Head == nullptr );
+}
+
 //------------------------------------------------------------------------------
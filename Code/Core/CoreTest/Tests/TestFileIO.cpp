@@ -8,6 +8,7 @@
 // Core
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
 #include "Core/Math/Random.h"
 #include "Core/Process/Process.h"
 #include "Core/Process/Thread.h"
@@ -35,6 +36,8 @@ private:
 
     void FileTime() const;
 
+    void MemoryMap() const;
+
     // Helpers
     mutable Random m_Random;
     void GenerateTempFileName( AString & tmpFileName ) const;
@@ -50,6 +53,7 @@ REGISTER_TESTS_BEGIN( TestFileIO )
     REGISTER_TEST( FileMove )
     REGISTER_TEST( ReadOnly )
     REGISTER_TEST( FileTime )
+    REGISTER_TEST( MemoryMap )
 REGISTER_TESTS_END
 
 // FileExists
@@ -304,6 +308,54 @@ void TestFileIO::FileTime() const
     TEST_ASSERT( timeNow == oldTime );
 }
 
+// MemoryMap
+//------------------------------------------------------------------------------
+void TestFileIO::MemoryMap() const
+{
+    // generate a process unique file path
+    AStackString<> path;
+    GenerateTempFileName( path );
+
+    // empty files can't be mapped
+    FileStream f;
+    TEST_ASSERT( f.Open( path.Get(), FileStream::WRITE_ONLY ) == true );
+    f.Close();
+    {
+        MemoryMappedFile mf;
+        TEST_ASSERT( mf.Open( path.Get() ) == false );
+    }
+
+    // write some data
+    const char data[] = "0123456789";
+    TEST_ASSERT( f.Open( path.Get(), FileStream::WRITE_ONLY ) == true );
+    TEST_ASSERT( f.Write( data, sizeof( data ) ) == sizeof( data ) );
+    f.Close();
+
+    // map it
+    MemoryMappedFile mf;
+    TEST_ASSERT( mf.Open( path.Get() ) == true );
+    TEST_ASSERT( mf.GetSize() == sizeof( data ) );
+    TEST_ASSERT( AString::StrNCmp( (const char *)mf.GetData(), data, sizeof( data ) ) == 0 );
+
+    // view remains valid when the file is replaced (Windows doesn't allow mapped files to be replaced)
+    #if !defined( __WINDOWS__ )
+        AStackString<> otherPath( path );
+        otherPath += ".other";
+        TEST_ASSERT( f.Open( otherPath.Get(), FileStream::WRITE_ONLY ) == true );
+        f.Write( (uint32_t)0 );
+        f.Close();
+        TEST_ASSERT( FileIO::FileMove( otherPath, path ) );
+    #endif
+    size_t size;
+    const void * view = mf.Release( size );
+    TEST_ASSERT( size == sizeof( data ) );
+    TEST_ASSERT( AString::StrNCmp( (const char *)view, data, sizeof( data ) ) == 0 );
+    MemoryMappedFile::Unmap( view, size );
+
+    // cleanup
+    VERIFY( FileIO::FileDelete( path.Get() ) );
+}
+
 // GenerateTempFileName
 //------------------------------------------------------------------------------
 void TestFileIO::GenerateTempFileName( AString & tmpFileName ) const
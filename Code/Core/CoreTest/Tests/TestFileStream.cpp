@@ -20,6 +20,7 @@ private:
 
     void WriteOnly() const;
     void ReadOnly() const;
+    void Append() const;
 
     // Helpers
     mutable uint32_t m_TempFileId = 0;
@@ -31,6 +32,7 @@ private:
 REGISTER_TESTS_BEGIN( TestFileStream )
     REGISTER_TEST( WriteOnly )
     REGISTER_TEST( ReadOnly )
+    REGISTER_TEST( Append )
 REGISTER_TESTS_END
 
 // WriteOnly
@@ -111,6 +113,50 @@ void TestFileStream::ReadOnly() const
     TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
 }
 
+// Append
+//------------------------------------------------------------------------------
+void TestFileStream::Append() const
+{
+    AStackString<> fileName;
+    GenerateTempFileName( fileName );
+
+    const AStackString<> data( "Some Data To Store In A File" );
+
+    // Create a file by appending to it
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) == true );
+        TEST_ASSERT( f.WriteBuffer( data.Get(), data.GetLength() ) == data.GetLength() );
+    }
+
+    // Append from two streams at once
+    {
+        FileStream f1;
+        FileStream f2;
+        TEST_ASSERT( f1.Open( fileName.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) == true );
+        TEST_ASSERT( f2.Open( fileName.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) == true );
+        TEST_ASSERT( f1.WriteBuffer( data.Get(), data.GetLength() ) == data.GetLength() );
+        TEST_ASSERT( f2.WriteBuffer( data.Get(), data.GetLength() ) == data.GetLength() );
+    }
+
+    // Existing contents are kept, and nothing is overwritten
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::READ_ONLY ) == true );
+        TEST_ASSERT( f.GetFileSize() == ( data.GetLength() * 3 ) );
+        AStackString<> buffer;
+        buffer.SetLength( data.GetLength() );
+        for ( uint32_t i = 0; i < 3; ++i )
+        {
+            TEST_ASSERT( f.ReadBuffer( buffer.Get(), data.GetLength() ) == data.GetLength() );
+            TEST_ASSERT( data == buffer );
+        }
+    }
+
+    // Clean up
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+}
+
 // GenerateTempFileName
 //------------------------------------------------------------------------------
 void TestFileStream::GenerateTempFileName( AString & outTempFileName ) const
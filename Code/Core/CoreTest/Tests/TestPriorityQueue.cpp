@@ -0,0 +1,375 @@
+// TestPriorityQueue.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TestFramework/UnitTest.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Containers/PriorityQueue.h"
+#include "Core/Math/Random.h"
+#include "Core/Strings/AString.h"
+
+// TestPriorityQueue
+//------------------------------------------------------------------------------
+class TestPriorityQueue : public UnitTest
+{
+private:
+    DECLARE_TESTS
+
+    void Empty() const;
+    void PushPop() const;
+    void Duplicates() const;
+    void Interleaved() const;
+    void CustomCompare() const;
+    void NonPOD() const;
+    void EqualPriorities() const;
+    void Remove() const;
+    void RemoveEqualPriorities() const;
+    void RemoveInterleaved() const;
+};
+
+// IndexedItem - an item which tracks its position in the heap
+//------------------------------------------------------------------------------
+class IndexedItem
+{
+public:
+    explicit IndexedItem( uint32_t cost = 0 ) : m_Cost( cost ) {}
+
+    uint32_t    m_Cost;
+    size_t      m_Index = (size_t)-1;
+};
+class IndexedItemCompare
+{
+public:
+    inline bool operator () ( const IndexedItem * a, const IndexedItem * b ) const { return ( a->m_Cost < b->m_Cost ); }
+};
+class IndexedItemIndex
+{
+public:
+    inline void     SetIndex( IndexedItem * item, size_t index ) const  { item->m_Index = index; }
+    inline size_t   GetIndex( IndexedItem * item ) const                { return item->m_Index; }
+};
+typedef PriorityQueue< IndexedItem *, IndexedItemCompare, IndexedItemIndex > IndexedQueue;
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestPriorityQueue )
+    REGISTER_TEST( Empty )
+    REGISTER_TEST( PushPop )
+    REGISTER_TEST( Duplicates )
+    REGISTER_TEST( Interleaved )
+    REGISTER_TEST( CustomCompare )
+    REGISTER_TEST( NonPOD )
+    REGISTER_TEST( EqualPriorities )
+    REGISTER_TEST( Remove )
+    REGISTER_TEST( RemoveEqualPriorities )
+    REGISTER_TEST( RemoveInterleaved )
+REGISTER_TESTS_END
+
+// Empty
+//------------------------------------------------------------------------------
+void TestPriorityQueue::Empty() const
+{
+    PriorityQueue< uint32_t > pq;
+    TEST_ASSERT( pq.IsEmpty() );
+    TEST_ASSERT( pq.GetSize() == 0 );
+
+    pq.Push( 7 );
+    TEST_ASSERT( pq.IsEmpty() == false );
+    TEST_ASSERT( pq.Top() == 7 );
+    pq.Pop();
+    TEST_ASSERT( pq.IsEmpty() );
+
+    pq.Push( 1 );
+    pq.Push( 2 );
+    pq.Clear();
+    TEST_ASSERT( pq.IsEmpty() );
+}
+
+// PushPop
+//------------------------------------------------------------------------------
+void TestPriorityQueue::PushPop() const
+{
+    Random r( 0x12345678 );
+
+    PriorityQueue< uint32_t > pq( 1000 );
+    for ( size_t i = 0; i < 1000; ++i )
+    {
+        pq.Push( r.GetRand() );
+    }
+    TEST_ASSERT( pq.GetSize() == 1000 );
+
+    // items must come out largest first
+    uint32_t prev = pq.Top();
+    while ( pq.IsEmpty() == false )
+    {
+        TEST_ASSERT( pq.Top() <= prev );
+        prev = pq.Top();
+        pq.Pop();
+    }
+}
+
+// Duplicates
+//------------------------------------------------------------------------------
+void TestPriorityQueue::Duplicates() const
+{
+    PriorityQueue< uint32_t > pq;
+    for ( uint32_t i = 0; i < 100; ++i )
+    {
+        pq.Push( i % 4 );
+    }
+
+    for ( uint32_t value = 4; value > 0; --value )
+    {
+        for ( size_t i = 0; i < 25; ++i )
+        {
+            TEST_ASSERT( pq.Top() == ( value - 1 ) );
+            pq.Pop();
+        }
+    }
+    TEST_ASSERT( pq.IsEmpty() );
+}
+
+// Interleaved
+//------------------------------------------------------------------------------
+void TestPriorityQueue::Interleaved() const
+{
+    // Push and Pop in batches, like the JobQueue does as the build progresses
+    Random r( 0x87654321 );
+    PriorityQueue< uint32_t > pq;
+    Array< uint32_t > reference( 0, true );
+    for ( size_t batch = 0; batch < 20; ++batch )
+    {
+        for ( size_t i = 0; i < 50; ++i )
+        {
+            const uint32_t value = r.GetRandIndex( 100 );
+            pq.Push( value );
+            reference.Append( value );
+        }
+        reference.Sort();
+
+        for ( size_t i = 0; i < 30; ++i )
+        {
+            TEST_ASSERT( pq.Top() == reference.Top() );
+            pq.Pop();
+            reference.Pop();
+        }
+        TEST_ASSERT( pq.GetSize() == reference.GetSize() );
+    }
+}
+
+// CustomCompare
+//------------------------------------------------------------------------------
+void TestPriorityQueue::CustomCompare() const
+{
+    // A descending comparison turns the queue into a min-heap
+    class DescendingCompare
+    {
+    public:
+        inline bool operator () ( uint32_t a, uint32_t b ) const { return ( a > b ); }
+    };
+
+    PriorityQueue< uint32_t, DescendingCompare > pq;
+    const uint32_t values[] = { 5, 3, 9, 1, 7 };
+    for ( const uint32_t value : values )
+    {
+        pq.Push( value );
+    }
+
+    const uint32_t expected[] = { 1, 3, 5, 7, 9 };
+    for ( const uint32_t value : expected )
+    {
+        TEST_ASSERT( pq.Top() == value );
+        pq.Pop();
+    }
+    TEST_ASSERT( pq.IsEmpty() );
+}
+
+// NonPOD
+//------------------------------------------------------------------------------
+void TestPriorityQueue::NonPOD() const
+{
+    PriorityQueue< AString > pq;
+    pq.Push( AString( "banana" ) );
+    pq.Push( AString( "cherry" ) );
+    pq.Push( AString( "apple" ) );
+
+    TEST_ASSERT( pq.Top() == "cherry" );
+    pq.Pop();
+    TEST_ASSERT( pq.Top() == "banana" );
+    pq.Pop();
+    TEST_ASSERT( pq.Top() == "apple" );
+    pq.Pop();
+    TEST_ASSERT( pq.IsEmpty() );
+}
+
+// EqualPriorities
+//------------------------------------------------------------------------------
+void TestPriorityQueue::EqualPriorities() const
+{
+    // distinct items with the same priority must all come out, grouped together
+    IndexedItem items[ 12 ];
+    for ( uint32_t i = 0; i < 12; ++i )
+    {
+        items[ i ].m_Cost = ( i % 3 );
+    }
+
+    IndexedQueue pq;
+    for ( IndexedItem & item : items )
+    {
+        pq.Push( &item );
+    }
+
+    bool seen[ 12 ] = { false };
+    for ( uint32_t cost = 3; cost > 0; --cost )
+    {
+        for ( size_t i = 0; i < 4; ++i )
+        {
+            IndexedItem * top = pq.Top();
+            TEST_ASSERT( top->m_Cost == ( cost - 1 ) );
+
+            const size_t itemIndex = (size_t)( top - items );
+            TEST_ASSERT( seen[ itemIndex ] == false );
+            seen[ itemIndex ] = true;
+
+            pq.Pop();
+            TEST_ASSERT( top->m_Index == IndexedQueue::INVALID_INDEX );
+        }
+    }
+    TEST_ASSERT( pq.IsEmpty() );
+}
+
+// Remove
+//------------------------------------------------------------------------------
+void TestPriorityQueue::Remove() const
+{
+    IndexedItem items[ 8 ];
+    const uint32_t costs[] = { 50, 20, 80, 10, 70, 30, 60, 40 };
+    IndexedQueue pq;
+    for ( size_t i = 0; i < 8; ++i )
+    {
+        items[ i ].m_Cost = costs[ i ];
+        pq.Push( &items[ i ] );
+    }
+
+    // positions are tracked for every item
+    for ( const IndexedItem & item : items )
+    {
+        TEST_ASSERT( item.m_Index < pq.GetSize() );
+    }
+
+    // remove the top, an item in the middle and the smallest (a leaf)
+    pq.Remove( &items[ 2 ] ); // 80
+    TEST_ASSERT( items[ 2 ].m_Index == IndexedQueue::INVALID_INDEX );
+    pq.Remove( &items[ 0 ] ); // 50
+    pq.Remove( &items[ 3 ] ); // 10
+    TEST_ASSERT( pq.GetSize() == 5 );
+
+    // remaining items come out in order
+    const uint32_t expected[] = { 70, 60, 40, 30, 20 };
+    for ( const uint32_t cost : expected )
+    {
+        TEST_ASSERT( pq.Top()->m_Cost == cost );
+        pq.Pop();
+    }
+    TEST_ASSERT( pq.IsEmpty() );
+
+    // removing the only item empties the queue
+    pq.Push( &items[ 0 ] );
+    pq.Remove( &items[ 0 ] );
+    TEST_ASSERT( pq.IsEmpty() );
+
+    // cleared items are no longer tracked
+    pq.Push( &items[ 0 ] );
+    pq.Push( &items[ 1 ] );
+    pq.Clear();
+    TEST_ASSERT( items[ 0 ].m_Index == IndexedQueue::INVALID_INDEX );
+    TEST_ASSERT( items[ 1 ].m_Index == IndexedQueue::INVALID_INDEX );
+}
+
+// RemoveEqualPriorities
+//------------------------------------------------------------------------------
+void TestPriorityQueue::RemoveEqualPriorities() const
+{
+    // the exact item must be removed, not another with the same priority
+    IndexedItem items[ 6 ];
+    IndexedQueue pq;
+    for ( IndexedItem & item : items )
+    {
+        item.m_Cost = 5;
+        pq.Push( &item );
+    }
+
+    pq.Remove( &items[ 4 ] );
+    pq.Remove( &items[ 1 ] );
+    TEST_ASSERT( pq.GetSize() == 4 );
+
+    bool seen[ 6 ] = { false };
+    while ( pq.IsEmpty() == false )
+    {
+        IndexedItem * top = pq.Top();
+        seen[ top - items ] = true;
+        pq.Pop();
+    }
+    TEST_ASSERT( seen[ 0 ] && seen[ 2 ] && seen[ 3 ] && seen[ 5 ] );
+    TEST_ASSERT( ( seen[ 1 ] == false ) && ( seen[ 4 ] == false ) );
+}
+
+// RemoveInterleaved
+//------------------------------------------------------------------------------
+void TestPriorityQueue::RemoveInterleaved() const
+{
+    // Push, Remove and Pop at random, checking against the items queued
+    const size_t numItems = 1000;
+    Array< IndexedItem > items( numItems, false );
+    Random r( 0x13572468 );
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        items.Append( IndexedItem( r.GetRandIndex( 100 ) ) );
+    }
+
+    IndexedQueue pq;
+    Array< IndexedItem * > queued( numItems, false );
+    size_t next = 0;
+    while ( ( next < numItems ) || ( pq.IsEmpty() == false ) )
+    {
+        const uint32_t action = r.GetRandIndex( 4 );
+        if ( ( next < numItems ) && ( ( action < 2 ) || pq.IsEmpty() ) )
+        {
+            IndexedItem * item = &items[ next++ ];
+            pq.Push( item );
+            queued.Append( item );
+        }
+        else if ( action == 2 )
+        {
+            const size_t i = r.GetRandIndex( (uint32_t)queued.GetSize() );
+            IndexedItem * item = queued[ i ];
+            queued.EraseIndex( i );
+            pq.Remove( item );
+            TEST_ASSERT( item->m_Index == IndexedQueue::INVALID_INDEX );
+        }
+        else
+        {
+            IndexedItem * top = pq.Top();
+            queued.Erase( queued.Find( top ) );
+            pq.Pop();
+        }
+        TEST_ASSERT( pq.GetSize() == queued.GetSize() );
+
+        // top must be the largest of the queued items and every
+        // queued item must know where it is
+        if ( pq.IsEmpty() == false )
+        {
+            uint32_t largest = 0;
+            for ( const IndexedItem * item : queued )
+            {
+                largest = ( item->m_Cost > largest ) ? item->m_Cost : largest;
+                TEST_ASSERT( item->m_Index < pq.GetSize() );
+            }
+            TEST_ASSERT( pq.Top()->m_Cost == largest );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -46,6 +46,10 @@ private:
     void TestMultipleServersOneClient() const;
     void TestConnectionCount() const;
     void TestDataTransfer() const;
+    void TestDataTransferEventLoop() const;
+    static void DataTransfer( bool useEventLoop );
+    void TestManyConnectionsEventLoop() const;
+    void TestGatheredPayload() const;
 
     void TestConnectionStuckDuringSend() const;
     static uint32_t TestConnectionStuckDuringSend_ThreadFunc( void * userData );
@@ -73,6 +77,9 @@ REGISTER_TESTS_BEGIN( TestTestTCPConnectionPool )
     REGISTER_TEST( TestMultipleServersOneClient )
     REGISTER_TEST( TestConnectionCount )
     REGISTER_TEST( TestDataTransfer )
+    REGISTER_TEST( TestDataTransferEventLoop )
+    REGISTER_TEST( TestManyConnectionsEventLoop )
+    REGISTER_TEST( TestGatheredPayload )
     REGISTER_TEST( TestConnectionStuckDuringSend )
     REGISTER_TEST( TestConnectionFailure )
 REGISTER_TESTS_END
@@ -195,6 +202,20 @@ void TestTestTCPConnectionPool::TestConnectionCount() const
 // TestDataTransfer
 //------------------------------------------------------------------------------
 void TestTestTCPConnectionPool::TestDataTransfer() const
+{
+    DataTransfer( false );
+}
+
+// TestDataTransferEventLoop
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestDataTransferEventLoop() const
+{
+    DataTransfer( true );
+}
+
+// DataTransfer
+//------------------------------------------------------------------------------
+/*static*/ void TestTestTCPConnectionPool::DataTransfer( bool useEventLoop )
 {
     // a special server which will assert that it receives some expected data
     class TestServer : public TCPConnectionPool
@@ -226,10 +247,18 @@ void TestTestTCPConnectionPool::TestDataTransfer() const
 
     TestServer server;
     server.m_ExpectedData = data.Get(); // Allow OnReceive to compare data to expected
+    if ( useEventLoop )
+    {
+        server.UseEventLoop();
+    }
     TEST_ASSERT( server.Listen( testPort ) );
 
     // client
     TCPConnectionPool client;
+    if ( useEventLoop )
+    {
+        client.UseEventLoop();
+    }
     const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
     TEST_ASSERT( ci );
 
@@ -263,6 +292,130 @@ void TestTestTCPConnectionPool::TestDataTransfer() const
     client.ShutdownAllConnections();
 }
 
+// TestManyConnectionsEventLoop
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestManyConnectionsEventLoop() const
+{
+    // a server which counts messages, and replies to each one
+    class EchoServer : public TCPConnectionPool
+    {
+    public:
+        ~EchoServer() { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * ci, void * data, uint32_t size, bool & )
+        {
+            AtomicIncU32( &m_NumReceived );
+            Send( ci, data, size );
+        }
+        volatile uint32_t m_NumReceived = 0;
+    };
+    class EchoClient : public TCPConnectionPool
+    {
+    public:
+        virtual void OnReceive( const ConnectionInfo *, void *, uint32_t, bool & )
+        {
+            AtomicIncU32( &m_NumReplies );
+        }
+        volatile uint32_t m_NumReplies = 0;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    EchoServer server;
+    server.UseEventLoop();
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // many connections, serviced by a single event loop
+    const uint32_t numConnections = 64;
+    const uint32_t numMessages = 8;
+    EchoClient client;
+    client.UseEventLoop( 1 );
+    const ConnectionInfo * connections[ numConnections ];
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        // Allow each connection to be retried in case of local resource exhaustion
+        Timer t;
+        while ( ( connections[ i ] = client.Connect( AStackString<>( "127.0.0.1" ), testPort ) ) == nullptr )
+        {
+            TEST_ASSERTM( t.GetElapsed() < 5.0f, "Failed to connect. (Connection %u)", i );
+            Thread::Sleep( 50 );
+        }
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == numConnections );
+
+    // interleave messages across all connections
+    char message[ 1024 ];
+    memset( message, 0, sizeof( message ) );
+    for ( uint32_t j = 0; j < numMessages; ++j )
+    {
+        for ( uint32_t i = 0; i < numConnections; ++i )
+        {
+            TEST_ASSERT( client.Send( connections[ i ], message, sizeof( message ) ) );
+        }
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumReceived ) == ( numConnections * numMessages ) );
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &client.m_NumReplies ) == ( numConnections * numMessages ) );
+
+    // disconnection is seen by the server
+    client.ShutdownAllConnections();
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+}
+
+// TestGatheredPayload
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestGatheredPayload() const
+{
+    // a server which records the messages it receives
+    class RecordingServer : public TCPConnectionPool
+    {
+    public:
+        ~RecordingServer() { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * ci, void * data, uint32_t size, bool & )
+        {
+            AStackString<> msg;
+            msg.Assign( (const char *)data, (const char *)data + size );
+            m_Messages.Append( msg );
+            m_Connection = ci;
+            m_ReceivedSemaphore.Signal();
+        }
+        Array< AString > m_Messages;
+        const ConnectionInfo * m_Connection = nullptr;
+        Semaphore m_ReceivedSemaphore;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    RecordingServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    TCPConnectionPool client;
+    const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+    TEST_ASSERT( ci );
+
+    // payload is sent from several buffers
+    const char * parts[] = { "Gathered", "-", "Payload" };
+    TCPConnectionPool::SendBuffer payload[ 3 ];
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        payload[ i ].size = (uint32_t)AString::StrLen( parts[ i ] );
+        payload[ i ].data = parts[ i ];
+    }
+    TEST_ASSERT( client.Send( ci, "Header", 6, payload, 3 ) );
+
+    // ...but is received as one
+    server.m_ReceivedSemaphore.Wait();
+    server.m_ReceivedSemaphore.Wait();
+    TEST_ASSERT( server.m_Messages.GetSize() == 2 );
+    TEST_ASSERT( server.m_Messages[ 0 ] == "Header" );
+    TEST_ASSERT( server.m_Messages[ 1 ] == "Gathered-Payload" );
+
+    // transfer is recorded on both ends
+    const uint64_t expectedBytes = ( sizeof( uint32_t ) + 6 + sizeof( uint32_t ) + 16 );
+    TEST_ASSERT( ci->GetBytesSent() == expectedBytes );
+    TEST_ASSERT( server.m_Connection->GetBytesReceived() == expectedBytes );
+
+    client.ShutdownAllConnections();
+}
+
 // TestConnectionStuckDuringSend
 //------------------------------------------------------------------------------
 void TestTestTCPConnectionPool::TestConnectionStuckDuringSend() const
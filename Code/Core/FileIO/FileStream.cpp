@@ -67,6 +67,13 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
         shareMode           |= FILE_SHARE_READ; // allow other readers
         creationDisposition |= OPEN_EXISTING;
     }
+    else if ( ( fileMode & APPEND ) != 0 )
+    {
+        ASSERT( ( fileMode & WRITE_ONLY ) != 0 );
+        desiredAccess       |= FILE_APPEND_DATA; // writes always go to the end
+        shareMode           |= ( FILE_SHARE_READ | FILE_SHARE_WRITE ); // allow other readers and appenders
+        creationDisposition |= OPEN_ALWAYS; // keep existing
+    }
     else if ( ( fileMode & WRITE_ONLY ) != 0 )
     {
         desiredAccess       |= GENERIC_WRITE;
@@ -129,6 +136,11 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
     {
         flags |= O_RDONLY;
     }
+    else if ( ( fileMode & APPEND ) != 0 )
+    {
+        ASSERT( ( fileMode & WRITE_ONLY ) != 0 );
+        flags |= ( O_WRONLY | O_CREAT | O_APPEND );
+    }
     else if ( ( fileMode & WRITE_ONLY ) != 0 )
     {
         flags |= ( O_WRONLY | O_CREAT | O_TRUNC );
@@ -0,0 +1,148 @@
+// MemoryMappedFile - Read-only view of a file
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "MemoryMappedFile.h"
+
+// Core
+#include "Core/Env/Assert.h"
+
+// system
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+MemoryMappedFile::MemoryMappedFile()
+    : m_Data( nullptr )
+    , m_Size( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+// Open
+//------------------------------------------------------------------------------
+bool MemoryMappedFile::Open( const char * fileName )
+{
+    ASSERT( m_Data == nullptr );
+
+    #if defined( __WINDOWS__ )
+        // Don't prevent other processes renaming or deleting the file (where possible)
+        HANDLE file = CreateFile( fileName,
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN,
+                                  nullptr );
+        if ( file == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if ( ( GetFileSizeEx( file, &fileSize ) == FALSE ) || ( fileSize.QuadPart == 0 ) )
+        {
+            CloseHandle( file );
+            return false;
+        }
+
+        // The view keeps the mapping (and file) open once created
+        HANDLE mapping = CreateFileMapping( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        CloseHandle( file );
+        if ( mapping == nullptr )
+        {
+            return false;
+        }
+        const void * data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        CloseHandle( mapping );
+        if ( data == nullptr )
+        {
+            return false;
+        }
+
+        m_Data = data;
+        m_Size = (size_t)fileSize.QuadPart;
+        return true;
+    #elif defined( __LINUX__ ) || defined( __APPLE__ )
+        const int file = open( fileName, O_RDONLY | O_CLOEXEC );
+        if ( file == -1 )
+        {
+            return false;
+        }
+
+        struct stat st;
+        if ( ( fstat( file, &st ) != 0 ) || ( st.st_size == 0 ) )
+        {
+            close( file );
+            return false;
+        }
+
+        // The mapping keeps the file open once created
+        void * data = mmap( nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+        close( file );
+        if ( data == MAP_FAILED )
+        {
+            return false;
+        }
+        madvise( data, (size_t)st.st_size, MADV_SEQUENTIAL ); // hint only
+
+        m_Data = data;
+        m_Size = (size_t)st.st_size;
+        return true;
+    #else
+        #error Unknown Platform
+    #endif
+}
+
+// Close
+//------------------------------------------------------------------------------
+void MemoryMappedFile::Close()
+{
+    if ( m_Data )
+    {
+        Unmap( m_Data, m_Size );
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+}
+
+// Release
+//------------------------------------------------------------------------------
+const void * MemoryMappedFile::Release( size_t & outSize )
+{
+    const void * data = m_Data;
+    outSize = m_Size;
+    m_Data = nullptr;
+    m_Size = 0;
+    return data;
+}
+
+// Unmap
+//------------------------------------------------------------------------------
+/*static*/ void MemoryMappedFile::Unmap( const void * data, size_t size )
+{
+    #if defined( __WINDOWS__ )
+        (void)size;
+        VERIFY( UnmapViewOfFile( data ) );
+    #elif defined( __LINUX__ ) || defined( __APPLE__ )
+        VERIFY( munmap( const_cast< void * >( data ), size ) == 0 );
+    #else
+        #error Unknown Platform
+    #endif
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,36 @@
+// MemoryMappedFile - Read-only view of a file
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// MemoryMappedFile
+//  - The file's contents are paged in from disk as they are accessed, instead of
+//    being read into an allocated buffer up front
+//  - The view remains valid if the file is replaced (by renaming another file
+//    over it) on Linux and OSX. Windows doesn't allow this while it is mapped.
+//------------------------------------------------------------------------------
+class MemoryMappedFile
+{
+public:
+    explicit MemoryMappedFile();
+    ~MemoryMappedFile();
+
+    bool Open( const char * fileName ); // fails for empty files, which can't be mapped
+    void Close();
+
+    inline const void * GetData() const { return m_Data; }
+    inline size_t       GetSize() const { return m_Size; }
+
+    // Take ownership of the view, which must be freed with Unmap
+    const void *        Release( size_t & outSize );
+    static void         Unmap( const void * data, size_t size );
+
+private:
+    const void *    m_Data;
+    size_t          m_Size;
+};
+
+//------------------------------------------------------------------------------
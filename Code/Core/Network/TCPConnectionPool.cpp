@@ -36,6 +36,10 @@
 #else
     #error Unknown platform
 #endif
+#if defined( __LINUX__ )
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+#endif
 
 // Defines
 //------------------------------------------------------------------------------
@@ -58,13 +62,14 @@
         enum ThreadType
         {
             THREAD_LISTEN,
-            THREAD_CONNECTION
+            THREAD_CONNECTION,
+            THREAD_EVENT_LOOP
         };
 
         TCPConnectionPoolProfileHelper( ThreadType threadType )
         {
             // Chose which bitmap to use
-            uint64_t& bitmap = ( threadType == THREAD_LISTEN ) ? s_IdBitmapListen : s_IdBitmapConnection;
+            uint64_t& bitmap = GetBitmap( threadType );
 
             // Find free bit
             uint32_t bit = 0;
@@ -92,7 +97,8 @@
 
             // Format and set
             AStackString<> threadName;
-            threadName.Format( ( threadType == THREAD_LISTEN ) ? "Listen_%u" : "Connection_%u", bit );
+            threadName.Format( ( threadType == THREAD_LISTEN ) ? "Listen_%u" :
+                               ( threadType == THREAD_CONNECTION ) ? "Connection_%u" : "EventLoop_%u", bit );
             PROFILE_SET_THREAD_NAME( threadName.Get() )
         }
         ~TCPConnectionPoolProfileHelper()
@@ -101,7 +107,7 @@
             if ( m_Bit < 63 )
             {
                 // Chose which bitmap to use
-                uint64_t& bitmap = ( m_ThreadType == THREAD_LISTEN ) ? s_IdBitmapListen : s_IdBitmapConnection;
+                uint64_t& bitmap = GetBitmap( m_ThreadType );
 
                 // Clear bit
                 MutexHolder mh( s_Mutex );
@@ -110,16 +116,24 @@
         }
 
     protected:
+        static uint64_t & GetBitmap( ThreadType threadType )
+        {
+            return ( threadType == THREAD_LISTEN ) ? s_IdBitmapListen :
+                   ( threadType == THREAD_CONNECTION ) ? s_IdBitmapConnection : s_IdBitmapEventLoop;
+        }
+
         ThreadType          m_ThreadType;
         uint32_t            m_Bit;
 
         static Mutex        s_Mutex;
         static uint64_t     s_IdBitmapListen;
         static uint64_t     s_IdBitmapConnection;
+        static uint64_t     s_IdBitmapEventLoop;
     };
     /*static*/ Mutex    TCPConnectionPoolProfileHelper::s_Mutex;
     /*static*/ uint64_t TCPConnectionPoolProfileHelper::s_IdBitmapListen        = 0;
     /*static*/ uint64_t TCPConnectionPoolProfileHelper::s_IdBitmapConnection    = 0;
+    /*static*/ uint64_t TCPConnectionPoolProfileHelper::s_IdBitmapEventLoop     = 0;
 
     #define TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( threadType )   \
         TCPConnectionPoolProfileHelper threadNameHelper( threadType );
@@ -136,19 +150,48 @@ ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
 , m_ThreadQuitNotification( false )
 , m_TCPConnectionPool( ownerPool )
 , m_UserData( nullptr )
+, m_BytesSent( 0 )
+, m_SendTime( 0 )
+, m_BytesReceived( 0 )
+, m_ConnectedTime( Timer::GetNow() )
 #ifdef DEBUG
 , m_InUse( false )
 #endif
+#if defined( __LINUX__ )
+, m_ReadSize( 0 )
+, m_ReadSizeBytes( 0 )
+, m_ReadBytes( 0 )
+, m_ReadBuffer( nullptr )
+#endif
 {
     ASSERT( ownerPool );
 }
 
+// GetSendRate
+//------------------------------------------------------------------------------
+float ConnectionInfo::GetSendRate() const
+{
+    const float seconds = (float)m_SendTime * Timer::GetFrequencyInvFloat();
+    return ( seconds > 0.0f ) ? ( (float)m_BytesSent / seconds ) : 0.0f;
+}
+
+// GetReceiveRate
+//------------------------------------------------------------------------------
+float ConnectionInfo::GetReceiveRate() const
+{
+    const float seconds = (float)( Timer::GetNow() - m_ConnectedTime ) * Timer::GetFrequencyInvFloat();
+    return ( seconds > 0.0f ) ? ( (float)m_BytesReceived / seconds ) : 0.0f;
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 TCPConnectionPool::TCPConnectionPool()
     : m_ListenConnection( nullptr )
     , m_Connections( 8, true )
     , m_ShuttingDown( false )
+    #if defined( __LINUX__ )
+        , m_NextEventLoop( 0 )
+    #endif
 {
 }
 
@@ -197,6 +240,76 @@ void TCPConnectionPool::ShutdownAllConnections()
         m_ConnectionsMutex.Lock();
     }
     m_ConnectionsMutex.Unlock();
+
+    #if defined( __LINUX__ )
+        // with all connections closed, the event loops can exit
+        for ( EventLoop * loop : m_EventLoops )
+        {
+            AtomicStoreRelease( &loop->m_Quit, true );
+        }
+        WakeEventLoops();
+        for ( EventLoop * loop : m_EventLoops )
+        {
+            Thread::WaitForThread( loop->m_Thread );
+            Thread::CloseHandle( loop->m_Thread );
+            close( loop->m_EPollFD );
+            close( loop->m_WakeFD );
+            FDELETE loop;
+        }
+        m_EventLoops.Clear();
+    #endif
+}
+
+// UseEventLoop
+//------------------------------------------------------------------------------
+void TCPConnectionPool::UseEventLoop( uint32_t numThreads )
+{
+    #if defined( __LINUX__ )
+        ASSERT( numThreads > 0 );
+        ASSERT( m_EventLoops.IsEmpty() );
+        ASSERT( ( m_ListenConnection == nullptr ) && ( GetNumConnections() == 0 ) );
+
+        m_EventLoops.SetCapacity( numThreads );
+        for ( uint32_t i = 0; i < numThreads; ++i )
+        {
+            EventLoop * loop = FNEW( EventLoop );
+            loop->m_Pool = this;
+            loop->m_Quit = false;
+            loop->m_EPollFD = epoll_create1( EPOLL_CLOEXEC );
+            loop->m_WakeFD = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+            if ( ( loop->m_EPollFD < 0 ) || ( loop->m_WakeFD < 0 ) )
+            {
+                // fall back to fewer event loops (or to a thread per connection if none)
+                TCPDEBUG( "Failed to create event loop. Error: %s\n", LAST_NETWORK_ERROR_STR );
+                if ( loop->m_EPollFD >= 0 )
+                {
+                    close( loop->m_EPollFD );
+                }
+                if ( loop->m_WakeFD >= 0 )
+                {
+                    close( loop->m_WakeFD );
+                }
+                FDELETE loop;
+                break;
+            }
+
+            // the wake event is identified by a null ConnectionInfo
+            struct epoll_event event;
+            memset( &event, 0, sizeof( event ) );
+            event.events = EPOLLIN;
+            event.data.ptr = nullptr;
+            VERIFY( epoll_ctl( loop->m_EPollFD, EPOLL_CTL_ADD, loop->m_WakeFD, &event ) == 0 );
+
+            loop->m_Thread = Thread::CreateThread( &EventLoopThreadWrapperFunction,
+                                                   "TCPEventLoop",
+                                                   ( 64 * KILOBYTE ),
+                                                   loop ); // user data argument
+            ASSERT( loop->m_Thread != INVALID_THREAD_HANDLE );
+            m_EventLoops.Append( loop );
+        }
+    #else
+        (void)numThreads; // Always a thread per connection on other platforms
+    #endif
 }
 
 // GetAddressAsString
@@ -244,8 +357,13 @@ bool TCPConnectionPool::Listen( uint16_t port )
     }
 
     // listen
+    //  - event loops accept connections without delay, so can service a backlog
+    int backlog = 0; // no backlog
+    #if defined( __LINUX__ )
+        backlog = m_EventLoops.IsEmpty() ? 0 : SOMAXCONN;
+    #endif
     TCPDEBUG( "Listen on port %i (%x)\n", port, (uint32_t)sockfd );
-    if ( listen( sockfd, 0 ) == SOCKET_ERROR ) // no backlog
+    if ( listen( sockfd, backlog ) == SOCKET_ERROR )
     {
         TCPDEBUG( "Listen FAILED %i (%x)\n", port, (uint32_t)sockfd );
         CloseSocket( sockfd );
@@ -462,16 +580,12 @@ void TCPConnectionPool::Disconnect( const ConnectionInfo * ci )
     // ensure the connection thread isn't busy destroying itself
     MutexHolder mh( m_ConnectionsMutex );
 
-    if ( ci == m_ListenConnection )
-    {
-        AtomicStoreRelease( &ci->m_ThreadQuitNotification, true );
-        return;
-    }
-
-    ConnectionInfo ** iter = m_Connections.Find( ci );
-    if ( iter != nullptr )
+    if ( ( ci == m_ListenConnection ) || ( m_Connections.Find( ci ) != nullptr ) )
     {
         AtomicStoreRelease( &ci->m_ThreadQuitNotification, true );
+        #if defined( __LINUX__ )
+            WakeEventLoops(); // event loops don't poll for the notification
+        #endif
         return;
     }
 
@@ -516,7 +630,19 @@ bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * da
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * data, size_t size, const void * payloadData, size_t payloadSize, uint32_t timeoutMS )
 {
-    SendBuffer buffers[ 4 ]; // size + data + payloadSize + payloadData
+    SendBuffer payload;
+    payload.size = (uint32_t)payloadSize;
+    payload.data = payloadData;
+
+    return Send( connection, data, size, &payload, 1, timeoutMS );
+}
+
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * data, size_t size, const SendBuffer * payloadBuffers, uint32_t numPayloadBuffers, uint32_t timeoutMS )
+{
+    ASSERT( numPayloadBuffers <= MAX_PAYLOAD_BUFFERS );
+
+    SendBuffer buffers[ 3 + MAX_PAYLOAD_BUFFERS ]; // size + data + payloadSize + payloadData
 
     // size
     uint32_t sizeData = (uint32_t)size;
@@ -527,16 +653,22 @@ bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * da
     buffers[ 1 ].size = (uint32_t)size;
     buffers[ 1 ].data = data;
 
-    // payloadSize
-    uint32_t payloadSizeData = (uint32_t)payloadSize;
+    // payloadSize (of all payload buffers, which are received as one)
+    uint32_t payloadSizeData = 0;
+    for ( uint32_t i = 0; i < numPayloadBuffers; ++i )
+    {
+        payloadSizeData += payloadBuffers[ i ].size;
+    }
     buffers[ 2 ].size = sizeof( payloadSizeData );
     buffers[ 2 ].data = &payloadSizeData;
 
     // payloadData
-    buffers[ 3 ].size = (uint32_t)payloadSize;
-    buffers[ 3 ].data = payloadData;
+    for ( uint32_t i = 0; i < numPayloadBuffers; ++i )
+    {
+        buffers[ 3 + i ] = payloadBuffers[ i ];
+    }
 
-    return SendInternal( connection, buffers, 4, timeoutMS );
+    return SendInternal( connection, buffers, 3 + numPayloadBuffers, timeoutMS );
 }
 
 // SendInternal
@@ -553,11 +685,11 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         return false;
     }
 
-    ASSERT( numBuffers <= 4 ); // Worst case = size + data + payloadSize + payload
+    ASSERT( numBuffers <= ( 3 + MAX_PAYLOAD_BUFFERS ) ); // Worst case = size + data + payloadSize + payload(s)
     #if defined( __WINDOWS__ )
-        WSABUF sendBuffers[ 4 ];
+        WSABUF sendBuffers[ 3 + MAX_PAYLOAD_BUFFERS ];
     #else
-        struct iovec sendBuffers[ 4 ];
+        struct iovec sendBuffers[ 3 + MAX_PAYLOAD_BUFFERS ];
     #endif
 
     // Calculate total to send
@@ -568,6 +700,7 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
     }
 
     Timer timer;
+    const int64_t sendStart = Timer::GetNow();
 
 #ifdef DEBUG
     ASSERT( connection->m_InUse == false );
@@ -645,6 +778,9 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         bytesSent += sent;
     }
 
+    connection->m_BytesSent += bytesSent;
+    connection->m_SendTime += ( Timer::GetNow() - sendStart );
+
     #ifdef DEBUG
         connection->m_InUse = false;
     #endif
@@ -746,6 +882,8 @@ bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
         dest += numBytes;
     }
 
+    ci->m_BytesReceived += ( sizeof( size ) + size );
+
     // tell user the data is in their buffer
     bool keepMemory = false;
     OnReceive( ci, buffer, size, keepMemory );
@@ -900,6 +1038,15 @@ void TCPConnectionPool::CreateListenThread( TCPSocket socket, uint32_t host, uin
     m_ListenConnection->m_RemotePort = port;
     m_ListenConnection->m_ThreadQuitNotification = false;
 
+    #if defined( __LINUX__ )
+        // Accept connections on an event loop?
+        if ( m_EventLoops.IsEmpty() == false )
+        {
+            SetNonBlocking( socket );
+            AddToEventLoop( m_ListenConnection, 0 );
+            return;
+        }
+    #endif
 
     // Spawn thread to handle socket
     Thread::ThreadHandle h = Thread::CreateThread( &ListenThreadWrapperFunction,
@@ -992,6 +1139,16 @@ void TCPConnectionPool::ListenThreadFunction( ConnectionInfo * ci )
         continue; // keep listening for more connections
     }
 
+    CloseListenConnection( ci );
+
+    // thread exit
+    TCPDEBUG( "Listen thread exited\n" );
+}
+
+// CloseListenConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CloseListenConnection( ConnectionInfo * ci )
+{
     // close the socket
     CloseSocket( ci->m_Socket );
     ci->m_Socket = INVALID_SOCKET;
@@ -1006,9 +1163,6 @@ void TCPConnectionPool::ListenThreadFunction( ConnectionInfo * ci )
         FDELETE ci;
         m_ShutdownSemaphore.Signal(); // Wake main thread which may be waiting on shutdown
     }
-
-    // thread exit
-    TCPDEBUG( "Listen thread exited\n" );
 }
 
 // CreateConnectionThread
@@ -1030,6 +1184,18 @@ ConnectionInfo * TCPConnectionPool::CreateConnectionThread( TCPSocket socket, ui
         TCPDEBUG( "Connected to %s : %i (%x)\n", addr.Get(), port, (uint32_t)socket );
     #endif
 
+    #if defined( __LINUX__ )
+        // Handle socket on an event loop?
+        if ( m_EventLoops.IsEmpty() == false )
+        {
+            m_Connections.Append( ci );
+            const uint32_t eventLoopIndex = m_NextEventLoop;
+            m_NextEventLoop = ( ( eventLoopIndex + 1 ) < m_EventLoops.GetSize() ) ? ( eventLoopIndex + 1 ) : 0;
+            AddToEventLoop( ci, eventLoopIndex );
+            return ci;
+        }
+    #endif
+
     // Spawn thread to handle socket
     Thread::ThreadHandle h = Thread::CreateThread( &ConnectionThreadWrapperFunction,
                                             "TCPConnection",
@@ -1114,6 +1280,16 @@ void TCPConnectionPool::ConnectionThreadFunction( ConnectionInfo * ci )
         }
     }
 
+    CloseConnection( ci );
+
+    // thread exit
+    TCPDEBUG( "connection thread exited\n" );
+}
+
+// CloseConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CloseConnection( ConnectionInfo * ci )
+{
     OnDisconnected( ci ); // Do callback
 
     // close the socket
@@ -1135,11 +1311,267 @@ void TCPConnectionPool::ConnectionThreadFunction( ConnectionInfo * ci )
             m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
         }
     }
+}
 
-    // thread exit
-    TCPDEBUG( "connection thread exited\n" );
+#if defined( __LINUX__ )
+// AddToEventLoop
+//------------------------------------------------------------------------------
+void TCPConnectionPool::AddToEventLoop( ConnectionInfo * ci, uint32_t eventLoopIndex )
+{
+    // the event loop thread takes ownership of the socket (and calls
+    // OnConnected for new connections) the next time it wakes
+    EventLoop * loop = m_EventLoops[ eventLoopIndex ];
+    {
+        MutexHolder mh( loop->m_PendingMutex );
+        loop->m_Pending.Append( ci );
+    }
+    const uint64_t value = 1;
+    const ssize_t written = write( loop->m_WakeFD, &value, sizeof( value ) );
+    (void)written; // can only fail if already signalled
+}
+
+// WakeEventLoops
+//------------------------------------------------------------------------------
+void TCPConnectionPool::WakeEventLoops() const
+{
+    for ( const EventLoop * loop : m_EventLoops )
+    {
+        const uint64_t value = 1;
+        const ssize_t written = write( loop->m_WakeFD, &value, sizeof( value ) );
+        (void)written; // can only fail if already signalled
+    }
 }
 
+// EventLoopThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionPool::EventLoopThreadWrapperFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_EVENT_LOOP );
+    PROFILE_FUNCTION
+
+    EventLoop * loop = (EventLoop *)data;
+    loop->m_Pool->EventLoopThreadFunction( loop );
+    return 0;
+}
+
+// EventLoopThreadFunction
+//  - Services many connections (and possibly the listen socket) from one thread
+//------------------------------------------------------------------------------
+void TCPConnectionPool::EventLoopThreadFunction( EventLoop * loop )
+{
+    Array< ConnectionInfo * > connections( 32, true ); // connections serviced by this thread
+    Array< ConnectionInfo * > newConnections( 8, true );
+
+    for ( ;; )
+    {
+        // take ownership of new connections
+        {
+            MutexHolder mh( loop->m_PendingMutex );
+            newConnections.Append( loop->m_Pending );
+            loop->m_Pending.Clear();
+        }
+        for ( ConnectionInfo * ci : newConnections )
+        {
+            ASSERT( ci->m_Socket != INVALID_SOCKET );
+            if ( ci != m_ListenConnection )
+            {
+                OnConnected( ci ); // Do callback
+            }
+
+            struct epoll_event event;
+            memset( &event, 0, sizeof( event ) );
+            event.events = EPOLLIN;
+            event.data.ptr = ci;
+            VERIFY( epoll_ctl( loop->m_EPollFD, EPOLL_CTL_ADD, ci->m_Socket, &event ) == 0 );
+            connections.Append( ci );
+        }
+        newConnections.Clear();
+
+        // close connections which were disconnected or failed
+        for ( size_t i = connections.GetSize(); i > 0; --i )
+        {
+            ConnectionInfo * ci = connections[ i - 1 ];
+            if ( AtomicLoadAcquire( &ci->m_ThreadQuitNotification ) )
+            {
+                EventLoopClose( loop, ci );
+                connections.EraseIndex( i - 1 );
+            }
+        }
+
+        // all connections are closed before we are asked to quit
+        if ( AtomicLoadAcquire( &loop->m_Quit ) )
+        {
+            ASSERT( connections.IsEmpty() );
+            break;
+        }
+
+        // wait for data, or to be woken by another thread
+        struct epoll_event events[ 64 ];
+        const int numEvents = epoll_wait( loop->m_EPollFD, events, 64, -1 );
+        for ( int i = 0; i < numEvents; ++i )
+        {
+            ConnectionInfo * ci = (ConnectionInfo *)events[ i ].data.ptr;
+            if ( ci == nullptr )
+            {
+                // woken - consume the event
+                uint64_t value;
+                const ssize_t numRead = read( loop->m_WakeFD, &value, sizeof( value ) );
+                (void)numRead;
+                continue;
+            }
+
+            if ( AtomicLoadAcquire( &ci->m_ThreadQuitNotification ) )
+            {
+                continue; // don't bother reading any pending data if closing
+            }
+
+            const bool ok = ( ci == m_ListenConnection ) ? EventLoopAccept( ci ) : EventLoopRead( ci );
+            if ( ok == false )
+            {
+                AtomicStoreRelease( &ci->m_ThreadQuitNotification, true ); // closed above
+            }
+        }
+    }
+
+    TCPDEBUG( "Event loop thread exited\n" );
+}
+
+// EventLoopAccept
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::EventLoopAccept( ConnectionInfo * listenConnection )
+{
+    // accept all pending connections
+    for ( ;; )
+    {
+        struct sockaddr_in remoteAddrInfo;
+        int remoteAddrInfoSize = sizeof( remoteAddrInfo );
+        TCPSocket newSocket = Accept( listenConnection->m_Socket, (struct sockaddr *)&remoteAddrInfo, &remoteAddrInfoSize );
+        if ( newSocket == INVALID_SOCKET )
+        {
+            return WouldBlock(); // no more connections, or socket shutdown
+        }
+
+        #ifdef TCPCONNECTION_DEBUG
+            AStackString<32> addr;
+            GetAddressAsString( remoteAddrInfo.sin_addr.s_addr, addr );
+            TCPDEBUG( "Connection accepted from %s : %i (%x)\n", addr.Get(), ntohs( remoteAddrInfo.sin_port ), (uint32_t)newSocket );
+        #endif
+
+        // Configure socket
+        DisableSigPipe( newSocket );        // Prevent socket inheritence by child processes
+        DisableNagle( newSocket );          // Disable Nagle's algorithm
+        SetLargeBufferSizes( newSocket );   // Set send/recv buffer sizes
+        SetNonBlocking( newSocket );        // Set non-blocking
+
+        // keep the new connected socket (handled by one of the event loops)
+        CreateConnectionThread( newSocket,
+                                remoteAddrInfo.sin_addr.s_addr,
+                                ntohs( remoteAddrInfo.sin_port ) );
+    }
+}
+
+// EventLoopRead
+//  - Read whatever data is available, without waiting for complete messages
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::EventLoopRead( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION
+
+    // work out how many bytes there are
+    if ( ci->m_ReadSizeBytes < sizeof( uint32_t ) )
+    {
+        const uint32_t bytesToRead = (uint32_t)sizeof( uint32_t ) - ci->m_ReadSizeBytes;
+        const int numBytes = (int)recv( ci->m_Socket, ( (char *)&ci->m_ReadSize ) + ci->m_ReadSizeBytes, bytesToRead, 0 );
+        if ( numBytes <= 0 )
+        {
+            if ( ( numBytes < 0 ) && WouldBlock() )
+            {
+                return true; // wait for more data
+            }
+            TCPDEBUG( "recv() failed (A). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, numBytes, (uint32_t)( ci->m_Socket ) );
+            return false;
+        }
+        ci->m_ReadSizeBytes += (uint32_t)numBytes;
+        if ( ci->m_ReadSizeBytes < sizeof( uint32_t ) )
+        {
+            return true; // wait for more data
+        }
+
+        TCPDEBUG( "Handle read: %i (%x)\n", ci->m_ReadSize, (uint32_t)( ci->m_Socket ) );
+
+        // get output location
+        ci->m_ReadBuffer = AllocBuffer( ci->m_ReadSize );
+        ASSERT( ci->m_ReadBuffer );
+        ci->m_ReadBytes = 0;
+    }
+
+    // read data into the user supplied buffer
+    if ( ci->m_ReadBytes < ci->m_ReadSize )
+    {
+        char * dest = (char *)ci->m_ReadBuffer + ci->m_ReadBytes;
+        const uint32_t bytesRemaining = ( ci->m_ReadSize - ci->m_ReadBytes );
+        const int numBytes = (int)recv( ci->m_Socket, dest, bytesRemaining, 0 );
+        if ( numBytes <= 0 )
+        {
+            if ( ( numBytes < 0 ) && WouldBlock() )
+            {
+                return true; // wait for more data
+            }
+            TCPDEBUG( "recv() failed (B). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, numBytes, (uint32_t)( ci->m_Socket ) );
+            return false; // buffer is freed when connection is closed
+        }
+        ci->m_ReadBytes += (uint32_t)numBytes;
+        if ( ci->m_ReadBytes < ci->m_ReadSize )
+        {
+            return true; // wait for more data
+        }
+    }
+
+    // message is complete, so prepare for the next one
+    void * buffer = ci->m_ReadBuffer;
+    const uint32_t size = ci->m_ReadSize;
+    ci->m_ReadBuffer = nullptr;
+    ci->m_ReadSize = 0;
+    ci->m_ReadSizeBytes = 0;
+    ci->m_ReadBytes = 0;
+    ci->m_BytesReceived += ( sizeof( size ) + size );
+
+    // tell user the data is in their buffer
+    // (any further messages are handled on subsequent wakes, so other
+    // connections on this event loop are serviced in between)
+    bool keepMemory = false;
+    OnReceive( ci, buffer, size, keepMemory );
+    if ( !keepMemory )
+    {
+        FreeBuffer( buffer );
+    }
+
+    return true;
+}
+
+// EventLoopClose
+//------------------------------------------------------------------------------
+void TCPConnectionPool::EventLoopClose( EventLoop * loop, ConnectionInfo * ci )
+{
+    epoll_ctl( loop->m_EPollFD, EPOLL_CTL_DEL, ci->m_Socket, nullptr );
+
+    if ( ci == m_ListenConnection )
+    {
+        CloseListenConnection( ci );
+        return;
+    }
+
+    // discard partially received message
+    if ( ci->m_ReadBuffer )
+    {
+        FreeBuffer( ci->m_ReadBuffer );
+        ci->m_ReadBuffer = nullptr;
+    }
+
+    CloseConnection( ci );
+}
+#endif
+
 // AllowSocketReuse
 //------------------------------------------------------------------------------
 void TCPConnectionPool::AllowSocketReuse( TCPSocket socket ) const
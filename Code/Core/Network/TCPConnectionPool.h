@@ -38,6 +38,12 @@ public:
     TCPConnectionPool & GetTCPConnectionPool() const { return *m_TCPConnectionPool; }
     inline uint32_t GetRemoteAddress() const { return m_RemoteAddress; }
 
+    // transfer statistics
+    inline uint64_t GetBytesSent() const { return m_BytesSent; }
+    inline uint64_t GetBytesReceived() const { return m_BytesReceived; }
+    float GetSendRate() const;      // bytes/sec while sending
+    float GetReceiveRate() const;   // bytes/sec over the lifetime of the connection
+
 private:
     friend class TCPConnectionPool;
 
@@ -48,9 +54,23 @@ private:
     TCPConnectionPool *     m_TCPConnectionPool; // back pointer to parent pool
     mutable void *          m_UserData;
 
+    // transfer statistics (updated by the thread sending/receiving)
+    mutable uint64_t        m_BytesSent;
+    mutable int64_t         m_SendTime;         // Timer ticks spent in Send
+    uint64_t                m_BytesReceived;
+    int64_t                 m_ConnectedTime;    // Timer::GetNow() when connection was created
+
 #ifdef DEBUG
     mutable bool            m_InUse; // sanity check we aren't sending from multiple threads unsafely
 #endif
+
+#if defined( __LINUX__ )
+    // partially received message (see TCPConnectionPool::UseEventLoop)
+    uint32_t                m_ReadSize;
+    uint32_t                m_ReadSizeBytes;    // bytes of m_ReadSize received so far
+    uint32_t                m_ReadBytes;        // bytes of m_ReadBuffer received so far
+    void *                  m_ReadBuffer;
+#endif
 };
 
 // TCPConnectionPool
@@ -64,6 +84,10 @@ public:
     // Must be called explicitly before destruction
     void ShutdownAllConnections();
 
+    // Service all connections from a small pool of event loop threads instead
+    // of a thread per connection (Linux only). Must be called before Listen/Connect.
+    void UseEventLoop( uint32_t numThreads = 2 );
+
     // manage connections
     bool Listen( uint16_t port );
     void StopListening();
@@ -76,8 +100,16 @@ public:
     size_t GetNumConnections() const;
 
     // transmit data
+    struct SendBuffer
+    {
+        uint32_t        size;
+        const void *    data;
+    };
+    enum : uint32_t { MAX_PAYLOAD_BUFFERS = 16 };
     bool Send( const ConnectionInfo * connection, const void * data, size_t size, uint32_t timeoutMS = 30000 );
     bool Send( const ConnectionInfo * connection, const void * data, size_t size, const void * payloadData, size_t payloadSize, uint32_t timeoutMS = 30000 );
+    // payload is gathered from several buffers, avoiding a copy into one contiguous buffer
+    bool Send( const ConnectionInfo * connection, const void * data, size_t size, const SendBuffer * payloadBuffers, uint32_t numPayloadBuffers, uint32_t timeoutMS = 30000 );
     bool Broadcast( const void * data, size_t size );
 
     static void GetAddressAsString( uint32_t addr, AString & address );
@@ -110,20 +142,38 @@ private:
                         int * addressSize ) const;
     TCPSocket   CreateSocket() const;
 
-    struct SendBuffer
-    {
-        uint32_t        size;
-        const void *    data;
-    };
     bool        SendInternal( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS );
 
     // thread management
     void                CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port );
     static uint32_t     ListenThreadWrapperFunction( void * data );
     void                ListenThreadFunction( ConnectionInfo * ci );
+    void                CloseListenConnection( ConnectionInfo * ci );
     ConnectionInfo *    CreateConnectionThread( TCPSocket socket, uint32_t host, uint16_t port, void * userData = nullptr );
     static uint32_t     ConnectionThreadWrapperFunction( void * data );
     void                ConnectionThreadFunction( ConnectionInfo * ci );
+    void                CloseConnection( ConnectionInfo * ci );
+
+    // epoll based event loops (see UseEventLoop)
+    #if defined( __LINUX__ )
+        struct EventLoop
+        {
+            TCPConnectionPool *         m_Pool;
+            int                         m_EPollFD;
+            int                         m_WakeFD;       // eventfd to interrupt epoll_wait
+            Thread::ThreadHandle        m_Thread;
+            volatile bool               m_Quit;
+            Mutex                       m_PendingMutex;
+            Array< ConnectionInfo * >   m_Pending;      // to be added by the event loop thread
+        };
+        void                AddToEventLoop( ConnectionInfo * ci, uint32_t eventLoopIndex );
+        void                WakeEventLoops() const;
+        static uint32_t     EventLoopThreadWrapperFunction( void * data );
+        void                EventLoopThreadFunction( EventLoop * loop );
+        bool                EventLoopAccept( ConnectionInfo * listenConnection );
+        bool                EventLoopRead( ConnectionInfo * ci );
+        void                EventLoopClose( EventLoop * loop, ConnectionInfo * ci );
+    #endif
 
     // internal helpers
     void                AllowSocketReuse( TCPSocket socket ) const;
@@ -142,6 +192,11 @@ private:
     bool                        m_ShuttingDown;
     Semaphore                   m_ShutdownSemaphore;
 
+    #if defined( __LINUX__ )
+        Array< EventLoop * >        m_EventLoops;
+        uint32_t                    m_NextEventLoop;
+    #endif
+
     // object to manage network subsystem lifetime
 protected:
     NetworkStartupHelper m_EnsureNetworkStarted;
@@ -105,6 +105,25 @@ inline void AtomicStoreRelease( T * volatile * x, T * value )
         #error Unknown compiler
     #endif
 }
+template < class T >
+inline T * AtomicExchange( T * volatile * x, T * value ) // returns previous value
+{
+    #if defined( __WINDOWS__ )
+        return static_cast< T * >( InterlockedExchangePointer( (void * volatile *)x, value ) );
+    #elif defined( __APPLE__ ) || defined( __LINUX__ )
+        return __atomic_exchange_n( x, value, __ATOMIC_SEQ_CST );
+    #endif
+}
+template < class T >
+inline T * AtomicCompareExchange( T * volatile * x, T * value, T * comparand ) // returns previous value
+{
+    #if defined( __WINDOWS__ )
+        return static_cast< T * >( InterlockedCompareExchangePointer( (void * volatile *)x, value, comparand ) );
+    #elif defined( __APPLE__ ) || defined( __LINUX__ )
+        __atomic_compare_exchange_n( x, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+        return comparand; // updated with the previous value on failure
+    #endif
+}
 
 // 32bit
 //------------------------------------------------------------------------------
@@ -172,6 +191,15 @@ inline uint32_t AtomicSubU32( volatile uint32_t * i, int32_t value )
         return __sync_sub_and_fetch( i, value );
     #endif
 }
+inline uint32_t AtomicCompareExchange( volatile uint32_t * x, uint32_t value, uint32_t comparand ) // returns previous value
+{
+    #if defined( __WINDOWS__ )
+        return (uint32_t)InterlockedCompareExchange( reinterpret_cast<volatile long*>( x ), (long)value, (long)comparand );
+    #elif defined( __APPLE__ ) || defined( __LINUX__ )
+        __atomic_compare_exchange_n( x, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+        return comparand; // updated with the previous value on failure
+    #endif
+}
 
 inline int32_t AtomicLoadRelaxed( const volatile int32_t * x )
 {
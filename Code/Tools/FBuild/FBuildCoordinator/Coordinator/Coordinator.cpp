@@ -11,16 +11,28 @@
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerConnectionPool.h"
 
 // Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+#include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#define WORKER_EXPIRY_TIME      ( 60.0f )   // workers report status every 10s; evict after missing several
+#define SNAPSHOT_SAVE_INTERVAL  ( 10.0f )
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-Coordinator::Coordinator( const AString & args )
+Coordinator::Coordinator( const AString & args, const AString & snapshotPath )
     : m_BaseArgs( args )
+    , m_SnapshotPath( snapshotPath )
     , m_ConnectionPool( nullptr )
 {
     m_ConnectionPool = FNEW( WorkerConnectionPool );
+    m_ConnectionPool->UseEventLoop(); // may serve many workers and clients
 }
 
 // DESTRUCTOR
@@ -45,6 +57,23 @@ int32_t Coordinator::Start()
     return Thread::WaitForThread( m_WorkThread );
 }
 
+// ShowStatus
+//------------------------------------------------------------------------------
+/*static*/ bool Coordinator::ShowStatus( const AString & snapshotPath )
+{
+    WorkerConnectionPool pool;
+    if ( LoadSnapshot( pool, snapshotPath ) == false )
+    {
+        OUTPUT( "Failed to load snapshot '%s'\n", snapshotPath.Get() );
+        return false;
+    }
+
+    AString status;
+    pool.GetStatus( status );
+    OUTPUT( "%s", status.Get() );
+    return true;
+}
+
 // WorkThreadWrapper
 //------------------------------------------------------------------------------
 /*static*/ uint32_t Coordinator::WorkThreadWrapper( void * userData )
@@ -67,14 +96,79 @@ uint32_t Coordinator::WorkThread()
         return (uint32_t)-3;
     }
 
+    // restore workers known before a restart, so clients are served immediately
+    if ( LoadSnapshot( *m_ConnectionPool, m_SnapshotPath ) )
+    {
+        AString status;
+        m_ConnectionPool->GetStatus( status );
+        OUTPUT( "Restored from snapshot '%s'\n%s", m_SnapshotPath.Get(), status.Get() );
+    }
+
+    Timer snapshotTimer;
     for(;;)
     {
         PROFILE_SYNCHRONIZE
 
         Thread::Sleep( 500 );
+
+        // drop workers which stopped sending status without disconnecting cleanly
+        m_ConnectionPool->EvictExpiredWorkers( WORKER_EXPIRY_TIME );
+
+        if ( snapshotTimer.GetElapsed() >= SNAPSHOT_SAVE_INTERVAL )
+        {
+            SaveSnapshot();
+            snapshotTimer.Start();
+        }
     }
 
     //return 0;
 }
 
+// LoadSnapshot
+//------------------------------------------------------------------------------
+/*static*/ bool Coordinator::LoadSnapshot( WorkerConnectionPool & pool, const AString & snapshotPath )
+{
+    if ( snapshotPath.IsEmpty() )
+    {
+        return false;
+    }
+
+    FileStream fs;
+    if ( fs.Open( snapshotPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    return pool.LoadWorkers( fs, Time::GetCurrentFileTime() );
+}
+
+// SaveSnapshot
+//------------------------------------------------------------------------------
+void Coordinator::SaveSnapshot() const
+{
+    PROFILE_FUNCTION
+
+    if ( m_SnapshotPath.IsEmpty() )
+    {
+        return;
+    }
+
+    // write to a temp file and rename, so a crash never leaves a partial snapshot
+    AStackString<> tmpPath( m_SnapshotPath );
+    tmpPath += ".tmp";
+    {
+        FileStream fs;
+        if ( fs.Open( tmpPath.Get(), FileStream::WRITE_ONLY ) == false )
+        {
+            OUTPUT( "Failed to write snapshot '%s'\n", tmpPath.Get() );
+            return;
+        }
+        m_ConnectionPool->SaveWorkers( fs, Time::GetCurrentFileTime() );
+    }
+    if ( FileIO::FileMove( tmpPath, m_SnapshotPath ) == false )
+    {
+        OUTPUT( "Failed to write snapshot '%s'\n", m_SnapshotPath.Get() );
+        FileIO::FileDelete( tmpPath.Get() );
+    }
+}
+
 //------------------------------------------------------------------------------
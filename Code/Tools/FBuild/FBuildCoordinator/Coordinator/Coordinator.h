@@ -19,16 +19,23 @@ class Coordinator
 {
 public:
  
-    explicit Coordinator( const AString & args );
+    explicit Coordinator( const AString & args, const AString & snapshotPath );
     ~Coordinator();
 
     int32_t Start();
 
+    // print the workers recorded in a snapshot (-status)
+    static bool ShowStatus( const AString & snapshotPath );
+
 private:
     static uint32_t WorkThreadWrapper( void * userData );
     uint32_t WorkThread();
 
+    static bool LoadSnapshot( WorkerConnectionPool & pool, const AString & snapshotPath );
+    void        SaveSnapshot() const;
+
     AString                 m_BaseArgs;
+    AString                 m_SnapshotPath;
     WorkerConnectionPool    * m_ConnectionPool;
     Thread::ThreadHandle    m_WorkThread;
 };
@@ -15,6 +15,8 @@
 // FBuildCoordinatorOptions (CONSTRUCTOR)
 //------------------------------------------------------------------------------
 FBuildCoordinatorOptions::FBuildCoordinatorOptions()
+    : m_SnapshotPath( "FBuildCoordinator.snapshot" )
+    , m_ShowStatus( false )
 {
 }
 
@@ -26,6 +28,24 @@ bool FBuildCoordinatorOptions::ProcessCommandLine( const AString & commandLine )
     Array< AString > tokens;
     commandLine.Tokenize( tokens );
 
+    // Check each token
+    for ( const AString & token : tokens )
+    {
+        if ( token.BeginsWith( "-snapshot=" ) )
+        {
+            m_SnapshotPath = token.Get() + 10;
+            continue;
+        }
+        else if ( token == "-status" )
+        {
+            m_ShowStatus = true;
+            continue;
+        }
+
+        ShowUsageError();
+        return false;
+    }
+
     return true;
 }
 
@@ -34,7 +54,14 @@ bool FBuildCoordinatorOptions::ProcessCommandLine( const AString & commandLine )
 void FBuildCoordinatorOptions::ShowUsageError()
 {
     OUTPUT( "FBuildCoordinator - " FBUILD_VERSION_STRING " - "
-            "Copyright 2012-2019 Franta Fulin - http://www.fastbuild.org\n" );
+            "Copyright 2012-2019 Franta Fulin - http://www.fastbuild.org\n"
+            "\n"
+            "Command Line Options:\n"
+            "------------------------------------------------------------\n"
+            "-snapshot=<file> : Save the worker registry to <file>, and restore\n"
+            "                   it on startup. Default is FBuildCoordinator.snapshot\n"
+            "-status : Print the worker registry from the snapshot of the running\n"
+            "          coordinator, with the age of each worker, and exit.\n" );
 }
 
 //------------------------------------------------------------------------------
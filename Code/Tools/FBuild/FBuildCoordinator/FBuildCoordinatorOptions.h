@@ -6,10 +6,7 @@
 //------------------------------------------------------------------------------
 // Core
 #include "Core/Env/Types.h"
-
-// Forward Declaration
-//------------------------------------------------------------------------------
-class AString;
+#include "Core/Strings/AString.h"
 
 // FBuildCoordinatorOptions
 //------------------------------------------------------------------------------
@@ -20,6 +17,10 @@ public:
 
     bool ProcessCommandLine( const AString & commandLine );
 
+    // Worker registry
+    AString m_SnapshotPath;     // worker registry is saved here, and restored on startup
+    bool    m_ShowStatus;       // print registry from snapshot and exit
+
 private:
     void ShowUsageError();
 };
@@ -64,6 +64,12 @@ int Main( const AString & args )
         return FBUILD_BAD_ARGS;
     }
 
+    // print the registry saved by a running coordinator, without starting one
+    if ( options.m_ShowStatus )
+    {
+        return Coordinator::ShowStatus( options.m_SnapshotPath ) ? FBUILD_OK : FBUILD_BAD_ARGS;
+    }
+
     // only allow 1 worker per system
     Timer t;
     while ( g_OneProcessMutex.TryLock() == false )
@@ -77,7 +83,7 @@ int Main( const AString & args )
         Thread::Sleep(100);
     }
 
-    Coordinator coordinator( args );
+    Coordinator coordinator( args, options.m_SnapshotPath );
 
     return coordinator.Start();
 }
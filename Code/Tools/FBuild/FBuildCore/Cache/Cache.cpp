@@ -12,7 +12,9 @@
 #include "Core/Containers/AutoPtr.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
@@ -20,6 +22,9 @@
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
+// system
+#include <memory.h> // for memset
+
 // CacheStats
 //------------------------------------------------------------------------------
 class CacheStats
@@ -29,15 +34,50 @@ public:
     uint64_t    m_NumBytes = 0;
 };
 
-// OldestFileTimeSorter
+// Defines
+//------------------------------------------------------------------------------
+#if defined( __WINDOWS__ )
+    #define ONE_HOUR ( 60 * 60 * (uint64_t)10000000 )
+#else
+    #define ONE_HOUR ( 60 * 60 * (uint64_t)1000000000 )
+#endif
+#define MAX_TRIM_AGE_HOURS ( 24 * 365 ) // older entries are trimmed together
+
+// CacheProgress
 //------------------------------------------------------------------------------
-class OldestFileTimeSorter
+class CacheProgress
 {
 public:
-    bool operator () ( const FileIO::FileInfo & a, const FileIO::FileInfo & b ) const
+    explicit CacheProgress( bool showProgress )
+        : m_ShowProgress( showProgress )
+    {
+        if ( m_ShowProgress )
+        {
+            FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
+        }
+    }
+    ~CacheProgress()
+    {
+        if ( m_ShowProgress )
+        {
+            FLog::ClearProgress();
+        }
+    }
+
+    void Update( float perc )
     {
-        return ( a.m_LastWriteTime < b.m_LastWriteTime );
+        // Throttled to avoid perf impact
+        if ( m_ShowProgress && ( ( m_Timer.GetElapsed() - m_LastProgressTime ) > 0.5f ) )
+        {
+            FLog::OutputProgress( m_Timer.GetElapsed(), perc, 0, 0, 0, 0 );
+            m_LastProgressTime = m_Timer.GetElapsed();
+        }
     }
+
+private:
+    bool    m_ShowProgress;
+    Timer   m_Timer;
+    float   m_LastProgressTime = 0.0f;
 };
 
 // CONSTRUCTOR
@@ -73,6 +113,7 @@ public:
 
     if ( FileIO::EnsurePathExists( m_CachePath ) )
     {
+        m_Index.Init( m_CachePath );
         return true;
     }
 
@@ -84,7 +125,7 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::Shutdown()
 {
-    // Nothing to do
+    m_Index.Flush();
 }
 
 // Publish
@@ -135,6 +176,7 @@ public:
         }
     }
 
+    m_Index.OnPublish( cacheId, dataSize );
     return true;
 }
 
@@ -157,6 +199,7 @@ public:
         {
             dataSize = cacheFileSize;
             data = mem.Release();
+            m_Index.OnAccess( cacheId );
             return true;
         }
     }
@@ -164,6 +207,47 @@ public:
     return false;
 }
 
+// Exists
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::Exists( const AString & cacheId )
+{
+    AStackString<> fullPath;
+    GetFullPathForCacheEntry( cacheId, fullPath );
+    return FileIO::FileExists( fullPath.Get() );
+}
+
+// RetrieveMapped
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::RetrieveMapped( const AString & cacheId, const void * & data, size_t & dataSize, bool & outIsMapped )
+{
+    // Reading a view of a file on a network share faults (SIGBUS or EXCEPTION_IN_PAGE_ERROR)
+    // instead of failing if the share drops, so those entries are copied into memory
+    if ( m_IsLocal == false )
+    {
+        return ICache::RetrieveMapped( cacheId, data, dataSize, outIsMapped );
+    }
+
+    AStackString<> fullPath;
+    GetFullPathForCacheEntry( cacheId, fullPath );
+
+    // Entries are replaced by renaming over them, so the view stays valid (on Windows
+    // the rename fails instead, which is treated as a failure to publish)
+    MemoryMappedFile mappedFile;
+    if ( mappedFile.Open( fullPath.Get() ) )
+    {
+        data = mappedFile.Release( dataSize );
+        outIsMapped = true;
+        m_Index.OnAccess( cacheId );
+        return true;
+    }
+
+    // Missing (or empty, which is never valid)
+    data = nullptr;
+    dataSize = 0;
+    outIsMapped = false;
+    return false;
+}
+
 // FreeMemory
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::FreeMemory( void * data, size_t UNUSED( dataSize ) )
@@ -179,36 +263,28 @@ public:
     const uint32_t NUM_DAYS( 30 );
     CacheStats perDay[ NUM_DAYS ];
 
-    // Get all the files
-    Array< FileIO::FileInfo > allFiles( 1000000 );
-    uint64_t totalSize = 0;
-    GetCacheFiles( showProgress, allFiles, totalSize );
-
-    // Assign files into buckets
+    // Assign entries into buckets, a shard at a time
+    CacheStats total;
     const uint64_t currentTime = Time::GetCurrentFileTime(); // Compare filetimes to now
-    for ( const FileIO::FileInfo & info : allFiles )
     {
-        // Determine age bucket
-        const uint64_t age = currentTime - info.m_LastWriteTime;
-        #if defined( __WINDOWS__ )
-            const uint64_t oneDay = ( 24 * 60 * 60 * (uint64_t)10000000 );
-        #else
-            const uint64_t oneDay = ( 24 * 60 * 60 * (uint64_t)1000000000 );
-        #endif
-        uint32_t ageInDays = (uint32_t)( age / oneDay );
-        if ( ageInDays >= 30 )
+        CacheProgress progress( showProgress );
+        Array< CacheIndex::Entry > entries( 4096, true );
+        for ( uint32_t shard = 0; shard < CacheIndex::NUM_SHARDS; ++shard )
         {
-            ageInDays = 29;
+            m_Index.LoadShard( shard, entries );
+            for ( const CacheIndex::Entry & entry : entries )
+            {
+                // Determine age bucket
+                const uint32_t ageInDays = Math::Min( GetAgeInHours( currentTime, entry.m_LastAccessTime ) / 24, NUM_DAYS - 1 );
+                perDay[ ageInDays ].m_NumFiles++;
+                perDay[ ageInDays ].m_NumBytes += entry.m_Size;
+                total.m_NumFiles++;
+                total.m_NumBytes += entry.m_Size;
+            }
+            progress.Update( ( (float)( shard + 1 ) / (float)CacheIndex::NUM_SHARDS ) * 100.0f );
         }
-        perDay[ ageInDays ].m_NumFiles++;
-        perDay[ ageInDays ].m_NumBytes += info.m_Size;
     }
 
-    // Totals
-    CacheStats total;
-    total.m_NumBytes = totalSize;
-    total.m_NumFiles = (uint32_t)allFiles.GetSize();
-
     // Generate cache info string
     OUTPUT( "================================================================================\n" );
     OUTPUT( " Age (Days) | Files    | Size (MiB) | %%\n" );
@@ -239,125 +315,117 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Trim( bool showProgress, uint32_t sizeMiB )
 {
-    // Get all the files
-    Array< FileIO::FileInfo > allFiles( 1000000 );
-    uint64_t totalSize = 0;
-    GetCacheFiles( showProgress, allFiles, totalSize );
-    OUTPUT( " - Before: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
+    CacheStats before;
+    CacheStats after;
+    DoTrim( showProgress, ( (uint64_t)sizeMiB * MEGABYTE ), before, after );
+
+    OUTPUT( " - Before: %u Files @ %u MiB\n", before.m_NumFiles, (uint32_t)( before.m_NumBytes / MEGABYTE ) );
+    OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
+    OUTPUT( " - After: %u Files @ %u MiB\n", after.m_NumFiles, (uint32_t)( after.m_NumBytes / MEGABYTE ) );
+    return true;
+}
+
+// TrimToSize
+//------------------------------------------------------------------------------
+void Cache::TrimToSize( uint64_t maxBytes )
+{
+    CacheStats before;
+    CacheStats after;
+    DoTrim( false, maxBytes, before, after );
+}
+
+// DoTrim
+//------------------------------------------------------------------------------
+void Cache::DoTrim( bool showProgress, uint64_t maxBytes, CacheStats & outBefore, CacheStats & outAfter )
+{
+    PROFILE_FUNCTION
+
+    // Include everything recorded by this process
+    m_Index.Flush();
 
-    // Sort by age
-    OldestFileTimeSorter sorter;
-    allFiles.Sort( sorter );
+    // Histogram of entries by hours since last use, so the cutoff for the oldest
+    // entries can be found without holding (or sorting) every entry in memory
+    const uint64_t currentTime = Time::GetCurrentFileTime();
+    Array< uint64_t > bytesPerHour( MAX_TRIM_AGE_HOURS + 1, false );
+    bytesPerHour.SetSize( MAX_TRIM_AGE_HOURS + 1 );
+    memset( bytesPerHour.Begin(), 0, bytesPerHour.GetSize() * sizeof( uint64_t ) );
+    CacheStats total;
+    Array< CacheIndex::Entry > entries( 4096, true );
+    {
+        CacheProgress progress( showProgress );
+        for ( uint32_t shard = 0; shard < CacheIndex::NUM_SHARDS; ++shard )
+        {
+            m_Index.LoadShard( shard, entries );
+            for ( const CacheIndex::Entry & entry : entries )
+            {
+                bytesPerHour[ GetAgeInHours( currentTime, entry.m_LastAccessTime ) ] += entry.m_Size;
+                total.m_NumFiles++;
+                total.m_NumBytes += entry.m_Size;
+            }
+            progress.Update( ( (float)( shard + 1 ) / (float)CacheIndex::NUM_SHARDS ) * 100.0f );
+        }
+    }
+    outBefore = total;
 
     // Do we need to delete anything?
-    OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
-    const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
-    uint32_t numDeleted = 0;
-    if ( limit < totalSize )
+    const uint64_t limit = maxBytes;
+    if ( limit < total.m_NumBytes )
     {
-        Timer timer;
-        float lastProgressTime = 0.0f;
-        if ( showProgress )
+        // Everything older than the cutoff goes, and as much of the cutoff hour as needed
+        const uint64_t toDeleteBytes = ( total.m_NumBytes - limit );
+        uint32_t cutoffHour = MAX_TRIM_AGE_HOURS;
+        uint64_t olderBytes = 0;
+        while ( ( olderBytes + bytesPerHour[ cutoffHour ] ) < toDeleteBytes )
         {
-            FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
+            olderBytes += bytesPerHour[ cutoffHour ];
+            --cutoffHour; // can't go past 0 as all hours sum to more than toDeleteBytes
         }
-        const uint64_t originalTotalSize = totalSize;
+        uint64_t cutoffBytesToDelete = ( toDeleteBytes - olderBytes );
 
-        // Iterate over files, deleting oldest first
-        for ( const FileIO::FileInfo & info : allFiles )
+        CacheProgress progress( showProgress );
+        for ( uint32_t shard = 0; shard < CacheIndex::NUM_SHARDS; ++shard )
         {
-            // Try to delete (ok to fail if file is in use)
-            if ( FileIO::FileDelete( info.m_Name.Get() ) )
+            m_Index.LoadShard( shard, entries );
+            for ( const CacheIndex::Entry & entry : entries )
             {
-                totalSize -= info.m_Size;
-                ++numDeleted;
-
-                // Are we under the limit now?
-                if ( totalSize <= limit )
+                const uint32_t ageInHours = GetAgeInHours( currentTime, entry.m_LastAccessTime );
+                if ( ageInHours < cutoffHour )
                 {
-                    break;
+                    continue;
                 }
-
-                // Progress
-                if ( showProgress )
+                if ( ageInHours == cutoffHour )
                 {
-                    // Throttled to avoid perf impact
-                    if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
+                    if ( cutoffBytesToDelete == 0 )
                     {
-                        const uint64_t toDeleteBytes = originalTotalSize - limit;
-                        const uint64_t deletedBytes = originalTotalSize - totalSize;
-                        const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
-                        FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
-                        lastProgressTime = timer.GetElapsed();
+                        continue;
                     }
+                    cutoffBytesToDelete -= Math::Min( cutoffBytesToDelete, entry.m_Size );
                 }
-            }
-        }
 
-        if ( showProgress )
-        {
-            FLog::ClearProgress();
-        }
-    }
-
-    OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize() - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
-    return true;
-}
-
-// GetCacheFiles
-//------------------------------------------------------------------------------
-void Cache::GetCacheFiles( bool showProgress,
-                           Array< FileIO::FileInfo > & outInfo,
-                           uint64_t & outTotalSize ) const
-{
-    // Throttle progress messages to avoid impacting performance significantly
-    // (network cache is usually the bottleneck, but a local caches is not)
-    Timer timer;
-    float lastProgressTime = 0.0f;
-    if ( showProgress )
-    {
-        FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
-    }
-
-    // Scan the matrix of directories
-    for ( size_t i=0; i<256; ++i )
-    {
-        for ( size_t j=0; j<256; ++j )
-        {
-            // Get Files
-            AStackString<> path;
-            path.Format( "%s%02x%c%02x%c", m_CachePath.Get(),
-                                               (uint32_t)i,
-                                               NATIVE_SLASH,
-                                               (uint32_t)j,
-                                               NATIVE_SLASH);
-            FileIO::GetFilesEx( path, nullptr, false, &outInfo );
-
-            // Progress
-            if ( showProgress )
-            {
-                // Throttled to avoid perf impact
-                if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
+                // Try to delete (ok to fail if file is in use)
+                AStackString<> fullPath;
+                GetFullPathForCacheEntry( entry.m_CacheId, fullPath );
+                if ( FileIO::FileDelete( fullPath.Get() ) || ( FileIO::FileExists( fullPath.Get() ) == false ) )
                 {
-                    const float perc = ( (float)( ( i*256 ) + j ) / (float)( 256 * 256 ) ) * 100.0f;
-                    FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
-                    lastProgressTime = timer.GetElapsed();
+                    m_Index.OnRemove( entry.m_CacheId );
+                    total.m_NumFiles--;
+                    total.m_NumBytes -= entry.m_Size;
                 }
             }
+            progress.Update( ( (float)( shard + 1 ) / (float)CacheIndex::NUM_SHARDS ) * 100.0f );
         }
+        m_Index.Flush();
     }
 
-    // Calculate totals
-    outTotalSize = 0;
-    for ( const FileIO::FileInfo & info : outInfo )
-    {
-        outTotalSize += info.m_Size;
-    }
+    outAfter = total;
+}
 
-    if ( showProgress )
-    {
-        FLog::ClearProgress();
-    }
+// GetAgeInHours
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Cache::GetAgeInHours( uint64_t currentTime, uint64_t fileTime )
+{
+    const uint64_t age = ( currentTime > fileTime ) ? ( currentTime - fileTime ) : 0;
+    return (uint32_t)Math::Min< uint64_t >( age / ONE_HOUR, MAX_TRIM_AGE_HOURS );
 }
 
 // GetFullPathForCacheEntry
@@ -5,9 +5,13 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "ICache.h"
-#include "Core/FileIO/FileIO.h"
+#include "CacheIndex.h"
 #include "Core/Strings/AString.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CacheStats;
+
 // Cache
 //------------------------------------------------------------------------------
 class Cache : public ICache
@@ -23,11 +27,22 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool Exists( const AString & cacheId ) override;
+    virtual bool RetrieveMapped( const AString & cacheId, const void * & data, size_t & dataSize, bool & outIsMapped ) override;
+
+    // Trim without output (to bound the size of a local cache)
+    void TrimToSize( uint64_t maxBytes );
+
+    // Entries are only read in place (see RetrieveMapped) from a cache on a local disk
+    inline void SetIsLocal( bool isLocal ) { m_IsLocal = isLocal; }
 private:
-    void GetCacheFiles( bool showProgress, Array< FileIO::FileInfo > & outInfo, uint64_t & outTotalSize ) const;
+    void DoTrim( bool showProgress, uint64_t maxBytes, CacheStats & outBefore, CacheStats & outAfter );
     void GetFullPathForCacheEntry( const AString & cacheId, AString & outFullPath ) const;
+    static uint32_t GetAgeInHours( uint64_t currentTime, uint64_t fileTime );
 
-    AString m_CachePath;
+    AString     m_CachePath;
+    CacheIndex  m_Index;
+    bool        m_IsLocal = false;
 };
 
 //------------------------------------------------------------------------------
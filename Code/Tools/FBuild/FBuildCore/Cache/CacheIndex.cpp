@@ -0,0 +1,481 @@
+// CacheIndex - Index of the entries in a local/network directory Cache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheIndex.h"
+
+// Core
+#include "Core/Containers/AutoPtr.h"
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+
+// system
+#include <memory.h> // for memcpy, memset
+
+// Defines
+//------------------------------------------------------------------------------
+#define INDEX_VERSION           ( 1 )
+#define MAX_PENDING_RECORDS     ( 256 )     // append to the journals once this many records are buffered
+#define MIN_COMPACTION_RECORDS  ( 1024 )    // don't rewrite small journals just to remove a few records
+
+enum : uint8_t
+{
+    RECORD_HEADER   = 1,    // first record of a complete journal
+    RECORD_PUBLISH  = 2,
+    RECORD_ACCESS   = 3,
+    RECORD_REMOVE   = 4,
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheIndex::CacheIndex()
+    : m_Pending( 0, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheIndex::~CacheIndex()
+{
+    ASSERT( m_Pending.IsEmpty() ); // should have been flushed
+}
+
+// Init
+//------------------------------------------------------------------------------
+void CacheIndex::Init( const AString & cachePath )
+{
+    m_CachePath = cachePath;
+}
+
+// OnPublish
+//------------------------------------------------------------------------------
+void CacheIndex::OnPublish( const AString & cacheId, uint64_t size )
+{
+    AddRecord( RECORD_PUBLISH, cacheId, size );
+}
+
+// OnAccess
+//------------------------------------------------------------------------------
+void CacheIndex::OnAccess( const AString & cacheId )
+{
+    AddRecord( RECORD_ACCESS, cacheId, 0 );
+}
+
+// OnRemove
+//------------------------------------------------------------------------------
+void CacheIndex::OnRemove( const AString & cacheId )
+{
+    AddRecord( RECORD_REMOVE, cacheId, 0 );
+}
+
+// Flush
+//------------------------------------------------------------------------------
+void CacheIndex::Flush()
+{
+    Array< Record > records( 0, true );
+    {
+        MutexHolder mh( m_PendingMutex );
+        records.Swap( m_Pending );
+    }
+    AppendRecords( records );
+}
+
+// LoadShard
+//------------------------------------------------------------------------------
+void CacheIndex::LoadShard( uint32_t shard, Array< Entry > & outEntries )
+{
+    PROFILE_FUNCTION
+
+    ASSERT( shard < NUM_SHARDS );
+    outEntries.Clear();
+
+    // A journal without a header was started by appending before the shard was
+    // indexed (or predates it), so the directories are the starting point. So are
+    // the directories of a shard changed since the journal was written, as entries
+    // can be published and trimmed by versions which don't use the index.
+    Array< Record > records( 0, true );
+    bool hasHeader = false;
+    ReadJournal( shard, records, hasHeader );
+    const bool rebuild = ( hasHeader == false ) || IsJournalStale( shard );
+    if ( rebuild )
+    {
+        ScanShard( shard, outEntries );
+    }
+
+    // table of entries by hash of their id
+    size_t tableSize = 1024;
+    while ( tableSize < ( ( outEntries.GetSize() + records.GetSize() ) * 2 ) )
+    {
+        tableSize *= 2;
+    }
+    Array< uint32_t > table( tableSize, false );
+    table.SetSize( tableSize );
+    memset( table.Begin(), 0xFF, tableSize * sizeof( uint32_t ) ); // 0xFFFFFFFF = unused
+    Array< bool > removed( outEntries.GetSize() + records.GetSize(), false );
+    removed.SetSize( outEntries.GetSize() );
+    memset( removed.Begin(), 0, removed.GetSize() * sizeof( bool ) );
+
+    for ( size_t i = 0; i < outEntries.GetSize(); ++i )
+    {
+        size_t slot = (size_t)xxHash::Calc64( outEntries[ i ].m_CacheId ) & ( tableSize - 1 );
+        while ( table[ slot ] != 0xFFFFFFFF )
+        {
+            slot = ( slot + 1 ) & ( tableSize - 1 );
+        }
+        table[ slot ] = (uint32_t)i;
+    }
+
+    // replay the journal
+    for ( const Record & record : records )
+    {
+        if ( record.m_Type == RECORD_HEADER )
+        {
+            continue;
+        }
+
+        const size_t idLength = AString::StrLen( record.m_CacheId );
+        size_t slot = (size_t)xxHash::Calc64( record.m_CacheId, idLength ) & ( tableSize - 1 );
+        while ( ( table[ slot ] != 0xFFFFFFFF ) && ( outEntries[ table[ slot ] ].m_CacheId != record.m_CacheId ) )
+        {
+            slot = ( slot + 1 ) & ( tableSize - 1 );
+        }
+
+        if ( table[ slot ] == 0xFFFFFFFF )
+        {
+            // only a publish tells us enough to add an entry, and when rebuilding
+            // the directories are authoritative (it may have been trimmed since)
+            if ( rebuild || ( record.m_Type != RECORD_PUBLISH ) )
+            {
+                continue;
+            }
+            table[ slot ] = (uint32_t)outEntries.GetSize();
+            Entry entry;
+            entry.m_CacheId = record.m_CacheId;
+            entry.m_Size = record.m_Size;
+            entry.m_LastAccessTime = record.m_Time;
+            outEntries.Append( entry );
+            removed.Append( false );
+            continue;
+        }
+
+        const uint32_t index = table[ slot ];
+        Entry & entry = outEntries[ index ];
+        switch ( record.m_Type )
+        {
+            case RECORD_PUBLISH:
+            {
+                entry.m_Size = record.m_Size;
+                entry.m_LastAccessTime = Math::Max( entry.m_LastAccessTime, record.m_Time );
+                removed[ index ] = false;
+                break;
+            }
+            case RECORD_ACCESS:
+            {
+                entry.m_LastAccessTime = Math::Max( entry.m_LastAccessTime, record.m_Time );
+                break;
+            }
+            case RECORD_REMOVE:
+            {
+                // when rebuilding the entry exists (it may have been published again since)
+                removed[ index ] = ( rebuild == false );
+                break;
+            }
+            default: ASSERT( false ); break; // IsValidRecord should have rejected this
+        }
+    }
+
+    // keep only the live entries
+    size_t numLive = 0;
+    for ( size_t i = 0; i < outEntries.GetSize(); ++i )
+    {
+        if ( removed[ i ] == false )
+        {
+            if ( numLive != i )
+            {
+                outEntries[ numLive ] = Move( outEntries[ i ] );
+            }
+            ++numLive;
+        }
+    }
+    outEntries.SetSize( numLive );
+
+    // write a complete journal if rebuilt, or if it's mostly superseded records
+    if ( rebuild || ( records.GetSize() > ( ( numLive * 2 ) + MIN_COMPACTION_RECORDS ) ) )
+    {
+        WriteJournal( shard, outEntries );
+    }
+}
+
+// InitRecord
+//------------------------------------------------------------------------------
+/*static*/ void CacheIndex::InitRecord( Record & record, uint8_t type, const char * cacheId, uint64_t size, uint64_t time )
+{
+    memset( &record, 0, sizeof( Record ) );
+    record.m_Type = type;
+    record.m_Size = size;
+    record.m_Time = time;
+    const size_t idLength = AString::StrLen( cacheId );
+    ASSERT( idLength < sizeof( record.m_CacheId ) );
+    memcpy( record.m_CacheId, cacheId, idLength );
+    record.m_Checksum = xxHash::Calc64( &record, sizeof( Record ) - sizeof( uint64_t ) );
+}
+
+// IsValidRecord
+//------------------------------------------------------------------------------
+/*static*/ bool CacheIndex::IsValidRecord( const Record & record )
+{
+    return ( record.m_Type >= RECORD_HEADER ) &&
+           ( record.m_Type <= RECORD_REMOVE ) &&
+           ( record.m_CacheId[ sizeof( record.m_CacheId ) - 1 ] == 0 ) &&
+           ( record.m_Checksum == xxHash::Calc64( &record, sizeof( Record ) - sizeof( uint64_t ) ) );
+}
+
+// GetShard
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CacheIndex::GetShard( const char * cacheId )
+{
+    // first two hex digits, as used for the top level directories
+    uint32_t shard = 0;
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        const char c = cacheId[ i ];
+        const uint32_t digit = ( ( c >= '0' ) && ( c <= '9' ) ) ? (uint32_t)( c - '0' ) :
+                               ( ( c >= 'A' ) && ( c <= 'F' ) ) ? (uint32_t)( c - 'A' + 10 ) :
+                               ( ( c >= 'a' ) && ( c <= 'f' ) ) ? (uint32_t)( c - 'a' + 10 ) : 0;
+        shard = ( shard * 16 ) + digit;
+    }
+    return shard;
+}
+
+// AddRecord
+//------------------------------------------------------------------------------
+void CacheIndex::AddRecord( uint8_t type, const AString & cacheId, uint64_t size )
+{
+    if ( ( cacheId.GetLength() < 2 ) || ( cacheId.GetLength() >= sizeof( Record::m_CacheId ) ) )
+    {
+        ASSERT( false ); // unexpected cache id format
+        return;
+    }
+
+    Record record;
+    InitRecord( record, type, cacheId.Get(), size, Time::GetCurrentFileTime() );
+
+    Array< Record > records( 0, true );
+    {
+        MutexHolder mh( m_PendingMutex );
+        m_Pending.Append( record );
+        if ( m_Pending.GetSize() < MAX_PENDING_RECORDS )
+        {
+            return;
+        }
+        records.Swap( m_Pending );
+    }
+    AppendRecords( records );
+}
+
+// AppendRecords
+//------------------------------------------------------------------------------
+void CacheIndex::AppendRecords( const Array< Record > & records ) const
+{
+    if ( records.IsEmpty() )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION
+
+    // append the records for each shard in a single write
+    const size_t numRecords = records.GetSize();
+    Array< bool > written( numRecords, false );
+    written.SetSize( numRecords );
+    memset( written.Begin(), 0, numRecords * sizeof( bool ) );
+    MemoryStream ms( MAX_PENDING_RECORDS * sizeof( Record ) );
+    for ( size_t i = 0; i < numRecords; ++i )
+    {
+        if ( written[ i ] )
+        {
+            continue;
+        }
+        const uint32_t shard = GetShard( records[ i ].m_CacheId );
+        ms.Reset();
+        for ( size_t j = i; j < numRecords; ++j )
+        {
+            if ( ( written[ j ] == false ) && ( GetShard( records[ j ].m_CacheId ) == shard ) )
+            {
+                ms.WriteBuffer( &records[ j ], sizeof( Record ) );
+                written[ j ] = true;
+            }
+        }
+
+        // failures are ok - the entries will just be found when the shard is next rebuilt
+        AStackString<> journalPath;
+        GetJournalPath( shard, journalPath );
+        FileStream f;
+        if ( FileIO::EnsurePathExistsForFile( journalPath ) &&
+             f.Open( journalPath.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) )
+        {
+            f.WriteBuffer( ms.GetData(), ms.GetSize() );
+        }
+    }
+}
+
+// ReadJournal
+//------------------------------------------------------------------------------
+bool CacheIndex::ReadJournal( uint32_t shard, Array< Record > & outRecords, bool & outHasHeader ) const
+{
+    outHasHeader = false;
+
+    AStackString<> journalPath;
+    GetJournalPath( shard, journalPath );
+    FileStream f;
+    if ( f.Open( journalPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    const size_t size = (size_t)f.GetFileSize();
+    AutoPtr< char > buffer( (char *)ALLOC( size ) );
+    if ( f.ReadBuffer( buffer.Get(), size ) != size )
+    {
+        return false;
+    }
+
+    // skip over torn records, resynchronizing with the next valid one
+    outRecords.SetCapacity( size / sizeof( Record ) );
+    const char * pos = buffer.Get();
+    const char * const end = ( buffer.Get() + size );
+    while ( (size_t)( end - pos ) >= sizeof( Record ) )
+    {
+        Record record;
+        memcpy( &record, pos, sizeof( Record ) );
+        if ( IsValidRecord( record ) == false )
+        {
+            ++pos;
+            continue;
+        }
+        if ( ( pos == buffer.Get() ) && ( record.m_Type == RECORD_HEADER ) && ( record.m_Size == INDEX_VERSION ) )
+        {
+            outHasHeader = true;
+        }
+        outRecords.Append( record );
+        pos += sizeof( Record );
+    }
+    return true;
+}
+
+// IsJournalStale
+//------------------------------------------------------------------------------
+bool CacheIndex::IsJournalStale( uint32_t shard ) const
+{
+    PROFILE_FUNCTION
+
+    // Publishing and trimming update the time of the directory holding the entry,
+    // and anything recorded by the index is appended to the journal afterwards
+    AStackString<> journalPath;
+    GetJournalPath( shard, journalPath );
+    const uint64_t journalTime = FileIO::GetFileLastWriteTime( journalPath );
+    for ( uint32_t i = 0; i < 256; ++i )
+    {
+        AStackString<> path;
+        path.Format( "%s%02X%c%02X", m_CachePath.Get(), shard, NATIVE_SLASH, i );
+        if ( FileIO::GetFileLastWriteTime( path ) > journalTime )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ScanShard
+//------------------------------------------------------------------------------
+void CacheIndex::ScanShard( uint32_t shard, Array< Entry > & outEntries ) const
+{
+    PROFILE_FUNCTION
+
+    Array< FileIO::FileInfo > files( 1024, true );
+    for ( uint32_t i = 0; i < 256; ++i )
+    {
+        AStackString<> path;
+        path.Format( "%s%02X%c%02X%c", m_CachePath.Get(), shard, NATIVE_SLASH, i, NATIVE_SLASH );
+        files.Clear();
+        FileIO::GetFilesEx( path, nullptr, false, &files );
+        for ( const FileIO::FileInfo & info : files )
+        {
+            if ( info.m_Name.EndsWithI( ".tmp" ) )
+            {
+                continue; // being published
+            }
+            const char * slash = info.m_Name.FindLast( NATIVE_SLASH );
+            Entry entry;
+            entry.m_CacheId = ( slash ? ( slash + 1 ) : info.m_Name.Get() );
+            entry.m_Size = info.m_Size;
+            entry.m_LastAccessTime = info.m_LastWriteTime;
+            if ( entry.m_CacheId.GetLength() < sizeof( Record::m_CacheId ) )
+            {
+                outEntries.Append( entry );
+            }
+        }
+    }
+}
+
+// WriteJournal
+//------------------------------------------------------------------------------
+bool CacheIndex::WriteJournal( uint32_t shard, const Array< Entry > & entries ) const
+{
+    PROFILE_FUNCTION
+
+    const uint64_t now = Time::GetCurrentFileTime();
+    MemoryStream ms( ( entries.GetSize() + 1 ) * sizeof( Record ) );
+    Record record;
+    InitRecord( record, RECORD_HEADER, "", INDEX_VERSION, now );
+    ms.WriteBuffer( &record, sizeof( Record ) );
+    for ( const Entry & entry : entries )
+    {
+        InitRecord( record, RECORD_PUBLISH, entry.m_CacheId.Get(), entry.m_Size, entry.m_LastAccessTime );
+        ms.WriteBuffer( &record, sizeof( Record ) );
+    }
+
+    // replace the journal
+    // (records appended by other processes while this was being done are lost, but
+    // their entries will be found again when the shard is next rebuilt)
+    AStackString<> journalPath;
+    GetJournalPath( shard, journalPath );
+    AStackString<> tmpPath( journalPath );
+    tmpPath += ".tmp";
+    {
+        FileStream f;
+        if ( ( FileIO::EnsurePathExistsForFile( tmpPath ) == false ) ||
+             ( f.Open( tmpPath.Get(), FileStream::WRITE_ONLY ) == false ) ||
+             ( f.WriteBuffer( ms.GetData(), ms.GetSize() ) != ms.GetSize() ) )
+        {
+            f.Close();
+            FileIO::FileDelete( tmpPath.Get() );
+            return false;
+        }
+    }
+    if ( FileIO::FileMove( tmpPath, journalPath ) == false )
+    {
+        FileIO::FileDelete( tmpPath.Get() );
+        return false;
+    }
+    return true;
+}
+
+// GetJournalPath
+//------------------------------------------------------------------------------
+void CacheIndex::GetJournalPath( uint32_t shard, AString & outPath ) const
+{
+    // format example: N:\\fbuild.cache\\index\\AA.fbi
+    outPath.Format( "%sindex%c%02X.fbi", m_CachePath.Get(), NATIVE_SLASH, shard );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,79 @@
+// CacheIndex - Index of the entries in a local/network directory Cache
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// CacheIndex
+//  - An append-only journal per shard of the cache (shards are the top level
+//    directories), recording when entries are published, hit and trimmed, so
+//    OutputInfo and Trim don't need to scan every directory
+//  - Records are buffered and appended in batches. Each record has a checksum,
+//    so records torn by concurrent writers (on network shares) are ignored
+//  - A shard without a valid journal (missing, or created by appending before
+//    the shard was ever indexed) is rebuilt from its directories when loaded
+//  - So is a shard with a directory changed after its journal, so entries
+//    published or trimmed by older versions sharing the cache are still seen
+//    (this checks the time of each directory in the shard, but doesn't list them)
+//------------------------------------------------------------------------------
+class CacheIndex
+{
+public:
+    explicit CacheIndex();
+    ~CacheIndex();
+
+    enum : uint32_t { NUM_SHARDS = 256 };
+
+    void        Init( const AString & cachePath ); // with trailing slash
+
+    // record activity (appended to the journals in batches)
+    void        OnPublish( const AString & cacheId, uint64_t size );
+    void        OnAccess( const AString & cacheId );
+    void        OnRemove( const AString & cacheId );
+    void        Flush();
+
+    struct Entry
+    {
+        AString     m_CacheId;
+        uint64_t    m_Size;
+        uint64_t    m_LastAccessTime;   // file time of the last publish or hit
+    };
+
+    // Get the entries in a shard, rebuilding or compacting its journal if needed
+    void        LoadShard( uint32_t shard, Array< Entry > & outEntries );
+
+private:
+    struct Record
+    {
+        uint8_t     m_Type;             // RECORD_xxx
+        uint8_t     m_Padding[ 7 ];
+        uint64_t    m_Size;             // RECORD_PUBLISH: size of the entry, RECORD_HEADER: version
+        uint64_t    m_Time;             // file time
+        char        m_CacheId[ 64 ];    // null terminated
+        uint64_t    m_Checksum;         // of everything above
+    };
+    static_assert( sizeof( Record ) == 96, "CacheIndex::Record has incorrect size" );
+
+    static void     InitRecord( Record & record, uint8_t type, const char * cacheId, uint64_t size, uint64_t time );
+    static bool     IsValidRecord( const Record & record );
+    static uint32_t GetShard( const char * cacheId );
+
+    void        AddRecord( uint8_t type, const AString & cacheId, uint64_t size );
+    void        AppendRecords( const Array< Record > & records ) const;
+    bool        ReadJournal( uint32_t shard, Array< Record > & outRecords, bool & outHasHeader ) const;
+    bool        IsJournalStale( uint32_t shard ) const;
+    void        ScanShard( uint32_t shard, Array< Entry > & outEntries ) const;
+    bool        WriteJournal( uint32_t shard, const Array< Entry > & entries ) const;
+    void        GetJournalPath( uint32_t shard, AString & outPath ) const;
+
+    AString         m_CachePath;
+    Mutex           m_PendingMutex;
+    Array< Record > m_Pending;      // records not yet appended to their journals
+};
+
+//------------------------------------------------------------------------------
@@ -29,7 +29,11 @@
         m_ShutdownFunc( nullptr ),
         m_PublishFunc( nullptr ),
         m_RetrieveFunc( nullptr ),
-        m_FreeMemoryFunc( nullptr )
+        m_FreeMemoryFunc( nullptr ),
+        m_OutputInfoFunc( nullptr ),
+        m_TrimFunc( nullptr ),
+        m_RetrieveBatchFunc( nullptr ),
+        m_ExistsBatchFunc( nullptr )
 {
     #if defined( __WINDOWS__ )
         m_DLL = ::LoadLibrary( dllName.Get() );
@@ -47,6 +51,8 @@
             m_FreeMemoryFunc= (CacheFreeMemoryFunc) GetFunction( "CacheFreeMemory", "?CacheFreeMemory@@YAXPEAX_K@Z" );
             m_OutputInfoFunc= (CacheOutputInfoFunc) GetFunction( "CacheOutputInfo", "?CacheOutputInfo@@YA_N_N@Z", true ); // Optional
             m_TrimFunc      = (CacheTrimFunc)       GetFunction( "CacheTrim",       "?CacheTrim@@YA_N_NI@Z", true ); // Optional
+            m_RetrieveBatchFunc = (CacheRetrieveBatchFunc) GetFunction( "CacheRetrieveBatch", "?CacheRetrieveBatch@@YAXPEAPEBDIPEAPEAXPEA_K@Z", true ); // Optional
+            m_ExistsBatchFunc   = (CacheExistsBatchFunc)   GetFunction( "CacheExistsBatch",   "?CacheExistsBatch@@YAXPEAPEBDIPEA_N@Z", true ); // Optional
         #else
             m_InitFunc      = (CacheInitFunc)       GetFunction( "CacheInit",       "?CacheInit@@YG_NPBD@Z" );
             m_ShutdownFunc  = (CacheShutdownFunc)   GetFunction( "CacheShutdown",   "?CacheShutdown@@YGXXZ"  );
@@ -55,6 +61,8 @@
             m_FreeMemoryFunc= (CacheFreeMemoryFunc) GetFunction( "CacheFreeMemory", "?CacheFreeMemory@@YGXPAX_K@Z" );
             m_OutputInfoFunc= (CacheOutputInfoFunc) GetFunction( "CacheOutputInfo", "?CacheOutputInfo@@YG_N_N@Z", true ); // Optional
             m_TrimFunc      = (CacheTrimFunc)       GetFunction( "CacheTrim",       "?CacheTrim@@YG_N_NI@Z", true ); // Optional
+            m_RetrieveBatchFunc = (CacheRetrieveBatchFunc) GetFunction( "CacheRetrieveBatch", "?CacheRetrieveBatch@@YGXPAPBDIPAPAXPA_K@Z", true ); // Optional
+            m_ExistsBatchFunc   = (CacheExistsBatchFunc)   GetFunction( "CacheExistsBatch",   "?CacheExistsBatch@@YGXPAPBDIPA_N@Z", true ); // Optional
         #endif
 
     #elif defined( __APPLE__ ) || defined( __LINUX__ )
@@ -71,6 +79,8 @@
         m_FreeMemoryFunc = (CacheFreeMemoryFunc)    GetFunction( "CacheFreeMemory" );
         m_OutputInfoFunc = (CacheOutputInfoFunc)    GetFunction( "CacheOutputInfo", nullptr, true ); // Optional
         m_TrimFunc       = (CacheTrimFunc)          GetFunction( "CacheTrim", nullptr, true ); // Optional
+        m_RetrieveBatchFunc = (CacheRetrieveBatchFunc) GetFunction( "CacheRetrieveBatch", nullptr, true ); // Optional
+        m_ExistsBatchFunc   = (CacheExistsBatchFunc)   GetFunction( "CacheExistsBatch", nullptr, true ); // Optional
     #else
         #error Unknown platform
     #endif
@@ -200,4 +210,69 @@ void * CachePlugin::GetFunction( const char * friendlyName, const char * mangled
     return false;
 }
 
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void CachePlugin::RetrieveBatch( const Array< AString > & cacheIds, Array< void * > & outData, Array< size_t > & outDataSizes )
+{
+    // RetrieveBatch is optional
+    if ( m_RetrieveBatchFunc == nullptr )
+    {
+        ICache::RetrieveBatch( cacheIds, outData, outDataSizes );
+        return;
+    }
+
+    const size_t numIds = cacheIds.GetSize();
+    Array< const char * > ids( numIds, false );
+    GetCacheIdPointers( cacheIds, ids );
+    Array< unsigned long long > sizes( numIds, false );
+    sizes.SetSize( numIds );
+    outData.SetSize( numIds );
+    for ( size_t i = 0; i < numIds; ++i )
+    {
+        outData[ i ] = nullptr;
+        sizes[ i ] = 0;
+    }
+
+    (*m_RetrieveBatchFunc)( ids.Begin(), (unsigned int)numIds, outData.Begin(), sizes.Begin() );
+
+    outDataSizes.SetSize( numIds );
+    for ( size_t i = 0; i < numIds; ++i )
+    {
+        outDataSizes[ i ] = (size_t)sizes[ i ];
+    }
+}
+
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void CachePlugin::ExistsBatch( const Array< AString > & cacheIds, Array< bool > & outExists )
+{
+    // ExistsBatch is optional
+    if ( m_ExistsBatchFunc == nullptr )
+    {
+        ICache::ExistsBatch( cacheIds, outExists );
+        return;
+    }
+
+    const size_t numIds = cacheIds.GetSize();
+    Array< const char * > ids( numIds, false );
+    GetCacheIdPointers( cacheIds, ids );
+    outExists.SetSize( numIds );
+    for ( size_t i = 0; i < numIds; ++i )
+    {
+        outExists[ i ] = false;
+    }
+
+    (*m_ExistsBatchFunc)( ids.Begin(), (unsigned int)numIds, outExists.Begin() );
+}
+
+// GetCacheIdPointers
+//------------------------------------------------------------------------------
+/*static*/ void CachePlugin::GetCacheIdPointers( const Array< AString > & cacheIds, Array< const char * > & outPointers )
+{
+    for ( const AString & cacheId : cacheIds )
+    {
+        outPointers.Append( cacheId.Get() );
+    }
+}
+
 //------------------------------------------------------------------------------
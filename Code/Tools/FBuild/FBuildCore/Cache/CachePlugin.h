@@ -26,7 +26,11 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void RetrieveBatch( const Array< AString > & cacheIds, Array< void * > & outData, Array< size_t > & outDataSizes ) override;
+    virtual void ExistsBatch( const Array< AString > & cacheIds, Array< bool > & outExists ) override;
 private:
+    static void GetCacheIdPointers( const Array< AString > & cacheIds, Array< const char * > & outPointers );
+
     void * GetFunction( const char * friendlyName, const char * mangledName = nullptr, bool optional = false ) const;
 
     void *              m_DLL;
@@ -37,6 +41,8 @@ private:
     CacheFreeMemoryFunc m_FreeMemoryFunc;
     CacheOutputInfoFunc m_OutputInfoFunc;
     CacheTrimFunc       m_TrimFunc;
+    CacheRetrieveBatchFunc  m_RetrieveBatchFunc;
+    CacheExistsBatchFunc    m_ExistsBatchFunc;
 };
 
 //------------------------------------------------------------------------------
@@ -96,6 +96,34 @@ typedef bool (STDCALL *CacheTrimFunc)( bool showProgress, unsigned int sizeMiB )
     CACHEPLUGIN_DLL_EXPORT bool STDCALL CacheTrim( bool showProgress, unsigned int sizeMiB );
 #endif
 
+// CacheRetrieveBatch (Optional)
+//------------------------------------------------------------------------------
+// Retrieve several previously stored items. Lookups can be overlapped to hide
+// latency. If not provided, CacheRetrieve is called from several threads.
+//
+// In:  cacheIds - string names of cache entries
+//      numIds   - number of cache entries
+// Out: data     - for each entry, retrieved data (or nullptr if not found).
+//                 Freed with CacheFreeMemory.
+//      dataSize - for each entry, size in bytes of retrieved data
+typedef void (STDCALL *CacheRetrieveBatchFunc)( const char ** cacheIds, unsigned int numIds, void ** data, unsigned long long * dataSize );
+#ifdef CACHEPLUGIN_DLL_EXPORT
+    CACHEPLUGIN_DLL_EXPORT void STDCALL CacheRetrieveBatch( const char ** cacheIds, unsigned int numIds, void ** data, unsigned long long * dataSize );
+#endif
+
+// CacheExistsBatch (Optional)
+//------------------------------------------------------------------------------
+// Check if several items are in the cache, without retrieving them. If not
+// provided, CacheRetrieve is called from several threads.
+//
+// In:  cacheIds - string names of cache entries
+//      numIds   - number of cache entries
+// Out: exists   - for each entry, true if it is in the cache
+typedef void (STDCALL *CacheExistsBatchFunc)( const char ** cacheIds, unsigned int numIds, bool * exists );
+#ifdef CACHEPLUGIN_DLL_EXPORT
+    CACHEPLUGIN_DLL_EXPORT void STDCALL CacheExistsBatch( const char ** cacheIds, unsigned int numIds, bool * exists );
+#endif
+
 #if !defined(__WINDOWS__)//TODO:Windows : Use unmangled name on windows.
 } //extern "C"
 #endif
@@ -0,0 +1,220 @@
+// CachePrefetcher - Look up jobs in the cache before they are queued
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CachePrefetcher.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ParallelFor.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Time/Timer.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CachePrefetcher::CachePrefetcher( JobQueue & jobQueue, ICache * cache, uint32_t numThreads, size_t maxHeldBytes )
+    : m_JobQueue( jobQueue )
+    , m_Cache( cache )
+    , m_NumThreads( numThreads )
+    , m_MaxHeldBytes( maxHeldBytes )
+    , m_Thread( INVALID_THREAD_HANDLE )
+    , m_Pending( 1024, true )
+    , m_Exiting( false )
+    , m_LookupJobs( nullptr )
+    , m_PrepareResults( LOOKUP_BATCH_SIZE, true )
+    , m_CacheIds( LOOKUP_BATCH_SIZE, true )
+    , m_Data( LOOKUP_BATCH_SIZE, true )
+    , m_DataSizes( LOOKUP_BATCH_SIZE, true )
+    , m_Exists( LOOKUP_BATCH_SIZE, true )
+    , m_NumPrefetched( 0 )
+    , m_NumHits( 0 )
+    , m_LookupTimeMS( 0 )
+{
+    ASSERT( cache );
+    ASSERT( numThreads > 0 );
+    m_Thread = Thread::CreateThread( ThreadFuncStatic, "CachePrefetch", ( 64 * KILOBYTE ), this );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CachePrefetcher::~CachePrefetcher()
+{
+    {
+        MutexHolder mh( m_Mutex );
+        m_Exiting = true;
+    }
+    m_Semaphore.Signal();
+    Thread::WaitForThread( m_Thread );
+    Thread::CloseHandle( m_Thread );
+
+    ASSERT( m_Pending.IsEmpty() );
+}
+
+// QueueJobs
+//------------------------------------------------------------------------------
+void CachePrefetcher::QueueJobs( Array< Job * > & jobs )
+{
+    if ( jobs.IsEmpty() )
+    {
+        return;
+    }
+
+    {
+        MutexHolder mh( m_Mutex );
+        ASSERT( m_Exiting == false );
+        m_Pending.Append( jobs );
+    }
+    jobs.Clear();
+    m_Semaphore.Signal();
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CachePrefetcher::ThreadFuncStatic( void * param )
+{
+    static_cast< CachePrefetcher * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CachePrefetcher::ThreadFunc()
+{
+    PROFILE_SET_THREAD_NAME( "CachePrefetch" )
+
+    Array< Job * > jobs( 1024, true );
+    for ( ;; )
+    {
+        m_Semaphore.Wait();
+
+        bool exiting;
+        {
+            MutexHolder mh( m_Mutex );
+            jobs.Swap( m_Pending );
+            exiting = m_Exiting;
+        }
+
+        if ( exiting )
+        {
+            // Hand back anything left so it can be cleaned up with the other
+            // incomplete jobs
+            m_JobQueue.QueuePrefetchedJobs( jobs.Begin(), jobs.GetSize() );
+            return;
+        }
+
+        ProcessJobs( jobs );
+        jobs.Clear();
+    }
+}
+
+// ProcessJobs
+//------------------------------------------------------------------------------
+void CachePrefetcher::ProcessJobs( Array< Job * > & jobs )
+{
+    // Release jobs in small batches, so workers don't wait for everything
+    // to be looked up
+    const size_t numJobs = jobs.GetSize();
+    for ( size_t i = 0; i < numJobs; i += LOOKUP_BATCH_SIZE )
+    {
+        const size_t batchSize = Math::Min< size_t >( LOOKUP_BATCH_SIZE, ( numJobs - i ) );
+        if ( FBuild::GetStopBuild() == false )
+        {
+            LookupJobs( jobs.Begin() + i, batchSize );
+        }
+        m_JobQueue.QueuePrefetchedJobs( jobs.Begin() + i, batchSize );
+    }
+}
+
+// LookupJobs
+//------------------------------------------------------------------------------
+void CachePrefetcher::LookupJobs( Job * const * jobs, size_t numJobs )
+{
+    PROFILE_FUNCTION
+
+    Timer t;
+
+    // Calculate cache keys
+    m_LookupJobs = jobs;
+    m_PrepareResults.SetSize( numJobs );
+    ParallelFor::Run( (uint32_t)numJobs, m_NumThreads, PrepareJob, this, 1 );
+    m_LookupJobs = nullptr;
+
+    m_CacheIds.Clear();
+    for ( size_t i = 0; i < numJobs; ++i )
+    {
+        if ( m_PrepareResults[ i ] )
+        {
+            m_CacheIds.Append( jobs[ i ]->GetCacheName() );
+        }
+    }
+    if ( m_CacheIds.IsEmpty() )
+    {
+        return; // Jobs will be looked up as normal when built
+    }
+
+    // Retrieve the data if within budget, otherwise just check for existence
+    // (the budget can be exceeded by up to one batch)
+    if ( Job::GetTotalCachePrefetchMemoryUsage() < m_MaxHeldBytes )
+    {
+        m_Cache->RetrieveBatch( m_CacheIds, m_Data, m_DataSizes );
+        ASSERT( m_Data.GetSize() == m_CacheIds.GetSize() );
+        size_t index = 0;
+        for ( size_t i = 0; i < numJobs; ++i )
+        {
+            if ( m_PrepareResults[ i ] )
+            {
+                void * data = m_Data[ index ];
+                if ( data )
+                {
+                    jobs[ i ]->SetCachePrefetchResult( Job::CACHE_PREFETCH_HIT, data, m_DataSizes[ index ] );
+                    ++m_NumHits;
+                }
+                else
+                {
+                    jobs[ i ]->SetCachePrefetchResult( Job::CACHE_PREFETCH_MISS );
+                }
+                ++index;
+            }
+        }
+    }
+    else
+    {
+        m_Cache->ExistsBatch( m_CacheIds, m_Exists );
+        ASSERT( m_Exists.GetSize() == m_CacheIds.GetSize() );
+        size_t index = 0;
+        for ( size_t i = 0; i < numJobs; ++i )
+        {
+            if ( m_PrepareResults[ i ] )
+            {
+                const bool exists = m_Exists[ index ];
+                jobs[ i ]->SetCachePrefetchResult( exists ? Job::CACHE_PREFETCH_EXISTS : Job::CACHE_PREFETCH_MISS );
+                m_NumHits += exists ? 1 : 0;
+                ++index;
+            }
+        }
+    }
+
+    m_NumPrefetched += (uint32_t)m_CacheIds.GetSize();
+    m_LookupTimeMS += (uint32_t)t.GetElapsedMS();
+}
+
+// PrepareJob
+//------------------------------------------------------------------------------
+/*static*/ bool CachePrefetcher::PrepareJob( uint32_t index, void * userData )
+{
+    CachePrefetcher & self = *static_cast< CachePrefetcher * >( userData );
+    Job * job = self.m_LookupJobs[ index ];
+    self.m_PrepareResults[ index ] = job->GetNode()->CastTo< ObjectNode >()->PrepareCachePrefetch( job );
+    return true;
+}
+
+//------------------------------------------------------------------------------
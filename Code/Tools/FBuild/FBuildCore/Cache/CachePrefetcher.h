@@ -0,0 +1,73 @@
+// CachePrefetcher - Look up jobs in the cache before they are queued
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ICache;
+class Job;
+class JobQueue;
+
+// CachePrefetcher
+//  - Jobs are handed over as they are made available and are looked up in the
+//    cache in batches (-cacheprefetch), so lookup latency is overlapped instead
+//    of being paid by each worker in turn
+//  - Jobs are passed on to the JobQueue once their lookup is complete, holding
+//    the retrieved data (or just the result, once the memory budget is used up)
+//  - Jobs still held at destruction are passed on without being looked up
+//------------------------------------------------------------------------------
+class CachePrefetcher
+{
+public:
+    explicit CachePrefetcher( JobQueue & jobQueue, ICache * cache, uint32_t numThreads, size_t maxHeldBytes );
+    ~CachePrefetcher();
+
+    // main thread adds jobs (takes all jobs from the array)
+    void        QueueJobs( Array< Job * > & jobs );
+
+    // stats
+    inline uint32_t GetNumPrefetched() const    { return m_NumPrefetched; }
+    inline uint32_t GetNumHits() const          { return m_NumHits; }
+    inline uint32_t GetLookupTimeMS() const     { return m_LookupTimeMS; }
+
+private:
+    static uint32_t ThreadFuncStatic( void * param );
+    void            ThreadFunc();
+    void            ProcessJobs( Array< Job * > & jobs );
+    void            LookupJobs( Job * const * jobs, size_t numJobs );
+    static bool     PrepareJob( uint32_t index, void * userData );
+
+    enum : uint32_t { LOOKUP_BATCH_SIZE = 64 }; // jobs looked up (and released to workers) together
+
+    JobQueue &              m_JobQueue;
+    ICache *                m_Cache;
+    uint32_t                m_NumThreads;       // for calculating cache keys
+    size_t                  m_MaxHeldBytes;
+    Thread::ThreadHandle    m_Thread;
+    Semaphore               m_Semaphore;        // signalled when jobs are added (and to exit)
+    Mutex                   m_Mutex;            // protects m_Pending and m_Exiting
+    Array< Job * >          m_Pending;
+    bool                    m_Exiting;
+
+    // prefetch thread only
+    Job * const *           m_LookupJobs;       // jobs being prepared by PrepareJob
+    Array< bool >           m_PrepareResults;
+    Array< AString >        m_CacheIds;
+    Array< void * >         m_Data;
+    Array< size_t >         m_DataSizes;
+    Array< bool >           m_Exists;
+    uint32_t                m_NumPrefetched;
+    uint32_t                m_NumHits;
+    uint32_t                m_LookupTimeMS;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,196 @@
+// CachePublishQueue - Publish to the cache from background threads
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CachePublishQueue.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/Node.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Time/Timer.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CachePublishQueue::CachePublishQueue( ICache * cache, uint32_t numThreads, size_t maxQueuedBytes, ICache * dataOwner )
+    : m_Cache( cache )
+    , m_DataOwner( dataOwner )
+    , m_Threads( numThreads, false )
+    , m_Queue( 256, true )
+    , m_QueueHead( 0 )
+    , m_QueuedBytes( 0 )
+    , m_MaxQueuedBytes( maxQueuedBytes )
+    , m_Exiting( false )
+    , m_NumPublished( 0 )
+    , m_NumFailed( 0 )
+    , m_PublishedNodes( 0, true )
+    , m_PublishTimeMS( 0 )
+    , m_DrainTimeMS( 0 )
+{
+    ASSERT( cache );
+    ASSERT( numThreads > 0 );
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        m_Threads.Append( Thread::CreateThread( ThreadFuncStatic, "CachePublish", ( 64 * KILOBYTE ), this ) );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CachePublishQueue::~CachePublishQueue()
+{
+    Drain();
+}
+
+// Publish
+//------------------------------------------------------------------------------
+bool CachePublishQueue::Publish( const Node * node, const AString & cacheId, void * data, size_t dataSize )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        ASSERT( m_Exiting == false );
+
+        // Always accept something, so a single large entry can't be starved
+        if ( ( m_QueuedBytes > 0 ) && ( ( m_QueuedBytes + dataSize ) > m_MaxQueuedBytes ) )
+        {
+            return false;
+        }
+
+        Entry entry;
+        entry.m_Node = node;
+        entry.m_CacheId = cacheId;
+        entry.m_Data = data;
+        entry.m_DataSize = dataSize;
+        m_Queue.Append( Move( entry ) );
+        m_QueuedBytes += dataSize;
+    }
+    m_Semaphore.Signal();
+    return true;
+}
+
+// Drain
+//------------------------------------------------------------------------------
+void CachePublishQueue::Drain()
+{
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_Exiting )
+        {
+            return; // already drained
+        }
+        m_Exiting = true;
+    }
+
+    PROFILE_FUNCTION
+
+    // Each thread exits once the queue is empty
+    Timer t;
+    m_Semaphore.Signal( (uint32_t)m_Threads.GetSize() );
+    for ( Thread::ThreadHandle handle : m_Threads )
+    {
+        Thread::WaitForThread( handle );
+        Thread::CloseHandle( handle );
+    }
+    m_Threads.Clear();
+    m_DrainTimeMS = (uint32_t)t.GetElapsedMS();
+
+    ASSERT( m_QueueHead == m_Queue.GetSize() );
+    ASSERT( m_QueuedBytes == 0 );
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CachePublishQueue::ThreadFuncStatic( void * param )
+{
+    static_cast< CachePublishQueue * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CachePublishQueue::ThreadFunc()
+{
+    PROFILE_SET_THREAD_NAME( "CachePublish" )
+
+    const bool verbose = FBuild::Get().GetOptions().m_CacheVerbose;
+
+    for ( ;; )
+    {
+        m_Semaphore.Wait();
+
+        Entry entry;
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_QueueHead == m_Queue.GetSize() )
+            {
+                ASSERT( m_Exiting ); // only signalled without an entry to exit
+                return;
+            }
+            entry = Move( m_Queue[ m_QueueHead ] );
+            ++m_QueueHead;
+            if ( m_QueueHead == m_Queue.GetSize() )
+            {
+                m_Queue.Clear();
+                m_QueueHead = 0;
+            }
+        }
+
+        PROFILE_SECTION( "Publish" )
+
+        Timer t;
+        const bool ok = m_Cache->Publish( entry.m_CacheId, entry.m_Data, entry.m_DataSize );
+        const uint32_t publishTime = (uint32_t)t.GetElapsedMS();
+        if ( m_DataOwner )
+        {
+            m_DataOwner->FreeMemory( entry.m_Data, entry.m_DataSize );
+        }
+        else
+        {
+            FREE( entry.m_Data );
+        }
+
+        {
+            MutexHolder mh( m_Mutex );
+            m_QueuedBytes -= entry.m_DataSize;
+            m_PublishTimeMS += publishTime;
+            if ( ok )
+            {
+                ++m_NumPublished;
+                if ( entry.m_Node )
+                {
+                    m_PublishedNodes.Append( entry.m_Node );
+                }
+            }
+            else
+            {
+                ++m_NumFailed;
+            }
+        }
+
+        // Output
+        if ( verbose && entry.m_Node )
+        {
+            if ( ok )
+            {
+                FLOG_BUILD( "Obj: %s\n"
+                            " - Cache Store (Async): %u ms '%s'\n",
+                            entry.m_Node->GetName().Get(), publishTime, entry.m_CacheId.Get() );
+            }
+            else
+            {
+                FLOG_BUILD( "Obj: %s\n"
+                            " - Cache Store Fail (Async): %u ms '%s'\n",
+                            entry.m_Node->GetName().Get(), publishTime, entry.m_CacheId.Get() );
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
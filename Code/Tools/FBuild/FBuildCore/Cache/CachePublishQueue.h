@@ -0,0 +1,78 @@
+// CachePublishQueue - Publish to the cache from background threads
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ICache;
+class Node;
+
+// CachePublishQueue
+//  - Takes already compressed cache entries from the worker threads so they can
+//    return to compiling while the (potentially slow) store happens (-cacheasync)
+//  - Memory held by queued entries is bounded. When full, the caller is expected
+//    to publish synchronously instead.
+//  - Outstanding entries are published before destruction
+//  - Also used to copy entries between caches (see TieredCache), in which case
+//    the data is freed by the cache it came from
+//------------------------------------------------------------------------------
+class CachePublishQueue
+{
+public:
+    explicit CachePublishQueue( ICache * cache, uint32_t numThreads, size_t maxQueuedBytes, ICache * dataOwner = nullptr );
+    ~CachePublishQueue();
+
+    // Takes ownership of data if the entry is queued. Data is allocated with ALLOC
+    // or, if there is a dataOwner, retrieved from it.
+    // (node is for stats and verbose output, and can be null)
+    bool        Publish( const Node * node, const AString & cacheId, void * data, size_t dataSize );
+
+    // Publish everything queued and stop the threads
+    void        Drain();
+
+    // stats (valid after Drain)
+    inline uint32_t GetNumPublished() const     { return m_NumPublished; }
+    inline uint32_t GetNumFailed() const        { return m_NumFailed; }
+    inline uint32_t GetPublishTimeMS() const    { return m_PublishTimeMS; }
+    inline uint32_t GetDrainTimeMS() const      { return m_DrainTimeMS; }
+    inline const Array< const Node * > & GetPublishedNodes() const { return m_PublishedNodes; } // entries which were stored
+
+private:
+    static uint32_t ThreadFuncStatic( void * param );
+    void            ThreadFunc();
+
+    struct Entry
+    {
+        const Node * m_Node;
+        AString     m_CacheId;
+        void *      m_Data;
+        size_t      m_DataSize;
+    };
+
+    ICache *                        m_Cache;
+    ICache *                        m_DataOwner;        // frees published data (or nullptr to FREE it)
+    Array< Thread::ThreadHandle >   m_Threads;
+    Semaphore                       m_Semaphore;        // signalled for each entry queued (and to exit)
+    Mutex                           m_Mutex;            // protects everything below
+    Array< Entry >                  m_Queue;
+    size_t                          m_QueueHead;        // next entry to publish
+    size_t                          m_QueuedBytes;
+    size_t                          m_MaxQueuedBytes;
+    bool                            m_Exiting;
+    uint32_t                        m_NumPublished;
+    uint32_t                        m_NumFailed;
+    Array< const Node * >           m_PublishedNodes;
+    uint32_t                        m_PublishTimeMS;    // summed over all threads
+    uint32_t                        m_DrainTimeMS;
+};
+
+//------------------------------------------------------------------------------
@@ -5,8 +5,124 @@
 //------------------------------------------------------------------------------
 #include "ICache.h"
 
+#include "Tools/FBuild/FBuildCore/Helpers/ParallelFor.h"
+
+#include <Core/FileIO/MemoryMappedFile.h>
 #include <Core/Strings/AString.h>
 
+// Defines
+//------------------------------------------------------------------------------
+#define BATCH_LOOKUP_THREADS ( 8 ) // lookups are mostly waiting on I/O
+
+// BatchLookup
+//------------------------------------------------------------------------------
+namespace
+{
+    struct BatchLookup
+    {
+        ICache *                    m_Cache;
+        const Array< AString > *    m_CacheIds;
+        void **                     m_Data;
+        size_t *                    m_DataSizes;
+        bool *                      m_Exists;
+    };
+
+    bool BatchRetrieveItem( uint32_t index, void * userData )
+    {
+        BatchLookup & lookup = *static_cast< BatchLookup * >( userData );
+        if ( lookup.m_Cache->Retrieve( ( *lookup.m_CacheIds )[ index ], lookup.m_Data[ index ], lookup.m_DataSizes[ index ] ) == false )
+        {
+            lookup.m_Data[ index ] = nullptr;
+            lookup.m_DataSizes[ index ] = 0;
+        }
+        return true;
+    }
+
+    bool BatchExistsItem( uint32_t index, void * userData )
+    {
+        BatchLookup & lookup = *static_cast< BatchLookup * >( userData );
+        lookup.m_Exists[ index ] = lookup.m_Cache->Exists( ( *lookup.m_CacheIds )[ index ] );
+        return true;
+    }
+}
+
+// Exists
+//------------------------------------------------------------------------------
+/*virtual*/ bool ICache::Exists( const AString & cacheId )
+{
+    // Without a cheaper way to check, retrieve the whole entry
+    void * data = nullptr;
+    size_t dataSize = 0;
+    if ( Retrieve( cacheId, data, dataSize ) )
+    {
+        FreeMemory( data, dataSize );
+        return true;
+    }
+    return false;
+}
+
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void ICache::RetrieveBatch( const Array< AString > & cacheIds, Array< void * > & outData, Array< size_t > & outDataSizes )
+{
+    const size_t numIds = cacheIds.GetSize();
+    outData.SetSize( numIds );
+    outDataSizes.SetSize( numIds );
+
+    BatchLookup lookup;
+    lookup.m_Cache = this;
+    lookup.m_CacheIds = &cacheIds;
+    lookup.m_Data = outData.Begin();
+    lookup.m_DataSizes = outDataSizes.Begin();
+    lookup.m_Exists = nullptr;
+    ParallelFor::Run( (uint32_t)numIds, BATCH_LOOKUP_THREADS, BatchRetrieveItem, &lookup, 1 );
+}
+
+// RetrieveMapped
+//------------------------------------------------------------------------------
+/*virtual*/ bool ICache::RetrieveMapped( const AString & cacheId, const void * & data, size_t & dataSize, bool & outIsMapped )
+{
+    void * retrievedData = nullptr;
+    outIsMapped = false;
+    if ( Retrieve( cacheId, retrievedData, dataSize ) )
+    {
+        data = retrievedData;
+        return true;
+    }
+    data = nullptr;
+    return false;
+}
+
+// ReleaseMapped
+//------------------------------------------------------------------------------
+void ICache::ReleaseMapped( const void * data, size_t dataSize, bool isMapped )
+{
+    if ( isMapped )
+    {
+        MemoryMappedFile::Unmap( data, dataSize );
+    }
+    else
+    {
+        FreeMemory( const_cast< void * >( data ), dataSize );
+    }
+}
+
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void ICache::ExistsBatch( const Array< AString > & cacheIds, Array< bool > & outExists )
+{
+    const size_t numIds = cacheIds.GetSize();
+    outExists.SetSize( numIds );
+
+    BatchLookup lookup;
+    lookup.m_Cache = this;
+    lookup.m_CacheIds = &cacheIds;
+    lookup.m_Data = nullptr;
+    lookup.m_DataSizes = nullptr;
+    lookup.m_Exists = outExists.Begin();
+    ParallelFor::Run( (uint32_t)numIds, BATCH_LOOKUP_THREADS, BatchExistsItem, &lookup, 1 );
+}
+
 // GetCacheId
 //------------------------------------------------------------------------------
 /*static*/ void ICache::GetCacheId( const uint64_t preprocessedSourceKey,
@@ -16,7 +132,8 @@
                                     AString & outCacheId )
 {
     // cache version - bump if cache format is changed
-    static const char cacheVersion( 'A' );
+    //  - B: large entries can be block frames (see Compressor::CompressBlocks)
+    static const char cacheVersion( 'B' );
 
     // format example: 2377DE32AB045A2D_FED872A1_AB62FEAA23498AAC-32A2B04375A2D7DE.7
     outCacheId.Format( "%016" PRIX64 "_%08X_%016" PRIX64 "-%016" PRIX64 ".%c",
@@ -4,6 +4,7 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include <Core/Containers/Array.h>
 #include <Core/Env/Types.h>
 
 // Forward Declarations
@@ -26,6 +27,19 @@ public:
     virtual bool OutputInfo( bool showProgress ) = 0;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) = 0;
 
+    // Optional interface
+    //  - Batched lookups, so high latency caches can overlap them. Results are in
+    //    the order of cacheIds (with null data for misses). The defaults issue
+    //    individual requests from several threads.
+    virtual bool Exists( const AString & cacheId );
+    virtual void RetrieveBatch( const Array< AString > & cacheIds, Array< void * > & outData, Array< size_t > & outDataSizes );
+    virtual void ExistsBatch( const Array< AString > & cacheIds, Array< bool > & outExists );
+    //  - Retrieval of an entry which can be read in place (memory-mapped) instead of
+    //    being copied into memory, for entries on a local disk only. The default
+    //    uses Retrieve. Data must be freed with ReleaseMapped.
+    virtual bool RetrieveMapped( const AString & cacheId, const void * & data, size_t & dataSize, bool & outIsMapped );
+    void         ReleaseMapped( const void * data, size_t dataSize, bool isMapped );
+
     // Helper functions
     static void GetCacheId( const uint64_t preprocessedSourceKey,
                             const uint32_t commandLineKey,
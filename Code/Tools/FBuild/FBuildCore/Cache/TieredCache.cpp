@@ -0,0 +1,349 @@
+// TieredCache - Local cache in front of a shared cache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TieredCache.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePublishQueue.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <memory.h> // for memcpy
+
+// Defines
+//------------------------------------------------------------------------------
+#define PROMOTE_THREADS ( 2 )
+#define PROMOTE_MAX_QUEUED_BYTES ( 64 * MEGABYTE )
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+TieredCache::TieredCache( ICache * sharedCache, const AString & localCachePath, uint32_t localCacheSizeMiB )
+    : m_SharedCache( sharedCache )
+    , m_LocalCache( nullptr )
+    , m_PromoteQueue( nullptr )
+    , m_LocalCachePath( localCachePath )
+    , m_LocalCacheMaxBytes( (uint64_t)localCacheSizeMiB * MEGABYTE )
+    , m_NumLocalStores( 0 )
+    , m_NumLocalHits( 0 )
+    , m_NumSharedHits( 0 )
+    , m_NumPromoted( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+TieredCache::~TieredCache()
+{
+    FDELETE m_PromoteQueue;
+    FDELETE m_LocalCache;
+    FDELETE m_SharedCache;
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Init( const AString & cachePath, const AString & cachePathMountPoint )
+{
+    PROFILE_FUNCTION
+
+    // Either cache can be used without the other
+    m_LocalCache = FNEW( Cache() );
+    m_LocalCache->SetIsLocal( true );
+    if ( m_LocalCache->Init( m_LocalCachePath, AString::GetEmpty() ) == false )
+    {
+        FDELETE m_LocalCache;
+        m_LocalCache = nullptr;
+    }
+    if ( m_SharedCache && ( m_SharedCache->Init( cachePath, cachePathMountPoint ) == false ) )
+    {
+        FDELETE m_SharedCache;
+        m_SharedCache = nullptr;
+    }
+
+    if ( m_LocalCache && m_SharedCache )
+    {
+        m_PromoteQueue = FNEW( CachePublishQueue( m_LocalCache, PROMOTE_THREADS, PROMOTE_MAX_QUEUED_BYTES, m_SharedCache ) );
+    }
+
+    return ( ( m_LocalCache != nullptr ) || ( m_SharedCache != nullptr ) );
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::Shutdown()
+{
+    // Finish copying to the local cache before it's trimmed
+    FDELETE m_PromoteQueue;
+    m_PromoteQueue = nullptr;
+
+    if ( m_LocalCache )
+    {
+        if ( m_NumLocalStores > 0 )
+        {
+            m_LocalCache->TrimToSize( m_LocalCacheMaxBytes );
+            m_NumLocalStores = 0;
+        }
+        m_LocalCache->Shutdown();
+    }
+    if ( m_SharedCache )
+    {
+        m_SharedCache->Shutdown();
+    }
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    const bool localOK = ( m_LocalCache && m_LocalCache->Publish( cacheId, data, dataSize ) );
+    if ( localOK )
+    {
+        AtomicIncU32( &m_NumLocalStores );
+    }
+
+    // The result from the shared cache is reported, since failing to store there
+    // is not made up for by the local cache
+    if ( m_SharedCache )
+    {
+        return m_SharedCache->Publish( cacheId, data, dataSize );
+    }
+    return localOK;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Retrieve( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    if ( m_LocalCache && m_LocalCache->Retrieve( cacheId, data, dataSize ) )
+    {
+        AtomicIncU32( &m_NumLocalHits );
+        return true;
+    }
+    if ( m_SharedCache && m_SharedCache->Retrieve( cacheId, data, dataSize ) )
+    {
+        AtomicIncU32( &m_NumSharedHits );
+        data = OnSharedHit( cacheId, data, dataSize );
+        return true;
+    }
+    return false;
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::FreeMemory( void * data, size_t dataSize )
+{
+    // With a local cache, shared hits are returned as copies allocated the same
+    // way as local hits
+    if ( m_LocalCache )
+    {
+        m_LocalCache->FreeMemory( data, dataSize );
+    }
+    else
+    {
+        m_SharedCache->FreeMemory( data, dataSize );
+    }
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::OutputInfo( bool showProgress )
+{
+    bool ok = true;
+    if ( m_LocalCache )
+    {
+        OUTPUT( "Local Cache: %s\n", m_LocalCachePath.Get() );
+        ok = m_LocalCache->OutputInfo( showProgress );
+    }
+    if ( m_SharedCache )
+    {
+        OUTPUT( "Shared Cache:\n" );
+        ok = m_SharedCache->OutputInfo( showProgress ) && ok;
+    }
+    return ok;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Trim( bool showProgress, uint32_t sizeMiB )
+{
+    bool ok = true;
+    if ( m_LocalCache )
+    {
+        // Never larger than the local cache is allowed to be
+        OUTPUT( "Local Cache: %s\n", m_LocalCachePath.Get() );
+        const uint32_t localSizeMiB = (uint32_t)Math::Min< uint64_t >( sizeMiB, ( m_LocalCacheMaxBytes / MEGABYTE ) );
+        ok = m_LocalCache->Trim( showProgress, localSizeMiB );
+    }
+    if ( m_SharedCache )
+    {
+        OUTPUT( "Shared Cache:\n" );
+        ok = m_SharedCache->Trim( showProgress, sizeMiB ) && ok;
+    }
+    return ok;
+}
+
+// Exists
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Exists( const AString & cacheId )
+{
+    return ( m_LocalCache && m_LocalCache->Exists( cacheId ) ) ||
+           ( m_SharedCache && m_SharedCache->Exists( cacheId ) );
+}
+
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::RetrieveBatch( const Array< AString > & cacheIds, Array< void * > & outData, Array< size_t > & outDataSizes )
+{
+    if ( m_LocalCache == nullptr )
+    {
+        m_SharedCache->RetrieveBatch( cacheIds, outData, outDataSizes );
+        for ( const void * data : outData )
+        {
+            if ( data )
+            {
+                AtomicIncU32( &m_NumSharedHits );
+            }
+        }
+        return;
+    }
+
+    m_LocalCache->RetrieveBatch( cacheIds, outData, outDataSizes );
+
+    // Look for misses in the shared cache
+    const size_t numIds = cacheIds.GetSize();
+    Array< AString > missingIds( numIds, true );
+    Array< uint32_t > missingIndices( numIds, true );
+    for ( size_t i = 0; i < numIds; ++i )
+    {
+        if ( outData[ i ] )
+        {
+            AtomicIncU32( &m_NumLocalHits );
+        }
+        else
+        {
+            missingIds.Append( cacheIds[ i ] );
+            missingIndices.Append( (uint32_t)i );
+        }
+    }
+    if ( missingIds.IsEmpty() || ( m_SharedCache == nullptr ) )
+    {
+        return;
+    }
+
+    Array< void * > sharedData;
+    Array< size_t > sharedDataSizes;
+    m_SharedCache->RetrieveBatch( missingIds, sharedData, sharedDataSizes );
+    for ( size_t i = 0; i < missingIds.GetSize(); ++i )
+    {
+        if ( sharedData[ i ] )
+        {
+            AtomicIncU32( &m_NumSharedHits );
+            const uint32_t index = missingIndices[ i ];
+            outData[ index ] = OnSharedHit( missingIds[ i ], sharedData[ i ], sharedDataSizes[ i ] );
+            outDataSizes[ index ] = sharedDataSizes[ i ];
+        }
+    }
+}
+
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::ExistsBatch( const Array< AString > & cacheIds, Array< bool > & outExists )
+{
+    if ( m_LocalCache == nullptr )
+    {
+        m_SharedCache->ExistsBatch( cacheIds, outExists );
+        return;
+    }
+
+    m_LocalCache->ExistsBatch( cacheIds, outExists );
+
+    // Look for misses in the shared cache
+    const size_t numIds = cacheIds.GetSize();
+    Array< AString > missingIds( numIds, true );
+    Array< uint32_t > missingIndices( numIds, true );
+    for ( size_t i = 0; i < numIds; ++i )
+    {
+        if ( outExists[ i ] == false )
+        {
+            missingIds.Append( cacheIds[ i ] );
+            missingIndices.Append( (uint32_t)i );
+        }
+    }
+    if ( missingIds.IsEmpty() || ( m_SharedCache == nullptr ) )
+    {
+        return;
+    }
+
+    Array< bool > sharedExists;
+    m_SharedCache->ExistsBatch( missingIds, sharedExists );
+    for ( size_t i = 0; i < missingIds.GetSize(); ++i )
+    {
+        outExists[ missingIndices[ i ] ] = sharedExists[ i ];
+    }
+}
+
+// RetrieveMapped
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::RetrieveMapped( const AString & cacheId, const void * & data, size_t & dataSize, bool & outIsMapped )
+{
+    if ( m_LocalCache == nullptr )
+    {
+        // Only the local cache is read in place (see Cache::RetrieveMapped)
+        return ICache::RetrieveMapped( cacheId, data, dataSize, outIsMapped );
+    }
+
+    if ( m_LocalCache->RetrieveMapped( cacheId, data, dataSize, outIsMapped ) )
+    {
+        AtomicIncU32( &m_NumLocalHits );
+        return true;
+    }
+
+    // Shared hits are copied, so they're freed like local hits
+    void * sharedData = nullptr;
+    if ( m_SharedCache && m_SharedCache->Retrieve( cacheId, sharedData, dataSize ) )
+    {
+        AtomicIncU32( &m_NumSharedHits );
+        data = OnSharedHit( cacheId, sharedData, dataSize );
+        outIsMapped = false;
+        return true;
+    }
+    return false;
+}
+
+// OnSharedHit
+//------------------------------------------------------------------------------
+void * TieredCache::OnSharedHit( const AString & cacheId, void * data, size_t dataSize )
+{
+    if ( m_LocalCache == nullptr )
+    {
+        return data; // freed by the shared cache
+    }
+
+    // Return a copy, so the original can be published to the local cache in
+    // the background (if there's room in the queue - otherwise it can be
+    // promoted next time)
+    void * copy = ALLOC( dataSize );
+    memcpy( copy, data, dataSize );
+    if ( m_PromoteQueue && m_PromoteQueue->Publish( nullptr, cacheId, data, dataSize ) )
+    {
+        AtomicIncU32( &m_NumPromoted );
+        AtomicIncU32( &m_NumLocalStores );
+    }
+    else
+    {
+        m_SharedCache->FreeMemory( data, dataSize );
+    }
+    return copy;
+}
+
+//------------------------------------------------------------------------------
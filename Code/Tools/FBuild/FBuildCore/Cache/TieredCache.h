@@ -0,0 +1,62 @@
+// TieredCache - Local cache in front of a shared cache
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ICache.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Cache;
+class CachePublishQueue;
+
+// TieredCache
+//  - Entries are looked up in the local cache (a directory, typically on a fast
+//    local disk) first and then the shared cache (a network share or plugin)
+//  - Shared cache hits are copied into the local cache in the background
+//  - Publishing writes to both
+//  - The local cache is trimmed to its size limit on shutdown, if anything
+//    was added to it
+//  - Either cache can be unavailable, in which case the other is used alone
+//------------------------------------------------------------------------------
+class TieredCache : public ICache
+{
+public:
+    // Takes ownership of the shared cache (which can be null)
+    explicit TieredCache( ICache * sharedCache, const AString & localCachePath, uint32_t localCacheSizeMiB );
+    virtual ~TieredCache() override;
+
+    virtual bool Init( const AString & cachePath, const AString & cachePathMountPoint ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool Exists( const AString & cacheId ) override;
+    virtual void RetrieveBatch( const Array< AString > & cacheIds, Array< void * > & outData, Array< size_t > & outDataSizes ) override;
+    virtual void ExistsBatch( const Array< AString > & cacheIds, Array< bool > & outExists ) override;
+    virtual bool RetrieveMapped( const AString & cacheId, const void * & data, size_t & dataSize, bool & outIsMapped ) override;
+
+    // stats
+    inline uint32_t GetNumLocalHits() const     { return m_NumLocalHits; }
+    inline uint32_t GetNumSharedHits() const    { return m_NumSharedHits; }
+    inline uint32_t GetNumPromoted() const      { return m_NumPromoted; }
+
+private:
+    void *  OnSharedHit( const AString & cacheId, void * data, size_t dataSize );
+
+    ICache *            m_SharedCache;
+    Cache *             m_LocalCache;
+    CachePublishQueue * m_PromoteQueue;     // copies shared hits into the local cache
+    AString             m_LocalCachePath;
+    uint64_t            m_LocalCacheMaxBytes;
+    uint32_t            m_NumLocalStores;   // published or promoted, so trim is needed
+    uint32_t            m_NumLocalHits;
+    uint32_t            m_NumSharedHits;
+    uint32_t            m_NumPromoted;
+};
+
+//------------------------------------------------------------------------------
@@ -12,11 +12,16 @@
 #include "Cache/ICache.h"
 #include "Cache/Cache.h"
 #include "Cache/CachePlugin.h"
+#include "Cache/CachePrefetcher.h"
+#include "Cache/CachePublishQueue.h"
 #include "Cache/LightCache.h"
+#include "Cache/TieredCache.h"
+#include "Graph/CompilerNode.h"
 #include "Graph/Node.h"
 #include "Graph/NodeGraph.h"
 #include "Graph/NodeProxy.h"
 #include "Graph/SettingsNode.h"
+#include "Helpers/BuildSnapshot.h"
 #include "Helpers/CompilationDatabase.h"
 #include "Helpers/Report.h"
 #include "Protocol/Client.h"
@@ -31,6 +36,7 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Mem/SmallBlockAllocator.h"
 #include "Core/Process/Atomic.h"
@@ -48,6 +54,11 @@
     #include <crtdbg.h>
 #endif
 
+// Defines
+//------------------------------------------------------------------------------
+#define CACHE_PUBLISH_THREADS           ( 4 )               // -cacheasync: stores are mostly waiting on I/O
+#define CACHE_PUBLISH_MAX_QUEUED_BYTES  ( 256 * MEGABYTE )  // -cacheasync: publish synchronously beyond this
+
 // Static
 //------------------------------------------------------------------------------
 /*static*/ bool FBuild::s_StopBuild( false );
@@ -60,6 +71,8 @@ FBuild::FBuild( const FBuildOptions & options )
     , m_JobQueue( nullptr )
     , m_Client( nullptr )
     , m_Cache( nullptr )
+    , m_TieredCache( nullptr )
+    , m_CachePublishQueue( nullptr )
     , m_LastProgressOutputTime( 0.0f )
     , m_LastProgressCalcTime( 0.0f )
     , m_SmoothedProgressCurrent( 0.0f )
@@ -138,8 +151,7 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         return false;
     }
 
-    const char * bffFile = m_Options.m_ConfigFile.IsEmpty() ? GetDefaultBFFFileName()
-                                                            : m_Options.m_ConfigFile.Get();
+    const char * bffFile = GetBFFFileName();
 
     if ( nodeGraphDBFile != nullptr )
     {
@@ -161,9 +173,37 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         #endif
     }
 
+    m_BuildSnapshotFile = m_DependencyGraphFile;
+    m_BuildSnapshotFile += ".snapshot";
+
+    // If nothing has changed since the last successful build of the requested
+    // targets, there's no need to load the DB at all
+    if ( IsBuildSnapshotUpToDate() )
+    {
+        GetBuildSnapshotKey( m_Options.m_Targets, m_UpToDateSnapshotKey );
+        return true;
+    }
+
+    return LoadDependencyGraph();
+}
+
+// GetBFFFileName
+//------------------------------------------------------------------------------
+const char * FBuild::GetBFFFileName() const
+{
+    return m_Options.m_ConfigFile.IsEmpty() ? GetDefaultBFFFileName()
+                                            : m_Options.m_ConfigFile.Get();
+}
+
+// LoadDependencyGraph
+//------------------------------------------------------------------------------
+bool FBuild::LoadDependencyGraph()
+{
+    PROFILE_FUNCTION
+
     SmallBlockAllocator::SetSingleThreadedMode( true );
 
-    m_DependencyGraph = NodeGraph::Initialize( bffFile, m_DependencyGraphFile.Get(), m_Options.m_ForceDBMigration_Debug );
+    m_DependencyGraph = NodeGraph::Initialize( GetBFFFileName(), m_DependencyGraphFile.Get(), m_Options.m_ForceDBMigration_Debug );
 
     SmallBlockAllocator::SetSingleThreadedMode( false );
 
@@ -177,13 +217,27 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
     // if the cache is enabled, make sure the path is set and accessible
     if ( m_Options.m_UseCacheRead || m_Options.m_UseCacheWrite || m_Options.m_CacheInfo || m_Options.m_CacheTrim )
     {
+        const AString & localCachePath = settings->GetCacheLocalPath();
+
+        ICache * sharedCache = nullptr;
         if ( !settings->GetCachePluginDLL().IsEmpty() )
         {
-            m_Cache = FNEW( CachePlugin( settings->GetCachePluginDLL() ) );
+            sharedCache = FNEW( CachePlugin( settings->GetCachePluginDLL() ) );
+        }
+        else if ( !settings->GetCachePath().IsEmpty() || localCachePath.IsEmpty() )
+        {
+            sharedCache = FNEW( Cache() );
+        }
+
+        // a local cache sits in front of the shared one (if there is one)
+        if ( !localCachePath.IsEmpty() )
+        {
+            m_TieredCache = FNEW( TieredCache( sharedCache, localCachePath, settings->GetCacheLocalSizeMiB() ) );
+            m_Cache = m_TieredCache;
         }
         else
         {
-            m_Cache = FNEW( Cache() );
+            m_Cache = sharedCache;
         }
 
         if ( m_Cache->Init( settings->GetCachePath(), settings->GetCachePathMountPoint() ) == false )
@@ -192,6 +246,7 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
             m_Options.m_UseCacheWrite = false;
             FDELETE m_Cache;
             m_Cache = nullptr;
+            m_TieredCache = nullptr;
         }
     }
 
@@ -266,6 +321,29 @@ bool FBuild::GetTargets( const Array< AString > & targets, Dependencies & outDep
 //------------------------------------------------------------------------------
 bool FBuild::Build( const Array< AString > & targets )
 {
+    // Initialize found the snapshot for these targets to be up-to-date?
+    if ( m_UpToDateSnapshotKey.IsEmpty() == false )
+    {
+        AStackString<> key;
+        GetBuildSnapshotKey( targets, key );
+        if ( key == m_UpToDateSnapshotKey )
+        {
+            FLOG_INFO( "Build skipped: nothing has changed since last successful build" );
+            for ( const AString & target : targets )
+            {
+                OUTPUT( "FBuild: OK: %s\n", target.Get() );
+            }
+            return true;
+        }
+
+        // Different targets to those checked - we need the DB after all
+        m_UpToDateSnapshotKey.Clear();
+        if ( LoadDependencyGraph() == false )
+        {
+            return false;
+        }
+    }
+
     // create a temporary node, not hooked into the DB
     NodeProxy proxy( AStackString< 32 >( "*proxy*" ) );
     Dependencies deps( targets.GetSize(), 0 );
@@ -285,9 +363,96 @@ bool FBuild::Build( const Array< AString > & targets )
         OUTPUT( "FBuild: %s: %s\n", nodeResult ? "OK" : "Error: BUILD FAILED", targets[ i ].Get() );
     }
 
+    // record inputs so a subsequent build can be skipped if nothing changes
+    if ( result && m_Options.m_UseBuildSnapshot )
+    {
+        SaveBuildSnapshot( targets, &proxy );
+    }
+
     return result;
 }
 
+// GetBuildSnapshotKey
+//------------------------------------------------------------------------------
+void FBuild::GetBuildSnapshotKey( const Array< AString > & targets, AString & outKey ) const
+{
+    // Args change the meaning of a build (-cache etc), so they are part of the key
+    outKey = m_Options.GetArgs();
+    for ( const AString & target : targets )
+    {
+        outKey += '|';
+        outKey += target;
+    }
+}
+
+// IsBuildSnapshotUpToDate
+//------------------------------------------------------------------------------
+bool FBuild::IsBuildSnapshotUpToDate() const
+{
+    PROFILE_FUNCTION
+
+    if ( ( m_Options.m_UseBuildSnapshot == false ) || m_Options.m_Targets.IsEmpty() )
+    {
+        return false;
+    }
+
+    // Anything other than a regular incremental build needs the DB
+    if ( m_Options.m_ForceCleanBuild ||
+         m_Options.m_DisplayTargetList ||
+         m_Options.m_DisplayDependencyDB ||
+         m_Options.m_GenerateCompilationDatabase ||
+         m_Options.m_GenerateReport ||
+         m_Options.m_CacheInfo ||
+         m_Options.m_CacheTrim ||
+         m_Options.m_ForceDBMigration_Debug )
+    {
+        return false;
+    }
+
+    const Timer t;
+
+    AStackString<> key;
+    GetBuildSnapshotKey( m_Options.m_Targets, key );
+    BuildSnapshot snapshot;
+    if ( snapshot.Load( m_BuildSnapshotFile.Get(), key ) == false )
+    {
+        return false;
+    }
+
+    const bool upToDate = snapshot.IsUpToDate( Math::Max( m_Options.m_NumWorkerThreads, 1u ) );
+    FLOG_INFO( "Build snapshot %s (%u files checked in %2.3fs)",
+               upToDate ? "up-to-date" : "out-of-date",
+               (uint32_t)snapshot.GetNumFiles(),
+               (double)t.GetElapsed() );
+    return upToDate;
+}
+
+// SaveBuildSnapshot
+//------------------------------------------------------------------------------
+void FBuild::SaveBuildSnapshot( const Array< AString > & targets, Node * rootNode ) const
+{
+    PROFILE_FUNCTION
+
+    // The snapshot must match the state recorded in the DB
+    if ( m_Options.m_SaveDBOnCompletion == false )
+    {
+        return;
+    }
+
+    BuildSnapshot snapshot;
+    if ( snapshot.Capture( *m_DependencyGraph, rootNode, m_DependencyGraphFile.Get() ) == false )
+    {
+        return; // graph contains work which must be done every build
+    }
+
+    AStackString<> key;
+    GetBuildSnapshotKey( targets, key );
+    if ( snapshot.Save( m_BuildSnapshotFile.Get(), key ) == false )
+    {
+        FLOG_WARN( "Failed to save build snapshot '%s'", m_BuildSnapshotFile.Get() );
+    }
+}
+
 // SaveDependencyGraph
 //------------------------------------------------------------------------------
 bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
@@ -366,7 +531,7 @@ bool FBuild::Build( Node * nodeToBuild )
     AtomicStoreRelaxed( &s_AbortBuild, false ); // allow multiple runs in same process
 
     // create worker threads
-    m_JobQueue = FNEW( JobQueue( m_Options.m_NumWorkerThreads ) );
+    m_JobQueue = FNEW( JobQueue( m_Options.m_NumWorkerThreads, m_DependencyGraph ? m_DependencyGraph->GetSettings() : nullptr ) );
 
     // create the connection management system if needed
     // (must be after JobQueue is created)
@@ -377,9 +542,26 @@ bool FBuild::Build( Node * nodeToBuild )
         Array< AString > workers;
         if ( settings->GetWorkerList().IsEmpty() )
         {
+            // toolchains used in previous builds let the coordinator
+            // favor workers which already have them
+            Array< uint64_t > toolIds( 0, true );
+            const size_t numNodes = m_DependencyGraph->GetNodeCount();
+            for ( size_t i = 0; i < numNodes; ++i )
+            {
+                const Node * node = m_DependencyGraph->GetNodeByIndex( i );
+                if ( node->GetType() == Node::COMPILER_NODE )
+                {
+                    const uint64_t toolId = node->CastTo< CompilerNode >()->GetManifest().GetToolId();
+                    if ( toolId )
+                    {
+                        toolIds.Append( toolId );
+                    }
+                }
+            }
+
             // check for workers through brokerage
             // TODO:C This could be moved out of the main code path
-            m_WorkerBrokerage.FindWorkers( workers );
+            m_WorkerBrokerage.FindWorkers( workers, settings->GetWorkerConnectionLimit(), toolIds );
         }
         else
         {
@@ -393,8 +575,23 @@ bool FBuild::Build( Node * nodeToBuild )
         }
         else
         {
+            // compilers to push to workers ahead of jobs
+            Array< const CompilerNode * > preseedCompilers( 0, true );
+            if ( m_Options.m_DistributionPreseed )
+            {
+                const size_t numNodes = m_DependencyGraph->GetNodeCount();
+                for ( size_t i = 0; i < numNodes; ++i )
+                {
+                    const Node * node = m_DependencyGraph->GetNodeByIndex( i );
+                    if ( ( node->GetType() == Node::COMPILER_NODE ) && node->CastTo< CompilerNode >()->CanBeDistributed() )
+                    {
+                        preseedCompilers.Append( node->CastTo< CompilerNode >() );
+                    }
+                }
+            }
+
             OUTPUT( "Distributed Compilation : %u Workers in pool '%s'\n", (uint32_t)workers.GetSize(), m_WorkerBrokerage.GetBrokerageRoot().Get() );
-            m_Client = FNEW( Client( workers, m_Options.m_DistributionPort, settings->GetWorkerConnectionLimit(), m_Options.m_DistVerbose ) );
+            m_Client = FNEW( Client( workers, m_Options.m_DistributionPort, settings->GetWorkerConnectionLimit(), m_Options.m_DistributionJobWindow, m_Options.m_DistributionDedup, m_Options.m_DistributionHighCompression, m_Options.m_DistributionDictionary, preseedCompilers, m_Options.m_DistVerbose ) );
         }
     }
 
@@ -413,6 +610,32 @@ bool FBuild::Build( Node * nodeToBuild )
 
     bool stopping( false );
 
+    // nodes register with their dependencies as they are discovered
+    if ( m_Options.m_EventDrivenScheduling )
+    {
+        m_DependencyGraph->ResetPendingDependencies();
+    }
+
+    // query all file stamps in parallel, instead of one at a time as the graph is walked
+    if ( m_Options.m_StatPrePass )
+    {
+        m_FileStampTable.Populate( *m_DependencyGraph, nodeToBuild, Math::Max( m_Options.m_NumWorkerThreads, 1u ) );
+        m_BuildStats.m_StatPrePassTime = m_FileStampTable.GetStatTime();
+        m_BuildStats.m_StatPrePassFiles = m_FileStampTable.GetNumFiles();
+    }
+
+    // publish to the cache from background threads, so workers can keep compiling
+    if ( m_Options.m_CacheAsync && m_Options.m_UseCacheWrite && m_Cache )
+    {
+        m_CachePublishQueue = FNEW( CachePublishQueue( m_Cache, CACHE_PUBLISH_THREADS, CACHE_PUBLISH_MAX_QUEUED_BYTES ) );
+    }
+
+    // prioritize nodes using build times from previous builds
+    if ( m_Options.m_CriticalPathScheduling )
+    {
+        m_DependencyGraph->ComputeCriticalPathCosts( nodeToBuild );
+    }
+
     // keep doing build passes until completed/failed
     for ( ;; )
     {
@@ -422,6 +645,7 @@ bool FBuild::Build( Node * nodeToBuild )
         if ( !stopping )
         {
             // do a sweep of the graph to create more jobs
+            // (only newly unblocked nodes if event driven)
             m_DependencyGraph->DoBuildPass( nodeToBuild );
         }
 
@@ -439,6 +663,14 @@ bool FBuild::Build( Node * nodeToBuild )
             if ( stopping == false )
             {
                 // free the network distribution system (if there is one)
+                if ( m_Client )
+                {
+                    m_BuildStats.m_DistBytesDeduplicated = m_Client->GetBytesDeduplicated();
+                    m_BuildStats.m_NumDistJobsHighCompression = m_Client->GetNumJobsHighCompression();
+                    m_BuildStats.m_NumDistJobsWithDictionary = m_Client->GetNumJobsWithDictionary();
+                    m_BuildStats.m_NumDistToolchainsPreseeded = m_Client->GetNumToolchainsPreseeded();
+                    m_BuildStats.m_NumDistResultChunks = m_Client->GetNumResultChunksReceived();
+                }
                 FDELETE m_Client;
                 m_Client = nullptr;
 
@@ -484,9 +716,44 @@ bool FBuild::Build( Node * nodeToBuild )
     // wrap up/free any jobs that come from the last build pass
     m_JobQueue->FinalizeCompletedJobs( *m_DependencyGraph );
 
+    if ( const CachePrefetcher * prefetcher = m_JobQueue->GetCachePrefetcher() )
+    {
+        m_BuildStats.m_NumCachePrefetches = prefetcher->GetNumPrefetched();
+        m_BuildStats.m_NumCachePrefetchHits = prefetcher->GetNumHits();
+        m_BuildStats.m_CachePrefetchTime = (float)prefetcher->GetLookupTimeMS() / 1000.0f;
+    }
+    m_BuildStats.m_PeakLocalLinkJobs = m_JobQueue->GetLocalLinkJobsPeak();
+    m_BuildStats.m_PeakLocalCopyJobs = m_JobQueue->GetLocalCopyJobsPeak();
+    m_BuildStats.m_PeakLocalJobMemoryMiB = m_JobQueue->GetLocalJobMemoryPeakMiB();
+
     FDELETE m_JobQueue;
     m_JobQueue = nullptr;
 
+    if ( m_TieredCache )
+    {
+        m_BuildStats.m_NumLocalCacheHits = m_TieredCache->GetNumLocalHits();
+        m_BuildStats.m_NumSharedCacheHits = m_TieredCache->GetNumSharedHits();
+        m_BuildStats.m_NumLocalCachePromotions = m_TieredCache->GetNumPromoted();
+    }
+
+    // everything queued for the cache must be published before we exit
+    if ( m_CachePublishQueue )
+    {
+        m_CachePublishQueue->Drain();
+        m_BuildStats.m_NumAsyncCacheStores = m_CachePublishQueue->GetNumPublished();
+        m_BuildStats.m_NumAsyncCacheStoreFails = m_CachePublishQueue->GetNumFailed();
+        for ( const Node * node : m_CachePublishQueue->GetPublishedNodes() )
+        {
+            node->SetStatFlag( Node::STATS_CACHE_STORE ); // only once stored, so failures aren't counted
+        }
+        m_BuildStats.m_AsyncCacheStoreTime = (float)m_CachePublishQueue->GetPublishTimeMS() / 1000.0f;
+        m_BuildStats.m_AsyncCacheDrainTime = (float)m_CachePublishQueue->GetDrainTimeMS() / 1000.0f;
+        FDELETE m_CachePublishQueue;
+        m_CachePublishQueue = nullptr;
+    }
+
+    m_FileStampTable.Clear();
+
     FLog::StopBuild();
 
     // even if the build has failed, we can still save the graph.
@@ -502,6 +769,11 @@ bool FBuild::Build( Node * nodeToBuild )
     float timeTaken = m_Timer.GetElapsed();
     m_BuildStats.m_TotalBuildTime = timeTaken;
 
+    if ( m_Options.m_CriticalPathScheduling )
+    {
+        m_DependencyGraph->GetCriticalPath( nodeToBuild, m_BuildStats.m_CriticalPath );
+    }
+
     m_BuildStats.OnBuildStop( nodeToBuild );
 
     return ( nodeToBuild->GetState() == Node::UP_TO_DATE );
@@ -7,6 +7,7 @@
 #include "Tools/FBuild/FBuildCore/FBuildOptions.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Helpers/FBuildStats.h"
+#include "Helpers/FileStampTable.h"
 #include "WorkerPool/WorkerBrokerage.h"
 
 #include "Core/Containers/Array.h"
@@ -20,11 +21,13 @@ class BFFMacros;
 class Client;
 class Dependencies;
 class FileStream;
+class CachePublishQueue;
 class ICache;
 class IOStream;
 class JobQueue;
 class Node;
 class NodeGraph;
+class TieredCache;
 
 // FBuild
 //------------------------------------------------------------------------------
@@ -87,6 +90,9 @@ public:
 
     // stats - read access
     const FBuildStats & GetStats() const    { return m_BuildStats; }
+
+    // -prestat
+    inline FileStampTable & GetFileStampTable() { return m_FileStampTable; }
     // stats - write access
     FBuildStats & GetStatsMutable()         { return m_BuildStats; }
 
@@ -97,6 +103,7 @@ public:
     static inline volatile bool * GetAbortBuildPointer() { return &s_AbortBuild; }
 
     inline ICache * GetCache() const { return m_Cache; }
+    inline CachePublishQueue * GetCachePublishQueue() const { return m_CachePublishQueue; } // -cacheasync
 
     static bool GetTempDir( AString & outTempDir );
 
@@ -106,6 +113,14 @@ public:
 protected:
     bool GetTargets( const Array< AString > & targets, Dependencies & outDeps ) const;
 
+    const char * GetBFFFileName() const;
+    bool LoadDependencyGraph();
+
+    // -snapshot
+    void GetBuildSnapshotKey( const Array< AString > & targets, AString & outKey ) const;
+    bool IsBuildSnapshotUpToDate() const;
+    void SaveBuildSnapshot( const Array< AString > & targets, Node * rootNode ) const;
+
     void UpdateBuildStatus( const Node * node );
 
     static bool s_StopBuild;
@@ -118,7 +133,11 @@ protected:
     Client * m_Client; // manage connections to worker servers
 
     AString m_DependencyGraphFile;
+    AString m_BuildSnapshotFile;
+    AString m_UpToDateSnapshotKey; // set if the DB load was skipped because nothing changed
     ICache * m_Cache;
+    TieredCache * m_TieredCache; // same as m_Cache, if a local cache is used
+    CachePublishQueue * m_CachePublishQueue;
 
     Timer m_Timer;
     float m_LastProgressOutputTime;
@@ -127,6 +146,7 @@ protected:
     float m_SmoothedProgressTarget;
 
     FBuildStats m_BuildStats;
+    FileStampTable m_FileStampTable;
 
     FBuildOptions m_Options;
 
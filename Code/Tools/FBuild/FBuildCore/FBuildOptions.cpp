@@ -71,7 +71,17 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
         // options start with a '-'
         if ( thisArg.BeginsWith( '-' ) )
         {
-            if ( thisArg == "-cache" )
+            if ( thisArg == "-adaptiverace" )
+            {
+                m_AdaptiveLocalRace = true;
+                continue;
+            }
+            else if ( thisArg == "-asyncdeps" )
+            {
+                m_AsyncDynamicDependencies = true;
+                continue;
+            }
+            else if ( thisArg == "-cache" )
             {
                 m_UseCacheRead = true;
                 m_UseCacheWrite = true;
@@ -87,11 +97,21 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_UseCacheWrite = true;
                 continue;
             }
+            else if ( thisArg == "-cacheasync" )
+            {
+                m_CacheAsync = true;
+                continue;
+            }
             else if ( thisArg == "-cacheinfo" )
             {
                 m_CacheInfo = true;
                 continue;
             }
+            else if ( thisArg == "-cacheprefetch" )
+            {
+                m_CachePrefetch = true;
+                continue;
+            }
             else if ( thisArg == "-cachetrim" )
             {
                 const int sizeIndex = ( i + 1 );
@@ -145,6 +165,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += '"';
                 continue;
             }
+            else if ( thisArg == "-criticalpath" )
+            {
+                m_CriticalPathScheduling = true;
+                continue;
+            }
             #ifdef DEBUG
                 else if ( thisArg == "-debug" )
                 {
@@ -157,12 +182,62 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_AllowDistributed = true;
                 continue;
             }
+            else if ( thisArg == "-distdedup" )
+            {
+                m_AllowDistributed = true;
+                m_DistributionDedup = true;
+                continue;
+            }
+            else if ( thisArg == "-distdictionary" )
+            {
+                m_AllowDistributed = true;
+                m_DistributionDictionary = true;
+                continue;
+            }
+            else if ( thisArg == "-disthc" )
+            {
+                m_AllowDistributed = true;
+                m_DistributionHighCompression = true;
+                continue;
+            }
+            else if ( thisArg == "-distpreseed" )
+            {
+                m_AllowDistributed = true;
+                m_DistributionPreseed = true;
+                continue;
+            }
             else if ( thisArg == "-distverbose" )
             {
                 m_AllowDistributed = true;
                 m_DistVerbose = true;
                 continue;
             }
+            else if ( thisArg == "-distwindow" )
+            {
+                const int windowIndex = ( i + 1 );
+                PRAGMA_DISABLE_PUSH_MSVC( 4996 ) // This function or variable may be unsafe...
+                if ( ( windowIndex >= argc ) ||
+                     ( sscanf( argv[ windowIndex ], "%u", &m_DistributionJobWindow ) ) != 1 || // TODO:C Consider using sscanf_s
+                     ( m_DistributionJobWindow == 0 ) || ( m_DistributionJobWindow > 256 ) )
+                PRAGMA_DISABLE_POP_MSVC // 4996
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <jobs> for '-distwindow' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                m_AllowDistributed = true;
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ windowIndex ];
+                continue;
+            }
+            else if ( thisArg == "-eventdriven" )
+            {
+                m_EventDrivenScheduling = true;
+                continue;
+            }
             else if ( thisArg == "-fastcancel" )
             {
                 m_FastCancel = true;
@@ -239,6 +314,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_NoUnity = true;
                 continue;
             }
+            else if ( thisArg == "-prestat" )
+            {
+                m_StatPrePass = true;
+                continue;
+            }
             else if ( thisArg == "-progress" )
             {
                 m_ShowProgress = true;
@@ -277,6 +357,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_ShowHiddenTargets = true;
                 continue;
             }
+            else if ( thisArg == "-snapshot" )
+            {
+                m_UseBuildSnapshot = true;
+                continue;
+            }
             else if ( thisArg == "-summary" )
             {
                 m_ShowSummary = true;
@@ -478,18 +563,42 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "Usage: %s [options] [target1]..[targetn]\n", programName.Get() );
     OUTPUT( "----------------------------------------------------------------------\n"
             "Options:\n"
+            " -adaptiverace  [Experimental] Only race remote jobs locally when\n"
+            "                the remote worker is expected to take longer.\n"
+            " -asyncdeps     [Experimental] Prepare dynamic dependencies of object\n"
+            "                lists and libraries on worker threads.\n"
             " -cache[read|write] Control use of the build cache.\n"
+            " -cacheasync    [Experimental] Publish to the cache from background\n"
+            "                threads.\n"
             " -cacheinfo     Output cache statistics.\n"
+            " -cacheprefetch [Experimental] Look up objects in the cache in\n"
+            "                batches, before they are built.\n"
             " -cachetrim [size] Trim the cache to the given size in MiB.\n"
             " -cacheverbose  Emit details about cache interactions.\n"
             " -clean         Force a clean build.\n"
             " -compdb        Generate JSON compilation database for specified targets.\n"
-            " -config [path] Explicitly specify the config file to use.\n" );
+            " -config [path] Explicitly specify the config file to use.\n"
+            " -criticalpath  [Experimental] Prioritize the longest chains of work,\n"
+            "                using build times from previous builds. The critical\n"
+            "                path is reported at the end of the build.\n" );
 #ifdef DEBUG
     OUTPUT( " -debug         Break at startup, to attach debugger.\n" );
 #endif
     OUTPUT( " -dist          Allow distributed compilation.\n"
+            " -distdedup     [Experimental] Don't resend preprocessed header content\n"
+            "                a worker has already received.\n"
+            " -distdictionary [Experimental] Compress job data with a dictionary\n"
+            "                trained on earlier jobs using the same compiler.\n"
+            " -disthc        [Experimental] Spend more client CPU time compressing\n"
+            "                job data, to send less of it to workers.\n"
+            " -distpreseed   [Experimental] Send compiler toolchains to workers as\n"
+            "                soon as they are connected, ahead of any jobs.\n"
             " -distverbose   Print detailed info for distributed compilation.\n"
+            " -distwindow [jobs] [Experimental] Number of jobs each worker may hold\n"
+            "                beyond those it is building, to hide network latency.\n"
+            "                Default is 1.\n"
+            " -eventdriven   [Experimental] Schedule nodes as their dependencies\n"
+            "                complete instead of sweeping the graph every pass.\n"
             " -fastcancel    [Experimental] Fast cancellation behavior on build failure.\n"
             " -fixuperrorpaths Reformat error paths to be Visual Studio friendly.\n"
             " -forceremote   Force distributable jobs to only be built remotely.\n"
@@ -505,6 +614,8 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -nostoponerror Don't stop building on first error. Try to build as much\n"
             "                as possible.\n"
             " -nosummaryonerror Hide the summary if the build fails. Implies -summary.\n"
+            " -prestat       [Experimental] Query the time stamps of all files in\n"
+            "                parallel before the build starts.\n"
             " -progress      Show the progress bar while building, even if stdout is redirected.\n"
             " -quiet         Don't show build output.\n"
             " -report        Ouput a detailed report.html at the end of the build.\n"
@@ -513,6 +624,8 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -showdeps      Show known dependency tree for specified targets.\n"
             " -showtargets   Display list of primary targets, excluding those marked \"Hidden\".\n"
             " -showalltargets Display list of primary targets, including those marked \"Hidden\".\n"
+            " -snapshot      [Experimental] Skip the build entirely if none of the\n"
+            "                inputs have changed since the last successful build.\n"
             " -summary       Show a summary at the end of the build.\n"
             " -verbose       Show detailed diagnostic information. This will slow\n"
             "                down building.\n"
@@ -57,20 +57,33 @@ public:
     bool        m_DisplayDependencyDB               = false;
     bool        m_GenerateCompilationDatabase       = false;
     bool        m_NoUnity                           = false;
+    bool        m_EventDrivenScheduling             = false;
+    bool        m_CriticalPathScheduling            = false;
+    bool        m_UseBuildSnapshot                  = false;
+    bool        m_StatPrePass                       = false;
+    bool        m_AsyncDynamicDependencies          = false;
 
     // Cache
     bool        m_UseCacheRead                      = false;
     bool        m_UseCacheWrite                     = false;
+    bool        m_CacheAsync                        = false;
     bool        m_CacheInfo                         = false;
+    bool        m_CachePrefetch                     = false;
     bool        m_CacheVerbose                      = false;
     uint32_t    m_CacheTrim                         = 0;
 
     // Distributed Compilation
     bool        m_AllowDistributed                  = false;
     bool        m_DistVerbose                       = false;
+    bool        m_DistributionDedup                 = false; // send header chunks workers already have by hash
+    bool        m_DistributionPreseed               = false; // push toolchains to workers ahead of jobs
+    bool        m_DistributionHighCompression       = false; // compress job data with LZ4HC for workers which support it
+    bool        m_DistributionDictionary            = false; // compress job data with a dictionary trained per toolchain
     bool        m_NoLocalConsumptionOfRemoteJobs    = false;
     bool        m_AllowLocalRace                    = true;
+    bool        m_AdaptiveLocalRace                 = false;
     uint16_t    m_DistributionPort                  = Protocol::PROTOCOL_PORT;
+    uint32_t    m_DistributionJobWindow             = 1; // jobs each worker may request beyond those it can build right now
 
     // General Output
     bool        m_ShowInfo                          = false;
@@ -13,6 +13,7 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Strings/AStackString.h"
 
 // Reflection
@@ -31,6 +32,7 @@ REFLECT_END( DirectoryListNode )
 DirectoryListNode::DirectoryListNode()
     : Node( AString::GetEmpty(), Node::DIRECTORY_LIST_NODE, Node::FLAG_NONE )
     , m_Recursive( true )
+    , m_ListingHash( 0 )
 {
     m_LastBuildTimeMs = 100;
 }
@@ -129,6 +131,20 @@ DirectoryListNode::~DirectoryListNode() = default;
     }
 }
 
+// CalcListingHash
+//------------------------------------------------------------------------------
+/*static*/ uint64_t DirectoryListNode::CalcListingHash( const Array< FileIO::FileInfo > & files )
+{
+    // Sum the name hashes so the result doesn't depend on the order the OS
+    // returns the files in. Mix in the count so an empty listing is non-zero.
+    uint64_t hash = ( files.GetSize() + 1 );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        hash += xxHash::Calc64( file.m_Name );
+    }
+    return hash;
+}
+
 // DoBuild
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult DirectoryListNode::DoBuild( Job * UNUSED( job ) )
@@ -138,6 +154,7 @@ DirectoryListNode::~DirectoryListNode() = default;
 
     Array< FileIO::FileInfo > files( 4096, true );
     FileIO::GetFilesEx( m_Path, &m_Patterns, m_Recursive, &files );
+    m_ListingHash = CalcListingHash( files );
 
     m_Files.SetCapacity( files.GetSize() );
 
@@ -21,6 +21,9 @@ public:
 
     const AString & GetPath() const { return m_Path; }
     const Array< FileIO::FileInfo > & GetFiles() const { return m_Files; }
+    const Array< AString > & GetPatterns() const { return m_Patterns; }
+    bool IsRecursive() const { return m_Recursive; }
+    uint64_t GetListingHash() const { return m_ListingHash; }
 
     static inline Node::Type GetTypeS() { return Node::DIRECTORY_LIST_NODE; }
 
@@ -36,6 +39,9 @@ public:
                             const Array< AString > & excludePatterns,
                             AString & result );
 
+    // Order independent hash of the names in an (unfiltered) directory listing
+    static uint64_t CalcListingHash( const Array< FileIO::FileInfo > & files );
+
 private:
     virtual BuildResult DoBuild( Job * job ) override;
 
@@ -56,6 +62,7 @@ private:
     // Internal State
     Array< FileIO::FileInfo > m_Files;
     AString m_PrettyName;
+    uint64_t m_ListingHash;
 };
 
 //------------------------------------------------------------------------------
@@ -22,6 +22,8 @@ public:
 
     static inline Node::Type GetTypeS() { return Node::EXEC_NODE; }
 
+    inline bool GetExecAlways() const { return m_ExecAlways; }
+
 private:
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph, bool forceClean ) override;
     virtual bool DetermineNeedToBuild( bool forceClean ) const override;
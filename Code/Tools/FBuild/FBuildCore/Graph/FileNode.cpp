@@ -46,7 +46,7 @@ FileNode::~FileNode() = default;
 /*virtual*/ Node::BuildResult FileNode::DoBuild( Job * UNUSED( job ) )
 {
     // NOTE: Not calling RecordStampFromBuiltFile as this is not a built file
-    m_Stamp = FileIO::GetFileLastWriteTime( m_Name );
+    m_Stamp = QueryFileStamp();
     // Don't assert m_Stamp != 0 as input file might not exist
     return NODE_RESULT_OK;
 }
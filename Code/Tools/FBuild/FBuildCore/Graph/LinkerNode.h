@@ -35,6 +35,7 @@ public:
     };
 
     inline bool IsADLL() const { return GetFlag( LINK_FLAG_DLL ); }
+    inline uint32_t GetLinkerJobMemoryMiB() const { return m_LinkerJobMemoryMiB; }
 
     static uint32_t DetermineLinkerTypeFlags( const AString & linkerType, const AString & linkerName );
     static uint32_t DetermineFlags( const AString & linkerType, const AString & linkerName, const AString & args );
@@ -94,6 +95,7 @@ protected:
     bool                m_LinkerLinkObjects             = false;
     AString             m_LinkerStampExe;
     AString             m_LinkerStampExeArgs;
+    uint32_t            m_LinkerJobMemoryMiB            = 0;
     Array< AString >    m_PreBuildDependencyNames;
     Array< AString >    m_Environment;
 
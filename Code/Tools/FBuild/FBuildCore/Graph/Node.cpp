@@ -131,6 +131,9 @@ Node::Node( const AString & name, Type type, uint32_t controlFlags )
     , m_ProgressAccumulator( 0 )
     , m_Index( INVALID_NODE_INDEX )
     , m_Hidden( false )
+    , m_NumPendingDependencies( 0 )
+    , m_PreferredWorkerThread( 0 )
+    , m_PreparingDynamicDependencies( false )
 {
     SetName( name );
 
@@ -142,6 +145,13 @@ Node::Node( const AString & name, Type type, uint32_t controlFlags )
 //------------------------------------------------------------------------------
 Node::~Node() = default;
 
+// PrepareDynamicDependencies
+//------------------------------------------------------------------------------
+/*virtual*/ bool Node::PrepareDynamicDependencies( Job * )
+{
+    return true;
+}
+
 // DoDynamicDependencies
 //------------------------------------------------------------------------------
 /*virtual*/ bool Node::DoDynamicDependencies( NodeGraph &, bool )
@@ -171,7 +181,7 @@ bool Node::DetermineNeedToBuild( bool forceClean ) const
 
     if ( IsAFile() )
     {
-        uint64_t lastWriteTime = FileIO::GetFileLastWriteTime( m_Name );
+        uint64_t lastWriteTime = QueryFileStamp();
 
         if ( lastWriteTime == 0 )
         {
@@ -1137,6 +1147,20 @@ bool Node::InitializePreBuildDependencies( NodeGraph & nodeGraph, const BFFItera
     return inoutCachedEnvString;
 }
 
+// QueryFileStamp
+//------------------------------------------------------------------------------
+uint64_t Node::QueryFileStamp() const
+{
+    ASSERT( IsAFile() );
+
+    uint64_t stamp;
+    if ( FBuild::IsValid() && FBuild::Get().GetFileStampTable().GetStamp( this, stamp ) )
+    {
+        return stamp;
+    }
+    return FileIO::GetFileLastWriteTime( m_Name );
+}
+
 // RecordStampFromBuiltFile
 //------------------------------------------------------------------------------
 void Node::RecordStampFromBuiltFile()
@@ -82,6 +82,7 @@ public:
     {
         FLAG_NONE                   = 0x00,
         FLAG_TRIVIAL_BUILD          = 0x01, // DoBuild is performed locally in main thread
+        FLAG_ASYNC_DYNAMIC_DEPS     = 0x02, // PrepareDynamicDependencies can be performed in a job
     };
 
     enum StatsFlag
@@ -211,6 +212,7 @@ protected:
     inline void SetIndex( uint32_t index ) { m_Index = index; }
 
     // each node must implement these core functions
+    virtual bool PrepareDynamicDependencies( Job * job ); // (Worker Thread) No NodeGraph access
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph, bool forceClean );
     virtual bool DetermineNeedToBuild( bool forceClean ) const;
     virtual BuildResult DoBuild( Job * job );
@@ -243,6 +245,9 @@ protected:
 
     void RecordStampFromBuiltFile();
 
+    // Last write time of the file for this node (using -prestat results if available)
+    uint64_t QueryFileStamp() const;
+
     AString m_Name;
 
     State m_State;
@@ -265,6 +270,12 @@ protected:
     Dependencies m_StaticDependencies;
     Dependencies m_DynamicDependencies;
 
+    // Event driven scheduling (see NodeGraph::ReleaseDependents)
+    uint32_t        m_NumPendingDependencies;   // dependencies this node is waiting on
+    Array< Node * > m_WaitingDependents;        // nodes waiting on this node to complete
+    uint32_t        m_PreferredWorkerThread;    // worker which released this node (0 = none)
+    bool            m_PreparingDynamicDependencies; // job is for PrepareDynamicDependencies, not DoBuild
+
     #if defined( DEBUG )
         mutable bool    m_IsSaved = false; // Help catch serialization errors
     #endif
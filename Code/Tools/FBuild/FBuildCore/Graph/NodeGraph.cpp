@@ -65,6 +65,7 @@
 NodeGraph::NodeGraph()
 : m_AllNodes( 1024, true )
 , m_NextNodeIndex( 0 )
+, m_ReadyNodes( 1024, true )
 , m_UsedFiles( 16, true )
 , m_Settings( nullptr )
 {
@@ -1021,6 +1022,30 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
 
     s_BuildPassTag++;
 
+    // revisit nodes unblocked since the last pass
+    if ( FBuild::Get().GetOptions().m_EventDrivenScheduling )
+    {
+        // NOTE: list can grow as nodes complete immediately
+        for ( size_t i = 0; i < m_ReadyNodes.GetSize(); ++i )
+        {
+            Node * n = m_ReadyNodes[ i ];
+
+            // may have been processed (or failed) since it was queued
+            if ( ( n->GetState() >= Node::BUILDING ) || ( n->m_NumPendingDependencies > 0 ) )
+            {
+                continue;
+            }
+
+            // resume with the cost accumulated when the node started waiting
+            const uint32_t ownCost = n->GetLastBuildTime();
+            const uint32_t cost = ( n->m_RecursiveCost > ownCost ) ? ( n->m_RecursiveCost - ownCost ) : 0;
+            n->SetBuildPassTag( s_BuildPassTag );
+            BuildRecurse( n, cost );
+            ReleaseDependents( n );
+        }
+        m_ReadyNodes.Clear();
+    }
+
     if ( nodeToBuild->GetType() == Node::PROXY_NODE )
     {
         const size_t total = nodeToBuild->GetStaticDependencies().GetSize();
@@ -1040,9 +1065,10 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
                 upToDateCount++;
                 continue;
             }
-            if ( n->GetState() != Node::BUILDING )
+            if ( ( n->GetState() != Node::BUILDING ) && ( n->m_NumPendingDependencies == 0 ) )
             {
                 BuildRecurse( n, 0 );
+                ReleaseDependents( n );
 
                 // check for nodes that become up-to-date immediately (trivial build)
                 if ( n->GetState() == Node::UP_TO_DATE )
@@ -1068,7 +1094,7 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
     }
     else
     {
-        if ( nodeToBuild->GetState() < Node::BUILDING )
+        if ( ( nodeToBuild->GetState() < Node::BUILDING ) && ( nodeToBuild->m_NumPendingDependencies == 0 ) )
         {
             BuildRecurse( nodeToBuild, 0 );
         }
@@ -1078,6 +1104,239 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
     JobQueue::Get().FlushJobBatch();
 }
 
+// ReleaseDependents
+//  - When scheduling is event driven, nodes waiting on dependencies register
+//    with those dependencies instead of being re-checked on every build pass.
+//    Once a node completes, the waiting nodes with no other outstanding
+//    dependencies are queued for the next build pass.
+//  - workerThreadIndex is the worker which completed the node (if any). Nodes
+//    released by it will prefer that worker's job queue.
+//------------------------------------------------------------------------------
+void NodeGraph::ReleaseDependents( Node * node, uint32_t workerThreadIndex )
+{
+    // only complete nodes release their dependents
+    if ( ( node->GetState() < Node::FAILED ) || node->m_WaitingDependents.IsEmpty() )
+    {
+        return;
+    }
+
+    const bool propagateFailure = ( node->GetState() == Node::FAILED ) &&
+                                  FBuild::Get().GetOptions().m_StopOnFirstError;
+
+    for ( Node * dependent : node->m_WaitingDependents )
+    {
+        ASSERT( dependent->m_NumPendingDependencies > 0 );
+        --dependent->m_NumPendingDependencies;
+
+        // dependent may have failed due to another dependency
+        if ( dependent->GetState() >= Node::BUILDING )
+        {
+            continue;
+        }
+
+        if ( propagateFailure )
+        {
+            // propogate failure state immediately (as CheckDependencies would)
+            dependent->SetState( Node::FAILED );
+            ReleaseDependents( dependent );
+            continue;
+        }
+
+        if ( dependent->m_NumPendingDependencies == 0 )
+        {
+            dependent->m_PreferredWorkerThread = workerThreadIndex;
+            m_ReadyNodes.Append( dependent );
+        }
+    }
+    node->m_WaitingDependents.Clear();
+}
+
+// FinishDynamicDependencies (Main Thread)
+//  - Complete dynamic dependencies which were prepared in a job (see BuildRecurse)
+//------------------------------------------------------------------------------
+void NodeGraph::FinishDynamicDependencies( Node * node, bool prepared, uint32_t workerThreadIndex )
+{
+    ASSERT( node->GetState() == Node::BUILDING );
+    ASSERT( node->m_PreparingDynamicDependencies );
+    node->m_PreparingDynamicDependencies = false;
+
+    const bool forceClean = FBuild::Get().GetOptions().m_ForceCleanBuild;
+    if ( prepared && node->DoDynamicDependencies( *this, forceClean ) )
+    {
+        node->SetState( Node::DYNAMIC_DEPS_DONE );
+
+        // revisit in the next pass (when not event driven, the next pass
+        // from the root will find it)
+        if ( FBuild::Get().GetOptions().m_EventDrivenScheduling )
+        {
+            node->m_PreferredWorkerThread = workerThreadIndex;
+            m_ReadyNodes.Append( node );
+        }
+        return;
+    }
+
+    node->SetState( Node::FAILED );
+    ReleaseDependents( node, workerThreadIndex );
+}
+
+// ResetPendingDependencies
+//------------------------------------------------------------------------------
+void NodeGraph::ResetPendingDependencies()
+{
+    // discard anything left over from a previous (possibly aborted) build
+    for ( Node * node : m_AllNodes )
+    {
+        node->m_NumPendingDependencies = 0;
+        node->m_WaitingDependents.Clear();
+    }
+    m_ReadyNodes.Clear();
+}
+
+// ComputeCriticalPathCosts
+//  - Using the build times recorded in previous builds, find the longest chain
+//    of work from each node up to the root (including the node itself). This
+//    is used as the cost of the node, so jobs the build will end up waiting on
+//    are prioritized over jobs with more slack.
+//------------------------------------------------------------------------------
+void NodeGraph::ComputeCriticalPathCosts( Node * rootNode )
+{
+    PROFILE_FUNCTION
+
+    // order nodes so dependencies come before their dependents
+    Array< Node * > nodes( m_AllNodes.GetSize() + 1, true );
+    s_BuildPassTag++;
+    GatherNodesInDependencyOrder( rootNode, nodes );
+
+    for ( Node * node : nodes )
+    {
+        node->m_RecursiveCost = 0;
+    }
+
+    // walk from the root down, pushing the longest chain above each node down
+    // to its dependencies (all dependents are visited before a dependency)
+    for ( size_t i = nodes.GetSize(); i > 0; --i )
+    {
+        Node * node = nodes[ i - 1 ];
+        node->m_RecursiveCost += node->GetLastBuildTime();
+        PropagateCriticalPathCost( node->GetPreBuildDependencies(), node->m_RecursiveCost );
+        PropagateCriticalPathCost( node->GetStaticDependencies(), node->m_RecursiveCost );
+        PropagateCriticalPathCost( node->GetDynamicDependencies(), node->m_RecursiveCost );
+    }
+}
+
+// GetCriticalPath
+//  - Find the chain of dependencies which took the longest to process in the
+//    last build (i.e. the one which bounded the build time). The path is
+//    returned in the order it was built.
+//------------------------------------------------------------------------------
+void NodeGraph::GetCriticalPath( Node * rootNode, Array< const Node * > & outPath ) const
+{
+    PROFILE_FUNCTION
+
+    // order nodes so dependencies come before their dependents
+    Array< Node * > nodes( m_AllNodes.GetSize() + 1, true );
+    s_BuildPassTag++;
+    GatherNodesInDependencyOrder( rootNode, nodes );
+
+    // calculate the longest chain of processing time leading to each node
+    Array< uint32_t > chainTimes;
+    chainTimes.SetSize( m_AllNodes.GetSize() );
+    for ( const Node * node : nodes )
+    {
+        if ( node->GetIndex() == INVALID_NODE_INDEX )
+        {
+            ASSERT( node == rootNode ); // only the root can be outside the graph (a proxy)
+            continue;
+        }
+        const Node * criticalDep = GetCriticalDependency( node, chainTimes );
+        chainTimes[ node->GetIndex() ] = node->GetProcessingTime() + ( criticalDep ? chainTimes[ criticalDep->GetIndex() ] : 0 );
+    }
+
+    // follow the longest chain down from the root
+    Array< const Node * > path( 64, true );
+    const Node * node = rootNode;
+    while ( ( node = GetCriticalDependency( node, chainTimes ) ) != nullptr )
+    {
+        path.Append( node );
+    }
+
+    outPath.Clear();
+    outPath.SetCapacity( path.GetSize() );
+    for ( size_t i = path.GetSize(); i > 0; --i )
+    {
+        outPath.Append( path[ i - 1 ] );
+    }
+}
+
+// GatherNodesInDependencyOrder
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::GatherNodesInDependencyOrder( Node * node, Array< Node * > & nodes )
+{
+    // don't visit the same node multiple times in the same pass
+    if ( node->GetBuildPassTag() == s_BuildPassTag )
+    {
+        return;
+    }
+    node->SetBuildPassTag( s_BuildPassTag );
+
+    GatherNodesInDependencyOrder( node->GetPreBuildDependencies(), nodes );
+    GatherNodesInDependencyOrder( node->GetStaticDependencies(), nodes );
+    GatherNodesInDependencyOrder( node->GetDynamicDependencies(), nodes );
+
+    nodes.Append( node );
+}
+
+// GatherNodesInDependencyOrder
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::GatherNodesInDependencyOrder( const Dependencies & dependencies, Array< Node * > & nodes )
+{
+    for ( const Dependency & dep : dependencies )
+    {
+        GatherNodesInDependencyOrder( dep.GetNode(), nodes );
+    }
+}
+
+// PropagateCriticalPathCost
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::PropagateCriticalPathCost( const Dependencies & dependencies, uint32_t cost )
+{
+    for ( const Dependency & dep : dependencies )
+    {
+        Node * n = dep.GetNode();
+        if ( cost > n->m_RecursiveCost )
+        {
+            n->m_RecursiveCost = cost;
+        }
+    }
+}
+
+// GetCriticalDependency
+//  - Return the dependency with the longest chain time (or nullptr if none)
+//------------------------------------------------------------------------------
+/*static*/ const Node * NodeGraph::GetCriticalDependency( const Node * node, const Array< uint32_t > & chainTimes )
+{
+    const Node * criticalDep = nullptr;
+    uint32_t criticalTime = 0;
+
+    const Dependencies * dependencyLists[] = { &node->GetPreBuildDependencies(),
+                                               &node->GetStaticDependencies(),
+                                               &node->GetDynamicDependencies() };
+    for ( const Dependencies * dependencies : dependencyLists )
+    {
+        for ( const Dependency & dep : *dependencies )
+        {
+            const Node * n = dep.GetNode();
+            const uint32_t chainTime = chainTimes[ n->GetIndex() ];
+            if ( ( criticalDep == nullptr ) || ( chainTime > criticalTime ) )
+            {
+                criticalDep = n;
+                criticalTime = chainTime;
+            }
+        }
+    }
+    return criticalDep;
+}
+
 // BuildRecurse
 //------------------------------------------------------------------------------
 void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
@@ -1125,6 +1384,19 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
 
     if ( nodeToBuild->GetState() != Node::DYNAMIC_DEPS_DONE )
     {
+        // static deps ready, prepare dynamic deps in a job if possible
+        // (merged in FinishDynamicDependencies once complete)
+        if ( ( nodeToBuild->GetControlFlags() & Node::FLAG_ASYNC_DYNAMIC_DEPS ) &&
+             FBuild::Get().GetOptions().m_AsyncDynamicDependencies )
+        {
+            if ( cost > nodeToBuild->m_RecursiveCost )
+            {
+                nodeToBuild->m_RecursiveCost = cost;
+            }
+            JobQueue::Get().AddDynamicDependenciesJobToBatch( nodeToBuild );
+            return;
+        }
+
         // static deps ready, update dynamic deps
         bool forceClean = FBuild::Get().GetOptions().m_ForceCleanBuild;
         if ( nodeToBuild->DoDynamicDependencies( *this, forceClean ) == false )
@@ -1154,7 +1426,13 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
     nodeToBuild->SetStatFlag( Node::STATS_PROCESSED );
     if ( nodeToBuild->DetermineNeedToBuild( forceClean ) )
     {
-        nodeToBuild->m_RecursiveCost = cost;
+        // when scheduling by critical path, the cost has been calculated
+        // up-front (but nodes new to this build won't have one)
+        if ( ( FBuild::Get().GetOptions().m_CriticalPathScheduling == false ) ||
+             ( cost > nodeToBuild->m_RecursiveCost ) )
+        {
+            nodeToBuild->m_RecursiveCost = cost;
+        }
         JobQueue::Get().AddJobToBatch( nodeToBuild );
     }
     else
@@ -1175,6 +1453,7 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
     uint32_t numberNodesUpToDate = 0;
     uint32_t numberNodesFailed = 0;
     const bool stopOnFirstError = FBuild::Get().GetOptions().m_StopOnFirstError;
+    const bool eventDriven = FBuild::Get().GetOptions().m_EventDrivenScheduling;
 
     Dependencies::Iter i = dependencies.Begin();
     Dependencies::Iter end = dependencies.End();
@@ -1187,13 +1466,14 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
         // recurse into nodes which have not been processed yet
         if ( state < Node::BUILDING )
         {
-            // early out if already seen
-            if ( n->GetBuildPassTag() != passTag )
+            // early out if already seen, or if waiting on its own dependencies
+            if ( ( n->GetBuildPassTag() != passTag ) && ( n->m_NumPendingDependencies == 0 ) )
             {
                 // prevent multiple recursions in this pass
                 n->SetBuildPassTag( passTag );
 
                 BuildRecurse( n, cost );
+                ReleaseDependents( n );
             }
         }
 
@@ -1227,6 +1507,16 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
                 break;
             }
         }
+        else if ( eventDriven )
+        {
+            // wait to be released when the dependency completes
+            n->m_WaitingDependents.Append( nodeToBuild );
+            ++nodeToBuild->m_NumPendingDependencies;
+            if ( cost > nodeToBuild->m_RecursiveCost )
+            {
+                nodeToBuild->m_RecursiveCost = cost;
+            }
+        }
 
         // keep trying to progress other nodes...
     }
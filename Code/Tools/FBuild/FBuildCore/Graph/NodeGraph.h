@@ -55,7 +55,7 @@ public:
     }
     inline ~NodeGraphHeader() = default;
 
-    enum : uint8_t { NODE_GRAPH_CURRENT_VERSION = 132 };
+    enum : uint8_t { NODE_GRAPH_CURRENT_VERSION = 134 };
 
     bool IsValid() const
     {
@@ -124,6 +124,13 @@ public:
     SettingsNode * CreateSettingsNode( const AString & name );
 
     void DoBuildPass( Node * nodeToBuild );
+    void ReleaseDependents( Node * node, uint32_t workerThreadIndex = 0 );
+    void FinishDynamicDependencies( Node * node, bool prepared, uint32_t workerThreadIndex );
+    void ResetPendingDependencies();
+
+    // critical path scheduling/reporting
+    void ComputeCriticalPathCosts( Node * rootNode );
+    void GetCriticalPath( Node * rootNode, Array< const Node * > & outPath ) const;
 
     static void CleanPath( AString & name, bool makeFullPath = true );
     static void CleanPath( const AString & name, AString & cleanPath, bool makeFullPath = true );
@@ -141,6 +148,8 @@ public:
                                    uint32_t & totalNodeTime );
 private:
     friend class FBuild;
+    friend class BuildSnapshot;
+    friend class FileStampTable;
 
     bool ParseFromRoot( const char * bffFile );
 
@@ -155,6 +164,11 @@ private:
                                           uint32_t & nodesBuiltTime,
                                           uint32_t & totalNodeTime );
 
+    static void GatherNodesInDependencyOrder( Node * node, Array< Node * > & nodes );
+    static void GatherNodesInDependencyOrder( const Dependencies & dependencies, Array< Node * > & nodes );
+    static void PropagateCriticalPathCost( const Dependencies & dependencies, uint32_t cost );
+    static const Node * GetCriticalDependency( const Node * node, const Array< uint32_t > & chainTimes );
+
     Node * FindNodeInternal( const AString & fullPath ) const;
 
     struct NodeWithDistance
@@ -193,6 +207,9 @@ private:
 
     Timer m_Timer;
 
+    // nodes whose dependencies have all completed (event driven scheduling)
+    Array< Node * > m_ReadyNodes;
+
     // each file used in the generation of the node graph is tracked
     struct UsedFile
     {
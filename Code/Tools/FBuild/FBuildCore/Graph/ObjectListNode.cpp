@@ -49,6 +49,7 @@ REFLECT_NODE_BEGIN( ObjectListNode, Node, MetaNone() )
     REFLECT( m_DeoptimizeWritableFilesWithToken,    "DeoptimizeWritableFilesWithToken", MetaOptional() )
     REFLECT( m_AllowDistribution,                   "AllowDistribution",                MetaOptional() )
     REFLECT( m_AllowCaching,                        "AllowCaching",                     MetaOptional() )
+    REFLECT( m_CompilerJobMemoryMiB,                "CompilerJobMemoryMiB",             MetaOptional() )
     REFLECT( m_Hidden,                              "Hidden",                           MetaOptional() )
     // Precompiled Headers
     REFLECT( m_PCHInputFile,                        "PCHInputFile",                     MetaOptional() + MetaFile() )
@@ -72,7 +73,7 @@ REFLECT_END( ObjectListNode )
 // ObjectListNode
 //------------------------------------------------------------------------------
 ObjectListNode::ObjectListNode()
-: Node( AString::GetEmpty(), Node::OBJECT_LIST_NODE, Node::FLAG_NONE )
+: Node( AString::GetEmpty(), Node::OBJECT_LIST_NODE, Node::FLAG_ASYNC_DYNAMIC_DEPS )
 {
     m_LastBuildTimeMs = 10000;
 
@@ -258,134 +259,158 @@ ObjectListNode::~ObjectListNode() = default;
     return false;
 }
 
-// GatherDynamicDependencies
+// PrepareDynamicDependencies (Worker Thread)
+//  - Determine the inputs and the objects to compile them to. This doesn't
+//    need the NodeGraph, so it can be done in a job (see NodeGraph::BuildRecurse)
 //------------------------------------------------------------------------------
-/*virtual*/ bool ObjectListNode::GatherDynamicDependencies( NodeGraph & nodeGraph, bool forceClean )
+/*virtual*/ bool ObjectListNode::PrepareDynamicDependencies( Job * /*job*/ )
 {
-    (void)forceClean; // dynamic deps are always re-added here, so this is meaningless
-
-    // clear dynamic deps from previous passes
-    m_DynamicDependencies.Clear();
-
-    #if defined( __WINDOWS__ )
-        // On Windows, with MSVC we compile a cpp file to generate the PCH
-        // Filter here to ensure that doesn't get compiled twice
-        Node * pchCPP = nullptr;
-        if ( m_UsingPrecompiledHeader && GetPrecompiledHeader()->IsMSVC() )
-        {
-            pchCPP = GetPrecompiledHeader()->GetPrecompiledHeaderCPPFile();
-        }
-    #endif
+    m_DynamicInputs.Clear();
 
     // Handle converting all static inputs into dynamic onces (i.e. cpp->obj)
     for ( size_t i=m_ObjectListInputStartIndex; i<m_ObjectListInputEndIndex; ++i )
     {
-        Dependency & dep = m_StaticDependencies[ i ];
+        Node * inputNode = m_StaticDependencies[ i ].GetNode();
 
         // is this a dir list?
-        if ( dep.GetNode()->GetType() == Node::DIRECTORY_LIST_NODE )
+        if ( inputNode->GetType() == Node::DIRECTORY_LIST_NODE )
         {
             // get the list of files
-            DirectoryListNode * dln = dep.GetNode()->CastTo< DirectoryListNode >();
+            const DirectoryListNode * dln = inputNode->CastTo< DirectoryListNode >();
             const Array< FileIO::FileInfo > & files = dln->GetFiles();
-            m_DynamicDependencies.SetCapacity( m_DynamicDependencies.GetSize() + files.GetSize() );
-            for ( Array< FileIO::FileInfo >::Iter fIt = files.Begin();
-                    fIt != files.End();
-                    fIt++ )
+            m_DynamicInputs.SetCapacity( m_DynamicInputs.GetSize() + files.GetSize() );
+            for ( const FileIO::FileInfo & fi : files )
             {
-                // Create the file node (or find an existing one)
-                Node * n = nodeGraph.FindNode( fIt->m_Name );
-                if ( n == nullptr )
-                {
-                    n = nodeGraph.CreateFileNode( fIt->m_Name );
-                }
-                else if ( n->IsAFile() == false )
-                {
-                    FLOG_ERROR( "Library() .CompilerInputFile '%s' is not a FileNode (type: %s)", n->GetName().Get(), n->GetTypeName() );
-                    return false;
-                }
-
-                // ignore the precompiled header as a convenience for the user
-                // so they don't have to exclude it explicitly
-                #if defined( __WINDOWS__ )
-                    if ( n == pchCPP )
-                    {
-                        continue;
-                    }
-                #endif
-
-                // create the object that will compile the above file
-                if ( CreateDynamicObjectNode( nodeGraph, n, dln->GetPath() ) == false )
-                {
-                    return false; // CreateDynamicObjectNode will have emitted error
-                }
+                AddDynamicInput( INPUT_DIRECTORY_LIST, nullptr, fi.m_Name, dln->GetPath() );
             }
         }
-        else if ( dep.GetNode()->GetType() == Node::UNITY_NODE )
+        else if ( inputNode->GetType() == Node::UNITY_NODE )
         {
             // get the dir list from the unity node
-            UnityNode * un = dep.GetNode()->CastTo< UnityNode >();
+            const UnityNode * un = inputNode->CastTo< UnityNode >();
 
             // unity files
             const Array< AString > & unityFiles = un->GetUnityFileNames();
-            for ( Array< AString >::Iter it = unityFiles.Begin();
-                  it != unityFiles.End();
-                  it++ )
+            for ( const AString & unityFile : unityFiles )
             {
-                Node * n = nodeGraph.FindNode( *it );
-                if ( n == nullptr )
-                {
-                    n = nodeGraph.CreateFileNode( *it );
-                }
-                else if ( n->IsAFile() == false )
-                {
-                    FLOG_ERROR( "Library() .CompilerInputUnity '%s' is not a FileNode (type: %s)", n->GetName().Get(), n->GetTypeName() );
-                    return false;
-                }
-
-                // create the object that will compile the above file
-                if ( CreateDynamicObjectNode( nodeGraph, n, AString::GetEmpty(), true ) == false )
-                {
-                    return false; // CreateDynamicObjectNode will have emitted error
-                }
+                AddDynamicInput( INPUT_UNITY, nullptr, unityFile, AString::GetEmpty() );
             }
 
             // files from unity to build individually
             const Array< UnityNode::FileAndOrigin > & isolatedFiles = un->GetIsolatedFileNames();
-            for ( Array< UnityNode::FileAndOrigin >::Iter it = isolatedFiles.Begin();
-                  it != isolatedFiles.End();
-                  it++ )
+            for ( const UnityNode::FileAndOrigin & isolatedFile : isolatedFiles )
             {
-                Node * n = nodeGraph.FindNode( it->GetName() );
-                if ( n == nullptr )
-                {
-                    n = nodeGraph.CreateFileNode( it->GetName() );
-                }
-                else if ( n->IsAFile() == false )
-                {
-                    FLOG_ERROR( "Library() Isolated '%s' is not a FileNode (type: %s)", n->GetName().Get(), n->GetTypeName() );
-                    return false;
-                }
-
-                // create the object that will compile the above file
-                const AString & baseDir = it->GetDirListOrigin() ? it->GetDirListOrigin()->GetPath() : AString::GetEmpty();
-                if ( CreateDynamicObjectNode( nodeGraph, n, baseDir, false, true ) == false )
-                {
-                    return false; // CreateDynamicObjectNode will have emitted error
-                }
+                const AString & baseDir = isolatedFile.GetDirListOrigin() ? isolatedFile.GetDirListOrigin()->GetPath() : AString::GetEmpty();
+                AddDynamicInput( INPUT_UNITY_ISOLATED, nullptr, isolatedFile.GetName(), baseDir );
             }
         }
-        else if ( dep.GetNode()->IsAFile() )
+        else if ( inputNode->IsAFile() )
+        {
+            // a single file
+            AddDynamicInput( INPUT_FILE, inputNode, inputNode->GetName(), AString::GetEmpty() );
+        }
+        else
+        {
+            ASSERT( false ); // unexpected node type
+        }
+    }
+
+    if ( m_ExtraASMPath.IsEmpty() == false )
+    {
+        if ( !FileIO::EnsurePathExists( m_ExtraASMPath ) )
+        {
+            FLOG_ERROR( "Failed to create folder for .asm file '%s'", m_ExtraASMPath.Get() );
+            return false;
+        }
+    }
+
+    if ( m_ExtraPDBPath.IsEmpty() == false )
+    {
+        if ( !FileIO::EnsurePathExists( m_ExtraPDBPath ) )
+        {
+            FLOG_ERROR( "Failed to create folder for .pdb file '%s'", m_ExtraPDBPath.Get() );
+            return false;
+        }
+    }
+
+    m_DynamicInputsPrepared = true;
+    return true;
+}
+
+// AddDynamicInput
+//------------------------------------------------------------------------------
+void ObjectListNode::AddDynamicInput( DynamicInputType type, Node * inputNode, const AString & inputFile, const AString & baseDir )
+{
+    m_DynamicInputs.Append( DynamicInput() );
+    DynamicInput & input = m_DynamicInputs.Top();
+    input.m_Type = type;
+    input.m_InputNode = inputNode;
+    input.m_InputFile = &inputFile;
+    GetObjectFileName( inputFile, baseDir, input.m_ObjectFile );
+}
+
+// GatherDynamicDependencies
+//------------------------------------------------------------------------------
+/*virtual*/ bool ObjectListNode::GatherDynamicDependencies( NodeGraph & nodeGraph, bool forceClean )
+{
+    (void)forceClean; // dynamic deps are always re-added here, so this is meaningless
+
+    ASSERT( m_DynamicInputsPrepared );
+
+    // clear dynamic deps from previous passes
+    m_DynamicDependencies.Clear();
+    m_DynamicDependencies.SetCapacity( m_DynamicInputs.GetSize() + 1 );
+
+    #if defined( __WINDOWS__ )
+        // On Windows, with MSVC we compile a cpp file to generate the PCH
+        // Filter here to ensure that doesn't get compiled twice
+        Node * pchCPP = nullptr;
+        if ( m_UsingPrecompiledHeader && GetPrecompiledHeader()->IsMSVC() )
+        {
+            pchCPP = GetPrecompiledHeader()->GetPrecompiledHeaderCPPFile();
+        }
+    #endif
+
+    for ( const DynamicInput & input : m_DynamicInputs )
+    {
+        // a single file, create the object that will compile it
+        if ( input.m_Type == INPUT_FILE )
         {
-            // a single file, create the object that will compile it
-            if ( CreateDynamicObjectNode( nodeGraph, dep.GetNode(), AString::GetEmpty() ) == false )
+            if ( CreateDynamicObjectNode( nodeGraph, input.m_InputNode, input.m_ObjectFile ) == false )
             {
                 return false; // CreateDynamicObjectNode will have emitted error
             }
+            continue;
         }
-        else
+
+        // Create the file node (or find an existing one)
+        Node * n = nodeGraph.FindNode( *input.m_InputFile );
+        if ( n == nullptr )
         {
-            ASSERT( false ); // unexpected node type
+            n = nodeGraph.CreateFileNode( *input.m_InputFile );
+        }
+        else if ( n->IsAFile() == false )
+        {
+            const char * property = ( input.m_Type == INPUT_DIRECTORY_LIST ) ? ".CompilerInputFile"
+                                  : ( input.m_Type == INPUT_UNITY ) ? ".CompilerInputUnity"
+                                  : "Isolated";
+            FLOG_ERROR( "Library() %s '%s' is not a FileNode (type: %s)", property, n->GetName().Get(), n->GetTypeName() );
+            return false;
+        }
+
+        // ignore the precompiled header as a convenience for the user
+        // so they don't have to exclude it explicitly
+        #if defined( __WINDOWS__ )
+            if ( ( input.m_Type == INPUT_DIRECTORY_LIST ) && ( n == pchCPP ) )
+            {
+                continue;
+            }
+        #endif
+
+        // create the object that will compile the above file
+        if ( CreateDynamicObjectNode( nodeGraph, n, input.m_ObjectFile, ( input.m_Type == INPUT_UNITY ), ( input.m_Type == INPUT_UNITY_ISOLATED ) ) == false )
+        {
+            return false; // CreateDynamicObjectNode will have emitted error
         }
     }
 
@@ -405,7 +430,19 @@ ObjectListNode::~ObjectListNode() = default;
 //------------------------------------------------------------------------------
 /*virtual*/ bool ObjectListNode::DoDynamicDependencies( NodeGraph & nodeGraph, bool forceClean )
 {
-    if ( GatherDynamicDependencies( nodeGraph, forceClean ) == false )
+    // prepare inputs, unless already done in a job
+    if ( ( m_DynamicInputsPrepared == false ) && ( PrepareDynamicDependencies( nullptr ) == false ) )
+    {
+        return false; // PrepareDynamicDependencies will have emitted error
+    }
+
+    const bool result = GatherDynamicDependencies( nodeGraph, forceClean );
+
+    // inputs are only valid for this pass
+    m_DynamicInputs.Clear();
+    m_DynamicInputsPrepared = false;
+
+    if ( result == false )
     {
         return false; // GatherDynamicDependencies will have emitted error
     }
@@ -417,24 +454,6 @@ ObjectListNode::~ObjectListNode() = default;
         return false;
     }
 
-    if ( m_ExtraASMPath.IsEmpty() == false )
-    {
-        if ( !FileIO::EnsurePathExists( m_ExtraASMPath ) )
-        {
-            FLOG_ERROR( "Failed to create folder for .asm file '%s'", m_ExtraASMPath.Get() );
-            return false;
-        }
-    }
-
-    if ( m_ExtraPDBPath.IsEmpty() == false )
-    {
-        if ( !FileIO::EnsurePathExists( m_ExtraPDBPath ) )
-        {
-            FLOG_ERROR( "Failed to create folder for .pdb file '%s'", m_ExtraPDBPath.Get() );
-            return false;
-        }
-    }
-
     return true;
 }
 
@@ -610,11 +629,8 @@ void ObjectListNode::GetObjectFileName( const AString & fileName, const AString
 
 // CreateDynamicObjectNode
 //------------------------------------------------------------------------------
-bool ObjectListNode::CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, const AString & baseDir, bool isUnityNode, bool isIsolatedFromUnityNode )
+bool ObjectListNode::CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, const AString & objFile, bool isUnityNode, bool isIsolatedFromUnityNode )
 {
-    AStackString<> objFile;
-    GetObjectFileName( inputFile->GetName(), baseDir, objFile );
-
     // Create an ObjectNode to compile the above file
     // and depend on that
     Node * on = nodeGraph.FindNode( objFile );
@@ -706,6 +722,7 @@ ObjectNode * ObjectListNode::CreateObjectNode( NodeGraph & nodeGraph,
     }
     node->m_AllowDistribution = m_AllowDistribution;
     node->m_AllowCaching = m_AllowCaching;
+    node->m_CompilerJobMemoryMiB = m_CompilerJobMemoryMiB;
     node->m_CompilerForceUsing = m_CompilerForceUsing;
     node->m_PreBuildDependencyNames = m_PreBuildDependencyNames;
     node->m_PrecompiledHeader = m_UsingPrecompiledHeader ? GetPrecompiledHeader()->GetName() : AString::GetEmpty();
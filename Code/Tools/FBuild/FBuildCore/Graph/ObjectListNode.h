@@ -46,12 +46,21 @@ public:
 protected:
     friend class FunctionObjectList;
 
+    virtual bool PrepareDynamicDependencies( Job * job ) override;
     virtual bool GatherDynamicDependencies( NodeGraph & nodeGraph, bool forceClean );
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph, bool forceClean ) override;
     virtual BuildResult DoBuild( Job * job ) override;
 
     // internal helpers
-    bool CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, const AString & baseDir, bool isUnityNode = false, bool isIsolatedFromUnityNode = false );
+    enum DynamicInputType : uint8_t
+    {
+        INPUT_DIRECTORY_LIST,
+        INPUT_UNITY,
+        INPUT_UNITY_ISOLATED,
+        INPUT_FILE,
+    };
+    void AddDynamicInput( DynamicInputType type, Node * inputNode, const AString & inputFile, const AString & baseDir );
+    bool CreateDynamicObjectNode( NodeGraph & nodeGraph, Node * inputFile, const AString & objFile, bool isUnityNode = false, bool isIsolatedFromUnityNode = false );
     ObjectNode * CreateObjectNode( NodeGraph & nodeGraph,
                                    const BFFIterator & iter,
                                    const Function * function,
@@ -89,6 +98,7 @@ protected:
     bool                m_DeoptimizeWritableFilesWithToken  = false;
     bool                m_AllowDistribution                 = true;
     bool                m_AllowCaching                      = true;
+    uint32_t            m_CompilerJobMemoryMiB              = 0;
     AString             m_PCHInputFile;
     AString             m_PCHOutputFile;
     AString             m_PCHOptions;
@@ -104,6 +114,17 @@ protected:
     uint32_t            m_ObjectListInputEndIndex           = 0;
     uint32_t            m_NumCompilerInputUnity             = 0;
     uint32_t            m_NumCompilerInputFiles             = 0;
+
+    // Inputs and the objects they compile to (see PrepareDynamicDependencies)
+    struct DynamicInput
+    {
+        const AString *     m_InputFile;    // owned by the input node
+        Node *              m_InputNode;    // only for INPUT_FILE
+        AString             m_ObjectFile;
+        DynamicInputType    m_Type;
+    };
+    Array< DynamicInput > m_DynamicInputs;
+    bool                m_DynamicInputsPrepared             = false;
 };
 
 //------------------------------------------------------------------------------
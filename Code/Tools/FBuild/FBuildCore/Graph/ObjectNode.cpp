@@ -6,6 +6,7 @@
 #include "ObjectNode.h"
 
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionObjectList.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePublishQueue.h"
 #include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
@@ -25,6 +26,7 @@
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
 
 // Core
+#include "Core/Containers/AutoPtr.h"
 #include "Core/Env/Env.h"
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/ConstMemoryStream.h"
@@ -57,6 +59,7 @@ REFLECT_NODE_BEGIN( ObjectNode, Node, MetaNone() )
     REFLECT( m_DeoptimizeWritableFilesWithToken,    "DeoptimizeWritableFilesWithToken", MetaOptional() )
     REFLECT( m_AllowDistribution,                   "AllowDistribution",                MetaOptional() )
     REFLECT( m_AllowCaching,                        "AllowCaching",                     MetaOptional() )
+    REFLECT( m_CompilerJobMemoryMiB,                "CompilerJobMemoryMiB",             MetaOptional() )
     REFLECT_ARRAY( m_CompilerForceUsing,            "CompilerForceUsing",               MetaOptional() + MetaFile() )
 
     // Preprocessor
@@ -393,8 +396,10 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
     // Try to use the light cache if enabled
     if ( useCache && GetCompiler()->GetUseLightCache() )
     {
+        // Hashing was already done if the cache was prefetched
+        const bool prefetched = ( job->GetCachePrefetchState() != Job::CACHE_PREFETCH_NONE );
         LightCache lc;
-        if ( lc.Hash( this, fullArgs.GetFinalArgs(), m_LightCacheKey, m_Includes ) == false )
+        if ( !prefetched && ( lc.Hash( this, fullArgs.GetFinalArgs(), m_LightCacheKey, m_Includes ) == false ) )
         {
             // Light cache could not be used (can't parse includes)
             if ( FBuild::Get().GetOptions().m_CacheVerbose )
@@ -1242,9 +1247,26 @@ bool ObjectNode::RetrieveFromCache( Job * job )
     ASSERT( cache );
     if ( cache )
     {
-        void * cacheData( nullptr );
+        // Use the result of the lookup done before the job was queued, if there was one,
+        // otherwise read the entry in place (memory-mapped where supported)
+        const void * cacheData( nullptr );
         size_t cacheDataSize( 0 );
-        if ( cache->Retrieve( cacheFileName, cacheData, cacheDataSize ) )
+        bool cacheDataIsMapped( false );
+        bool retrieved;
+        switch ( job->GetCachePrefetchState() )
+        {
+            case Job::CACHE_PREFETCH_HIT:
+                cacheData = job->TakeCachePrefetchData( cacheDataSize );
+                retrieved = true;
+                break;
+            case Job::CACHE_PREFETCH_MISS:
+                retrieved = false;
+                break;
+            default:
+                retrieved = cache->RetrieveMapped( cacheFileName, cacheData, cacheDataSize, cacheDataIsMapped );
+                break;
+        }
+        if ( retrieved )
         {
             const uint32_t retrieveTime = uint32_t( t.GetElapsedMS() );
 
@@ -1255,57 +1277,61 @@ bool ObjectNode::RetrieveFromCache( Job * job )
                 pchKey = xxHash::Calc64( cacheData, cacheDataSize );
             }
 
-            const uint32_t startDecompress = uint32_t( t.GetElapsedMS() );
-
-            // do decompression
-            Compressor c;
-            if ( c.IsValidData( cacheData, cacheDataSize ) == false )
-            {
-                FLOG_WARN( "Cache returned invalid data (header) for '%s'", m_Name.Get() );
-                return false;
-            }
-            if ( c.Decompress( cacheData ) == false )
-            {
-                FLOG_WARN( "Cache returned invalid data (payload) for '%s'", m_Name.Get() );
-                return false;
-            }
-            const void * data = c.GetResult();
-            const size_t dataSize = c.GetResultSize();
-
-            const uint32_t stopDecompress = uint32_t( t.GetElapsedMS() );
-
-            MultiBuffer buffer( data, dataSize );
+            const uint32_t startExtract = uint32_t( t.GetElapsedMS() );
 
             Array< AString > fileNames( 4, false );
             fileNames.Append( m_Name );
 
             GetExtraCacheFilePaths( job, fileNames );
 
-            // Extract the files
-            const size_t numFiles = fileNames.GetSize();
-            for ( size_t i=0; i<numFiles; ++i )
+            // Decompress straight to the files, a block at a time
+            size_t dataSize;
+            bool complete;
+            bool writeFailed;
+            size_t failedFileIndex;
+            {
+                MultiBufferExtractor extractor( fileNames );
+                const bool decompressed = Compressor::Decompress( cacheData, cacheDataSize, extractor );
+                dataSize = (size_t)extractor.Tell();
+                cache->ReleaseMapped( cacheData, cacheDataSize, cacheDataIsMapped );
+
+                writeFailed = extractor.GetFailedFileIndex( failedFileIndex );
+                complete = ( decompressed && extractor.IsComplete() && ( writeFailed == false ) );
+            } // files are closed here, so they can be deleted
+
+            if ( complete == false )
             {
-                if ( !buffer.ExtractFile( i, fileNames[ i ] ) )
+                // Don't leave truncated files behind, which could be mistaken for
+                // valid outputs (the object will be built instead)
+                for ( const AString & fileName : fileNames )
                 {
-                    cache->FreeMemory( cacheData, cacheDataSize );
-                    FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileNames[ i ].Get() );
-                    return false;
+                    FileIO::FileDelete( fileName.Get() );
+                }
+
+                if ( writeFailed )
+                {
+                    FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileNames[ failedFileIndex ].Get() );
                 }
+                else
+                {
+                    FLOG_WARN( "Cache returned invalid data for '%s'", m_Name.Get() );
+                }
+                return false;
+            }
 
-                // Update file modification time
-                const bool timeSetOK = FileIO::SetFileLastWriteTimeToNow( fileNames[ i ] );
+            const uint32_t stopExtract = uint32_t( t.GetElapsedMS() );
 
-                // set the time on the local file
-                if ( timeSetOK == false )
+            // Update file modification times (now that the files are closed)
+            const size_t numFiles = fileNames.GetSize();
+            for ( size_t i=0; i<numFiles; ++i )
+            {
+                if ( FileIO::SetFileLastWriteTimeToNow( fileNames[ i ] ) == false )
                 {
-                    cache->FreeMemory( cacheData, cacheDataSize );
                     FLOG_ERROR( "Failed to set timestamp after cache hit. Error: %s Target: '%s'", LAST_ERROR_STR, fileNames[ i ].Get() );
                     return false;
                 }
             }
 
-            cache->FreeMemory( cacheData, cacheDataSize );
-
             FileIO::WorkAroundForWindowsFilePermissionProblem( m_Name );
 
             // record new file time (note that time may differ from what we set above due to
@@ -1317,7 +1343,7 @@ bool ObjectNode::RetrieveFromCache( Job * job )
             output.Format( "Obj: %s <CACHE>\n", GetName().Get() );
             if ( FBuild::Get().GetOptions().m_CacheVerbose )
             {
-                output.AppendFormat( " - Cache Hit: %u ms (Retrieve: %u ms - Decompress: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n", uint32_t( t.GetElapsedMS() ), retrieveTime, stopDecompress - startDecompress, cacheDataSize, dataSize, cacheFileName.Get() );
+                output.AppendFormat( " - Cache Hit: %u ms (Retrieve: %u ms - Extract: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n", uint32_t( t.GetElapsedMS() ), retrieveTime, stopExtract - startExtract, cacheDataSize, dataSize, cacheFileName.Get() );
             }
             FLOG_BUILD_DIRECT( output.Get() );
 
@@ -1345,6 +1371,56 @@ bool ObjectNode::RetrieveFromCache( Job * job )
     return false;
 }
 
+// CanPrefetchFromCache
+//------------------------------------------------------------------------------
+bool ObjectNode::CanPrefetchFromCache() const
+{
+    // The cache key must be obtainable without preprocessing, so only objects
+    // using the LightCache can be looked up ahead of time
+    return ShouldUseCache() &&
+           FBuild::Get().GetOptions().m_UseCacheRead &&
+           GetCompiler()->GetUseLightCache() &&
+           ( GetCompiler()->SimpleDistributionMode() == false ) &&
+           ( GetDedicatedPreprocessor() == nullptr ) &&
+           ( GetFlag( FLAG_CREATING_PCH ) == false ); // PCH key is reset when built
+}
+
+// PrepareCachePrefetch
+//------------------------------------------------------------------------------
+bool ObjectNode::PrepareCachePrefetch( Job * job )
+{
+    PROFILE_FUNCTION
+
+    ASSERT( CanPrefetchFromCache() );
+
+    // Args are not finalized, as that could create a response file in the tmp
+    // dir of a worker thread
+    Args fullArgs;
+    const bool showIncludes( false );
+    const bool finalize( false );
+    if ( !BuildArgs( job, fullArgs, PASS_PREPROCESSOR_ONLY, ShouldUseDeoptimization(), showIncludes, finalize ) )
+    {
+        return false; // Build will report the error
+    }
+
+    // If a response file would be needed, the args would not match those used
+    // when building, so leave it to the build
+    const uint32_t maxArgLength( 30000 );
+    if ( fullArgs.GetRawArgs().GetLength() > maxArgLength )
+    {
+        return false;
+    }
+
+    LightCache lc;
+    if ( lc.Hash( this, fullArgs.GetRawArgs(), m_LightCacheKey, m_Includes ) == false )
+    {
+        return false; // Build will fall back to preprocessing
+    }
+
+    GetCacheName( job );
+    return true;
+}
+
 // WriteToCache
 //------------------------------------------------------------------------------
 void ObjectNode::WriteToCache( Job * job )
@@ -1375,24 +1451,49 @@ void ObjectNode::WriteToCache( Job * job )
         {
             // try to compress
             const uint32_t startCompress( (uint32_t)t.GetElapsedMS() );
+            // (large outputs like PCHs are split into blocks compressed in parallel,
+            // which older versions can't read, so they use a different cache version)
             Compressor c;
-            c.Compress( buffer.GetData(), (size_t)buffer.GetDataSize() );
-            const void * data = c.GetResult();
+            const size_t bufferSize = (size_t)buffer.GetDataSize();
+            if ( bufferSize > ( 4 * Compressor::BLOCK_SIZE ) )
+            {
+                c.CompressBlocks( buffer.GetData(), bufferSize );
+            }
+            else
+            {
+                c.Compress( buffer.GetData(), bufferSize );
+            }
             const size_t dataSize = c.GetResultSize();
+            AutoPtr< char > data( (char *)c.ReleaseResult() );
             const uint32_t stopCompress( (uint32_t)t.GetElapsedMS() );
 
+            // Dependent objects need to know the PCH key to be able to pull from the cache
+            const uint64_t pchCacheKey = ( GetFlag( FLAG_CREATING_PCH ) && GetFlag( FLAG_MSVC ) ) ? xxHash::Calc64( data.Get(), dataSize ) : 0;
+
+            // hand off to the background threads if possible (-cacheasync)
+            //  - except for PCHs, as objects using them are only cacheable once
+            //    the PCH is known to be in the cache
+            //  - queued stores are counted once published (see FBuild::Build)
             const uint32_t startPublish( stopCompress );
-            if ( cache->Publish( cacheFileName, data, dataSize ) )
+            CachePublishQueue * publishQueue = ( pchCacheKey == 0 ) ? FBuild::Get().GetCachePublishQueue() : nullptr;
+            const bool queued = publishQueue && publishQueue->Publish( this, cacheFileName, data.Get(), dataSize );
+            if ( queued )
             {
-                // cache store complete
+                data.Release(); // now owned by the queue
+            }
+            if ( queued || cache->Publish( cacheFileName, data.Get(), dataSize ) )
+            {
+                // cache store complete (or queued)
                 const uint32_t stopPublish( (uint32_t)t.GetElapsedMS() );
 
-                SetStatFlag( Node::STATS_CACHE_STORE );
+                if ( queued == false )
+                {
+                    SetStatFlag( Node::STATS_CACHE_STORE );
+                }
 
-                // Dependent objects need to know the PCH key to be able to pull from the cache
-                if ( GetFlag( FLAG_CREATING_PCH ) && GetFlag( FLAG_MSVC ) )
+                if ( pchCacheKey != 0 )
                 {
-                    m_PCHCacheKey = xxHash::Calc64( data, dataSize );
+                    m_PCHCacheKey = pchCacheKey;
                 }
 
                 const uint32_t cachingTime = uint32_t( t.GetElapsedMS() );
@@ -1403,8 +1504,8 @@ void ObjectNode::WriteToCache( Job * job )
                 {
                     AStackString<> output;
                     output.Format( "Obj: %s\n"
-                                   " - Cache Store: %u ms (Store: %u ms - Compress: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n",
-                                   GetName().Get(), cachingTime, ( stopPublish - startPublish ), ( stopCompress - startCompress ), dataSize, (size_t)buffer.GetDataSize(), cacheFileName.Get() );
+                                   " - Cache Store%s: %u ms (Store: %u ms - Compress: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n",
+                                   GetName().Get(), queued ? " (Queued)" : "", cachingTime, ( stopPublish - startPublish ), ( stopCompress - startCompress ), dataSize, (size_t)buffer.GetDataSize(), cacheFileName.Get() );
                     if ( m_PCHCacheKey != 0 )
                     {
                         output.AppendFormat( " - PCH Key: %" PRIx64 "\n", m_PCHCacheKey );
@@ -79,6 +79,8 @@ public:
     inline bool IsUsingPDB() const { return GetFlag( FLAG_USING_PDB ); }
     inline bool IsUsingStaticAnalysisMSVC() const { return GetFlag( FLAG_STATIC_ANALYSIS_MSVC ); }
 
+    inline uint32_t GetCompilerJobMemoryMiB() const { return m_CompilerJobMemoryMiB; }
+
     virtual void SaveRemote( IOStream & stream ) const override;
     static Node * LoadRemote( IOStream & stream );
 
@@ -94,6 +96,10 @@ public:
     void GetNativeAnalysisXMLPath( AString& outXMLFileName ) const;
 
     const char * GetObjExtension() const;
+
+    // cache lookup ahead of building (-cacheprefetch)
+    bool CanPrefetchFromCache() const;
+    bool PrepareCachePrefetch( Job * job );
 private:
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph, bool forceClean ) override;
     virtual BuildResult DoBuild( Job * job ) override;
@@ -196,6 +202,7 @@ private:
     bool                m_DeoptimizeWritableFilesWithToken  = false;
     bool                m_AllowDistribution                 = true;
     bool                m_AllowCaching                      = true;
+    uint32_t            m_CompilerJobMemoryMiB              = 0;
     Array< AString >    m_CompilerForceUsing;
     AString             m_Preprocessor;
     AString             m_PreprocessorOptions;
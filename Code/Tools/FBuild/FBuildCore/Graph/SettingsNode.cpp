@@ -22,6 +22,7 @@
 #define DIST_MEMORY_LIMIT_MIN ( 16 ) // 16MiB
 #define DIST_MEMORY_LIMIT_MAX ( ( sizeof(void *) == 8 ) ? 64 * 1024 : 2048 ) // 64 GiB or 2 GiB
 #define DIST_MEMORY_LIMIT_DEFAULT ( ( sizeof(void *) == 8 ) ? 2048 : 1024 ) // 2 GiB or 1 GiB
+#define CACHE_LOCAL_SIZE_DEFAULT ( 10 * 1024 ) // 10 GiB
 
 // REFLECTION
 //------------------------------------------------------------------------------
@@ -30,9 +31,14 @@ REFLECT_NODE_BEGIN( SettingsNode, Node, MetaNone() )
     REFLECT(        m_CachePath,                "CachePath",                MetaOptional() )
     REFLECT(        m_CachePathMountPoint,      "CachePathMountPoint",      MetaOptional() )
     REFLECT(        m_CachePluginDLL,           "CachePluginDLL",           MetaOptional() )
+    REFLECT(        m_CacheLocalPath,           "CacheLocalPath",           MetaOptional() )
+    REFLECT(        m_CacheLocalSizeMiB,        "CacheLocalSizeMiB",        MetaOptional() + MetaRange( 1, 1024 * 1024 ) )
     REFLECT_ARRAY(  m_Workers,                  "Workers",                  MetaOptional() )
     REFLECT(        m_WorkerConnectionLimit,    "WorkerConnectionLimit",    MetaOptional() )
     REFLECT(        m_DistributableJobMemoryLimitMiB, "DistributableJobMemoryLimitMiB", MetaOptional() + MetaRange( DIST_MEMORY_LIMIT_MIN, DIST_MEMORY_LIMIT_MAX ) )
+    REFLECT(        m_LocalLinkJobLimit,        "LocalLinkJobLimit",        MetaOptional() )
+    REFLECT(        m_LocalCopyJobLimit,        "LocalCopyJobLimit",        MetaOptional() )
+    REFLECT(        m_LocalJobMemoryLimitMiB,   "LocalJobMemoryLimitMiB",   MetaOptional() )
     REFLECT(        m_DisableDBMigration,       "DisableDBMigration",       MetaOptional() )
 REFLECT_END( SettingsNode )
 
@@ -40,13 +46,18 @@ REFLECT_END( SettingsNode )
 //------------------------------------------------------------------------------
 SettingsNode::SettingsNode()
 : Node( AString::GetEmpty(), Node::SETTINGS_NODE, Node::FLAG_NONE )
+, m_CacheLocalSizeMiB( CACHE_LOCAL_SIZE_DEFAULT )
 , m_WorkerConnectionLimit( 15 )
 , m_DistributableJobMemoryLimitMiB( DIST_MEMORY_LIMIT_DEFAULT )
+, m_LocalLinkJobLimit( 0 )
+, m_LocalCopyJobLimit( 0 )
+, m_LocalJobMemoryLimitMiB( 0 )
 , m_DisableDBMigration( false )
 {
     // Cache path from environment
     Env::GetEnvVariable( "FASTBUILD_CACHE_PATH", m_CachePathFromEnvVar );
     Env::GetEnvVariable( "FASTBUILD_CACHE_PATH_MOUNT_POINT", m_CachePathMountPointFromEnvVar );
+    Env::GetEnvVariable( "FASTBUILD_CACHE_LOCAL_PATH", m_CacheLocalPathFromEnvVar );
 }
 
 // Initialize
@@ -110,6 +121,18 @@ const AString & SettingsNode::GetCachePluginDLL() const
     return m_CachePluginDLL;
 }
 
+// GetCacheLocalPath
+//------------------------------------------------------------------------------
+const AString & SettingsNode::GetCacheLocalPath() const
+{
+    // Settings() bff option overrides environment variable
+    if ( m_CacheLocalPath.IsEmpty() == false )
+    {
+        return m_CacheLocalPath;
+    }
+    return m_CacheLocalPathFromEnvVar;
+}
+
 // ProcessEnvironment
 //------------------------------------------------------------------------------
 void SettingsNode::ProcessEnvironment( const Array< AString > & envStrings ) const
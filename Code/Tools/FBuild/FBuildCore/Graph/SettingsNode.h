@@ -29,9 +29,14 @@ public:
     const AString &                     GetCachePath() const;
     const AString &                     GetCachePathMountPoint() const;
     const AString &                     GetCachePluginDLL() const;
+    const AString &                     GetCacheLocalPath() const;
+    uint32_t                            GetCacheLocalSizeMiB() const { return m_CacheLocalSizeMiB; }
     inline const Array< AString > &     GetWorkerList() const { return m_Workers; }
     uint32_t                            GetWorkerConnectionLimit() const { return m_WorkerConnectionLimit; }
     uint32_t                            GetDistributableJobMemoryLimitMiB() const { return m_DistributableJobMemoryLimitMiB; }
+    uint32_t                            GetLocalLinkJobLimit() const { return m_LocalLinkJobLimit; }
+    uint32_t                            GetLocalCopyJobLimit() const { return m_LocalCopyJobLimit; }
+    uint32_t                            GetLocalJobMemoryLimitMiB() const { return m_LocalJobMemoryLimitMiB; }
     bool                                GetDisableDBMigration() const { return m_DisableDBMigration; }
 
 private:
@@ -40,6 +45,7 @@ private:
     // Settings from environment variables
     AString             m_CachePathFromEnvVar;
     AString             m_CachePathMountPointFromEnvVar;
+    AString             m_CacheLocalPathFromEnvVar;
 
     // Exposed settings
     //friend class FunctionSettings;
@@ -47,9 +53,14 @@ private:
     AString             m_CachePath;
     AString             m_CachePathMountPoint;
     AString             m_CachePluginDLL;
+    AString             m_CacheLocalPath;
+    uint32_t            m_CacheLocalSizeMiB;
     Array< AString  >   m_Workers;
     uint32_t            m_WorkerConnectionLimit;
     uint32_t            m_DistributableJobMemoryLimitMiB;
+    uint32_t            m_LocalLinkJobLimit;
+    uint32_t            m_LocalCopyJobLimit;
+    uint32_t            m_LocalJobMemoryLimitMiB;
     bool                m_DisableDBMigration; // TODO:C Remove this option some time after v0.99
 };
 
@@ -0,0 +1,457 @@
+// BuildSnapshot
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "BuildSnapshot.h"
+
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/DirectoryListNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/ExecNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ParallelFor.h"
+
+// Core
+#include "Core/Containers/AutoPtr.h"
+#include "Core/Env/Env.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+#include <memory.h>
+
+// Defines
+//------------------------------------------------------------------------------
+#define BUILD_SNAPSHOT_VERSION      ( 1 )
+#define BUILD_SNAPSHOT_MAX_RECORDS  ( 8 )   // Distinct target/option combinations kept
+
+// Helpers
+//------------------------------------------------------------------------------
+namespace
+{
+    // Snapshots are invalidated by DB format changes as well as their own
+    inline uint32_t GetSnapshotVersion()
+    {
+        return ( ( (uint32_t)NodeGraphHeader::NODE_GRAPH_CURRENT_VERSION << 8 ) | BUILD_SNAPSHOT_VERSION );
+    }
+
+    // Read a whole file into memory
+    bool ReadFileContents( const char * fileName, AutoPtr< char > & outData, size_t & outSize )
+    {
+        FileStream fs;
+        if ( fs.Open( fileName, FileStream::READ_ONLY ) == false )
+        {
+            return false;
+        }
+        outSize = (size_t)fs.GetFileSize();
+        outData = (char *)ALLOC( outSize + 1 ); // +1 so empty files still get a valid buffer
+        return ( fs.ReadBuffer( outData.Get(), outSize ) == outSize );
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+BuildSnapshot::BuildSnapshot()
+    : m_Files( 0, true )
+    , m_DirectoryListings( 0, true )
+    , m_EnvironmentVars( 0, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BuildSnapshot::~BuildSnapshot() = default;
+
+// Capture
+//------------------------------------------------------------------------------
+bool BuildSnapshot::Capture( NodeGraph & nodeGraph, Node * rootNode, const char * nodeGraphDBFile )
+{
+    PROFILE_FUNCTION
+
+    m_Files.Clear();
+    m_DirectoryListings.Clear();
+    m_EnvironmentVars.Clear();
+
+    Array< Node * > nodes( nodeGraph.GetNodeCount() + 1, true );
+    NodeGraph::s_BuildPassTag++;
+    NodeGraph::GatherNodesInDependencyOrder( rootNode, nodes );
+
+    m_Files.SetCapacity( nodes.GetSize() + nodeGraph.m_UsedFiles.GetSize() + 1 );
+    for ( const Node * node : nodes )
+    {
+        switch ( node->GetType() )
+        {
+            case Node::PROXY_NODE:
+            {
+                continue; // root of a multi-target build
+            }
+            // Nodes which do work on every build can't be skipped
+            case Node::REMOVE_DIR_NODE:
+            case Node::SLN_NODE:
+            case Node::VCXPROJECT_NODE:
+            case Node::XCODEPROJECT_NODE:
+            {
+                return false;
+            }
+            case Node::EXEC_NODE:
+            {
+                if ( node->CastTo< ExecNode >()->GetExecAlways() )
+                {
+                    return false;
+                }
+                break;
+            }
+            case Node::DIRECTORY_LIST_NODE:
+            {
+                const DirectoryListNode * dln = node->CastTo< DirectoryListNode >();
+                m_DirectoryListings.Append( DirectoryListing() );
+                DirectoryListing & listing = m_DirectoryListings.Top();
+                listing.m_Path = dln->GetPath();
+                listing.m_Patterns = dln->GetPatterns();
+                listing.m_Recursive = dln->IsRecursive();
+                listing.m_ListingHash = dln->GetListingHash();
+                break;
+            }
+            default: break;
+        }
+
+        if ( node->IsAFile() )
+        {
+            // Outputs with no stamp will be rebuilt next time
+            if ( ( node->GetStamp() == 0 ) && ( node->GetType() != Node::FILE_NODE ) )
+            {
+                return false;
+            }
+
+            // Use the stamp recorded during the build rather than querying the
+            // file again, so modifications made during the build are detected
+            m_Files.Append( FileStamp() );
+            FileStamp & file = m_Files.Top();
+            file.m_Name = node->GetName();
+            file.m_Stamp = node->GetStamp();
+        }
+    }
+
+    // bff files
+    for ( const NodeGraph::UsedFile & usedFile : nodeGraph.m_UsedFiles )
+    {
+        m_Files.Append( FileStamp() );
+        FileStamp & file = m_Files.Top();
+        file.m_Name = usedFile.m_FileName;
+        file.m_Stamp = usedFile.m_TimeStamp;
+    }
+
+    // the DB itself, so the snapshot is discarded if the DB is modified or removed
+    {
+        m_Files.Append( FileStamp() );
+        FileStamp & file = m_Files.Top();
+        file.m_Name = nodeGraphDBFile;
+        file.m_Stamp = FileIO::GetFileLastWriteTime( file.m_Name );
+        if ( file.m_Stamp == 0 )
+        {
+            return false;
+        }
+    }
+
+    // environment variables used by the bff
+    for ( const FBuild::EnvironmentVarAndHash & var : FBuild::Get().GetImportedEnvironmentVars() )
+    {
+        m_EnvironmentVars.Append( EnvironmentVar() );
+        EnvironmentVar & envVar = m_EnvironmentVars.Top();
+        envVar.m_Name = var.GetName();
+        envVar.m_Hash = var.GetHash();
+    }
+
+    // LIB is implicitly tracked by the DB. Use the process environment (rather
+    // than any BFF override) so it can be checked without loading the DB.
+    {
+        m_EnvironmentVars.Append( EnvironmentVar() );
+        EnvironmentVar & envVar = m_EnvironmentVars.Top();
+        envVar.m_Name = "LIB";
+        AStackString<> value;
+        envVar.m_Hash = Env::GetEnvVariable( "LIB", value ) ? xxHash::Calc32( value ) : 0;
+    }
+
+    return true;
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool BuildSnapshot::Load( const char * snapshotFile, const AString & key )
+{
+    PROFILE_FUNCTION
+
+    AutoPtr< char > data;
+    size_t size = 0;
+    if ( ReadFileContents( snapshotFile, data, size ) == false )
+    {
+        return false;
+    }
+
+    ConstMemoryStream ms( data.Get(), size );
+    uint32_t version = 0;
+    uint32_t numRecords = 0;
+    if ( ( ms.Read( version ) == false ) ||
+         ( version != GetSnapshotVersion() ) ||
+         ( ms.Read( numRecords ) == false ) )
+    {
+        return false;
+    }
+
+    AStackString<> recordKey;
+    for ( uint32_t i = 0; i < numRecords; ++i )
+    {
+        uint32_t recordSize = 0;
+        if ( ( ms.Read( recordKey ) == false ) || ( ms.Read( recordSize ) == false ) )
+        {
+            return false;
+        }
+        const uint64_t recordPos = ms.Tell();
+        if ( ( recordPos + recordSize ) > size )
+        {
+            return false; // corrupt
+        }
+        if ( recordKey == key )
+        {
+            ConstMemoryStream record( data.Get() + recordPos, recordSize );
+            return Deserialize( record );
+        }
+        ms.Seek( recordPos + recordSize );
+    }
+
+    return false; // no snapshot for this key
+}
+
+// Save
+//------------------------------------------------------------------------------
+bool BuildSnapshot::Save( const char * snapshotFile, const AString & key ) const
+{
+    PROFILE_FUNCTION
+
+    MemoryStream record( 1024 * 1024, 1024 * 1024 );
+    Serialize( record );
+
+    // Preserve records for other keys
+    AutoPtr< char > oldData;
+    size_t oldSize = 0;
+    uint32_t oldNumRecords = 0;
+    ConstMemoryStream oldStream;
+    if ( ReadFileContents( snapshotFile, oldData, oldSize ) )
+    {
+        oldStream.Replace( oldData.Get(), oldSize, false );
+        uint32_t version = 0;
+        if ( ( oldStream.Read( version ) == false ) ||
+             ( version != GetSnapshotVersion() ) ||
+             ( oldStream.Read( oldNumRecords ) == false ) )
+        {
+            oldNumRecords = 0;
+        }
+    }
+
+    MemoryStream ms( record.GetSize() + oldSize + 64 );
+    const uint32_t version = GetSnapshotVersion();
+    ms.Write( version );
+    const size_t numRecordsPos = ms.GetSize();
+    uint32_t numRecords = 1;
+    ms.Write( numRecords );
+
+    // Most recent record first
+    ms.Write( key );
+    ms.Write( (uint32_t)record.GetSize() );
+    ms.WriteBuffer( record.GetData(), record.GetSize() );
+
+    AStackString<> recordKey;
+    for ( uint32_t i = 0; ( i < oldNumRecords ) && ( numRecords < BUILD_SNAPSHOT_MAX_RECORDS ); ++i )
+    {
+        uint32_t recordSize = 0;
+        if ( ( oldStream.Read( recordKey ) == false ) || ( oldStream.Read( recordSize ) == false ) )
+        {
+            break;
+        }
+        const uint64_t recordPos = oldStream.Tell();
+        if ( ( recordPos + recordSize ) > oldSize )
+        {
+            break; // corrupt
+        }
+        if ( recordKey != key )
+        {
+            ms.Write( recordKey );
+            ms.Write( recordSize );
+            ms.WriteBuffer( oldData.Get() + recordPos, recordSize );
+            ++numRecords;
+        }
+        oldStream.Seek( recordPos + recordSize );
+    }
+
+    // patch record count
+    memcpy( (char *)ms.GetDataMutable() + numRecordsPos, &numRecords, sizeof( numRecords ) );
+
+    // Write to a tmp file and rename, so a partially written file is never used
+    AStackString<> tmpFileName( snapshotFile );
+    tmpFileName += ".tmp";
+    FileStream fs;
+    if ( fs.Open( tmpFileName.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return false;
+    }
+    if ( fs.WriteBuffer( ms.GetData(), ms.GetSize() ) != ms.GetSize() )
+    {
+        return false;
+    }
+    fs.Close();
+    return FileIO::FileMove( tmpFileName, AStackString<>( snapshotFile ) );
+}
+
+// IsUpToDate
+//------------------------------------------------------------------------------
+bool BuildSnapshot::IsUpToDate( uint32_t numThreads ) const
+{
+    PROFILE_FUNCTION
+
+    if ( IsEnvironmentUpToDate() == false )
+    {
+        return false;
+    }
+
+    const uint32_t numItems = (uint32_t)( m_Files.GetSize() + m_DirectoryListings.GetSize() );
+    return ParallelFor::Run( numItems, numThreads, IsItemUpToDateFunc, const_cast< BuildSnapshot * >( this ) );
+}
+
+// IsEnvironmentUpToDate
+//------------------------------------------------------------------------------
+bool BuildSnapshot::IsEnvironmentUpToDate() const
+{
+    AStackString<> value;
+    for ( const EnvironmentVar & var : m_EnvironmentVars )
+    {
+        const uint32_t hash = Env::GetEnvVariable( var.m_Name.Get(), value ) ? xxHash::Calc32( value ) : 0;
+        if ( hash != var.m_Hash )
+        {
+            FLOG_INFO( "Snapshot invalid: '%s' Environment variable has changed", var.m_Name.Get() );
+            return false;
+        }
+    }
+    return true;
+}
+
+// IsItemUpToDate
+//  - Items are the files, followed by the directory listings
+//------------------------------------------------------------------------------
+bool BuildSnapshot::IsItemUpToDate( uint32_t index ) const
+{
+    if ( index < m_Files.GetSize() )
+    {
+        const FileStamp & file = m_Files[ index ];
+        if ( FileIO::GetFileLastWriteTime( file.m_Name ) != file.m_Stamp )
+        {
+            FLOG_INFO( "Snapshot invalid: '%s' has changed", file.m_Name.Get() );
+            return false;
+        }
+        return true;
+    }
+
+    const DirectoryListing & listing = m_DirectoryListings[ index - m_Files.GetSize() ];
+    Array< FileIO::FileInfo > files( 4096, true );
+    FileIO::GetFilesEx( listing.m_Path, &listing.m_Patterns, listing.m_Recursive, &files );
+    if ( DirectoryListNode::CalcListingHash( files ) != listing.m_ListingHash )
+    {
+        FLOG_INFO( "Snapshot invalid: contents of '%s' have changed", listing.m_Path.Get() );
+        return false;
+    }
+    return true;
+}
+
+// IsItemUpToDateFunc
+//------------------------------------------------------------------------------
+/*static*/ bool BuildSnapshot::IsItemUpToDateFunc( uint32_t index, void * userData )
+{
+    return static_cast< const BuildSnapshot * >( userData )->IsItemUpToDate( index );
+}
+
+// Serialize
+//------------------------------------------------------------------------------
+void BuildSnapshot::Serialize( IOStream & stream ) const
+{
+    stream.Write( (uint32_t)m_Files.GetSize() );
+    for ( const FileStamp & file : m_Files )
+    {
+        stream.Write( file.m_Name );
+        stream.Write( file.m_Stamp );
+    }
+
+    stream.Write( (uint32_t)m_DirectoryListings.GetSize() );
+    for ( const DirectoryListing & listing : m_DirectoryListings )
+    {
+        stream.Write( listing.m_Path );
+        stream.Write( listing.m_Patterns );
+        stream.Write( listing.m_Recursive );
+        stream.Write( listing.m_ListingHash );
+    }
+
+    stream.Write( (uint32_t)m_EnvironmentVars.GetSize() );
+    for ( const EnvironmentVar & var : m_EnvironmentVars )
+    {
+        stream.Write( var.m_Name );
+        stream.Write( var.m_Hash );
+    }
+}
+
+// Deserialize
+//------------------------------------------------------------------------------
+bool BuildSnapshot::Deserialize( IOStream & stream )
+{
+    uint32_t numFiles = 0;
+    if ( stream.Read( numFiles ) == false )
+    {
+        return false;
+    }
+    m_Files.SetSize( numFiles );
+    for ( FileStamp & file : m_Files )
+    {
+        if ( ( stream.Read( file.m_Name ) == false ) || ( stream.Read( file.m_Stamp ) == false ) )
+        {
+            return false;
+        }
+    }
+
+    uint32_t numListings = 0;
+    if ( stream.Read( numListings ) == false )
+    {
+        return false;
+    }
+    m_DirectoryListings.SetSize( numListings );
+    for ( DirectoryListing & listing : m_DirectoryListings )
+    {
+        if ( ( stream.Read( listing.m_Path ) == false ) ||
+             ( stream.Read( listing.m_Patterns ) == false ) ||
+             ( stream.Read( listing.m_Recursive ) == false ) ||
+             ( stream.Read( listing.m_ListingHash ) == false ) )
+        {
+            return false;
+        }
+    }
+
+    uint32_t numVars = 0;
+    if ( stream.Read( numVars ) == false )
+    {
+        return false;
+    }
+    m_EnvironmentVars.SetSize( numVars );
+    for ( EnvironmentVar & var : m_EnvironmentVars )
+    {
+        if ( ( stream.Read( var.m_Name ) == false ) || ( stream.Read( var.m_Hash ) == false ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,73 @@
+// BuildSnapshot
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class IOStream;
+class Node;
+class NodeGraph;
+
+// BuildSnapshot
+//  - Compact record of everything a successful build depended on (file stamps,
+//    directory listings, bff files and environment variables)
+//  - If nothing in the snapshot has changed, the build would be a no-op, so it
+//    can be skipped without loading the dependency graph at all
+//------------------------------------------------------------------------------
+class BuildSnapshot
+{
+public:
+    explicit BuildSnapshot();
+    ~BuildSnapshot();
+
+    // Record the state of everything the (successfully built) root depends on.
+    // Returns false if the graph contains nodes which build unconditionally.
+    bool        Capture( NodeGraph & nodeGraph, Node * rootNode, const char * nodeGraphDBFile );
+
+    // Snapshots are stored per key (targets and options), keeping the most recent few
+    bool        Load( const char * snapshotFile, const AString & key );
+    bool        Save( const char * snapshotFile, const AString & key ) const;
+
+    // Check (in parallel) whether anything recorded has changed
+    bool        IsUpToDate( uint32_t numThreads ) const;
+
+    inline size_t GetNumFiles() const { return m_Files.GetSize(); }
+
+private:
+    bool        IsEnvironmentUpToDate() const;
+    bool        IsItemUpToDate( uint32_t index ) const;
+    static bool IsItemUpToDateFunc( uint32_t index, void * userData );
+
+    void        Serialize( IOStream & stream ) const;
+    bool        Deserialize( IOStream & stream );
+
+    struct FileStamp
+    {
+        AString     m_Name;
+        uint64_t    m_Stamp;
+    };
+    struct DirectoryListing
+    {
+        AString             m_Path;
+        Array< AString >    m_Patterns;
+        bool                m_Recursive;
+        uint64_t            m_ListingHash;
+    };
+    struct EnvironmentVar
+    {
+        AString     m_Name;
+        uint32_t    m_Hash;
+    };
+
+    Array< FileStamp >          m_Files;
+    Array< DirectoryListing >   m_DirectoryListings;
+    Array< EnvironmentVar >     m_EnvironmentVars;
+};
+
+//------------------------------------------------------------------------------
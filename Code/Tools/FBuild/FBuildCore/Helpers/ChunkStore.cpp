@@ -0,0 +1,359 @@
+// ChunkStore
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ChunkStore.h"
+
+// Core
+#include "Core/Containers/AutoPtr.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// system
+#include <memory.h> // for memcpy, memchr
+
+// Defines
+//------------------------------------------------------------------------------
+#define MIN_CHUNK_SIZE      ( 256 )                 // merge sections between line directives smaller than this
+#define INITIAL_TABLE_SIZE  ( 1024 )
+
+// Chunk types in encoded stream
+enum : uint8_t
+{
+    CHUNK_REFERENCE = 0,    // hash only - the Server already has the chunk
+    CHUNK_STORE     = 1,    // hash + data - the Server should keep the chunk
+    CHUNK_INLINE    = 2,    // data only - the Server is out of space for new chunks
+};
+
+// IsLineDirective
+//------------------------------------------------------------------------------
+static bool IsLineDirective( const char * pos, const char * end )
+{
+    // "#line 123" (MSVC) or "# 123" (GCC/Clang)
+    if ( ( pos >= end ) || ( *pos != '#' ) )
+    {
+        return false;
+    }
+    ++pos;
+    while ( ( pos < end ) && ( ( *pos == ' ' ) || ( *pos == '\t' ) ) )
+    {
+        ++pos;
+    }
+    if ( pos >= end )
+    {
+        return false;
+    }
+    if ( ( *pos >= '0' ) && ( *pos <= '9' ) )
+    {
+        return true;
+    }
+    return ( ( end - pos ) > 4 ) && ( pos[ 0 ] == 'l' ) && ( pos[ 1 ] == 'i' ) && ( pos[ 2 ] == 'n' ) && ( pos[ 3 ] == 'e' ) && ( pos[ 4 ] == ' ' );
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+ChunkStore::ChunkStore( bool keepData )
+    : m_Table( 0, true )
+    , m_NumChunks( 0 )
+    , m_BytesStored( 0 )
+    , m_BytesReferenced( 0 )
+    , m_MaxBytesStored( DEFAULT_MAX_BYTES_STORED )
+    , m_KeepData( keepData )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+ChunkStore::~ChunkStore()
+{
+    Clear();
+}
+
+// Encode
+//------------------------------------------------------------------------------
+void ChunkStore::Encode( const void * data, uint32_t dataSize, MemoryStream & outStream )
+{
+    PROFILE_FUNCTION
+
+    Array< uint32_t > chunkEnds( 0, true );
+    Split( (const char *)data, dataSize, chunkEnds );
+
+    outStream.Write( dataSize );
+    outStream.Write( (uint32_t)chunkEnds.GetSize() );
+
+    uint32_t chunkStart = 0;
+    for ( const uint32_t chunkEnd : chunkEnds )
+    {
+        const char * chunk = (const char *)data + chunkStart;
+        const uint32_t chunkSize = ( chunkEnd - chunkStart );
+        chunkStart = chunkEnd;
+
+        const uint64_t hash = CalcHash( chunk, chunkSize );
+        if ( Find( hash ) )
+        {
+            // Server already has this chunk
+            outStream.Write( (uint8_t)CHUNK_REFERENCE );
+            outStream.Write( hash );
+            m_BytesReferenced += chunkSize;
+            continue;
+        }
+
+        // new chunk - the Server keeps it if there is space
+        if ( ( m_BytesStored + chunkSize ) <= m_MaxBytesStored )
+        {
+            outStream.Write( (uint8_t)CHUNK_STORE );
+            outStream.Write( hash );
+            Insert( hash, chunk, chunkSize );
+        }
+        else
+        {
+            outStream.Write( (uint8_t)CHUNK_INLINE );
+        }
+        outStream.Write( chunkSize );
+        outStream.WriteBuffer( chunk, chunkSize );
+    }
+}
+
+// Decode
+//------------------------------------------------------------------------------
+bool ChunkStore::Decode( ConstMemoryStream & stream, void * & outData, uint32_t & outDataSize )
+{
+    PROFILE_FUNCTION
+
+    ASSERT( m_KeepData );
+
+    uint32_t dataSize = 0;
+    uint32_t numChunks = 0;
+    if ( ( stream.Read( dataSize ) == false ) ||
+         ( stream.Read( numChunks ) == false ) )
+    {
+        return false;
+    }
+
+    AutoPtr< char > data( (char *)ALLOC( dataSize + 1 ) );
+    uint32_t pos = 0;
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        uint8_t type = 0;
+        uint64_t hash = 0;
+        if ( ( stream.Read( type ) == false ) ||
+             ( ( type != CHUNK_INLINE ) && ( stream.Read( hash ) == false ) ) )
+        {
+            return false;
+        }
+
+        if ( type == CHUNK_REFERENCE )
+        {
+            const Entry * entry = Find( hash );
+            if ( ( entry == nullptr ) || ( entry->m_Size > ( dataSize - pos ) ) )
+            {
+                return false; // chunk was never sent, or is corrupt
+            }
+            memcpy( data.Get() + pos, entry->m_Data, entry->m_Size );
+            pos += entry->m_Size;
+            continue;
+        }
+
+        uint32_t chunkSize = 0;
+        if ( ( ( type != CHUNK_STORE ) && ( type != CHUNK_INLINE ) ) ||
+             ( stream.Read( chunkSize ) == false ) ||
+             ( chunkSize > ( dataSize - pos ) ) ||
+             ( chunkSize > ( stream.GetSize() - stream.Tell() ) ) )
+        {
+            return false;
+        }
+        const char * chunk = (const char *)stream.GetData() + stream.Tell();
+        stream.Seek( stream.Tell() + chunkSize );
+
+        memcpy( data.Get() + pos, chunk, chunkSize );
+        pos += chunkSize;
+
+        if ( type == CHUNK_STORE )
+        {
+            // don't trust the hash we were sent, or a later reference could
+            // silently resolve to the wrong data
+            if ( ( CalcHash( chunk, chunkSize ) != hash ) ||
+                 ( Find( hash ) != nullptr ) ||
+                 ( ( m_BytesStored + chunkSize ) > m_MaxBytesStored ) )
+            {
+                return false; // corrupt, or out of sync with the Client
+            }
+            Insert( hash, chunk, chunkSize );
+        }
+    }
+
+    if ( pos != dataSize )
+    {
+        return false;
+    }
+
+    data.Get()[ dataSize ] = 0; // null terminate for consistency with locally preprocessed data
+    outData = data.Release();
+    outDataSize = dataSize;
+    return true;
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void ChunkStore::Clear()
+{
+    for ( Entry & entry : m_Table )
+    {
+        FREE( entry.m_Data );
+    }
+    m_Table.Clear();
+    m_NumChunks = 0;
+    m_BytesStored = 0;
+    m_BytesReferenced = 0;
+}
+
+// Split
+//------------------------------------------------------------------------------
+/*static*/ void ChunkStore::Split( const char * data, uint32_t dataSize, Array< uint32_t > & outChunkEnds )
+{
+    outChunkEnds.Clear();
+
+    const char * const end = data + dataSize;
+    uint32_t chunkStart = 0;
+    uint32_t sectionStart = 0; // content since the last line directive
+    const char * pos = data;
+    for ( ;; )
+    {
+        const char * newLine = (const char *)memchr( pos, '\n', (size_t)( end - pos ) );
+        if ( newLine == nullptr )
+        {
+            break;
+        }
+        pos = newLine + 1;
+
+        // end a chunk at each line directive, unless the sections either side of it
+        // are both very small. Runs of small sections are merged, but never into a
+        // large one, so the chunk for a header is bounded by its own directives and
+        // is the same in every translation unit (even the first header, which follows
+        // a few directives naming the translation unit)
+        if ( IsLineDirective( pos, end ) )
+        {
+            const uint32_t offset = (uint32_t)( pos - data );
+            if ( ( offset - sectionStart ) >= MIN_CHUNK_SIZE )
+            {
+                if ( sectionStart > chunkStart )
+                {
+                    outChunkEnds.Append( sectionStart );
+                }
+                outChunkEnds.Append( offset );
+                chunkStart = offset;
+            }
+            sectionStart = offset;
+        }
+    }
+
+    if ( ( ( dataSize - sectionStart ) >= MIN_CHUNK_SIZE ) && ( sectionStart > chunkStart ) )
+    {
+        outChunkEnds.Append( sectionStart );
+        chunkStart = sectionStart;
+    }
+    if ( chunkStart < dataSize )
+    {
+        outChunkEnds.Append( dataSize );
+    }
+}
+
+// Find
+//------------------------------------------------------------------------------
+const ChunkStore::Entry * ChunkStore::Find( uint64_t hash ) const
+{
+    if ( m_Table.IsEmpty() )
+    {
+        return nullptr;
+    }
+
+    const size_t mask = ( m_Table.GetSize() - 1 );
+    size_t index = (size_t)hash & mask;
+    for ( ;; )
+    {
+        const Entry & entry = m_Table[ index ];
+        if ( entry.m_Hash == hash )
+        {
+            return &entry;
+        }
+        if ( entry.m_Hash == 0 )
+        {
+            return nullptr;
+        }
+        index = ( index + 1 ) & mask;
+    }
+}
+
+// Insert
+//------------------------------------------------------------------------------
+void ChunkStore::Insert( uint64_t hash, const void * data, uint32_t size )
+{
+    ASSERT( Find( hash ) == nullptr );
+
+    // keep load factor below 50%
+    if ( ( ( m_NumChunks + 1 ) * 2 ) > m_Table.GetSize() )
+    {
+        Grow();
+    }
+
+    const size_t mask = ( m_Table.GetSize() - 1 );
+    size_t index = (size_t)hash & mask;
+    while ( m_Table[ index ].m_Hash != 0 )
+    {
+        index = ( index + 1 ) & mask;
+    }
+
+    Entry & entry = m_Table[ index ];
+    entry.m_Hash = hash;
+    entry.m_Size = size;
+    if ( m_KeepData )
+    {
+        entry.m_Data = ALLOC( size );
+        memcpy( entry.m_Data, data, size );
+    }
+
+    ++m_NumChunks;
+    m_BytesStored += size;
+}
+
+// Grow
+//------------------------------------------------------------------------------
+void ChunkStore::Grow()
+{
+    Array< Entry > oldTable( 0, true );
+    oldTable.Swap( m_Table );
+
+    const size_t newSize = oldTable.IsEmpty() ? INITIAL_TABLE_SIZE : ( oldTable.GetSize() * 2 );
+    m_Table.SetSize( newSize );
+    memset( m_Table.Begin(), 0, newSize * sizeof( Entry ) );
+
+    // re-insert existing entries
+    const size_t mask = ( newSize - 1 );
+    for ( const Entry & entry : oldTable )
+    {
+        if ( entry.m_Hash == 0 )
+        {
+            continue;
+        }
+        size_t index = (size_t)entry.m_Hash & mask;
+        while ( m_Table[ index ].m_Hash != 0 )
+        {
+            index = ( index + 1 ) & mask;
+        }
+        m_Table[ index ] = entry;
+    }
+}
+
+// CalcHash
+//------------------------------------------------------------------------------
+/*static*/ uint64_t ChunkStore::CalcHash( const void * data, uint32_t size )
+{
+    const uint64_t hash = xxHash::Calc64( data, size );
+    return ( hash != 0 ) ? hash : 1; // 0 marks unused entries
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,74 @@
+// ChunkStore
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ConstMemoryStream;
+class MemoryStream;
+
+// ChunkStore
+//  - Content-hashed chunks of preprocessed output, split at line directives, so
+//    that headers shared by many translation units are only sent to a worker
+//    once (-distdedup)
+//  - The Server stores the chunks it receives from each Client. The Client keeps
+//    a mirror of that store (without the data) for each Server, so it can send
+//    chunks the Server already has by hash alone.
+//  - Each store holds a limited number of bytes. The Server shares its budget
+//    between its Clients and tells each one its share, so both sides agree on
+//    which chunks are stored.
+//------------------------------------------------------------------------------
+class ChunkStore
+{
+public:
+    explicit ChunkStore( bool keepData );
+    ~ChunkStore();
+
+    // limit assumed by Servers older than PROTOCOL_VERSION_CHUNK_BUDGET
+    static const uint64_t DEFAULT_MAX_BYTES_STORED = ( 256 * MEGABYTE );
+
+    // Client: encode data, referencing chunks already sent
+    void        Encode( const void * data, uint32_t dataSize, MemoryStream & outStream );
+
+    // Server: rebuild data from an encoded stream
+    bool        Decode( ConstMemoryStream & stream, void * & outData, uint32_t & outDataSize );
+
+    void        Clear();
+
+    inline void     SetMaxBytesStored( uint64_t maxBytes ) { m_MaxBytesStored = maxBytes; }
+    inline uint64_t GetMaxBytesStored() const   { return m_MaxBytesStored; }
+
+    inline uint32_t GetNumChunks() const        { return m_NumChunks; }
+    inline uint64_t GetBytesStored() const      { return m_BytesStored; }
+    inline uint64_t GetBytesReferenced() const  { return m_BytesReferenced; }
+
+    // Split data into chunks at line directives (exposed for tests)
+    static void Split( const char * data, uint32_t dataSize, Array< uint32_t > & outChunkEnds );
+
+private:
+    struct Entry
+    {
+        uint64_t    m_Hash;     // 0 = unused
+        void *      m_Data;     // only when keeping data
+        uint32_t    m_Size;
+    };
+
+    const Entry *   Find( uint64_t hash ) const;
+    void            Insert( uint64_t hash, const void * data, uint32_t size );
+    void            Grow();
+    static uint64_t CalcHash( const void * data, uint32_t size );
+
+    Array< Entry >  m_Table;    // open addressing, power of 2 size
+    uint32_t        m_NumChunks;
+    uint64_t        m_BytesStored;
+    uint64_t        m_BytesReferenced;
+    uint64_t        m_MaxBytesStored;
+    bool            m_KeepData;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,194 @@
+// CompressionDictionary
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CompressionDictionary.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// system
+#include <memory.h> // for memcpy, memchr
+
+// Defines
+//------------------------------------------------------------------------------
+#define MIN_LINE_LENGTH     ( 8 )       // shorter lines are cheap to encode without a dictionary
+#define MAX_LINE_LENGTH     ( 1024 )    // longer lines would crowd out everything else
+
+// DictionaryLine
+//------------------------------------------------------------------------------
+namespace
+{
+    struct DictionaryLine
+    {
+        uint64_t        m_Hash;         // 0 = unused
+        const char *    m_Pos;          // first occurrence
+        uint32_t        m_Length;
+        uint32_t        m_LastSample;
+        uint32_t        m_NumSamples;   // number of samples the line appears in
+        bool            m_Selected;
+    };
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::CompressionDictionary()
+    : m_Data( nullptr )
+    , m_Size( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::~CompressionDictionary()
+{
+    Clear();
+}
+
+// Train
+//------------------------------------------------------------------------------
+void CompressionDictionary::Train( const void * samples, const Array< uint32_t > & sampleSizes, uint32_t maxSize )
+{
+    PROFILE_FUNCTION
+
+    ASSERT( maxSize <= MAX_SIZE );
+
+    Clear();
+
+    // content is only worth priming with if it's shared between samples
+    const uint32_t numSamples = (uint32_t)sampleSizes.GetSize();
+    if ( numSamples < 2 )
+    {
+        return;
+    }
+
+    // size table for a line per 32 bytes of input at most 50% full
+    size_t totalSize = 0;
+    for ( const uint32_t sampleSize : sampleSizes )
+    {
+        totalSize += sampleSize;
+    }
+    size_t tableSize = 1024;
+    while ( tableSize < ( totalSize / 16 ) )
+    {
+        tableSize *= 2;
+    }
+    Array< DictionaryLine > table( tableSize, false );
+    table.SetSize( tableSize );
+    memset( table.Begin(), 0, tableSize * sizeof( DictionaryLine ) );
+    Array< uint32_t > order( tableSize / 2, true ); // table indices in order of first occurrence
+
+    // count how many samples each distinct line appears in
+    const char * sample = (const char *)samples;
+    for ( uint32_t sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex )
+    {
+        const char * pos = sample;
+        const char * const end = sample + sampleSizes[ sampleIndex ];
+        while ( pos < end )
+        {
+            const char * lineEnd = (const char *)memchr( pos, '\n', (size_t)( end - pos ) );
+            lineEnd = lineEnd ? ( lineEnd + 1 ) : end;
+            const uint32_t length = (uint32_t)( lineEnd - pos );
+            if ( ( length >= MIN_LINE_LENGTH ) && ( length <= MAX_LINE_LENGTH ) && ( order.GetSize() < ( tableSize / 2 ) ) )
+            {
+                uint64_t hash = xxHash::Calc64( pos, length );
+                hash = hash ? hash : 1; // 0 marks unused entries
+
+                size_t index = (size_t)hash & ( tableSize - 1 );
+                while ( ( table[ index ].m_Hash != 0 ) &&
+                        ( ( table[ index ].m_Hash != hash ) || ( table[ index ].m_Length != length ) ) )
+                {
+                    index = ( index + 1 ) & ( tableSize - 1 );
+                }
+
+                DictionaryLine & line = table[ index ];
+                if ( line.m_Hash == 0 )
+                {
+                    line.m_Hash = hash;
+                    line.m_Pos = pos;
+                    line.m_Length = length;
+                    line.m_LastSample = sampleIndex;
+                    line.m_NumSamples = 1;
+                    order.Append( (uint32_t)index );
+                }
+                else if ( line.m_LastSample != sampleIndex )
+                {
+                    line.m_LastSample = sampleIndex;
+                    line.m_NumSamples++;
+                }
+            }
+            pos = lineEnd;
+        }
+        sample = end;
+    }
+
+    // select the most widely shared lines until the dictionary is full
+    uint32_t size = 0;
+    for ( uint32_t numShared = numSamples; ( numShared >= 2 ) && ( size < maxSize ); --numShared )
+    {
+        for ( const uint32_t index : order )
+        {
+            DictionaryLine & line = table[ index ];
+            if ( ( line.m_NumSamples == numShared ) && ( ( size + line.m_Length ) <= maxSize ) )
+            {
+                line.m_Selected = true;
+                size += line.m_Length;
+            }
+        }
+    }
+    if ( size == 0 )
+    {
+        return;
+    }
+
+    // write the most widely shared lines last, so they are nearest the data being
+    // compressed, keeping lines which share a popularity in their original order
+    m_Data = ALLOC( size );
+    m_Size = size;
+    char * dst = (char *)m_Data;
+    for ( uint32_t numShared = 2; numShared <= numSamples; ++numShared )
+    {
+        for ( const uint32_t index : order )
+        {
+            const DictionaryLine & line = table[ index ];
+            if ( line.m_Selected && ( line.m_NumSamples == numShared ) )
+            {
+                memcpy( dst, line.m_Pos, line.m_Length );
+                dst += line.m_Length;
+            }
+        }
+    }
+    ASSERT( dst == ( (char *)m_Data + m_Size ) );
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool CompressionDictionary::Load( const void * data, size_t dataSize )
+{
+    Clear();
+
+    if ( ( dataSize == 0 ) || ( dataSize > MAX_SIZE ) )
+    {
+        return false; // corrupt or from an incompatible version
+    }
+
+    m_Data = ALLOC( dataSize );
+    memcpy( m_Data, data, dataSize );
+    m_Size = (uint32_t)dataSize;
+    return true;
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void CompressionDictionary::Clear()
+{
+    FREE( m_Data );
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+//------------------------------------------------------------------------------
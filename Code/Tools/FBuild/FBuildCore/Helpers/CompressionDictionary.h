@@ -0,0 +1,42 @@
+// CompressionDictionary
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+
+// CompressionDictionary
+//  - Content shared by many buffers (typically lines common to the preprocessed
+//    output of a toolchain's translation units), used to prime the Compressor so
+//    small buffers compress almost as well as large ones (-distdictionary)
+//  - Trained by the Client and sent to each Server once per toolchain
+//------------------------------------------------------------------------------
+class CompressionDictionary
+{
+public:
+    explicit CompressionDictionary();
+    ~CompressionDictionary();
+
+    enum : uint32_t { MAX_SIZE = 64 * 1024 }; // LZ4 can't reference data further back than this
+
+    // Build from samples of the data the dictionary will be used to compress
+    // (samples are stored back to back, with their sizes in sampleSizes)
+    void        Train( const void * samples, const Array< uint32_t > & sampleSizes, uint32_t maxSize = MAX_SIZE );
+
+    // Take a dictionary trained elsewhere
+    bool        Load( const void * data, size_t dataSize );
+
+    void        Clear();
+
+    inline bool         IsEmpty() const { return ( m_Size == 0 ); }
+    inline const void * GetData() const { return m_Data; }
+    inline uint32_t     GetSize() const { return m_Size; }
+
+private:
+    void *      m_Data;
+    uint32_t    m_Size;
+};
+
+//------------------------------------------------------------------------------
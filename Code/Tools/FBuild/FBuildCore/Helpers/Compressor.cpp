@@ -4,18 +4,103 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Compressor.h"
+#include "CompressionDictionary.h"
 
 #include "Core/Containers/AutoPtr.h"
 #include "Core/Env/Assert.h"
+#include "Core/Env/Env.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/IOStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 
 #include "lz4.h"
+#include "lz4hc.h"
 
 #include <memory.h>
 
+// Defines
+//------------------------------------------------------------------------------
+#define MAX_BLOCK_SIZE ( 64 * 1024 * 1024 ) // reject block frames which would need unreasonable buffers to decompress
+
+// Block compression
+//------------------------------------------------------------------------------
+namespace
+{
+    struct CompressionSlot
+    {
+        char *          m_Output;
+        uint32_t        m_OutputSize;
+        Semaphore       m_Ready;        // signalled when m_Output holds the block
+    };
+
+    struct BlockCompressionState
+    {
+        const char *                m_Data;
+        size_t                      m_DataSize;
+        uint32_t                    m_NumBlocks;
+        Compressor::CompressionType m_Type;
+        CompressionSlot *           m_Slots;        // block N uses slot N % m_NumSlots
+        uint32_t                    m_NumSlots;
+        volatile uint32_t           m_NextBlock;
+        Semaphore                   m_FreeSlots;    // limits blocks compressed ahead of the writer
+    };
+
+    // Compress a block, storing it uncompressed if that would be smaller
+    uint32_t CompressBlock( const char * src, uint32_t srcSize, char * dst, Compressor::CompressionType type )
+    {
+        const int dstCapacity = LZ4_compressBound( (int)srcSize );
+        const int size = ( type == Compressor::COMPRESSION_TYPE_LZ4HC ) ? LZ4_compress_HC( src, dst, (int)srcSize, dstCapacity, LZ4HC_CLEVEL_DEFAULT )
+                                                                        : LZ4_compress_default( src, dst, (int)srcSize, dstCapacity );
+        if ( ( size <= 0 ) || ( (uint32_t)size >= srcSize ) )
+        {
+            memcpy( dst, src, srcSize );
+            return srcSize;
+        }
+        return (uint32_t)size;
+    }
+
+    bool DecompressBlock( const char * src, uint32_t srcSize, char * dst, uint32_t dstSize )
+    {
+        if ( srcSize == dstSize )
+        {
+            memcpy( dst, src, srcSize ); // stored uncompressed
+            return true;
+        }
+        return ( LZ4_decompress_safe( src, dst, (int)srcSize, (int)dstSize ) == (int)dstSize );
+    }
+
+    bool WriteBlock( IOStream & output, const char * data, uint32_t size )
+    {
+        return ( output.Write( size ) && ( output.WriteBuffer( data, size ) == size ) );
+    }
+
+    uint32_t BlockCompressionThreadFunc( void * param )
+    {
+        BlockCompressionState & state = *static_cast< BlockCompressionState * >( param );
+        for ( ;; )
+        {
+            state.m_FreeSlots.Wait();
+            const uint32_t block = ( AtomicIncU32( &state.m_NextBlock ) - 1 );
+            if ( block >= state.m_NumBlocks )
+            {
+                return 0;
+            }
+
+            const size_t offset = ( (size_t)block * Compressor::BLOCK_SIZE );
+            const uint32_t size = (uint32_t)Math::Min< size_t >( state.m_DataSize - offset, Compressor::BLOCK_SIZE );
+            CompressionSlot & slot = state.m_Slots[ block % state.m_NumSlots ];
+            slot.m_OutputSize = CompressBlock( state.m_Data + offset, size, slot.m_Output, state.m_Type );
+            slot.m_Ready.Signal();
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 Compressor::Compressor()
     : m_Result( nullptr )
@@ -34,11 +119,23 @@ Compressor::~Compressor()
 //------------------------------------------------------------------------------
 bool Compressor::IsValidData( const void * data, size_t dataSize ) const
 {
+    if ( dataSize < sizeof( Header ) )
+    {
+        return false;
+    }
     const Header * header = (const Header *)data;
-    if ( header->m_CompressionType > 1 )
+    if ( header->m_CompressionType > COMPRESSION_TYPE_LZ4HC )
+    {
+        return false;
+    }
+    if ( ( header->m_Flags & ~( HEADER_FLAG_DICTIONARY | HEADER_FLAG_BLOCKS ) ) || ( header->m_Padding != 0 ) )
     {
         return false;
     }
+    if ( header->m_Flags & HEADER_FLAG_BLOCKS )
+    {
+        return IsValidBlockFrame( header, dataSize );
+    }
     if ( ( header->m_CompressedSize + sizeof( Header ) ) != dataSize )
     {
         return false;
@@ -52,22 +149,54 @@ bool Compressor::IsValidData( const void * data, size_t dataSize ) const
 
 // Compress
 //------------------------------------------------------------------------------
-bool Compressor::Compress( const void * data, size_t dataSize )
+bool Compressor::Compress( const void * data, size_t dataSize, CompressionType type, const CompressionDictionary * dictionary )
 {
     PROFILE_FUNCTION
 
     ASSERT( data );
     ASSERT( m_Result == nullptr );
+    ASSERT( type != COMPRESSION_TYPE_NONE );
+
+    const bool useDictionary = ( dictionary && ( dictionary->IsEmpty() == false ) );
 
     // allocate worst case output size for LZ4
     const int worstCaseSize = LZ4_compressBound( (int)dataSize );
     AutoPtr< char > output( (char *)ALLOC( (size_t)worstCaseSize ) );
 
     // do compression
-    const int compressedSize = LZ4_compress_default( (const char*)data, output.Get(), (int)dataSize, worstCaseSize);
+    int compressedSize;
+    if ( type == COMPRESSION_TYPE_LZ4HC )
+    {
+        if ( useDictionary )
+        {
+            LZ4_streamHC_t * stream = LZ4_createStreamHC();
+            LZ4_loadDictHC( stream, (const char *)dictionary->GetData(), (int)dictionary->GetSize() );
+            compressedSize = LZ4_compress_HC_continue( stream, (const char*)data, output.Get(), (int)dataSize, worstCaseSize );
+            LZ4_freeStreamHC( stream );
+        }
+        else
+        {
+            compressedSize = LZ4_compress_HC( (const char*)data, output.Get(), (int)dataSize, worstCaseSize, LZ4HC_CLEVEL_DEFAULT );
+        }
+    }
+    else
+    {
+        ASSERT( type == COMPRESSION_TYPE_LZ4 );
+        if ( useDictionary )
+        {
+            LZ4_stream_t * stream = LZ4_createStream();
+            LZ4_loadDict( stream, (const char *)dictionary->GetData(), (int)dictionary->GetSize() );
+            compressedSize = LZ4_compress_fast_continue( stream, (const char*)data, output.Get(), (int)dataSize, worstCaseSize, 1 );
+            LZ4_freeStream( stream );
+        }
+        else
+        {
+            compressedSize = LZ4_compress_default( (const char*)data, output.Get(), (int)dataSize, worstCaseSize );
+        }
+    }
 
     // did the compression yield any benefit?
-    const bool compressed = ( compressedSize < (int)dataSize );
+    const bool compressed = ( compressedSize > 0 ) && ( compressedSize < (int)dataSize );
 
     if ( compressed )
     {
@@ -86,7 +215,9 @@ bool Compressor::Compress( const void * data, size_t dataSize )
 
     // fill out header
     Header * header = (Header*)m_Result;
-    header->m_CompressionType = compressed ? 1u : 0u;   // compression type
+    header->m_CompressionType = compressed ? (uint8_t)type : (uint8_t)COMPRESSION_TYPE_NONE;
+    header->m_Flags = ( compressed && useDictionary ) ? HEADER_FLAG_DICTIONARY : 0;
+    header->m_Padding = 0;
     header->m_UncompressedSize = (uint32_t)dataSize;    // input size
     header->m_CompressedSize = compressed ? compressedSize : (uint32_t)dataSize;    // output size
 
@@ -95,7 +226,7 @@ bool Compressor::Compress( const void * data, size_t dataSize )
 
 // Decompress
 //------------------------------------------------------------------------------
-bool Compressor::Decompress( const void * data )
+bool Compressor::Decompress( const void * data, const CompressionDictionary * dictionary )
 {
     PROFILE_FUNCTION
 
@@ -105,14 +236,26 @@ bool Compressor::Decompress( const void * data )
     const Header * header = (const Header *)data;
 
     // handle uncompressed case
-    if ( header->m_CompressionType == 0 )
+    if ( header->m_CompressionType == COMPRESSION_TYPE_NONE )
     {
         m_Result = ALLOC( header->m_UncompressedSize );
         memcpy( m_Result, (char *)data + sizeof( Header ), header->m_UncompressedSize );
         m_ResultSize = header->m_UncompressedSize;
         return true;
     }
-    ASSERT( header->m_CompressionType == 1 );
+    ASSERT( ( header->m_CompressionType == COMPRESSION_TYPE_LZ4 ) || ( header->m_CompressionType == COMPRESSION_TYPE_LZ4HC ) );
+
+    // data compressed with a dictionary can't be decoded without it
+    const bool useDictionary = ( ( header->m_Flags & HEADER_FLAG_DICTIONARY ) != 0 );
+    if ( useDictionary && ( ( dictionary == nullptr ) || dictionary->IsEmpty() ) )
+    {
+        return false;
+    }
+
+    if ( header->m_Flags & HEADER_FLAG_BLOCKS )
+    {
+        return DecompressBlocks( header );
+    }
 
     // uncompressed size
     const uint32_t uncompressedSize = header->m_UncompressedSize;
@@ -122,8 +265,9 @@ bool Compressor::Decompress( const void * data )
     // skip over header to LZ4 data
     const char * compressedData = ( (const char *)data + sizeof( Header ) );
 
-    // decompress
-    const int bytesDecompressed = LZ4_decompress_safe( compressedData, (char *)m_Result, (int)header->m_CompressedSize, (int)uncompressedSize);
+    // decompress (LZ4 and LZ4HC share a format)
+    const int bytesDecompressed = useDictionary ? LZ4_decompress_safe_usingDict( compressedData, (char *)m_Result, (int)header->m_CompressedSize, (int)uncompressedSize, (const char *)dictionary->GetData(), (int)dictionary->GetSize() )
+                                                : LZ4_decompress_safe( compressedData, (char *)m_Result, (int)header->m_CompressedSize, (int)uncompressedSize);
     if ( bytesDecompressed == (int)uncompressedSize )
     {
         return true;
@@ -136,4 +280,289 @@ bool Compressor::Decompress( const void * data )
     return false;
 }
 
+// CompressBlocks
+//------------------------------------------------------------------------------
+void Compressor::CompressBlocks( const void * data, size_t dataSize, CompressionType type, uint32_t numThreads )
+{
+    ASSERT( m_Result == nullptr );
+
+    // grow the output as blocks complete, instead of allocating the worst case up front
+    MemoryStream output( sizeof( Header ) + ( dataSize / 4 ), 4 * BLOCK_SIZE );
+    VERIFY( CompressBlocks( data, dataSize, output, type, numThreads ) ); // can't fail writing to memory
+    m_ResultSize = output.GetSize();
+    m_Result = output.Release();
+}
+
+// CompressBlocks
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::CompressBlocks( const void * data, size_t dataSize, IOStream & output, CompressionType type, uint32_t numThreads )
+{
+    PROFILE_FUNCTION
+
+    ASSERT( data );
+    ASSERT( type != COMPRESSION_TYPE_NONE );
+    ASSERT( dataSize <= 0xFFFFFFFF ); // only 32bit data supported
+
+    Header header;
+    header.m_CompressionType = (uint8_t)type;
+    header.m_Flags = HEADER_FLAG_BLOCKS;
+    header.m_Padding = 0;
+    header.m_UncompressedSize = (uint32_t)dataSize;
+    header.m_CompressedSize = BLOCK_SIZE;
+    if ( output.WriteBuffer( &header, sizeof( Header ) ) != sizeof( Header ) )
+    {
+        return false;
+    }
+
+    const uint32_t numBlocks = (uint32_t)( ( dataSize + BLOCK_SIZE - 1 ) / BLOCK_SIZE );
+    numThreads = Math::Min( ( numThreads > 0 ) ? numThreads : Env::GetNumProcessors(), numBlocks );
+
+    // not worth spawning threads for a single block
+    if ( numThreads <= 1 )
+    {
+        AutoPtr< char > buffer( (char *)ALLOC( (size_t)LZ4_compressBound( BLOCK_SIZE ) ) );
+        for ( uint32_t block = 0; block < numBlocks; ++block )
+        {
+            const size_t offset = ( (size_t)block * BLOCK_SIZE );
+            const uint32_t size = (uint32_t)Math::Min< size_t >( dataSize - offset, BLOCK_SIZE );
+            const uint32_t compressedSize = CompressBlock( (const char *)data + offset, size, buffer.Get(), type );
+            if ( WriteBlock( output, buffer.Get(), compressedSize ) == false )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // compress on worker threads, up to two blocks per thread ahead of the output
+    BlockCompressionState state;
+    state.m_Data = (const char *)data;
+    state.m_DataSize = dataSize;
+    state.m_NumBlocks = numBlocks;
+    state.m_Type = type;
+    state.m_NumSlots = ( numThreads * 2 );
+    state.m_Slots = FNEW_ARRAY( CompressionSlot[ state.m_NumSlots ] );
+    state.m_NextBlock = 0;
+    for ( uint32_t i = 0; i < state.m_NumSlots; ++i )
+    {
+        state.m_Slots[ i ].m_Output = (char *)ALLOC( (size_t)LZ4_compressBound( BLOCK_SIZE ) );
+    }
+    state.m_FreeSlots.Signal( state.m_NumSlots );
+
+    Array< Thread::ThreadHandle > threads( numThreads, false );
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        threads.Append( Thread::CreateThread( BlockCompressionThreadFunc, "CompressBlocks", ( 64 * KILOBYTE ), &state ) );
+    }
+
+    // write blocks in order as they complete (waiting for every block, even if writing fails)
+    bool ok = true;
+    for ( uint32_t block = 0; block < numBlocks; ++block )
+    {
+        CompressionSlot & slot = state.m_Slots[ block % state.m_NumSlots ];
+        slot.m_Ready.Wait();
+        ok = ok && WriteBlock( output, slot.m_Output, slot.m_OutputSize );
+        state.m_FreeSlots.Signal();
+    }
+    state.m_FreeSlots.Signal( numThreads ); // release threads waiting to claim blocks past the end
+
+    for ( Thread::ThreadHandle handle : threads )
+    {
+        Thread::WaitForThread( handle );
+        Thread::CloseHandle( handle );
+    }
+    for ( uint32_t i = 0; i < state.m_NumSlots; ++i )
+    {
+        FREE( state.m_Slots[ i ].m_Output );
+    }
+    FDELETE_ARRAY( state.m_Slots );
+
+    return ok;
+}
+
+// Decompress
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::Decompress( IOStream & input, IOStream & output )
+{
+    PROFILE_FUNCTION
+
+    Header header;
+    if ( input.ReadBuffer( &header, sizeof( Header ) ) != sizeof( Header ) )
+    {
+        return false;
+    }
+
+    // data from Compress is decompressed in one go
+    if ( ( header.m_Flags & HEADER_FLAG_BLOCKS ) == 0 )
+    {
+        const size_t dataSize = ( sizeof( Header ) + header.m_CompressedSize );
+        AutoPtr< char > data( (char *)ALLOC( dataSize ) );
+        memcpy( data.Get(), &header, sizeof( Header ) );
+        if ( input.ReadBuffer( data.Get() + sizeof( Header ), header.m_CompressedSize ) != header.m_CompressedSize )
+        {
+            return false;
+        }
+        Compressor c;
+        if ( ( c.IsValidData( data.Get(), dataSize ) == false ) || ( c.Decompress( data.Get() ) == false ) )
+        {
+            return false;
+        }
+        return ( output.WriteBuffer( c.GetResult(), c.GetResultSize() ) == c.GetResultSize() );
+    }
+
+    const uint32_t blockSize = header.m_CompressedSize;
+    if ( ( header.m_CompressionType == COMPRESSION_TYPE_NONE ) ||
+         ( header.m_CompressionType > COMPRESSION_TYPE_LZ4HC ) ||
+         ( header.m_Flags != HEADER_FLAG_BLOCKS ) ||
+         ( header.m_Padding != 0 ) ||
+         ( blockSize == 0 ) || ( blockSize > MAX_BLOCK_SIZE ) )
+    {
+        return false;
+    }
+
+    // only one block is held at a time
+    AutoPtr< char > compressed( (char *)ALLOC( blockSize ) );
+    AutoPtr< char > uncompressed( (char *)ALLOC( blockSize ) );
+    uint32_t remaining = header.m_UncompressedSize;
+    while ( remaining > 0 )
+    {
+        const uint32_t size = Math::Min( remaining, blockSize );
+        uint32_t compressedSize;
+        if ( ( input.Read( compressedSize ) == false ) ||
+             ( compressedSize > size ) ||
+             ( input.ReadBuffer( compressed.Get(), compressedSize ) != compressedSize ) ||
+             ( DecompressBlock( compressed.Get(), compressedSize, uncompressed.Get(), size ) == false ) ||
+             ( output.WriteBuffer( uncompressed.Get(), size ) != size ) )
+        {
+            return false;
+        }
+        remaining -= size;
+    }
+    return true;
+}
+
+// Decompress
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::Decompress( const void * data, size_t dataSize, IOStream & output )
+{
+    PROFILE_FUNCTION
+
+    Compressor c;
+    if ( c.IsValidData( data, dataSize ) == false )
+    {
+        return false;
+    }
+    const Header * header = (const Header *)data;
+
+    // uncompressed data is written as is
+    if ( header->m_CompressionType == COMPRESSION_TYPE_NONE )
+    {
+        const uint32_t size = header->m_UncompressedSize;
+        return ( ( sizeof( Header ) + size ) <= dataSize ) &&
+               ( output.WriteBuffer( header + 1, size ) == size );
+    }
+
+    // data from Compress is decompressed in one go
+    if ( ( header->m_Flags & HEADER_FLAG_BLOCKS ) == 0 )
+    {
+        if ( c.Decompress( data ) == false )
+        {
+            return false;
+        }
+        return ( output.WriteBuffer( c.GetResult(), c.GetResultSize() ) == c.GetResultSize() );
+    }
+
+    // only one uncompressed block is held at a time (block sizes were validated above)
+    const uint32_t blockSize = header->m_CompressedSize;
+    uint32_t remaining = header->m_UncompressedSize;
+    AutoPtr< char > uncompressed( (char *)ALLOC( Math::Min( remaining, blockSize ) ) );
+    const char * src = (const char *)( header + 1 );
+    while ( remaining > 0 )
+    {
+        const uint32_t size = Math::Min( remaining, blockSize );
+        uint32_t compressedSize;
+        memcpy( &compressedSize, src, sizeof( uint32_t ) );
+        src += sizeof( uint32_t );
+        if ( ( DecompressBlock( src, compressedSize, uncompressed.Get(), size ) == false ) ||
+             ( output.WriteBuffer( uncompressed.Get(), size ) != size ) )
+        {
+            return false;
+        }
+        src += compressedSize;
+        remaining -= size;
+    }
+    return true;
+}
+
+// IsValidBlockFrame
+//------------------------------------------------------------------------------
+bool Compressor::IsValidBlockFrame( const Header * header, size_t dataSize ) const
+{
+    // dictionaries aren't supported with block frames
+    const uint32_t blockSize = header->m_CompressedSize;
+    if ( ( header->m_CompressionType == COMPRESSION_TYPE_NONE ) ||
+         ( header->m_Flags & HEADER_FLAG_DICTIONARY ) ||
+         ( blockSize == 0 ) || ( blockSize > MAX_BLOCK_SIZE ) )
+    {
+        return false;
+    }
+
+    // walk the blocks, which must exactly fill the data
+    const char * pos = (const char *)( header + 1 );
+    const char * const end = ( (const char *)header + dataSize );
+    uint32_t remaining = header->m_UncompressedSize;
+    while ( remaining > 0 )
+    {
+        uint32_t compressedSize;
+        if ( (size_t)( end - pos ) < sizeof( uint32_t ) )
+        {
+            return false;
+        }
+        memcpy( &compressedSize, pos, sizeof( uint32_t ) );
+        pos += sizeof( uint32_t );
+
+        const uint32_t size = Math::Min( remaining, blockSize );
+        if ( ( compressedSize > size ) || ( (size_t)( end - pos ) < compressedSize ) )
+        {
+            return false;
+        }
+        pos += compressedSize;
+        remaining -= size;
+    }
+    return ( pos == end );
+}
+
+// DecompressBlocks
+//------------------------------------------------------------------------------
+bool Compressor::DecompressBlocks( const Header * header )
+{
+    const uint32_t uncompressedSize = header->m_UncompressedSize;
+    const uint32_t blockSize = header->m_CompressedSize;
+    m_Result = ALLOC( uncompressedSize );
+    m_ResultSize = uncompressedSize;
+
+    const char * src = (const char *)( header + 1 );
+    char * dst = (char *)m_Result;
+    uint32_t remaining = uncompressedSize;
+    while ( remaining > 0 )
+    {
+        const uint32_t size = Math::Min( remaining, blockSize );
+        uint32_t compressedSize;
+        memcpy( &compressedSize, src, sizeof( uint32_t ) );
+        src += sizeof( uint32_t );
+        if ( DecompressBlock( src, compressedSize, dst, size ) == false )
+        {
+            // Data is corrupt
+            FREE( m_Result );
+            m_Result = nullptr;
+            m_ResultSize = 0;
+            return false;
+        }
+        src += compressedSize;
+        dst += size;
+        remaining -= size;
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
@@ -6,6 +6,11 @@
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CompressionDictionary;
+class IOStream;
+
 // Compressor
 //------------------------------------------------------------------------------
 class Compressor
@@ -14,10 +19,38 @@ public:
     explicit Compressor();
     ~Compressor();
 
+    enum CompressionType : uint8_t
+    {
+        COMPRESSION_TYPE_NONE   = 0,    // data could not be compressed
+        COMPRESSION_TYPE_LZ4    = 1,    // fast (default)
+        COMPRESSION_TYPE_LZ4HC  = 2,    // slower to compress, smaller output, same decompression speed
+    };
+    // Bitmask of types this build can decompress (sent to Clients by Servers)
+    static inline uint8_t GetSupportedTypes() { return ( 1 << COMPRESSION_TYPE_LZ4 ) | ( 1 << COMPRESSION_TYPE_LZ4HC ); }
+
     bool IsValidData( const void * data, size_t dataSize ) const;
 
-    bool Compress( const void * data, size_t dataSize );
-    bool Decompress( const void * data );
+    bool Compress( const void * data, size_t dataSize, CompressionType type = COMPRESSION_TYPE_LZ4, const CompressionDictionary * dictionary = nullptr );
+    bool Decompress( const void * data, const CompressionDictionary * dictionary = nullptr );
+
+    // Block frames
+    //  - Large buffers (PCHs, PDBs) are split into fixed size blocks which are
+    //    compressed on several threads (0 = one per processor) and written out in
+    //    order as each completes, so output can be consumed (written to a file or
+    //    socket) while compression is still running
+    //  - Only a few blocks per thread are held beyond the output, rather than a
+    //    worst case sized copy of the whole buffer
+    //  - Output is the same regardless of the number of threads used
+    enum : uint32_t { BLOCK_SIZE = ( 1024 * 1024 ) };
+    void        CompressBlocks( const void * data, size_t dataSize, CompressionType type = COMPRESSION_TYPE_LZ4, uint32_t numThreads = 0 );
+    static bool CompressBlocks( const void * data, size_t dataSize, IOStream & output, CompressionType type = COMPRESSION_TYPE_LZ4, uint32_t numThreads = 0 );
+
+    // Decompress a block frame (or data from Compress) from a stream, a block at a time
+    static bool Decompress( IOStream & input, IOStream & output );
+
+    // Decompress data in memory (which can be memory-mapped) to a stream, a block at a
+    // time, without a copy of the input (data is validated)
+    static bool Decompress( const void * data, size_t dataSize, IOStream & output );
 
     const void *    GetResult() const       { return m_Result; }
     size_t          GetResultSize() const   { return m_ResultSize; }
@@ -27,10 +60,21 @@ public:
 private:
     struct Header
     {
-        uint32_t m_CompressionType;
+        uint8_t  m_CompressionType; // CompressionType (older versions wrote a uint32_t with the same values)
+        uint8_t  m_Flags;           // HEADER_FLAG_xxx
+        uint16_t m_Padding;
         uint32_t m_UncompressedSize;
-        uint32_t m_CompressedSize;
+        uint32_t m_CompressedSize;  // size of the data following the header (block frames: size of each block before compression)
+    };
+    enum : uint8_t
+    {
+        HEADER_FLAG_DICTIONARY  = 0x1,  // data can only be decompressed with the same dictionary
+        HEADER_FLAG_BLOCKS      = 0x2,  // data is a sequence of blocks, each prefixed by its compressed size
     };
+
+    bool        IsValidBlockFrame( const Header * header, size_t dataSize ) const;
+    bool        DecompressBlocks( const Header * header );
+
     void * m_Result;
     size_t m_ResultSize;
 };
@@ -38,6 +38,27 @@ FBuildStats::FBuildStats()
     , m_TotalBuildTime( 0.0f )
     , m_TotalLocalCPUTimeMS( 0 )
     , m_TotalRemoteCPUTimeMS( 0 )
+    , m_StatPrePassTime( 0.0f )
+    , m_StatPrePassFiles( 0 )
+    , m_NumAsyncCacheStores( 0 )
+    , m_NumAsyncCacheStoreFails( 0 )
+    , m_AsyncCacheStoreTime( 0.0f )
+    , m_AsyncCacheDrainTime( 0.0f )
+    , m_NumCachePrefetches( 0 )
+    , m_NumCachePrefetchHits( 0 )
+    , m_CachePrefetchTime( 0.0f )
+    , m_NumLocalCacheHits( 0 )
+    , m_NumSharedCacheHits( 0 )
+    , m_NumLocalCachePromotions( 0 )
+    , m_PeakLocalLinkJobs( 0 )
+    , m_PeakLocalCopyJobs( 0 )
+    , m_PeakLocalJobMemoryMiB( 0 )
+    , m_DistBytesDeduplicated( 0 )
+    , m_NumDistJobsHighCompression( 0 )
+    , m_NumDistJobsWithDictionary( 0 )
+    , m_NumDistToolchainsPreseeded( 0 )
+    , m_NumDistResultChunks( 0 )
+    , m_CriticalPath( 0, true )
     , m_RootNode( nullptr )
     , m_NodesByTime( 100 * 1000, true )
 {}
@@ -88,6 +109,11 @@ void FBuildStats::OnBuildStop( Node * node )
             OutputSummary();
         }
     }
+
+    if ( options.m_CriticalPathScheduling )
+    {
+        OutputCriticalPath();
+    }
 }
 
 // GatherPostBuildStatistics
@@ -189,6 +215,29 @@ void FBuildStats::OutputSummary() const
         output.AppendFormat( " - Hits       : %u (%2.1f %%)\n", hits, (double)hitPerc );
         output.AppendFormat( " - Misses     : %u\n", misses );
         output.AppendFormat( " - Stores     : %u\n", stores );
+        if ( ( m_NumAsyncCacheStores + m_NumAsyncCacheStoreFails ) > 0 )
+        {
+            // Store time would otherwise have been spent on the worker threads, but time
+            // waiting for the background threads to finish after the build was not saved
+            AStackString<> storeTime;
+            AStackString<> drainTime;
+            FormatTime( m_AsyncCacheStoreTime, storeTime );
+            FormatTime( m_AsyncCacheDrainTime, drainTime );
+            output.AppendFormat( " - Async      : %u (%u failed) - Store: %s (Waited after build: %s)\n",
+                                 m_NumAsyncCacheStores, m_NumAsyncCacheStoreFails, storeTime.Get(), drainTime.Get() );
+        }
+        if ( m_NumCachePrefetches > 0 )
+        {
+            AStackString<> prefetchTime;
+            FormatTime( m_CachePrefetchTime, prefetchTime );
+            output.AppendFormat( " - Prefetched : %u (%u found) - Lookup: %s\n",
+                                 m_NumCachePrefetches, m_NumCachePrefetchHits, prefetchTime.Get() );
+        }
+        if ( ( m_NumLocalCacheHits + m_NumSharedCacheHits ) > 0 )
+        {
+            output.AppendFormat( " - Local      : %u hits (%u from shared, %u promoted)\n",
+                                 m_NumLocalCacheHits, m_NumSharedCacheHits, m_NumLocalCachePromotions );
+        }
     }
 
     AStackString<> buffer;
@@ -203,6 +252,41 @@ void FBuildStats::OutputSummary() const
     FormatTime( totalRemoteCPUInSeconds, buffer );
     float remoteRatio = ( totalRemoteCPUInSeconds / m_TotalBuildTime );
     output.AppendFormat( " - Remote CPU : %s (%2.1f:1)\n", buffer.Get(), (double)remoteRatio );
+    if ( m_StatPrePassFiles > 0 )
+    {
+        FormatTime( m_StatPrePassTime, buffer );
+        output.AppendFormat( " - Stat Phase : %s (%u files)\n", buffer.Get(), m_StatPrePassFiles );
+    }
+    output += "-----------------------------------------------------------------\n";
+
+    OUTPUT( "%s", output.Get() );
+}
+
+// OutputCriticalPath
+//------------------------------------------------------------------------------
+void FBuildStats::OutputCriticalPath() const
+{
+    PROFILE_FUNCTION
+
+    AStackString< 4096 > output;
+    output += "--- Critical Path -----------------------------------------------\n";
+    output += "Time (s)  Name:\n";
+
+    uint32_t totalTimeMS = 0;
+    for ( const Node * n : m_CriticalPath )
+    {
+        // only show nodes which did some work (not input files etc)
+        if ( n->GetProcessingTime() == 0 )
+        {
+            continue;
+        }
+        totalTimeMS += n->GetProcessingTime();
+        output.AppendFormat( "%-9.3f %s\n", (double)( (float)n->GetProcessingTime() / 1000.0f ), n->GetPrettyName().Get() );
+    }
+
+    AStackString<> buffer;
+    FormatTime( (float)( (double)totalTimeMS / (double)1000 ), buffer );
+    output.AppendFormat( " - Total     : %s\n", buffer.Get() );
     output += "-----------------------------------------------------------------\n";
 
     OUTPUT( "%s", output.Get() );
@@ -31,11 +31,35 @@ public:
     float       m_TotalBuildTime;       // Total time taken
     uint32_t    m_TotalLocalCPUTimeMS;  // Total CPU time on local host
     uint32_t    m_TotalRemoteCPUTimeMS; // Total CPU time on remote workers
+    float       m_StatPrePassTime;      // Time spent querying file stamps (-prestat)
+    uint32_t    m_StatPrePassFiles;     // Number of files queried (-prestat)
+    uint32_t    m_NumAsyncCacheStores;      // Entries published in the background (-cacheasync)
+    uint32_t    m_NumAsyncCacheStoreFails;  // Entries which failed to publish in the background (-cacheasync)
+    float       m_AsyncCacheStoreTime;      // Time spent publishing in the background (-cacheasync)
+    float       m_AsyncCacheDrainTime;      // Time spent waiting for background publishing after the build (-cacheasync)
+    uint32_t    m_NumCachePrefetches;       // Entries looked up before being built (-cacheprefetch)
+    uint32_t    m_NumCachePrefetchHits;     // Entries found by lookups before being built (-cacheprefetch)
+    float       m_CachePrefetchTime;        // Time spent on lookups before being built (-cacheprefetch)
+    uint32_t    m_NumLocalCacheHits;        // Entries found in the local cache (.CacheLocalPath)
+    uint32_t    m_NumSharedCacheHits;       // Entries found in the shared cache behind the local cache (.CacheLocalPath)
+    uint32_t    m_NumLocalCachePromotions;  // Shared cache entries copied to the local cache (.CacheLocalPath)
+    uint32_t    m_PeakLocalLinkJobs;        // Most local link jobs at once (if .LocalLinkJobLimit is set)
+    uint32_t    m_PeakLocalCopyJobs;        // Most local copy jobs at once (if .LocalCopyJobLimit is set)
+    uint32_t    m_PeakLocalJobMemoryMiB;    // Most estimated memory of local jobs at once (if .LocalJobMemoryLimitMiB is set)
+    uint64_t    m_DistBytesDeduplicated;    // Job data sent to workers by hash (-distdedup)
+    uint32_t    m_NumDistJobsHighCompression;   // Jobs sent to workers compressed with LZ4HC (-disthc)
+    uint32_t    m_NumDistJobsWithDictionary;    // Jobs sent to workers compressed with a dictionary (-distdictionary)
+    uint32_t    m_NumDistToolchainsPreseeded;   // Toolchains pushed to workers ahead of jobs (-distpreseed)
+    uint32_t    m_NumDistResultChunks;          // Chunks of large results streamed from workers
+
+    // chain of nodes which bounded the build time (-criticalpath)
+    Array< const Node * > m_CriticalPath;
 
     // after the build it complete, accumulate all the stats
     void GatherPostBuildStatistics( Node * node );
 
     void OutputSummary() const;
+    void OutputCriticalPath() const;
 
     // get the total stats
     uint32_t GetNodesProcessed() const  { return m_Totals.m_NumProcessed; }
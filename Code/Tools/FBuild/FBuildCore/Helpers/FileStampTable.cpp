@@ -0,0 +1,146 @@
+// FileStampTable
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FileStampTable.h"
+
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ParallelFor.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Time/Timer.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define STAMP_NOT_QUERIED   ( 0xFFFFFFFFFFFFFFFF )
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+FileStampTable::FileStampTable()
+    : m_Files( 0, true )
+    , m_Stamps( 0, true )
+    , m_StatTime( 0.0f )
+    , m_Valid( false )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+FileStampTable::~FileStampTable() = default;
+
+// Populate
+//------------------------------------------------------------------------------
+void FileStampTable::Populate( NodeGraph & nodeGraph, Node * rootNode, uint32_t numThreads )
+{
+    PROFILE_FUNCTION
+
+    const Timer t;
+
+    // find all the files
+    Array< Node * > nodes( nodeGraph.GetNodeCount() + 1, true );
+    NodeGraph::s_BuildPassTag++;
+    NodeGraph::GatherNodesInDependencyOrder( rootNode, nodes );
+
+    m_Files.Clear();
+    m_Files.SetCapacity( nodes.GetSize() );
+    for ( const Node * node : nodes )
+    {
+        if ( ( node->GetType() != Node::PROXY_NODE ) && node->IsAFile() )
+        {
+            m_Files.Append( node );
+        }
+    }
+
+    // query them all
+    m_Stamps.SetSize( nodeGraph.GetNodeCount() );
+    for ( uint64_t & stamp : m_Stamps )
+    {
+        stamp = STAMP_NOT_QUERIED;
+    }
+    ParallelFor::Run( (uint32_t)m_Files.GetSize(), numThreads, StatFunc, this );
+
+    m_StatTime = t.GetElapsed();
+    m_Valid = true;
+
+    FLOG_INFO( "Stat pre-pass: %u files in %2.3fs", (uint32_t)m_Files.GetSize(), (double)m_StatTime );
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void FileStampTable::Clear()
+{
+    m_Files.Clear();
+    m_Stamps.Clear();
+    m_Valid = false;
+}
+
+// GetStamp
+//------------------------------------------------------------------------------
+bool FileStampTable::GetStamp( const Node * node, uint64_t & outStamp ) const
+{
+    if ( m_Valid == false )
+    {
+        return false;
+    }
+
+    // Nodes created during the build are not in the table
+    const uint32_t index = node->GetIndex();
+    if ( ( index >= m_Stamps.GetSize() ) || ( m_Stamps[ index ] == STAMP_NOT_QUERIED ) )
+    {
+        return false;
+    }
+
+    outStamp = m_Stamps[ index ];
+    return true;
+}
+
+// OnNodeBuilt
+//------------------------------------------------------------------------------
+void FileStampTable::OnNodeBuilt( const Node * node )
+{
+    if ( m_Valid == false )
+    {
+        return;
+    }
+
+    switch ( node->GetType() )
+    {
+        // These only read from the file system
+        case Node::PROXY_NODE:
+        case Node::FILE_NODE:
+        case Node::DIRECTORY_LIST_NODE:
+        case Node::ALIAS_NODE:
+        case Node::COMPILER_NODE:
+        case Node::OBJECT_LIST_NODE:
+        case Node::COPY_DIR_NODE:
+        case Node::SETTINGS_NODE:
+        {
+            return;
+        }
+        default:
+        {
+            // Any file in the graph may have been written (generated source
+            // files, unity files etc), so the stamps can't be trusted any more
+            FLOG_INFO( "Stat pre-pass stamps invalidated by '%s'", node->GetName().Get() );
+            m_Valid = false;
+            return;
+        }
+    }
+}
+
+// StatFunc
+//------------------------------------------------------------------------------
+/*static*/ bool FileStampTable::StatFunc( uint32_t index, void * userData )
+{
+    FileStampTable & table = *static_cast< FileStampTable * >( userData );
+    const Node * node = table.m_Files[ index ];
+    table.m_Stamps[ node->GetIndex() ] = FileIO::GetFileLastWriteTime( node->GetName() );
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,49 @@
+// FileStampTable
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Node;
+class NodeGraph;
+
+// FileStampTable
+//  - Last write times of all files in the graph, queried in parallel before
+//    the first build pass (-prestat)
+//  - Only valid until a job which may write files completes. After that,
+//    stamps are queried from the file system as they are needed.
+//------------------------------------------------------------------------------
+class FileStampTable
+{
+public:
+    explicit FileStampTable();
+    ~FileStampTable();
+
+    // Query stamps for every file node (inputs and outputs) the root depends on
+    void        Populate( NodeGraph & nodeGraph, Node * rootNode, uint32_t numThreads );
+    void        Clear();
+
+    // Get the stamp recorded for a node (Main Thread)
+    bool        GetStamp( const Node * node, uint64_t & outStamp ) const;
+
+    // Stop using the table if the completed node might have modified files (Main Thread)
+    void        OnNodeBuilt( const Node * node );
+
+    inline uint32_t GetNumFiles() const     { return (uint32_t)m_Files.GetSize(); }
+    inline float    GetStatTime() const     { return m_StatTime; }
+
+private:
+    static bool StatFunc( uint32_t index, void * userData );
+
+    Array< const Node * >   m_Files;    // Nodes queried by the pre-pass
+    Array< uint64_t >       m_Stamps;   // Indexed by node index
+    float                   m_StatTime;
+    bool                    m_Valid;
+};
+
+//------------------------------------------------------------------------------
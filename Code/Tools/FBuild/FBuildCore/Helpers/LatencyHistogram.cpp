@@ -0,0 +1,113 @@
+// LatencyHistogram
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "LatencyHistogram.h"
+
+#include "Core/Env/Assert.h"
+#include "Core/Process/Atomic.h"
+
+#include <memory.h>
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram()
+    : m_Count( 0 )
+{
+    memset( m_Buckets, 0, sizeof( m_Buckets ) );
+}
+
+// Record
+//------------------------------------------------------------------------------
+void LatencyHistogram::Record( uint32_t timeMS )
+{
+    AtomicIncU32( &m_Buckets[ GetBucketIndex( timeMS ) ] );
+    AtomicIncU32( &m_Count );
+}
+
+// GetCount
+//------------------------------------------------------------------------------
+uint32_t LatencyHistogram::GetCount() const
+{
+    return AtomicLoadRelaxed( &m_Count );
+}
+
+// GetPercentile
+//------------------------------------------------------------------------------
+uint32_t LatencyHistogram::GetPercentile( float fraction ) const
+{
+    ASSERT( ( fraction >= 0.0f ) && ( fraction <= 1.0f ) );
+
+    const uint32_t count = GetCount();
+    if ( count == 0 )
+    {
+        return 0;
+    }
+
+    // find the bucket containing the requested sample
+    //  - buckets may be updated concurrently, so the last non-empty bucket is
+    //    used if the total is not reached
+    const uint32_t target = ( (uint32_t)( fraction * (float)( count - 1 ) ) + 1 );
+    uint32_t total = 0;
+    uint32_t lastNonEmpty = 0;
+    for ( uint32_t i = 0; i < NUM_BUCKETS; ++i )
+    {
+        const uint32_t inBucket = AtomicLoadRelaxed( &m_Buckets[ i ] );
+        if ( inBucket == 0 )
+        {
+            continue;
+        }
+        lastNonEmpty = i;
+        total += inBucket;
+        if ( total >= target )
+        {
+            break;
+        }
+    }
+    return GetBucketMidPoint( lastNonEmpty );
+}
+
+// GetBucketIndex
+//------------------------------------------------------------------------------
+/*static*/ uint32_t LatencyHistogram::GetBucketIndex( uint32_t timeMS )
+{
+    // values below 4 have their own bucket
+    if ( timeMS < 4 )
+    {
+        return timeMS;
+    }
+
+    // find most significant bit
+    uint32_t msb = 2;
+    while ( ( msb < 31 ) && ( ( timeMS >> ( msb + 1 ) ) != 0 ) )
+    {
+        ++msb;
+    }
+
+    // 4 buckets per power of 2, using the 2 bits below the msb
+    const uint32_t subBucket = ( ( timeMS >> ( msb - 2 ) ) & 3 );
+    const uint32_t index = ( ( ( msb - 1 ) * 4 ) + subBucket );
+    ASSERT( index < NUM_BUCKETS );
+    return index;
+}
+
+// GetBucketMidPoint
+//------------------------------------------------------------------------------
+/*static*/ uint32_t LatencyHistogram::GetBucketMidPoint( uint32_t index )
+{
+    if ( index < 4 )
+    {
+        return index;
+    }
+
+    // invert GetBucketIndex
+    const uint32_t msb = ( ( index / 4 ) + 1 );
+    const uint32_t subBucket = ( index % 4 );
+    const uint64_t lower = ( (uint64_t)( 4 + subBucket ) << ( msb - 2 ) );
+    const uint64_t width = ( (uint64_t)1 << ( msb - 2 ) );
+    const uint64_t mid = ( lower + ( width / 2 ) );
+    return ( mid > 0xFFFFFFFF ) ? 0xFFFFFFFF : (uint32_t)mid;
+}
+
+//------------------------------------------------------------------------------
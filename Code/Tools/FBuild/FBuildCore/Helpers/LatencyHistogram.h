@@ -0,0 +1,38 @@
+// LatencyHistogram
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// LatencyHistogram
+//  - Distribution of durations (in ms), safe to record from any thread
+//  - Buckets are log-spaced with 4 buckets per power of 2, so percentiles are
+//    accurate to within ~12%
+//------------------------------------------------------------------------------
+class LatencyHistogram
+{
+public:
+    explicit LatencyHistogram();
+    ~LatencyHistogram() = default;
+
+    void        Record( uint32_t timeMS );
+
+    uint32_t    GetCount() const;
+
+    // Approximate duration which the given fraction (0.0 to 1.0) of samples
+    // did not exceed (0 if there are no samples)
+    uint32_t    GetPercentile( float fraction ) const;
+
+private:
+    static uint32_t GetBucketIndex( uint32_t timeMS );
+    static uint32_t GetBucketMidPoint( uint32_t index );
+
+    enum : uint32_t { NUM_BUCKETS = 124 }; // Enough for the full range of uint32_t
+
+    uint32_t    m_Count;
+    uint32_t    m_Buckets[ NUM_BUCKETS ];
+};
+
+//------------------------------------------------------------------------------
@@ -6,12 +6,39 @@
 #include "MultiBuffer.h"
 
 // Core
+#include "Core/Env/Assert.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Strings/AString.h"
 
+// system
+#include <memory.h> // for memcpy
+
+// OpenFileForWrite
+//------------------------------------------------------------------------------
+namespace
+{
+    bool OpenFileForWrite( FileStream & fs, const AString & fileName )
+    {
+        if ( fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+        {
+            return true;
+        }
+
+        // On Windows, we can occasionally fail to open the file with error 1224 (ERROR_USER_MAPPED_FILE), due to
+        // things like anti-virus etc. Simply retry if that happens
+        // Also, when a <LOCAL RACE> occurs, the local compilation process might not have exited at this point
+        // (we call ::TerminateProcess, which is async),which can cause failure below, because the file is still locked.
+        FileIO::WorkAroundForWindowsFilePermissionProblem( fileName, FileStream::WRITE_ONLY, 15 ); // 15 secs max wait
+
+        // Try again
+        return fs.Open( fileName.Get(), FileStream::WRITE_ONLY );
+    }
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 MultiBuffer::MultiBuffer()
@@ -126,19 +153,9 @@ bool MultiBuffer::ExtractFile( size_t index, const AString& fileName ) const
     const void * fileData = (void *)( (size_t)m_ReadStream->GetData() + offset );
 
     FileStream fs;
-    if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+    if ( !OpenFileForWrite( fs, fileName ) )
     {
-        // On Windows, we can occasionally fail to open the file with error 1224 (ERROR_USER_MAPPED_FILE), due to
-        // things like anti-virus etc. Simply retry if that happens
-        // Also, when a <LOCAL RACE> occurs, the local compilation process might not have exited at this point
-        // (we call ::TerminateProcess, which is async),which can cause failure below, because the file is still locked.
-        FileIO::WorkAroundForWindowsFilePermissionProblem( fileName, FileStream::WRITE_ONLY, 15 ); // 15 secs max wait
-
-        // Try again
-        if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
-        {
-            return false;
-        }
+        return false;
     }
     if ( fs.WriteBuffer( fileData, fileSize ) != fileSize )
     {
@@ -171,4 +188,196 @@ void * MultiBuffer::Release( size_t & outSize )
     return m_WriteStream->Release();
 }
 
+// CONSTRUCTOR - MultiBufferExtractor
+//------------------------------------------------------------------------------
+MultiBufferExtractor::MultiBufferExtractor( const Array< AString > & fileNames )
+    : m_FileNames( fileNames )
+    , m_HeaderSize( 0 )
+    , m_NumFiles( 0 )
+    , m_CurrentFile( 0 )
+    , m_CurrentFileRemaining( 0 )
+    , m_BytesWritten( 0 )
+    , m_Error( false )
+    , m_FileError( false )
+{
+    ASSERT( fileNames.GetSize() <= MultiBuffer::MAX_FILES );
+}
+
+// DESTRUCTOR - MultiBufferExtractor
+//------------------------------------------------------------------------------
+MultiBufferExtractor::~MultiBufferExtractor()
+{
+    if ( m_File.IsOpen() )
+    {
+        m_File.Close();
+    }
+}
+
+// IsComplete
+//------------------------------------------------------------------------------
+bool MultiBufferExtractor::IsComplete() const
+{
+    return ( m_Error == false ) && ( m_NumFiles > 0 ) && ( m_CurrentFile == m_NumFiles );
+}
+
+// GetFailedFileIndex
+//------------------------------------------------------------------------------
+bool MultiBufferExtractor::GetFailedFileIndex( size_t & outIndex ) const
+{
+    outIndex = m_CurrentFile;
+    return m_FileError;
+}
+
+// ReadBuffer
+//------------------------------------------------------------------------------
+/*virtual*/ uint64_t MultiBufferExtractor::ReadBuffer( void * UNUSED( buffer ), uint64_t UNUSED( bytesToRead ) )
+{
+    ASSERT( false ); // write only
+    return 0;
+}
+
+// WriteBuffer
+//------------------------------------------------------------------------------
+/*virtual*/ uint64_t MultiBufferExtractor::WriteBuffer( const void * buffer, uint64_t bytesToWrite )
+{
+    const uint8_t * src = (const uint8_t *)buffer;
+    uint64_t remaining = bytesToWrite;
+    while ( ( remaining > 0 ) && ( m_Error == false ) )
+    {
+        // Accumulate the header (number of files, then the size of each)
+        const uint32_t headerSize = ( m_HeaderSize < sizeof( uint32_t ) ) ? (uint32_t)sizeof( uint32_t )
+                                                                          : (uint32_t)( sizeof( uint32_t ) + ( sizeof( uint64_t ) * m_NumFiles ) );
+        if ( m_HeaderSize < headerSize )
+        {
+            const uint32_t size = (uint32_t)Math::Min< uint64_t >( remaining, ( headerSize - m_HeaderSize ) );
+            memcpy( m_Header + m_HeaderSize, src, size );
+            m_HeaderSize += size;
+            src += size;
+            remaining -= size;
+            if ( ( m_HeaderSize == headerSize ) && ( ParseHeader() == false ) )
+            {
+                m_Error = true;
+            }
+            continue;
+        }
+
+        // Data beyond the last file
+        if ( m_CurrentFile == m_NumFiles )
+        {
+            m_Error = true;
+            break;
+        }
+
+        // Write to the current file (files no one asked for are skipped)
+        const uint64_t size = Math::Min( remaining, m_CurrentFileRemaining );
+        if ( m_File.IsOpen() && ( m_File.WriteBuffer( src, size ) != size ) )
+        {
+            m_Error = true;
+            m_FileError = true;
+            break;
+        }
+        src += size;
+        remaining -= size;
+        m_CurrentFileRemaining -= size;
+        if ( m_CurrentFileRemaining == 0 )
+        {
+            if ( m_File.IsOpen() )
+            {
+                m_File.Close();
+            }
+            ++m_CurrentFile;
+            if ( StartFile() == false )
+            {
+                m_Error = true;
+                m_FileError = true;
+            }
+        }
+    }
+
+    const uint64_t bytesWritten = ( bytesToWrite - remaining );
+    m_BytesWritten += bytesWritten;
+    return m_Error ? 0 : bytesWritten;
+}
+
+// Flush
+//------------------------------------------------------------------------------
+/*virtual*/ void MultiBufferExtractor::Flush()
+{
+}
+
+// Tell
+//------------------------------------------------------------------------------
+/*virtual*/ uint64_t MultiBufferExtractor::Tell() const
+{
+    return m_BytesWritten;
+}
+
+// Seek
+//------------------------------------------------------------------------------
+/*virtual*/ bool MultiBufferExtractor::Seek( uint64_t UNUSED( pos ) ) const
+{
+    ASSERT( false ); // data must be written in order
+    return false;
+}
+
+// GetFileSize
+//------------------------------------------------------------------------------
+/*virtual*/ uint64_t MultiBufferExtractor::GetFileSize() const
+{
+    return m_BytesWritten;
+}
+
+// ParseHeader
+//------------------------------------------------------------------------------
+bool MultiBufferExtractor::ParseHeader()
+{
+    if ( m_HeaderSize == sizeof( uint32_t ) )
+    {
+        // There must be a file for each name, but can be extra files
+        memcpy( &m_NumFiles, m_Header, sizeof( uint32_t ) );
+        if ( ( m_NumFiles == 0 ) || ( m_NumFiles < m_FileNames.GetSize() ) || ( m_NumFiles > MultiBuffer::MAX_FILES ) )
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // File sizes received - start on the first file
+    memcpy( m_FileSizes, m_Header + sizeof( uint32_t ), sizeof( uint64_t ) * m_NumFiles );
+    if ( StartFile() == false )
+    {
+        m_FileError = true;
+        return false;
+    }
+    return true;
+}
+
+// StartFile
+//------------------------------------------------------------------------------
+bool MultiBufferExtractor::StartFile()
+{
+    // Open the current file, creating any empty files along the way
+    while ( m_CurrentFile < m_NumFiles )
+    {
+        m_CurrentFileRemaining = m_FileSizes[ m_CurrentFile ];
+        if ( m_CurrentFile < m_FileNames.GetSize() )
+        {
+            if ( OpenFileForWrite( m_File, m_FileNames[ m_CurrentFile ] ) == false )
+            {
+                return false;
+            }
+        }
+        if ( m_CurrentFileRemaining > 0 )
+        {
+            return true;
+        }
+        if ( m_File.IsOpen() )
+        {
+            m_File.Close();
+        }
+        ++m_CurrentFile;
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 // Core
 #include "Core/Containers/Array.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/FileStream.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -31,11 +32,55 @@ public:
 
     void *          Release( size_t & outSize );
 
-private:
     enum : uint32_t { MAX_FILES = 4 };
 
+private:
     ConstMemoryStream * m_ReadStream;
     MemoryStream *      m_WriteStream;
 };
 
+// MultiBufferExtractor
+//  - Writes out the files in a MultiBuffer as the MultiBuffer is written to it
+//    (by a Compressor for example), so the whole MultiBuffer is never held
+//  - Each file is closed as soon as it is complete
+//------------------------------------------------------------------------------
+class MultiBufferExtractor : public IOStream
+{
+public:
+    explicit MultiBufferExtractor( const Array< AString > & fileNames );
+    virtual ~MultiBufferExtractor() override;
+
+    // Were all the files written in full?
+    bool            IsComplete() const;
+
+    // Was there a problem writing a file (as opposed to invalid data)?
+    bool            GetFailedFileIndex( size_t & outIndex ) const;
+
+    // IOStream (write only)
+    virtual uint64_t ReadBuffer( void * buffer, uint64_t bytesToRead ) override;
+    virtual uint64_t WriteBuffer( const void * buffer, uint64_t bytesToWrite ) override;
+    virtual void Flush() override;
+    virtual uint64_t Tell() const override;
+    virtual bool Seek( uint64_t pos ) const override;
+    virtual uint64_t GetFileSize() const override;
+
+private:
+    bool            ParseHeader();
+    bool            StartFile();
+
+    enum : uint32_t { MAX_HEADER_SIZE = sizeof( uint32_t ) + ( sizeof( uint64_t ) * MultiBuffer::MAX_FILES ) };
+
+    const Array< AString > &    m_FileNames;
+    uint8_t                     m_Header[ MAX_HEADER_SIZE ];
+    uint32_t                    m_HeaderSize;           // bytes of header received so far
+    uint32_t                    m_NumFiles;             // once the header is received
+    uint64_t                    m_FileSizes[ MultiBuffer::MAX_FILES ];
+    uint32_t                    m_CurrentFile;
+    uint64_t                    m_CurrentFileRemaining;
+    FileStream                  m_File;
+    uint64_t                    m_BytesWritten;
+    bool                        m_Error;
+    bool                        m_FileError;
+};
+
 //------------------------------------------------------------------------------
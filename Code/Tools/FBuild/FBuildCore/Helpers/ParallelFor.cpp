@@ -0,0 +1,94 @@
+// ParallelFor
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ParallelFor.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+
+// ParallelForState
+//------------------------------------------------------------------------------
+namespace
+{
+    struct ParallelForState
+    {
+        ParallelFor::ItemFunction   m_Function;
+        void *                      m_UserData;
+        uint32_t                    m_NumItems;
+        uint32_t                    m_BatchSize;
+        volatile uint32_t           m_NextItem;
+        volatile bool               m_Stopped;
+    };
+}
+
+// Run
+//------------------------------------------------------------------------------
+/*static*/ bool ParallelFor::Run( uint32_t numItems, uint32_t numThreads, ItemFunction func, void * userData, uint32_t batchSize )
+{
+    PROFILE_FUNCTION
+
+    ParallelForState state;
+    state.m_Function = func;
+    state.m_UserData = userData;
+    state.m_NumItems = numItems;
+    state.m_BatchSize = batchSize;
+    state.m_NextItem = 0;
+    state.m_Stopped = false;
+
+    // Don't create more threads than there are batches of work
+    ASSERT( batchSize > 0 );
+    const uint32_t numBatches = ( ( numItems + batchSize - 1 ) / batchSize );
+    numThreads = Math::Min( numThreads, numBatches );
+
+    // The calling thread participates, so spawn one less thread
+    Array< Thread::ThreadHandle > threads( numThreads, false );
+    for ( uint32_t i = 1; i < numThreads; ++i )
+    {
+        threads.Append( Thread::CreateThread( ThreadFunc, "ParallelFor", ( 64 * KILOBYTE ), &state ) );
+    }
+    ThreadFunc( &state );
+    for ( Thread::ThreadHandle handle : threads )
+    {
+        Thread::WaitForThread( handle );
+        Thread::CloseHandle( handle );
+    }
+
+    return ( AtomicLoadRelaxed( &state.m_Stopped ) == false );
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t ParallelFor::ThreadFunc( void * param )
+{
+    ParallelForState & state = *static_cast< ParallelForState * >( param );
+    while ( AtomicLoadRelaxed( &state.m_Stopped ) == false )
+    {
+        // claim a batch of items
+        const uint32_t end = AtomicAddU32( &state.m_NextItem, state.m_BatchSize );
+        const uint32_t begin = ( end - state.m_BatchSize );
+        if ( begin >= state.m_NumItems )
+        {
+            break;
+        }
+
+        const uint32_t batchEnd = Math::Min( end, state.m_NumItems );
+        for ( uint32_t i = begin; i < batchEnd; ++i )
+        {
+            if ( state.m_Function( i, state.m_UserData ) == false )
+            {
+                AtomicStoreRelaxed( &state.m_Stopped, true );
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
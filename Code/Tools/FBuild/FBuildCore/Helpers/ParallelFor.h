@@ -0,0 +1,31 @@
+// ParallelFor
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// ParallelFor
+//  - Process items [0, numItems) using up to numThreads threads (the calling
+//    thread participates). Items are claimed in small batches (use a batch size
+//    of 1 for items which are slow, such as network requests).
+//  - Intended for short bursts of blocking work (like file system queries)
+//    done outside of the JobQueue, before or instead of a build.
+//------------------------------------------------------------------------------
+class ParallelFor
+{
+public:
+    // Return false to stop processing (remaining items are skipped)
+    typedef bool (*ItemFunction)( uint32_t index, void * userData );
+
+    enum : uint32_t { DEFAULT_BATCH_SIZE = 64 };
+
+    // Returns false if processing was stopped early
+    static bool Run( uint32_t numItems, uint32_t numThreads, ItemFunction func, void * userData, uint32_t batchSize = DEFAULT_BATCH_SIZE );
+
+private:
+    static uint32_t ThreadFunc( void * param );
+};
+
+//------------------------------------------------------------------------------
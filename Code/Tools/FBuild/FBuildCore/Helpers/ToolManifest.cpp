@@ -131,7 +131,7 @@ bool ToolManifestFile::DoBuild()
     // Load the file content
     void * uncompressedContent;
     uint32_t uncompressedContentSize;
-    if ( LoadFile( uncompressedContent, uncompressedContentSize ) == false )
+    if ( LoadFile( m_Name, uncompressedContent, uncompressedContentSize ) == false )
     {
         return false; // LoadFile emits an error
     }
@@ -492,9 +492,34 @@ const void * ToolManifest::GetFileData( uint32_t fileId, size_t & dataSize ) con
     return m_Files[ fileId ].GetFileData( dataSize );
 }
 
+// GetRemoteFileData
+//------------------------------------------------------------------------------
+const void * ToolManifest::GetRemoteFileData( uint32_t fileId, size_t & dataSize ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    const ToolManifestFile & f = m_Files[ fileId ];
+    if ( f.GetSyncState() != ToolManifestFile::SYNCHRONIZED )
+    {
+        return nullptr;
+    }
+
+    // load our copy of the file, rather than the original on the client
+    AStackString<> fileName;
+    GetRemoteFilePath( fileId, fileName );
+    return f.GetFileData( fileName, dataSize );
+}
+
 // GetFileData (ToolManifestFile)
 //------------------------------------------------------------------------------
 const void * ToolManifestFile::GetFileData( size_t & outDataSize ) const
+{
+    return GetFileData( m_Name, outDataSize );
+}
+
+// GetFileData (ToolManifestFile)
+//------------------------------------------------------------------------------
+const void * ToolManifestFile::GetFileData( const AString & fileName, size_t & outDataSize ) const
 {
     // Should only be possible to access data if we know it's up-to-date
     ASSERT( m_TimeStamp );
@@ -506,7 +531,7 @@ const void * ToolManifestFile::GetFileData( size_t & outDataSize ) const
         // Load the file content
         void * uncompressedContent;
         uint32_t uncompressedContentSize;
-        if ( LoadFile( uncompressedContent, uncompressedContentSize ) == false )
+        if ( LoadFile( fileName, uncompressedContent, uncompressedContentSize ) == false )
         {
             return nullptr; // LoadFile emits an error
         }
@@ -651,20 +676,20 @@ void ToolManifest::GetRemotePath( AString & path ) const
 
 // LoadFile (ToolManifestFile)
 //------------------------------------------------------------------------------
-bool ToolManifestFile::LoadFile( void * & uncompressedContent, uint32_t & uncompressedContentSize ) const
+bool ToolManifestFile::LoadFile( const AString & fileName, void * & uncompressedContent, uint32_t & uncompressedContentSize ) const
 {
     // read the file into memory
     FileStream fs;
-    if ( fs.Open( m_Name.Get(), FileStream::READ_ONLY ) == false )
+    if ( fs.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
     {
-        FLOG_ERROR( "Error: opening file '%s' in Compiler ToolManifest\n", m_Name.Get() );
+        FLOG_ERROR( "Error: opening file '%s' in Compiler ToolManifest\n", fileName.Get() );
         return false;
     }
     uncompressedContentSize = (uint32_t)fs.GetFileSize();
     AutoPtr< void > mem( ALLOC( uncompressedContentSize ) );
     if ( fs.Read( mem.Get(), uncompressedContentSize ) != uncompressedContentSize )
     {
-        FLOG_ERROR( "Error: reading file '%s' in Compiler ToolManifest\n", m_Name.Get() );
+        FLOG_ERROR( "Error: reading file '%s' in Compiler ToolManifest\n", fileName.Get() );
         return false;
     }
 
@@ -41,6 +41,7 @@ public:
     void                Migrate( const ToolManifestFile & oldFile );
 
     const void *        GetFileData( size_t & outDataSize ) const;
+    const void *        GetFileData( const AString & fileName, size_t & outDataSize ) const;
 
     // Access state
     const AString &     GetName() const                     { return m_Name; }
@@ -54,7 +55,7 @@ public:
     void                SetFileLock( FileStream * fileLock )    { m_FileLock = fileLock; }
 
 protected:
-    bool                LoadFile( void * & uncompressedContent, uint32_t & uncompressedContentSize ) const;
+    bool                LoadFile( const AString & fileName, void * & uncompressedContent, uint32_t & uncompressedContentSize ) const;
 
     // common members
     AString          m_Name;
@@ -108,6 +109,7 @@ public:
     void CancelSynchronizingFiles();
 
     const void *    GetFileData( uint32_t fileId, size_t & dataSize ) const;
+    const void *    GetRemoteFileData( uint32_t fileId, size_t & dataSize ) const; // for sharing a synchronized toolchain
     bool            ReceiveFileData( uint32_t fileId, const void * data, size_t & dataSize );
 
     void            GetRemotePath( AString & path ) const;
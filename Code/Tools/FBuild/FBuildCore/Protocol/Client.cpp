@@ -29,6 +29,9 @@
 // Defines
 //------------------------------------------------------------------------------
 #define CLIENT_STATUS_UPDATE_FREQUENCY_SECONDS ( 0.1f )
+#define CLIENT_PRESEED_FREQUENCY_SECONDS ( 0.1f )
+#define DICTIONARY_NUM_SAMPLES ( 8 )            // jobs per toolchain to train compression dictionaries on
+#define DICTIONARY_MAX_SAMPLE_SIZE ( MEGABYTE ) // from the start of each job
 #define CONNECTION_REATTEMPT_DELAY_TIME ( 10.0f )
 #define SYSTEM_ERROR_ATTEMPT_COUNT ( 3 )
 #define DIST_INFO( ... ) if ( m_DetailedLogging ) { FLOG_BUILD( __VA_ARGS__ ); }
@@ -38,12 +41,28 @@
 Client::Client( const Array< AString > & workerList,
                 uint16_t port,
                 uint32_t workerConnectionLimit,
+                uint32_t jobWindow,
+                bool dedupJobData,
+                bool highCompression,
+                bool useDictionaries,
+                const Array< const CompilerNode * > & preseedCompilers,
                 bool detailedLogging )
     : m_WorkerList( workerList )
     , m_ShouldExit( false )
     , m_DetailedLogging( detailedLogging )
     , m_WorkerConnectionLimit( workerConnectionLimit )
+    , m_JobWindow( jobWindow )
+    , m_DedupJobData( dedupJobData )
+    , m_HighCompression( highCompression )
+    , m_UseDictionaries( useDictionaries )
+    , m_PreseedCompilers( preseedCompilers )
     , m_Port( port )
+    , m_Dictionaries( 0, true )
+    , m_BytesDeduplicated( 0 )
+    , m_NumJobsHighCompression( 0 )
+    , m_NumJobsWithDictionary( 0 )
+    , m_NumToolchainsPreseeded( 0 )
+    , m_NumResultChunksReceived( 0 )
 {
     // allocate space for server states
     m_ServerList.SetSize( workerList.GetSize() );
@@ -67,6 +86,11 @@ Client::~Client()
     ShutdownAllConnections();
 
     Thread::CloseHandle( m_Thread );
+
+    for ( ToolDictionary * toolDictionary : m_Dictionaries )
+    {
+        FDELETE toolDictionary;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -77,19 +101,53 @@ Client::~Client()
     ASSERT( ss );
 
     MutexHolder mh( ss->m_Mutex );
-    DIST_INFO( "Disconnected: %s\n", ss->m_RemoteName.Get() );
+    DIST_INFO( "Disconnected: %s (Sent: %.2f MiB @ %.2f MiB/s, Received: %.2f MiB @ %.2f MiB/s)\n",
+               ss->m_RemoteName.Get(),
+               (double)connection->GetBytesSent() / (double)MEGABYTE,
+               (double)connection->GetSendRate() / (double)MEGABYTE,
+               (double)connection->GetBytesReceived() / (double)MEGABYTE,
+               (double)connection->GetReceiveRate() / (double)MEGABYTE );
+    if ( ss->m_SentChunks.GetBytesReferenced() > 0 )
+    {
+        DIST_INFO( " - Deduplicated: %.2f MiB (%u chunks stored)\n",
+                   (double)ss->m_SentChunks.GetBytesReferenced() / (double)MEGABYTE,
+                   ss->m_SentChunks.GetNumChunks() );
+    }
+    ss->m_SentChunks.Clear(); // server discards its chunks when we disconnect
+    ss->m_SentChunks.SetMaxBytesStored( ChunkStore::DEFAULT_MAX_BYTES_STORED );
+    ss->m_PreseededToolIds.Clear();
+    ss->m_DictionaryToolIds.Clear();
+    ss->m_AcceptsCancellation = false;
+
+    // discard partially streamed results
+    if ( ss->m_ResultFile )
+    {
+        FDELETE ss->m_ResultFile;
+        ss->m_ResultFile = nullptr;
+        FileIO::FileDelete( ss->m_ResultFileName.Get() );
+    }
     if ( ss->m_Jobs.IsEmpty() == false )
     {
         Job ** it = ss->m_Jobs.Begin();
         const Job * const * end = ss->m_Jobs.End();
         while ( it != end )
         {
+            if ( ss->m_StreamedJobIds.Find( (*it)->GetJobId() ) )
+            {
+                Array< AString > streamedFileNames( 3, false );
+                GetStreamedResultFileNames( *it, streamedFileNames );
+                for ( const AString & streamedFileName : streamedFileNames )
+                {
+                    FileIO::FileDelete( streamedFileName.Get() );
+                }
+            }
             FLOG_MONITOR( "FINISH_JOB TIMEOUT %s \"%s\" \n", ss->m_RemoteName.Get(), (*it)->GetNode()->GetName().Get() );
             JobQueue::Get().ReturnUnfinishedDistributableJob( *it );
             ++it;
         }
         ss->m_Jobs.Clear();
     }
+    ss->m_StreamedJobIds.Clear();
 
     // This is usually null here, but might need to be freed if
     // we had the connection drop between message and payload
@@ -134,6 +192,18 @@ void Client::ThreadFunc()
             break;
         }
 
+        PreseedToolchains();
+        if ( AtomicLoadRelaxed( &m_ShouldExit ) )
+        {
+            break;
+        }
+
+        CancelLostRaces();
+        if ( AtomicLoadRelaxed( &m_ShouldExit ) )
+        {
+            break;
+        }
+
         Thread::Sleep( 1 );
         if ( AtomicLoadRelaxed( &m_ShouldExit ) )
         {
@@ -224,7 +294,7 @@ void Client::LookForWorkers()
             ss.m_NumJobsAvailable = numJobsAvailable;
 
             // send connection msg
-            Protocol::MsgConnection msg( numJobsAvailable );
+            Protocol::MsgConnection msg( numJobsAvailable, m_JobWindow );
             SendMessageInternal( ci, msg );
         }
 
@@ -279,6 +349,108 @@ void Client::CommunicateJobAvailability()
     }
 }
 
+// PreseedToolchains
+//------------------------------------------------------------------------------
+void Client::PreseedToolchains()
+{
+    if ( m_PreseedCompilers.IsEmpty() )
+    {
+        return;
+    }
+
+    // too soon since we last checked?
+    if ( m_PreseedTimer.GetElapsed() < CLIENT_PRESEED_FREQUENCY_SECONDS )
+    {
+        return;
+    }
+    m_PreseedTimer.Start();
+
+    PROFILE_FUNCTION
+
+    MutexHolder mh( m_ServerListMutex );
+
+    // push the manifest of each compiler which has been checked this build to
+    // every server which doesn't have it yet, so servers can synchronize the
+    // toolchain before jobs which need it arrive
+    for ( const CompilerNode * compiler : m_PreseedCompilers )
+    {
+        if ( compiler->GetState() != Node::UP_TO_DATE )
+        {
+            continue;
+        }
+        const ToolManifest & manifest = compiler->GetManifest();
+        const uint64_t toolId = manifest.GetToolId();
+        ASSERT( toolId );
+
+        MemoryStream ms;
+        for ( ServerState & ss : m_ServerList )
+        {
+            if ( AtomicLoadRelaxed( &ss.m_Connection ) == nullptr )
+            {
+                continue;
+            }
+
+            MutexHolder ssMH( ss.m_Mutex );
+            const ConnectionInfo * connection = AtomicLoadRelaxed( &ss.m_Connection );
+            if ( ( connection == nullptr ) || ss.m_Blacklisted || ss.m_PreseededToolIds.Find( toolId ) )
+            {
+                continue;
+            }
+
+            if ( ms.GetSize() == 0 )
+            {
+                manifest.SerializeForRemote( ms );
+            }
+
+            DIST_INFO( "Preseeding toolchain 0x%016" PRIx64 " to: %s\n", toolId, ss.m_RemoteName.Get() );
+            Protocol::MsgManifest msg( toolId );
+            SendMessageInternal( connection, msg, ms );
+            ss.m_PreseededToolIds.Append( toolId );
+            AtomicIncU32( &m_NumToolchainsPreseeded );
+        }
+    }
+}
+
+// CancelLostRaces
+//------------------------------------------------------------------------------
+void Client::CancelLostRaces()
+{
+    // jobs completed by a local race don't need to be built remotely
+    Array< uint32_t > jobIds( 0, true );
+    JobQueue::Get().TakeRemoteJobsToCancel( jobIds );
+    if ( jobIds.IsEmpty() )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION
+
+    MutexHolder mh( m_ServerListMutex );
+    for ( ServerState & ss : m_ServerList )
+    {
+        if ( AtomicLoadRelaxed( &ss.m_Connection ) == nullptr )
+        {
+            continue;
+        }
+
+        MutexHolder ssMH( ss.m_Mutex );
+        const ConnectionInfo * connection = AtomicLoadRelaxed( &ss.m_Connection );
+        if ( ( connection == nullptr ) || ( ss.m_AcceptsCancellation == false ) )
+        {
+            continue; // older servers will build the job, and we'll discard the result
+        }
+
+        for ( const uint32_t jobId : jobIds )
+        {
+            if ( ss.m_Jobs.FindDeref( jobId ) )
+            {
+                Protocol::MsgCancelJob msg( jobId );
+                SendMessageInternal( connection, msg );
+            }
+        }
+    }
+}
+
 // SendMessageInternal
 //------------------------------------------------------------------------------
 void Client::SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg )
@@ -310,6 +482,22 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
                 (uint32_t)memoryStream.GetSize() );
 }
 
+// SendMessageInternal
+//------------------------------------------------------------------------------
+void Client::SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & memoryStream, const void * payloadData, size_t payloadDataSize )
+{
+    if ( msg.Send( connection, memoryStream, payloadData, payloadDataSize ) )
+    {
+        return;
+    }
+
+    DIST_INFO( "Send Failed: %s (Type: %u, Size: %u, Payload: %u)\n",
+                ((ServerState *)connection->GetUserData())->m_RemoteName.Get(),
+                (uint32_t)msg.GetType(),
+                msg.GetSize(),
+                (uint32_t)( memoryStream.GetSize() + payloadDataSize ) );
+}
+
 // OnReceive
 //------------------------------------------------------------------------------
 /*virtual*/ void Client::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
@@ -361,6 +549,24 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_REQUEST_JOBS:
+        {
+            const Protocol::MsgRequestJobs * msg = static_cast< const Protocol::MsgRequestJobs * >( imsg );
+            Process( connection, msg );
+            break;
+        }
+        case Protocol::MSG_JOB_RESULTS:
+        {
+            const Protocol::MsgJobResults * msg = static_cast< const Protocol::MsgJobResults * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_JOB_RESULT_CHUNK:
+        {
+            const Protocol::MsgJobResultChunk * msg = static_cast< const Protocol::MsgJobResultChunk * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         case Protocol::MSG_REQUEST_MANIFEST:
         {
             const Protocol::MsgRequestManifest * msg = static_cast< const Protocol::MsgRequestManifest * >( imsg );
@@ -373,6 +579,18 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_CANCEL_JOB:
+        {
+            const Protocol::MsgCancelJob * msg = static_cast< const Protocol::MsgCancelJob * >( imsg );
+            Process( connection, msg );
+            break;
+        }
+        case Protocol::MSG_CHUNK_BUDGET:
+        {
+            const Protocol::MsgChunkBudget * msg = static_cast< const Protocol::MsgChunkBudget * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -398,34 +616,63 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     ServerState * ss = (ServerState *)connection->GetUserData();
     ASSERT( ss );
 
-    // no jobs for blacklisted workers
-    if ( ss->m_Blacklisted )
+    if ( SendJob( connection, ss, false, false, false ) == false )
     {
+        // tell the client we don't have anything right now
         MutexHolder mh( ss->m_Mutex );
         Protocol::MsgNoJobAvailable msg;
         SendMessageInternal( connection, msg );
-        return;
     }
+}
 
-    Job * job = JobQueue::Get().GetDistributableJobToProcess( true );
-    if ( job == nullptr )
+// Process( MsgRequestJobs )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestJobs * msg )
+{
+    PROFILE_SECTION( "MsgRequestJobs" )
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    const uint32_t numJobsRequested = msg->GetNumJobs();
+    uint32_t numJobsSent = 0;
+    const bool allowChunking = ( m_DedupJobData && msg->AcceptsChunkedData() );
+    const bool allowHighCompression = ( m_HighCompression && ( msg->GetCompressionTypes() & ( 1 << Compressor::COMPRESSION_TYPE_LZ4HC ) ) );
+    const bool allowDictionary = ( m_UseDictionaries && msg->AcceptsDictionaries() );
     {
-        PROFILE_SECTION( "NoJob" )
-        // tell the client we don't have anything right now
-        // (we completed or gave away the job already)
         MutexHolder mh( ss->m_Mutex );
-        Protocol::MsgNoJobAvailable msg;
-        SendMessageInternal( connection, msg );
-        return;
+        ss->m_AcceptsCancellation = msg->AcceptsCancellation();
+    }
+    while ( ( numJobsSent < numJobsRequested ) && SendJob( connection, ss, allowChunking, allowHighCompression, allowDictionary ) )
+    {
+        ++numJobsSent;
     }
 
-    // send the job to the client
-    MemoryStream stream;
-    job->Serialize( stream );
+    if ( numJobsSent < numJobsRequested )
+    {
+        // tell the client about all the jobs we can't provide at once
+        MutexHolder mh( ss->m_Mutex );
+        Protocol::MsgNoJobsAvailable noJobsMsg( numJobsRequested - numJobsSent );
+        SendMessageInternal( connection, noJobsMsg );
+    }
+}
 
-    MutexHolder mh( ss->m_Mutex );
+// SendJob
+//------------------------------------------------------------------------------
+bool Client::SendJob( const ConnectionInfo * connection, ServerState * ss, bool allowChunking, bool allowHighCompression, bool allowDictionary )
+{
+    // no jobs for blacklisted workers
+    if ( ss->m_Blacklisted )
+    {
+        return false;
+    }
 
-    ss->m_Jobs.Append( job ); // Track in-flight job
+    Job * job = JobQueue::Get().GetDistributableJobToProcess( true );
+    if ( job == nullptr )
+    {
+        // we completed or gave away the job already
+        return false;
+    }
 
     // if tool is explicity specified, get the id of the tool manifest
     Node * n = job->GetNode()->CastTo< ObjectNode >()->GetCompiler();
@@ -433,15 +680,122 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     uint64_t toolId = manifest.GetToolId();
     ASSERT( toolId );
 
+    // send the job to the client
+    MemoryStream stream;
+    Compressor uncompressed;
+    const bool recompress = ( allowChunking || allowHighCompression || allowDictionary );
+    if ( recompress )
+    {
+        // get the uncompressed data to deduplicate and/or compress for this server
+        ASSERT( job->IsDataCompressed() );
+        VERIFY( uncompressed.Decompress( job->GetData() ) );
+    }
+    else
+    {
+        job->SerializeHeader( stream );
+    }
+
+    MutexHolder mh( ss->m_Mutex );
+
+    // chunks must be encoded in the order jobs are sent, so this is done under the lock
+    Compressor recompressed;
+    bool usesDictionary = false;
+    if ( recompress )
+    {
+        const void * data = uncompressed.GetResult();
+        size_t dataSize = uncompressed.GetResultSize();
+        MemoryStream chunks( allowChunking ? ( dataSize / 4 ) : 0, 64 * KILOBYTE );
+        if ( allowChunking )
+        {
+            const uint64_t bytesReferenced = ss->m_SentChunks.GetBytesReferenced();
+            ss->m_SentChunks.Encode( data, (uint32_t)dataSize, chunks );
+            AtomicAddU64( &m_BytesDeduplicated, (int64_t)( ss->m_SentChunks.GetBytesReferenced() - bytesReferenced ) );
+            data = chunks.GetData();
+            dataSize = chunks.GetSize();
+        }
+
+        // the dictionary must arrive before the first job compressed with it
+        const CompressionDictionary * dictionary = allowDictionary ? GetDictionary( toolId, data, dataSize ) : nullptr;
+        if ( dictionary && ( ss->m_DictionaryToolIds.Find( toolId ) == nullptr ) )
+        {
+            MemoryStream dictionaryStream( dictionary->GetSize() );
+            dictionaryStream.WriteBuffer( dictionary->GetData(), dictionary->GetSize() );
+            Protocol::MsgDictionary msg( toolId );
+            SendMessageInternal( connection, msg, dictionaryStream );
+            ss->m_DictionaryToolIds.Append( toolId );
+        }
+        usesDictionary = ( dictionary != nullptr );
+
+        recompressed.Compress( data, dataSize, allowHighCompression ? Compressor::COMPRESSION_TYPE_LZ4HC : Compressor::COMPRESSION_TYPE_LZ4, dictionary );
+        job->SerializeHeader( stream, recompressed.GetResultSize(), true );
+        if ( allowHighCompression )
+        {
+            AtomicIncU32( &m_NumJobsHighCompression );
+        }
+        if ( usesDictionary )
+        {
+            AtomicIncU32( &m_NumJobsWithDictionary );
+        }
+    }
+
+    ss->m_Jobs.Append( job ); // Track in-flight job
+
+    // note when the job was sent, so we can decide if racing it locally is worthwhile
+    JobQueue::Get().OnSentToRemote( job, ss->GetExpectedRoundTripTimeMS( job->GetNode()->GetLastBuildTime() ) );
+
     // output to signify remote start
     FLOG_BUILD( "-> Obj: %s <REMOTE: %s>\n", job->GetNode()->GetName().Get(), ss->m_RemoteName.Get() );
     FLOG_MONITOR( "START_JOB %s \"%s\" \n", ss->m_RemoteName.Get(), job->GetNode()->GetName().Get() );
 
     {
         PROFILE_SECTION( "SendJob" )
-        Protocol::MsgJob msg( toolId );
-        SendMessageInternal( connection, msg, stream );
+        if ( recompress )
+        {
+            Protocol::MsgJob msg( toolId, allowChunking, usesDictionary );
+            SendMessageInternal( connection, msg, stream, recompressed.GetResult(), recompressed.GetResultSize() );
+        }
+        else
+        {
+            Protocol::MsgJob msg( toolId );
+            SendMessageInternal( connection, msg, stream, job->GetData(), job->GetDataSize() );
+        }
     }
+    return true;
+}
+
+// GetDictionary
+//------------------------------------------------------------------------------
+const CompressionDictionary * Client::GetDictionary( uint64_t toolId, const void * data, size_t dataSize )
+{
+    MutexHolder mh( m_DictionariesMutex );
+
+    ToolDictionary ** found = m_Dictionaries.FindDeref( toolId );
+    ToolDictionary * toolDictionary = found ? *found : nullptr;
+    if ( toolDictionary == nullptr )
+    {
+        toolDictionary = FNEW( ToolDictionary( toolId ) );
+        m_Dictionaries.Append( toolDictionary );
+    }
+
+    if ( toolDictionary->m_Trained )
+    {
+        return toolDictionary->m_Dictionary.IsEmpty() ? nullptr : &toolDictionary->m_Dictionary;
+    }
+
+    // sample the first jobs, which are sent without a dictionary
+    const uint32_t sampleSize = (uint32_t)Math::Min< size_t >( dataSize, DICTIONARY_MAX_SAMPLE_SIZE );
+    toolDictionary->m_Samples.WriteBuffer( data, sampleSize );
+    toolDictionary->m_SampleSizes.Append( sampleSize );
+    if ( toolDictionary->m_SampleSizes.GetSize() == DICTIONARY_NUM_SAMPLES )
+    {
+        // done under the lock, but only once per toolchain
+        toolDictionary->m_Dictionary.Train( toolDictionary->m_Samples.GetData(), toolDictionary->m_SampleSizes );
+        toolDictionary->m_Trained = true;
+        FREE( toolDictionary->m_Samples.Release() );
+        toolDictionary->m_SampleSizes.Destruct();
+        DIST_INFO( "Trained compression dictionary for toolchain 0x%016" PRIx64 " (%u bytes)\n", toolId, toolDictionary->m_Dictionary.GetSize() );
+    }
+    return nullptr;
 }
 
 // Process( MsgJobResult )
@@ -450,11 +804,116 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
 {
     PROFILE_SECTION( "MsgJobResult" )
 
-    // find server
+    ConstMemoryStream ms( payload, payloadSize );
+    ProcessJobResult( connection, ms );
+}
+
+// Process( MsgJobResults )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResults *, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgJobResults" )
+
+    ConstMemoryStream ms( payload, payloadSize );
+
+    uint32_t numJobs = 0;
+    ms.Read( numJobs );
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        ProcessJobResult( connection, ms );
+    }
+}
+
+// Process( MsgJobResultChunk )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResultChunk * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgJobResultChunk" )
+
     ServerState * ss = (ServerState *)connection->GetUserData();
     ASSERT( ss );
 
-    ConstMemoryStream ms( payload, payloadSize );
+    if ( WriteResultChunk( ss, msg, payload, payloadSize ) == false )
+    {
+        // the job is returned to the queue when we disconnect
+        DIST_INFO( "Failed to write streamed result from: %s\n", ss->m_RemoteName.Get() );
+        Disconnect( connection );
+    }
+}
+
+// WriteResultChunk
+//------------------------------------------------------------------------------
+bool Client::WriteResultChunk( ServerState * ss, const Protocol::MsgJobResultChunk * msg, const void * payload, size_t payloadSize )
+{
+    // chunks arrive in order, one file at a time
+    if ( ss->m_ResultFile == nullptr )
+    {
+        // first chunk of a file
+        Array< AString > streamedFileNames( 3, false );
+        {
+            MutexHolder mh( ss->m_Mutex );
+            Job ** it = ss->m_Jobs.FindDeref( msg->GetJobId() );
+            if ( it == nullptr )
+            {
+                return false; // protocol error
+            }
+            GetStreamedResultFileNames( *it, streamedFileNames );
+        }
+        if ( msg->GetFileIndex() >= streamedFileNames.GetSize() )
+        {
+            return false; // protocol error
+        }
+
+        ss->m_ResultFileName = streamedFileNames[ msg->GetFileIndex() ];
+        ss->m_ResultFileJobId = msg->GetJobId();
+        ss->m_ResultFileIndex = msg->GetFileIndex();
+        ss->m_ResultFile = FNEW( FileStream );
+        if ( ( Node::EnsurePathExistsForFile( ss->m_ResultFileName ) == false ) ||
+             ( ss->m_ResultFile->Open( ss->m_ResultFileName.Get(), FileStream::WRITE_ONLY ) == false ) )
+        {
+            FLOG_ERROR( "Failed to create file. Error: %s File: '%s'", LAST_ERROR_STR, ss->m_ResultFileName.Get() );
+            return false;
+        }
+    }
+    else if ( ( msg->GetJobId() != ss->m_ResultFileJobId ) || ( msg->GetFileIndex() != ss->m_ResultFileIndex ) )
+    {
+        return false; // protocol error
+    }
+
+    // write the chunk straight to the file
+    Compressor c;
+    if ( ( c.IsValidData( payload, payloadSize ) == false ) || ( c.Decompress( payload ) == false ) )
+    {
+        return false; // protocol error
+    }
+    if ( ss->m_ResultFile->WriteBuffer( c.GetResult(), c.GetResultSize() ) != c.GetResultSize() )
+    {
+        FLOG_ERROR( "Failed to write file. Error: %s File: '%s'", LAST_ERROR_STR, ss->m_ResultFileName.Get() );
+        return false;
+    }
+    AtomicIncU32( &m_NumResultChunksReceived );
+
+    if ( msg->IsLastChunk() )
+    {
+        FDELETE ss->m_ResultFile;
+        ss->m_ResultFile = nullptr;
+
+        MutexHolder mh( ss->m_Mutex );
+        if ( ss->m_StreamedJobIds.Find( msg->GetJobId() ) == nullptr )
+        {
+            ss->m_StreamedJobIds.Append( msg->GetJobId() );
+        }
+    }
+    return true;
+}
+
+// ProcessJobResult
+//------------------------------------------------------------------------------
+void Client::ProcessJobResult( const ConnectionInfo * connection, ConstMemoryStream & ms )
+{
+    // find server
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
 
     uint32_t jobId = 0;
     ms.Read( jobId );
@@ -481,15 +940,48 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
     uint32_t size = 0;
     ms.Read( size );
     const void * data = (const char *)ms.GetData() + ms.Tell();
+    ms.Seek( ms.Tell() + size ); // next result (if batched)
 
+    // a file still being streamed was cut short (the job failed part way through sending it)
+    if ( ss->m_ResultFile && ( ss->m_ResultFileJobId == jobId ) )
+    {
+        FDELETE ss->m_ResultFile;
+        ss->m_ResultFile = nullptr;
+        FileIO::FileDelete( ss->m_ResultFileName.Get() );
+    }
+
+    // files streamed ahead of the result (if any)
+    Array< AString > streamedFileNames( 0, true );
     {
         MutexHolder mh( ss->m_Mutex );
-        VERIFY( ss->m_Jobs.FindDerefAndErase( jobId ) );
+        Job ** it = ss->m_Jobs.FindDeref( jobId );
+        ASSERT( it );
+        if ( it )
+        {
+            uint32_t * streamedJobId = ss->m_StreamedJobIds.Find( jobId );
+            if ( streamedJobId )
+            {
+                GetStreamedResultFileNames( *it, streamedFileNames );
+                ss->m_StreamedJobIds.Erase( streamedJobId );
+            }
+
+            // update timing history for this server
+            ss->m_RoundTripTimes.Record( (*it)->GetRemoteElapsedMS() );
+            ss->m_BuildTimes.Record( buildTime );
+            ss->m_Jobs.Erase( it );
+        }
     }
 
     // Has the job been cancelled in the interim?
     // (Due to a Race by the main thread for example)
     Job * job = JobQueue::Get().OnReturnRemoteJob( jobId );
+    if ( ( job == nullptr ) || ( result == false ) )
+    {
+        for ( const AString & streamedFileName : streamedFileNames )
+        {
+            FileIO::FileDelete( streamedFileName.Get() );
+        }
+    }
     if ( job == nullptr )
     {
         // don't save result as we were cancelled
@@ -516,37 +1008,45 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
         }
         else
         {
-            size_t dataSize = ms.GetSize() - ms.Tell();
-            Compressor c;
-            if ( isDataCompressed )
-            {                
-                c.Decompress( data );
-                data = c.GetResult();
-                dataSize = c.GetResultSize();
-            }
-            MultiBuffer mb( data, dataSize );
-            
-            size_t fileIndex = 0;
-
-            const ObjectNode * on = job->GetNode()->CastTo< ObjectNode >();
+            Array< AString > fileNames( 3, false );
+            GetResultFileNames( job, fileNames );
 
-            // 1. Object file
-            result = WriteFileToDisk( nodeName, mb, fileIndex++ );
-
-            // 2. PDB file (optional)
-            if ( result && on->IsUsingPDB() )
+            if ( streamedFileNames.IsEmpty() == false )
             {
-                AStackString<> pdbName;
-                on->GetPDBName( pdbName );
-                result = WriteFileToDisk( pdbName, mb, fileIndex++ );
+                // already written - move into place
+                for ( size_t i = 0; result && ( i < fileNames.GetSize() ); ++i )
+                {
+                    if ( FileIO::FileMove( streamedFileNames[ i ], fileNames[ i ] ) == false )
+                    {
+                        FLOG_ERROR( "Failed to create file. Error: %s File: '%s'", LAST_ERROR_STR, fileNames[ i ].Get() );
+                        result = false;
+                    }
+                }
+                if ( result == false )
+                {
+                    for ( const AString & streamedFileName : streamedFileNames )
+                    {
+                        FileIO::FileDelete( streamedFileName.Get() );
+                    }
+                }
             }
-
-            // 3. .nativecodeanalysis.xml (optional)
-            if ( result && on->IsUsingStaticAnalysisMSVC() )
+            else
             {
-                AStackString<> xmlFileName;
-                on->GetNativeAnalysisXMLPath( xmlFileName );
-                result = WriteFileToDisk( xmlFileName, mb, fileIndex++ );
+                size_t dataSize = size;
+                Compressor c;
+                if ( isDataCompressed )
+                {
+                    c.Decompress( data );
+                    data = c.GetResult();
+                    dataSize = c.GetResultSize();
+                }
+                MultiBuffer mb( data, dataSize );
+
+                // object file, then pdb and .nativecodeanalysis.xml (optional)
+                for ( size_t i = 0; result && ( i < fileNames.GetSize() ); ++i )
+                {
+                    result = WriteFileToDisk( fileNames[ i ], mb, i );
+                }
             }
 
             if ( result )
@@ -665,6 +1165,50 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
     JobQueue::Get().FinishedProcessingJob( job, result, true ); // remote job
 }
 
+// Process( MsgCancelJob )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgCancelJob * msg )
+{
+    PROFILE_SECTION( "MsgCancelJob" )
+
+    // server dropped a job won by a local race before starting it,
+    // so there will be no result
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    const uint32_t jobId = msg->GetJobId();
+    {
+        MutexHolder mh( ss->m_Mutex );
+        Job ** it = ss->m_Jobs.FindDeref( jobId );
+        ASSERT( it );
+        if ( it == nullptr )
+        {
+            return;
+        }
+        DIST_INFO( "Cancelled: %s - %s (Won Race Locally)\n", ss->m_RemoteName.Get(), (*it)->GetNode()->GetName().Get() );
+        ss->m_Jobs.Erase( it );
+    }
+
+    // free the job, which is no longer referenced
+    VERIFY( JobQueue::Get().OnReturnRemoteJob( jobId ) == nullptr );
+}
+
+// Process( MsgChunkBudget )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgChunkBudget * msg )
+{
+    PROFILE_SECTION( "MsgChunkBudget" )
+
+    // server shares its job data chunk storage between its clients, and
+    // sends our share before requesting chunked data
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    MutexHolder mh( ss->m_Mutex );
+    ASSERT( ss->m_SentChunks.GetBytesStored() <= msg->GetMaxBytesStored() );
+    ss->m_SentChunks.SetMaxBytesStored( msg->GetMaxBytesStored() );
+}
+
 // Process( MsgRequestManifest )
 //------------------------------------------------------------------------------
 void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg )
@@ -750,9 +1294,59 @@ const ToolManifest * Client::FindManifest( const ConnectionInfo * connection, ui
         }
     }
 
+    // toolchains pushed ahead of jobs
+    if ( ss->m_PreseededToolIds.Find( toolId ) )
+    {
+        for ( const CompilerNode * compiler : m_PreseedCompilers )
+        {
+            const ToolManifest & m = compiler->GetManifest();
+            if ( m.GetToolId() == toolId )
+            {
+                return &m;
+            }
+        }
+    }
+
     return nullptr;
 }
 
+// GetResultFileNames
+//------------------------------------------------------------------------------
+/*static*/ void Client::GetResultFileNames( const Job * job, Array< AString > & fileNames )
+{
+    const ObjectNode * on = job->GetNode()->CastTo< ObjectNode >();
+
+    // 1. Object file
+    fileNames.Append( on->GetName() );
+
+    // 2. PDB file (optional)
+    if ( on->IsUsingPDB() )
+    {
+        AStackString<> pdbName;
+        on->GetPDBName( pdbName );
+        fileNames.Append( pdbName );
+    }
+
+    // 3. .nativecodeanalysis.xml (optional)
+    if ( on->IsUsingStaticAnalysisMSVC() )
+    {
+        AStackString<> xmlFileName;
+        on->GetNativeAnalysisXMLPath( xmlFileName );
+        fileNames.Append( xmlFileName );
+    }
+}
+
+// GetStreamedResultFileNames
+//------------------------------------------------------------------------------
+/*static*/ void Client::GetStreamedResultFileNames( const Job * job, Array< AString > & fileNames )
+{
+    GetResultFileNames( job, fileNames );
+    for ( AString & fileName : fileNames )
+    {
+        fileName.AppendFormat( ".%u.tmp", job->GetJobId() );
+    }
+}
+
 // WriteFileToDisk
 //------------------------------------------------------------------------------
 bool Client::WriteFileToDisk( const AString & fileName, const MultiBuffer & multiBuffer, size_t index ) const
@@ -772,9 +1366,40 @@ Client::ServerState::ServerState()
     , m_CurrentMessage( nullptr )
     , m_NumJobsAvailable( 0 )
     , m_Jobs( 16, true )
+    , m_SentChunks( false )
+    , m_PreseededToolIds( 0, true )
+    , m_DictionaryToolIds( 0, true )
+    , m_AcceptsCancellation( false )
+    , m_ResultFile( nullptr )
+    , m_ResultFileJobId( 0 )
+    , m_ResultFileIndex( 0 )
+    , m_StreamedJobIds( 0, true )
     , m_Blacklisted( false )
 {
     m_DelayTimer.Start( 999.0f );
 }
 
+// ServerState::GetExpectedRoundTripTimeMS
+//------------------------------------------------------------------------------
+uint32_t Client::ServerState::GetExpectedRoundTripTimeMS( uint32_t buildTimeMS ) const
+{
+    // Need some history before estimates are meaningful
+    const uint32_t minSamples = 4;
+    if ( m_RoundTripTimes.GetCount() < minSamples )
+    {
+        return 0; // unknown
+    }
+
+    const uint32_t typicalRoundTripMS = m_RoundTripTimes.GetPercentile( 0.5f );
+    if ( buildTimeMS == 0 )
+    {
+        return typicalRoundTripMS; // no history for this job
+    }
+
+    // Known build time plus typical overhead (transfer, queuing etc) of this server
+    const uint32_t typicalBuildTimeMS = m_BuildTimes.GetPercentile( 0.5f );
+    const uint32_t overheadMS = ( typicalRoundTripMS > typicalBuildTimeMS ) ? ( typicalRoundTripMS - typicalBuildTimeMS ) : 0;
+    return ( buildTimeMS + overheadMS );
+}
+
 //------------------------------------------------------------------------------
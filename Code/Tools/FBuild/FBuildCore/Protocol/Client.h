@@ -4,7 +4,12 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/ChunkStore.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/LatencyHistogram.h"
+
 #include "Core/Containers/Array.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
@@ -12,14 +17,21 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CompilerNode;
+class ConstMemoryStream;
+class FileStream;
 class Job;
-class MemoryStream;
 class MultiBuffer;
 namespace Protocol
 {
     class IMessage;
+    class MsgCancelJob;
+    class MsgChunkBudget;
     class MsgJobResult;
+    class MsgJobResultChunk;
+    class MsgJobResults;
     class MsgRequestJob;
+    class MsgRequestJobs;
     class MsgRequestManifest;
     class MsgRequestFile;
     class MsgServerStatus;
@@ -34,17 +46,42 @@ public:
     Client( const Array< AString > & workerList,
             uint16_t port,
             uint32_t workerConnectionLimit,
+            uint32_t jobWindow,
+            bool dedupJobData,
+            bool highCompression,
+            bool useDictionaries,
+            const Array< const CompilerNode * > & preseedCompilers,
             bool detailedLogging );
     ~Client();
 
+    // stats
+    inline uint64_t GetBytesDeduplicated() const        { return m_BytesDeduplicated; }
+    inline uint32_t GetNumJobsHighCompression() const   { return m_NumJobsHighCompression; }
+    inline uint32_t GetNumJobsWithDictionary() const    { return m_NumJobsWithDictionary; }
+    inline uint32_t GetNumToolchainsPreseeded() const   { return m_NumToolchainsPreseeded; }
+    inline uint32_t GetNumResultChunksReceived() const  { return m_NumResultChunksReceived; }
+
 private:
     virtual void OnDisconnected( const ConnectionInfo * connection );
     virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory );
 
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJob * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJobs * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJobResult *, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResults *, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultChunk * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgCancelJob * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgChunkBudget * msg );
+
+    struct ServerState;
+    bool SendJob( const ConnectionInfo * connection, ServerState * ss, bool allowChunking, bool allowHighCompression, bool allowDictionary );
+    const CompressionDictionary * GetDictionary( uint64_t toolId, const void * data, size_t dataSize );
+    void ProcessJobResult( const ConnectionInfo * connection, ConstMemoryStream & ms );
+    bool WriteResultChunk( ServerState * ss, const Protocol::MsgJobResultChunk * msg, const void * payload, size_t payloadSize );
+    static void GetResultFileNames( const Job * job, Array< AString > & fileNames );
+    static void GetStreamedResultFileNames( const Job * job, Array< AString > & fileNames );
 
     const ToolManifest * FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const;
     bool WriteFileToDisk( const AString& fileName, const MultiBuffer & multiBuffer, size_t index ) const;
@@ -54,10 +91,13 @@ private:
 
     void            LookForWorkers();
     void            CommunicateJobAvailability();
+    void            PreseedToolchains();
+    void            CancelLostRaces();
 
     // More verbose name to avoid conflict with windows.h SendMessage
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg );
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & memoryStream );
+    void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & memoryStream, const void * payloadData, size_t payloadDataSize );
 
     Array< AString >    m_WorkerList;   // workers to connect to
     volatile bool       m_ShouldExit;   // signal from main thread
@@ -66,11 +106,14 @@ private:
 
     // state
     Timer               m_StatusUpdateTimer;
+    Timer               m_PreseedTimer;
 
     struct ServerState
     {
         explicit ServerState();
 
+        uint32_t GetExpectedRoundTripTimeMS( uint32_t buildTimeMS ) const;
+
         const ConnectionInfo *  m_Connection;
         AString                 m_RemoteName;
 
@@ -79,13 +122,54 @@ private:
         Timer                   m_DelayTimer;
         uint32_t                m_NumJobsAvailable;     // num jobs we've told this server we have available
         Array< Job * >          m_Jobs;                 // jobs we've sent to this server
+        LatencyHistogram        m_RoundTripTimes;       // time from sending jobs to receiving results
+        LatencyHistogram        m_BuildTimes;           // time taken to build jobs on the server
+        ChunkStore              m_SentChunks;           // mirror of the job data chunks this server has stored
+        Array< uint64_t >       m_PreseededToolIds;     // toolchains pushed to this server ahead of jobs
+        Array< uint64_t >       m_DictionaryToolIds;    // toolchains whose compression dictionary this server has
+        bool                    m_AcceptsCancellation;  // server drops queued jobs won by a local race
+
+        // large results are streamed ahead of the job result, to temp files next to their destinations
+        FileStream *            m_ResultFile;           // file currently being streamed (if any)
+        AString                 m_ResultFileName;
+        uint32_t                m_ResultFileJobId;
+        uint8_t                 m_ResultFileIndex;
+        Array< uint32_t >       m_StreamedJobIds;       // jobs with streamed files, awaiting their result
 
         bool                    m_Blacklisted;
     };
     Mutex                   m_ServerListMutex;
     Array< ServerState >    m_ServerList;
     uint32_t                m_WorkerConnectionLimit;
+    uint32_t                m_JobWindow;    // jobs each worker may request beyond those it can build right now
+    bool                    m_DedupJobData; // send job data chunks the worker already has by hash
+    bool                    m_HighCompression; // recompress job data with LZ4HC
+    bool                    m_UseDictionaries; // recompress job data with a dictionary per toolchain
+    Array< const CompilerNode * > m_PreseedCompilers; // toolchains to push to servers ahead of jobs
     uint16_t                m_Port;
+
+    // job data compression dictionaries, trained on the first jobs for each toolchain
+    struct ToolDictionary
+    {
+        explicit ToolDictionary( uint64_t toolId ) : m_ToolId( toolId ), m_SampleSizes( 0, true ), m_Trained( false ) {}
+
+        inline bool operator == ( uint64_t toolId ) const { return ( m_ToolId == toolId ); }
+
+        uint64_t                m_ToolId;
+        MemoryStream            m_Samples;      // freed once trained
+        Array< uint32_t >       m_SampleSizes;
+        CompressionDictionary   m_Dictionary;   // can be empty if the samples had nothing in common
+        bool                    m_Trained;
+    };
+    Mutex                   m_DictionariesMutex;
+    Array< ToolDictionary * > m_Dictionaries;
+
+    // stats (updated from several threads)
+    uint64_t                m_BytesDeduplicated;        // job data sent to servers by hash
+    uint32_t                m_NumJobsHighCompression;   // jobs recompressed with LZ4HC
+    uint32_t                m_NumJobsWithDictionary;    // jobs recompressed with a toolchain's dictionary
+    uint32_t                m_NumToolchainsPreseeded;   // manifests pushed to servers ahead of jobs
+    uint32_t                m_NumResultChunksReceived;  // chunks of large results streamed from servers
 };
 
 //------------------------------------------------------------------------------
@@ -37,7 +37,15 @@
             "File",
             "RequestWorkerList",
             "WorkerList",
-            "SetWorkerStatus"
+            "SetWorkerStatus",
+            "RequestJobs",
+            "NoJobsAvailable",
+            "JobResults",
+            "RequestToolPeers",
+            "Dictionary",
+            "JobResultChunk",
+            "CancelJob",
+            "ChunkBudget"
         };
         static_assert( ( sizeof( msgNames ) / sizeof(const char *) ) == Protocol::NUM_MESSAGES, "msgNames item count doesn't match NUM_MESSAGES" );
 
@@ -89,6 +97,35 @@ bool Protocol::IMessage::Send( const ConnectionInfo * connection, const ConstMem
     return pool.Send( connection, this, m_MsgSize, payload.GetData(), payload.GetSize() );
 }
 
+// IMessage::Send (with payload)
+//------------------------------------------------------------------------------
+bool Protocol::IMessage::Send( const ConnectionInfo * connection, const MemoryStream & payload, const void * payloadData, size_t payloadDataSize ) const
+{
+    ASSERT( connection );
+    ASSERT( m_HasPayload == true ); // must NOT use Send with payload
+
+    // payloadData is appended to the payload on the wire, without copying it into the stream
+    TCPConnectionPool::SendBuffer buffers[ 2 ];
+    buffers[ 0 ].size = (uint32_t)payload.GetSize();
+    buffers[ 0 ].data = payload.GetData();
+    buffers[ 1 ].size = (uint32_t)payloadDataSize;
+    buffers[ 1 ].data = payloadData;
+
+    TCPConnectionPool & pool = connection->GetTCPConnectionPool();
+    return pool.Send( connection, this, m_MsgSize, buffers, 2 );
+}
+
+// IMessage::Send (with payload)
+//------------------------------------------------------------------------------
+bool Protocol::IMessage::Send( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * payloadBuffers, uint32_t numPayloadBuffers ) const
+{
+    ASSERT( connection );
+    ASSERT( m_HasPayload == true ); // must NOT use Send with payload
+
+    TCPConnectionPool & pool = connection->GetTCPConnectionPool();
+    return pool.Send( connection, this, m_MsgSize, payloadBuffers, numPayloadBuffers );
+}
+
 // IMessage::Broadcast
 //------------------------------------------------------------------------------
 bool Protocol::IMessage::Broadcast( TCPConnectionPool * pool ) const
@@ -102,11 +139,12 @@ bool Protocol::IMessage::Broadcast( TCPConnectionPool * pool ) const
 
 // MsgConnection
 //------------------------------------------------------------------------------
-Protocol::MsgConnection::MsgConnection( uint32_t numJobsAvailable )
+Protocol::MsgConnection::MsgConnection( uint32_t numJobsAvailable, uint32_t jobWindow )
     : Protocol::IMessage( Protocol::MSG_CONNECTION, sizeof( MsgConnection ), false )
     , m_ProtocolVersion( PROTOCOL_VERSION )
     , m_NumJobsAvailable( numJobsAvailable )
     , m_Platform(Env::GetPlatform())
+    , m_JobWindow( jobWindow )
 {
     memset( m_Padding2, 0, sizeof( m_Padding2 ) );
     memset( m_HostName, 0, sizeof( m_HostName ) );
@@ -138,10 +176,34 @@ Protocol::MsgNoJobAvailable::MsgNoJobAvailable()
 {
 }
 
+// MsgRequestJobs
+//------------------------------------------------------------------------------
+Protocol::MsgRequestJobs::MsgRequestJobs( uint32_t numJobs, bool acceptsChunkedData, uint8_t compressionTypes, bool acceptsDictionaries, bool acceptsCancellation )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_JOBS, sizeof( MsgRequestJobs ), false )
+    , m_NumJobs( numJobs )
+    , m_AcceptsChunkedData( acceptsChunkedData )
+    , m_CompressionTypes( compressionTypes )
+    , m_AcceptsDictionaries( acceptsDictionaries )
+    , m_AcceptsCancellation( acceptsCancellation )
+{
+    ASSERT( numJobs > 0 );
+}
+
+// MsgNoJobsAvailable
+//------------------------------------------------------------------------------
+Protocol::MsgNoJobsAvailable::MsgNoJobsAvailable( uint32_t numJobs )
+    : Protocol::IMessage( Protocol::MSG_NO_JOBS_AVAILABLE, sizeof( MsgNoJobsAvailable ), false )
+    , m_NumJobs( numJobs )
+{
+    ASSERT( numJobs > 0 );
+}
+
 // MsgJob
 //------------------------------------------------------------------------------
-Protocol::MsgJob::MsgJob( uint64_t toolId )
+Protocol::MsgJob::MsgJob( uint64_t toolId, bool isDataChunked, bool usesDictionary )
     : Protocol::IMessage( Protocol::MSG_JOB, sizeof( MsgJob ), true )
+    , m_IsDataChunked( isDataChunked )
+    , m_UsesDictionary( usesDictionary )
     , m_ToolId( toolId )
 {
     memset( m_Padding2, 0, sizeof( m_Padding2 ) );
@@ -155,6 +217,13 @@ Protocol::MsgJobResult::MsgJobResult()
 {
 }
 
+// MsgJobResults
+//------------------------------------------------------------------------------
+Protocol::MsgJobResults::MsgJobResults()
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULTS, sizeof( MsgJobResults ), true )
+{
+}
+
 // MsgRequestManifest
 //------------------------------------------------------------------------------
 Protocol::MsgRequestManifest::MsgRequestManifest( uint64_t toolId )
@@ -193,11 +262,13 @@ Protocol::MsgFile::MsgFile( uint64_t toolId, uint32_t fileId )
 
 // MsgRequestWorkerList
 //------------------------------------------------------------------------------
-Protocol::MsgRequestWorkerList::MsgRequestWorkerList()
-    : Protocol::IMessage( Protocol::MSG_REQUEST_WORKER_LIST, sizeof( MsgRequestWorkerList ), false )
+Protocol::MsgRequestWorkerList::MsgRequestWorkerList( uint32_t maxWorkers )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_WORKER_LIST, sizeof( MsgRequestWorkerList ), true )
     , m_ProtocolVersion( PROTOCOL_VERSION )
     , m_Platform(Env::GetPlatform())
+    , m_MaxWorkers( maxWorkers )
 {
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
 }
 
 // MsgWorkerList
@@ -209,12 +280,64 @@ Protocol::MsgWorkerList::MsgWorkerList()
 
 // MsgSetWorkerStatus
 //------------------------------------------------------------------------------
-Protocol::MsgSetWorkerStatus::MsgSetWorkerStatus( bool isAvailable )
-    : Protocol::IMessage( Protocol::MSG_SET_WORKER_STATUS, sizeof( MsgSetWorkerStatus ), false )
+Protocol::MsgSetWorkerStatus::MsgSetWorkerStatus( bool isAvailable, uint32_t numCPUsFree, uint32_t numJobsQueued )
+    : Protocol::IMessage( Protocol::MSG_SET_WORKER_STATUS, sizeof( MsgSetWorkerStatus ), true )
     , m_IsAvailable( isAvailable )
     , m_ProtocolVersion( PROTOCOL_VERSION )
     , m_Platform(Env::GetPlatform())
+    , m_NumCPUsFree( numCPUsFree )
+    , m_NumJobsQueued( numJobsQueued )
+{
+}
+
+// MsgRequestToolPeers
+//------------------------------------------------------------------------------
+Protocol::MsgRequestToolPeers::MsgRequestToolPeers( uint64_t toolId )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_TOOL_PEERS, sizeof( MsgRequestToolPeers ), false )
+    , m_ProtocolVersion( PROTOCOL_VERSION )
+    , m_Platform( Env::GetPlatform() )
+    , m_ToolId( toolId )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+    ASSERT( toolId );
+}
+
+// MsgDictionary
+//------------------------------------------------------------------------------
+Protocol::MsgDictionary::MsgDictionary( uint64_t toolId )
+    : Protocol::IMessage( Protocol::MSG_DICTIONARY, sizeof( MsgDictionary ), true )
+    , m_ToolId( toolId )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+    ASSERT( toolId );
+}
+
+// MsgJobResultChunk
+//------------------------------------------------------------------------------
+Protocol::MsgJobResultChunk::MsgJobResultChunk( uint32_t jobId, uint8_t fileIndex, bool lastChunk )
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULT_CHUNK, sizeof( MsgJobResultChunk ), true )
+    , m_JobId( jobId )
+    , m_FileIndex( fileIndex )
+    , m_LastChunk( lastChunk )
 {
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgCancelJob
+//------------------------------------------------------------------------------
+Protocol::MsgCancelJob::MsgCancelJob( uint32_t jobId )
+    : Protocol::IMessage( Protocol::MSG_CANCEL_JOB, sizeof( MsgCancelJob ), false )
+    , m_JobId( jobId )
+{
+}
+
+// MsgChunkBudget
+//------------------------------------------------------------------------------
+Protocol::MsgChunkBudget::MsgChunkBudget( uint64_t maxBytesStored )
+    : Protocol::IMessage( Protocol::MSG_CHUNK_BUDGET, sizeof( MsgChunkBudget ), false )
+    , m_MaxBytesStored( maxBytesStored )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
 }
 
 //------------------------------------------------------------------------------
@@ -6,13 +6,13 @@
 //------------------------------------------------------------------------------
 #include "Core/Env/MSVCStaticAnalysis.h"
 #include "Core/Env/Types.h"
+#include "Core/Network/TCPConnectionPool.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
 class ConnectionInfo;
 class ConstMemoryStream;
 class MemoryStream;
-class TCPConnectionPool;
 
 // Defines
 //------------------------------------------------------------------------------
@@ -29,7 +29,16 @@ class TCPConnectionPool;
 namespace Protocol
 {
     enum : uint16_t { PROTOCOL_PORT = 31264 }; // Arbitrarily chosen port
-    enum { PROTOCOL_VERSION = 20 };
+    enum { PROTOCOL_VERSION = 28 };
+    enum { PROTOCOL_VERSION_MINIMUM = 20 };  // oldest Client a Server will accept
+    enum { PROTOCOL_VERSION_BATCHING = 21 }; // first version with batched job messages
+    enum { PROTOCOL_VERSION_CHUNKING = 22 }; // first version with deduplicated job data
+    enum { PROTOCOL_VERSION_WORKER_LOAD = 23 }; // first version with worker load sent to the coordinator
+    enum { PROTOCOL_VERSION_TOOL_SHARING = 24 }; // first version with toolchains shared between workers
+    enum { PROTOCOL_VERSION_COMPRESSION = 25 }; // first version with negotiated job data compression
+    enum { PROTOCOL_VERSION_RESULT_STREAMING = 26 }; // first version with large job results streamed in chunks
+    enum { PROTOCOL_VERSION_CANCEL_JOB = 27 }; // first version with queued jobs cancelled when a local race wins
+    enum { PROTOCOL_VERSION_CHUNK_BUDGET = 28 }; // first version with the job data chunk budget set by the worker
 
     enum { PROTOCOL_TEST_PORT = PROTOCOL_PORT + 1 }; // Different port for use by tests
 
@@ -49,15 +58,29 @@ namespace Protocol
         MSG_JOB_RESULT          = 6, // Server -> Client : Return completed job
 
         MSG_REQUEST_MANIFEST    = 7, // Server -> Client : Ask client for the manifest of tools required for a job
-        MSG_MANIFEST            = 8, // Server <- Client : Respond with manifest details
+        MSG_MANIFEST            = 8, // Server <- Client : Respond with manifest details (or push it ahead of jobs)
 
-        MSG_REQUEST_FILE        = 9, // Server -> Client : Ask client for a file
+        MSG_REQUEST_FILE        = 9, // Server -> Client : Ask client (or another Server) for a file
         MSG_FILE                = 10,// Server <- Client : Send a requested file
 
         MSG_REQUEST_WORKER_LIST = 11,// Client -> Coordinator : Ask coordinator for the list of workers
         MSG_WORKER_LIST         = 12,// Client <- Coordinator : Respond with the list of workers
         MSG_SET_WORKER_STATUS   = 13,// Server -> Coordinator : Sets worker status (available or unavailable)
 
+        MSG_REQUEST_JOBS        = 14,// Server -> Client : Ask for several jobs to do
+        MSG_NO_JOBS_AVAILABLE   = 15,// Server <- Client : Respond that some of the requested jobs are not available
+        MSG_JOB_RESULTS         = 16,// Server -> Client : Return several completed jobs
+
+        MSG_REQUEST_TOOL_PEERS  = 17,// Server -> Coordinator : Ask for workers which have a toolchain (reply is MSG_WORKER_LIST)
+
+        MSG_DICTIONARY          = 18,// Server <- Client : Compression dictionary for the job data of a toolchain
+
+        MSG_JOB_RESULT_CHUNK    = 19,// Server -> Client : Part of a result file, sent ahead of the result for the job
+
+        MSG_CANCEL_JOB          = 20,// Server <-> Client : Drop a job which was won by a local race (reply if dropped before it started)
+
+        MSG_CHUNK_BUDGET        = 21,// Server -> Client : Job data chunk bytes the worker will store for the client
+
         NUM_MESSAGES            // leave last
     };
 };
@@ -76,6 +99,8 @@ namespace Protocol
         bool Send( const ConnectionInfo * connection ) const;
         bool Send( const ConnectionInfo * connection, const MemoryStream & payload ) const;
         bool Send( const ConnectionInfo * connection, const ConstMemoryStream & payload ) const;
+        bool Send( const ConnectionInfo * connection, const MemoryStream & payload, const void * payloadData, size_t payloadDataSize ) const;
+        bool Send( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * payloadBuffers, uint32_t numPayloadBuffers ) const;
         bool Broadcast( TCPConnectionPool * pool ) const;
 
         inline MessageType  GetType() const { return m_MsgType; }
@@ -98,20 +123,22 @@ namespace Protocol
     class MsgConnection : public IMessage
     {
     public:
-        explicit MsgConnection( uint32_t numJobsAvailable );
+        MsgConnection( uint32_t numJobsAvailable, uint32_t jobWindow );
 
         inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
         inline uint32_t GetNumJobsAvailable() const { return m_NumJobsAvailable; }
         inline uint8_t  GetPlatform() const { return m_Platform; }
         const char * GetHostName() const { return m_HostName; }
+        inline uint32_t GetJobWindow() const { return ( m_ProtocolVersion >= PROTOCOL_VERSION_BATCHING ) ? m_JobWindow : 1; }
     private:
         uint32_t        m_ProtocolVersion;
         uint32_t        m_NumJobsAvailable;
         uint8_t         m_Platform;
         uint8_t         m_Padding2[3];
         char            m_HostName[ 64 ];
+        uint32_t        m_JobWindow;        // PROTOCOL_VERSION_BATCHING onwards
     };
-    static_assert( sizeof( MsgConnection ) == sizeof( IMessage ) + 76, "MsgConnection message has incorrect size" );
+    static_assert( sizeof( MsgConnection ) == sizeof( IMessage ) + 80, "MsgConnection message has incorrect size" );
 
     // MsgStatus
     //------------------------------------------------------------------------------
@@ -144,16 +171,54 @@ namespace Protocol
     };
     static_assert( sizeof( MsgNoJobAvailable ) == sizeof( IMessage ), "MsgNoJobAvailable message has incorrect size" );
 
+    // MsgRequestJobs
+    //------------------------------------------------------------------------------
+    class MsgRequestJobs : public IMessage
+    {
+    public:
+        MsgRequestJobs( uint32_t numJobs, bool acceptsChunkedData, uint8_t compressionTypes, bool acceptsDictionaries, bool acceptsCancellation );
+
+        inline uint32_t GetNumJobs() const { return m_NumJobs; }
+        inline bool     AcceptsChunkedData() const { return m_AcceptsChunkedData; }
+        inline uint8_t  GetCompressionTypes() const { return m_CompressionTypes; }
+        inline bool     AcceptsDictionaries() const { return m_AcceptsDictionaries; }
+        inline bool     AcceptsCancellation() const { return m_AcceptsCancellation; }
+    private:
+        uint32_t        m_NumJobs;
+        bool            m_AcceptsChunkedData;   // PROTOCOL_VERSION_CHUNKING onwards
+        uint8_t         m_CompressionTypes;     // PROTOCOL_VERSION_COMPRESSION onwards: mask of Compressor types (0 = LZ4 only)
+        bool            m_AcceptsDictionaries;  // PROTOCOL_VERSION_COMPRESSION onwards
+        bool            m_AcceptsCancellation;  // PROTOCOL_VERSION_CANCEL_JOB onwards
+    };
+    static_assert( sizeof( MsgRequestJobs ) == sizeof( IMessage ) + 8, "MsgRequestJobs message has incorrect size" );
+
+    // MsgNoJobsAvailable
+    //------------------------------------------------------------------------------
+    class MsgNoJobsAvailable : public IMessage
+    {
+    public:
+        explicit MsgNoJobsAvailable( uint32_t numJobs );
+
+        inline uint32_t GetNumJobs() const { return m_NumJobs; }
+    private:
+        uint32_t        m_NumJobs;
+    };
+    static_assert( sizeof( MsgNoJobsAvailable ) == sizeof( IMessage ) + 4, "MsgNoJobsAvailable message has incorrect size" );
+
     // MsgJob
     //------------------------------------------------------------------------------
     class MsgJob : public IMessage
     {
     public:
-        explicit MsgJob( uint64_t toolId );
+        explicit MsgJob( uint64_t toolId, bool isDataChunked = false, bool usesDictionary = false );
 
         inline uint64_t GetToolId() const { return m_ToolId; }
+        inline bool     IsDataChunked() const { return m_IsDataChunked; }
+        inline bool     UsesDictionary() const { return m_UsesDictionary; }
     private:
-        char     m_Padding2[ 4 ];
+        bool     m_IsDataChunked;   // job data is encoded with a ChunkStore
+        bool     m_UsesDictionary;  // job data is compressed with the toolchain's MsgDictionary
+        char     m_Padding2[ 2 ];
         uint64_t m_ToolId;
     };
     static_assert( sizeof( MsgJob ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgJob message has incorrect size" );
@@ -167,6 +232,15 @@ namespace Protocol
     };
     static_assert( sizeof( MsgJobResult ) == sizeof( IMessage ), "MsgJobResult message has incorrect size" );
 
+    // MsgJobResults
+    //------------------------------------------------------------------------------
+    class MsgJobResults : public IMessage
+    {
+    public:
+        MsgJobResults();
+    };
+    static_assert( sizeof( MsgJobResults ) == sizeof( IMessage ), "MsgJobResults message has incorrect size" );
+
     // MsgRequestManifest
     //------------------------------------------------------------------------------
     class MsgRequestManifest : public IMessage
@@ -239,15 +313,19 @@ namespace Protocol
     class MsgRequestWorkerList : public IMessage
     {
     public:
-        MsgRequestWorkerList();
+        explicit MsgRequestWorkerList( uint32_t maxWorkers );
 
         inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
         inline uint8_t  GetPlatform() const { return m_Platform; }
+        inline uint32_t GetMaxWorkers() const { return ( m_ProtocolVersion >= PROTOCOL_VERSION_WORKER_LOAD ) ? m_MaxWorkers : 0; }
     private:
         uint32_t        m_ProtocolVersion;
         uint8_t         m_Platform;
+        uint8_t         m_Padding2[ 3 ];
+        uint32_t        m_MaxWorkers;       // PROTOCOL_VERSION_WORKER_LOAD onwards (0 = no limit)
+        // payload: tool ids used by the client (PROTOCOL_VERSION_WORKER_LOAD onwards)
     };
-    static_assert( sizeof( MsgRequestWorkerList ) == sizeof( IMessage ) + 8, "MsgRequestWorkerList message has incorrect size" );
+    static_assert( sizeof( MsgRequestWorkerList ) == sizeof( IMessage ) + 12, "MsgRequestWorkerList message has incorrect size" );
 
     // MsgWorkerList
     //------------------------------------------------------------------------------
@@ -263,17 +341,102 @@ namespace Protocol
     class MsgSetWorkerStatus : public IMessage
     {
     public:
-        explicit MsgSetWorkerStatus( bool isAvailable );
+        MsgSetWorkerStatus( bool isAvailable, uint32_t numCPUsFree, uint32_t numJobsQueued );
 
         inline bool     IsAvailable() const { return m_IsAvailable; }
         inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
         inline uint8_t  GetPlatform() const { return m_Platform; }
+        inline bool     HasLoad() const { return ( m_ProtocolVersion >= PROTOCOL_VERSION_WORKER_LOAD ); }
+        inline uint32_t GetNumCPUsFree() const { return HasLoad() ? m_NumCPUsFree : 0; }
+        inline uint32_t GetNumJobsQueued() const { return HasLoad() ? m_NumJobsQueued : 0; }
     private:
         bool            m_IsAvailable;
         uint32_t        m_ProtocolVersion;
         uint8_t         m_Platform;
+        uint32_t        m_NumCPUsFree;      // PROTOCOL_VERSION_WORKER_LOAD onwards
+        uint32_t        m_NumJobsQueued;    // PROTOCOL_VERSION_WORKER_LOAD onwards
+        // payload: tool ids synchronized on the worker (PROTOCOL_VERSION_WORKER_LOAD onwards)
+    };
+    static_assert( sizeof( MsgSetWorkerStatus ) == sizeof( IMessage ) + 20, "MsgSetWorkerStatus message has incorrect size" );
+
+    // MsgRequestToolPeers
+    //------------------------------------------------------------------------------
+    class MsgRequestToolPeers : public IMessage
+    {
+    public:
+        explicit MsgRequestToolPeers( uint64_t toolId );
+
+        inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
+        inline uint8_t  GetPlatform() const { return m_Platform; }
+        inline uint64_t GetToolId() const { return m_ToolId; }
+    private:
+        uint32_t        m_ProtocolVersion;
+        uint8_t         m_Platform;
+        uint8_t         m_Padding2[ 3 ];
+        uint64_t        m_ToolId;
+    };
+    static_assert( sizeof( MsgRequestToolPeers ) == sizeof( IMessage ) + 4/*alignment*/ + 16, "MsgRequestToolPeers message has incorrect size" );
+
+    // MsgDictionary
+    //------------------------------------------------------------------------------
+    class MsgDictionary : public IMessage
+    {
+    public:
+        explicit MsgDictionary( uint64_t toolId );
+
+        inline uint64_t GetToolId() const { return m_ToolId; }
+    private:
+        char     m_Padding2[ 4 ];
+        uint64_t m_ToolId;
+        // payload: CompressionDictionary data
+    };
+    static_assert( sizeof( MsgDictionary ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgDictionary message has incorrect size" );
+
+    // MsgJobResultChunk
+    //------------------------------------------------------------------------------
+    class MsgJobResultChunk : public IMessage
+    {
+    public:
+        MsgJobResultChunk( uint32_t jobId, uint8_t fileIndex, bool lastChunk );
+
+        inline uint32_t GetJobId() const { return m_JobId; }
+        inline uint8_t  GetFileIndex() const { return m_FileIndex; }
+        inline bool     IsLastChunk() const { return m_LastChunk; }
+    private:
+        uint32_t        m_JobId;
+        uint8_t         m_FileIndex;    // index of the file in the job's results (object, then pdb etc)
+        bool            m_LastChunk;    // last chunk of the file
+        char            m_Padding2[ 2 ];
+        // payload: compressed chunk of the file
+    };
+    static_assert( sizeof( MsgJobResultChunk ) == sizeof( IMessage ) + 8, "MsgJobResultChunk message has incorrect size" );
+
+    // MsgCancelJob
+    //------------------------------------------------------------------------------
+    class MsgCancelJob : public IMessage
+    {
+    public:
+        explicit MsgCancelJob( uint32_t jobId );
+
+        inline uint32_t GetJobId() const { return m_JobId; }
+    private:
+        uint32_t        m_JobId;
+    };
+    static_assert( sizeof( MsgCancelJob ) == sizeof( IMessage ) + 4, "MsgCancelJob message has incorrect size" );
+
+    // MsgChunkBudget
+    //------------------------------------------------------------------------------
+    class MsgChunkBudget : public IMessage
+    {
+    public:
+        explicit MsgChunkBudget( uint64_t maxBytesStored );
+
+        inline uint64_t GetMaxBytesStored() const { return m_MaxBytesStored; }
+    private:
+        char     m_Padding2[ 4 ];
+        uint64_t m_MaxBytesStored;
     };
-    static_assert( sizeof( MsgSetWorkerStatus ) == sizeof( IMessage ) + 12, "MsgSetWorkerStatus message has incorrect size" );
+    static_assert( sizeof( MsgChunkBudget ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgChunkBudget message has incorrect size" );
 };
 
 //------------------------------------------------------------------------------
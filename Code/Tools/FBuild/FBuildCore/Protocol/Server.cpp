@@ -7,23 +7,42 @@
 #include "Protocol.h"
 
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerage.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
+#include "Core/Containers/AutoPtr.h"
 #include "Core/Env/Env.h"
 #include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
+// system
+#include <memory.h> // for memset
+
+// Defines
+//------------------------------------------------------------------------------
+#define CHUNK_BUDGET_TOTAL      ( (uint64_t)1024 * MEGABYTE )   // job data chunks stored for all clients together
+#define CHUNK_BUDGET_MIN        ( (uint64_t)16 * MEGABYTE )     // not worth chunking with less than this
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 Server::Server( uint32_t numThreadsInJobQueue )
     : m_ShouldExit( false )
     , m_ClientList( 32, true )
+    , m_ChunkBudgetFree( CHUNK_BUDGET_TOTAL )
+    , m_WorkerBrokerage( nullptr )
+    , m_PendingPeerSyncs( 0, true )
+    , m_PeerSyncThread( INVALID_THREAD_HANDLE )
+    , m_PeerPort( Protocol::PROTOCOL_PORT )
+    , m_NumToolchainsFromPeers( 0 )
 {
     m_JobQueueRemote = FNEW( JobQueueRemote( numThreadsInJobQueue ? numThreadsInJobQueue : Env::GetNumProcessors() ) );
 
@@ -41,10 +60,19 @@ Server::~Server()
     AtomicStoreRelaxed( &m_ShouldExit, true );
     JobQueueRemote::Get().WakeMainThread();
     Thread::WaitForThread( m_Thread );
+    if ( m_PeerSyncThread != INVALID_THREAD_HANDLE )
+    {
+        m_PeerSyncSemaphore.Signal();
+        Thread::WaitForThread( m_PeerSyncThread );
+    }
 
     ShutdownAllConnections();
 
     Thread::CloseHandle( m_Thread );
+    if ( m_PeerSyncThread != INVALID_THREAD_HANDLE )
+    {
+        Thread::CloseHandle( m_PeerSyncThread );
+    }
 
     FDELETE m_JobQueueRemote;
 
@@ -99,15 +127,63 @@ bool Server::IsSynchingTool( AString & statusStr ) const
     return false; // no toolchain is currently synching
 }
 
+// GetSynchronizedToolIds
+//------------------------------------------------------------------------------
+void Server::GetSynchronizedToolIds( Array< uint64_t > & outToolIds ) const
+{
+    MutexHolder manifestMH( m_ToolManifestsMutex );
+
+    outToolIds.Clear();
+    for ( const ToolManifest * manifest : m_Tools )
+    {
+        if ( manifest->IsSynchronized() )
+        {
+            outToolIds.Append( manifest->GetToolId() );
+        }
+    }
+}
+
+// SetWorkerBrokerage
+//------------------------------------------------------------------------------
+void Server::SetWorkerBrokerage( WorkerBrokerage * brokerage )
+{
+    ASSERT( m_WorkerBrokerage == nullptr );
+    m_WorkerBrokerage = brokerage;
+
+    m_PeerSyncThread = Thread::CreateThread( PeerSyncThreadFuncStatic,
+                                             "PeerSync",
+                                             ( 64 * KILOBYTE ),
+                                             this );
+    ASSERT( m_PeerSyncThread );
+}
+
 // OnConnected
 //------------------------------------------------------------------------------
 /*virtual*/ void Server::OnConnected( const ConnectionInfo * connection )
 {
+    // connections we make to other workers (see SyncToolsFromPeers) carry the manifest to copy
+    ToolManifest * peerManifest = (ToolManifest *)connection->GetUserData();
+
     ClientState * cs = FNEW( ClientState( connection ) );
+    cs->m_IsPeer = ( peerManifest != nullptr );
     connection->SetUserData( cs );
 
     MutexHolder mh( m_ClientListMutex );
     m_ClientList.Append( cs );
+
+    if ( peerManifest )
+    {
+        // we have no jobs to offer, we only want the files
+        Protocol::MsgConnection msg( 0, 1 );
+        msg.Send( connection );
+
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+        PeerSync * sync = m_PendingPeerSyncs.Find( peerManifest );
+        ASSERT( sync );
+        cs->m_PeerClient = sync->m_Client; // to fall back to if this worker drops
+        m_PendingPeerSyncs.Erase( sync );
+        RequestMissingFiles( connection, peerManifest );
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -117,6 +193,17 @@ bool Server::IsSynchingTool( AString & statusStr ) const
     ClientState * cs = (ClientState *)connection->GetUserData();
     ASSERT( cs );
 
+    // Stop sending results to this client, and wait for any being sent
+    // (they use the connection, which is freed when we return)
+    {
+        MutexHolder mh( m_ClientListMutex );
+        AtomicStoreRelaxed( &cs->m_Disconnecting, true );
+    }
+    while ( AtomicLoadAcquire( &cs->m_NumSendingResults ) > 0 )
+    {
+        Thread::Sleep( 1 );
+    }
+
     // Unhook any jobs which are queued or in progress for this client
     // - deletes the queued jobs
     // - unhooks the UserData for in-progress jobs so the result is discarded on completion
@@ -143,6 +230,15 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             }
             ++it;
         }
+
+        // toolchains waiting for a peer lookup can't fall back to this Client now
+        for ( PeerSync & sync : m_PendingPeerSyncs )
+        {
+            if ( sync.m_Client == connection )
+            {
+                sync.m_Client = nullptr;
+            }
+        }
     }
 
     // free the serverstate structure
@@ -150,6 +246,18 @@ bool Server::IsSynchingTool( AString & statusStr ) const
     ClientState ** iter = m_ClientList.Find( cs );
     ASSERT( iter );
     m_ClientList.Erase( iter );
+    m_ChunkBudgetFree += cs->m_ChunkBudget; // chunks are freed with the ClientState
+
+    // if this was another worker sending us a toolchain, get the rest of
+    // the files from the Client which needed it instead
+    if ( cs->m_PeerClient )
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+        for ( ToolManifest * manifest : cancelledManifests )
+        {
+            RequestMissingFiles( cs->m_PeerClient, manifest );
+        }
+    }
 
     // because we cancelled manifest syncrhonization, we need to check if other
     // connections are waiting for the same manifest
@@ -160,6 +268,12 @@ bool Server::IsSynchingTool( AString & statusStr ) const
         {
             ClientState * otherCS = *it;
 
+            // workers sending us toolchains can't fall back to this Client now
+            if ( otherCS->m_PeerClient == connection )
+            {
+                otherCS->m_PeerClient = nullptr;
+            }
+
             MutexHolder mh2( otherCS->m_Mutex );
             const Job * const * jEnd = otherCS->m_WaitingJobs.End();
             for ( Job ** jIt = otherCS->m_WaitingJobs.Begin(); jIt != jEnd; ++jIt )
@@ -168,6 +282,7 @@ bool Server::IsSynchingTool( AString & statusStr ) const
                 ToolManifest * jMan = j->GetToolManifest();
                 if ( cancelledManifests.Find( jMan ) )
                 {
+                    MutexHolder manifestMH( m_ToolManifestsMutex );
                     RequestMissingFiles( otherCS->m_Connection, jMan );
                 }
             }
@@ -184,6 +299,10 @@ bool Server::IsSynchingTool( AString & statusStr ) const
     {
         delete *it;
     }
+    for ( ToolDictionary * dictionary : cs->m_Dictionaries )
+    {
+        FDELETE dictionary;
+    }
 
     FDELETE cs;
 }
@@ -244,6 +363,12 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_NO_JOBS_AVAILABLE:
+        {
+            const Protocol::MsgNoJobsAvailable * msg = static_cast< const Protocol::MsgNoJobsAvailable * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         case Protocol::MSG_JOB:
         {
             const Protocol::MsgJob * msg = static_cast< const Protocol::MsgJob * >( imsg );
@@ -256,12 +381,30 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_REQUEST_FILE:
+        {
+            const Protocol::MsgRequestFile * msg = static_cast< const Protocol::MsgRequestFile * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         case Protocol::MSG_FILE:
         {
             const Protocol::MsgFile * msg = static_cast< const Protocol::MsgFile * >( imsg );
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_DICTIONARY:
+        {
+            const Protocol::MsgDictionary * msg = static_cast< const Protocol::MsgDictionary * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_CANCEL_JOB:
+        {
+            const Protocol::MsgCancelJob * msg = static_cast< const Protocol::MsgCancelJob * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -282,7 +425,9 @@ bool Server::IsSynchingTool( AString & statusStr ) const
 void Server::Process( const ConnectionInfo * connection, const Protocol::MsgConnection * msg )
 {
     // check for valid/supported protocol version
-    if ( msg->GetProtocolVersion() != Protocol::PROTOCOL_VERSION )
+    // (older clients are served one job per message)
+    if ( ( msg->GetProtocolVersion() < Protocol::PROTOCOL_VERSION_MINIMUM ) ||
+         ( msg->GetProtocolVersion() > Protocol::PROTOCOL_VERSION ) )
     {
         AStackString<> remoteAddr;
         TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
@@ -306,6 +451,8 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgConn
     MutexHolder mh( cs->m_Mutex );
     cs->m_NumJobsAvailable = msg->GetNumJobsAvailable();
     cs->m_HostName = msg->GetHostName();
+    cs->m_ProtocolVersion = msg->GetProtocolVersion();
+    cs->m_JobWindow = Math::Max( msg->GetJobWindow(), 1u );
 }
 
 // Process( MsgStatus )
@@ -332,6 +479,17 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgNoJo
     cs->m_NumJobsRequested--;
 }
 
+// Process( MsgNoJobsAvailable )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgNoJobsAvailable * msg )
+{
+    // We requested several jobs, but the client didn't have them all
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    MutexHolder mh( cs->m_Mutex );
+    ASSERT( cs->m_NumJobsRequested >= msg->GetNumJobs() );
+    cs->m_NumJobsRequested -= Math::Min( msg->GetNumJobs(), cs->m_NumJobsRequested );
+}
+
 // Process( MsgJob )
 //------------------------------------------------------------------------------
 void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize )
@@ -347,6 +505,19 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
 
     Job * job = FNEW( Job( ms ) );
     job->SetUserData( cs );
+    job->SetResultStreamingAllowed( cs->m_ProtocolVersion >= Protocol::PROTOCOL_VERSION_RESULT_STREAMING );
+
+    // rebuild deduplicated job data, or decompress data only we have the dictionary for
+    if ( ( msg->IsDataChunked() || msg->UsesDictionary() ) && ( DecodeJobData( cs, job, msg ) == false ) )
+    {
+        AStackString<> remoteAddr;
+        TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
+        FLOG_WARN( "Disconnecting '%s' due to bad job data\n", remoteAddr.Get() );
+        cs->m_NumJobsActive--;
+        FDELETE job;
+        Disconnect( connection );
+        return;
+    }
 
     //
     const uint64_t toolId = msg->GetToolId();
@@ -387,6 +558,51 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
     cs->m_WaitingJobs.Append( job );
 }
 
+// DecodeJobData
+//------------------------------------------------------------------------------
+/*static*/ bool Server::DecodeJobData( ClientState * cs, Job * job, const Protocol::MsgJob * msg )
+{
+    PROFILE_FUNCTION
+
+    ASSERT( job->IsDataCompressed() );
+
+    // the Client sends the dictionary before the first job which uses it
+    const CompressionDictionary * dictionary = nullptr;
+    if ( msg->UsesDictionary() )
+    {
+        const ToolDictionary * const * found = cs->m_Dictionaries.FindDeref( msg->GetToolId() );
+        if ( found == nullptr )
+        {
+            return false;
+        }
+        dictionary = &( *found )->m_Dictionary;
+    }
+
+    Compressor c;
+    if ( ( c.IsValidData( job->GetData(), job->GetDataSize() ) == false ) ||
+         ( c.Decompress( job->GetData(), dictionary ) == false ) )
+    {
+        return false;
+    }
+
+    if ( msg->IsDataChunked() == false )
+    {
+        const size_t dataSize = c.GetResultSize();
+        job->OwnData( c.ReleaseResult(), dataSize, false );
+        return true;
+    }
+
+    ConstMemoryStream ms( c.GetResult(), c.GetResultSize() );
+    void * data = nullptr;
+    uint32_t dataSize = 0;
+    if ( cs->m_ChunkStore.Decode( ms, data, dataSize ) == false )
+    {
+        return false;
+    }
+    job->OwnData( data, dataSize, false );
+    return true;
+}
+
 // Process( MsgManifest )
 //------------------------------------------------------------------------------
 void Server::Process( const ConnectionInfo * connection, const Protocol::MsgManifest * msg, const void * payload, size_t payloadSize )
@@ -398,10 +614,23 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
     {
         MutexHolder manifestMH( m_ToolManifestsMutex ); // ensure we don't make redundant requests
 
-        // fill out the received manifest
         ToolManifest ** found = m_Tools.FindDeref( toolId );
-        ASSERT( found );
-        manifest = *found;
+        if ( found )
+        {
+            manifest = *found;
+            if ( manifest->GetFiles().IsEmpty() == false )
+            {
+                return; // already received (pushed by a client, and requested for a job)
+            }
+        }
+        else
+        {
+            // a client is pushing a toolchain ahead of the jobs which need it
+            manifest = FNEW( ToolManifest( toolId ) );
+            m_Tools.Append( manifest );
+        }
+
+        // fill out the received manifest
         manifest->DeserializeFromRemote( ms );
     }
 
@@ -413,7 +642,46 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
         return;
     }
 
-    RequestMissingFiles( connection, manifest );
+    SynchronizeTool( connection, manifest );
+}
+
+// Process( MsgRequestFile )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg )
+{
+    PROFILE_SECTION( "MsgRequestFile" )
+
+    // another worker is copying a toolchain from us
+    const uint64_t toolId = msg->GetToolId();
+    const uint32_t fileId = msg->GetFileId();
+
+    const void * data = nullptr;
+    size_t dataSize = 0;
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+
+        ToolManifest ** found = m_Tools.FindDeref( toolId );
+        if ( found && ( fileId < ( *found )->GetFiles().GetSize() ) )
+        {
+            data = ( *found )->GetRemoteFileData( fileId, dataSize );
+        }
+    }
+
+    if ( data == nullptr )
+    {
+        // the other worker will get the file from its Client instead
+        AStackString<> remoteAddr;
+        TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
+        FLOG_WARN( "Disconnecting '%s' due to request for unavailable fileId %u for manifest 0x%" PRIx64 "\n", remoteAddr.Get(), fileId, toolId );
+        Disconnect( connection );
+        return;
+    }
+
+    // NOTE: data is kept by the manifest, which lives as long as we do
+    ConstMemoryStream ms( data, dataSize );
+
+    Protocol::MsgFile resultMsg( toolId, fileId );
+    resultMsg.Send( connection, ms );
 }
 
 // Process( MsgFile )
@@ -453,6 +721,76 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
     // ToolChain is now synchronized
     // Allow any jobs that were waiting on it to start
     CheckWaitingJobs( manifest );
+
+    // done with the worker we copied it from
+    const ClientState * cs = (const ClientState *)connection->GetUserData();
+    if ( cs->m_IsPeer )
+    {
+        AtomicIncU32( &m_NumToolchainsFromPeers );
+        Disconnect( connection );
+    }
+}
+
+// Process( MsgDictionary )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgDictionary * msg, const void * payload, size_t payloadSize )
+{
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    MutexHolder mh( cs->m_Mutex );
+
+    ToolDictionary ** found = cs->m_Dictionaries.FindDeref( msg->GetToolId() );
+    ToolDictionary * toolDictionary = found ? *found : nullptr;
+    if ( toolDictionary == nullptr )
+    {
+        toolDictionary = FNEW( ToolDictionary );
+        toolDictionary->m_ToolId = msg->GetToolId();
+        cs->m_Dictionaries.Append( toolDictionary );
+    }
+
+    if ( toolDictionary->m_Dictionary.Load( payload, payloadSize ) == false )
+    {
+        AStackString<> remoteAddr;
+        TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
+        FLOG_WARN( "Disconnecting '%s' due to bad compression dictionary\n", remoteAddr.Get() );
+        Disconnect( connection );
+    }
+}
+
+// Process( MsgCancelJob )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgCancelJob * msg )
+{
+    // The client won a local race for this job, so drop it if we haven't started it
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    MutexHolder mh( cs->m_Mutex );
+
+    const uint32_t jobId = msg->GetJobId();
+    Job * job = nullptr;
+    Job ** waitingJob = cs->m_WaitingJobs.FindDeref( jobId );
+    if ( waitingJob )
+    {
+        job = *waitingJob;
+        cs->m_WaitingJobs.Erase( waitingJob );
+    }
+    else
+    {
+        job = JobQueueRemote::Get().CancelPendingJob( cs, jobId );
+    }
+
+    if ( job == nullptr )
+    {
+        return; // already building (or built) - the result will be sent as normal
+    }
+    FDELETE job;
+
+    // confirm to the client, which will otherwise wait for the result
+    Protocol::MsgCancelJob reply( jobId );
+    reply.Send( connection );
+
+    // free the slot for another job
+    ASSERT( cs->m_NumJobsActive > 0 );
+    cs->m_NumJobsActive--;
+    JobQueueRemote::Get().WakeMainThread();
 }
 
 // CheckWaitingJobs
@@ -460,10 +798,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
 void Server::CheckWaitingJobs( const ToolManifest * manifest )
 {
     // queue for start any jobs that may now be ready
-    #ifdef ASSERTS_ENABLED
-        bool atLeastOneJobStarted = false;
-    #endif
-
+    // (toolchains pushed ahead of time by Clients may have none)
     MutexHolder mhC( m_ClientListMutex );
     const ClientState * const * end = m_ClientList.End();
     for ( ClientState ** it = m_ClientList.Begin(); it!=end; ++it )
@@ -484,16 +819,123 @@ void Server::CheckWaitingJobs( const ToolManifest * manifest )
                 cs->m_WaitingJobs.EraseIndex( (size_t)i );
                 JobQueueRemote::Get().QueueJob( job );
                 PROTOCOL_DEBUG( "Server: Job %x can now be started\n", job );
-                #ifdef ASSERTS_ENABLED
-                    atLeastOneJobStarted = true;
-                #endif
             }
         }
     }
+}
 
-    // We should only have called this function when a ToolChain sync was complete
-    // so at least 1 job should have been waiting for it
-    ASSERT( atLeastOneJobStarted );
+// PeerSyncThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Server::PeerSyncThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "PeerSyncThread" )
+
+    Server * s = (Server *)param;
+    s->PeerSyncThreadFunc();
+    return 0;
+}
+
+// PeerSyncThreadFunc
+//------------------------------------------------------------------------------
+void Server::PeerSyncThreadFunc()
+{
+    while ( AtomicLoadRelaxed( &m_ShouldExit ) == false )
+    {
+        // handle all the toolchains waiting for a lookup before sleeping
+        while ( SyncToolsFromPeers() )
+        {
+        }
+
+        m_PeerSyncSemaphore.Wait( 100 );
+    }
+}
+
+// SyncToolsFromPeers
+//------------------------------------------------------------------------------
+bool Server::SyncToolsFromPeers()
+{
+    if ( AtomicLoadRelaxed( &m_ShouldExit ) )
+    {
+        return false;
+    }
+
+    // find a toolchain waiting for a peer lookup
+    ToolManifest * manifest = nullptr;
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+        for ( const PeerSync & sync : m_PendingPeerSyncs )
+        {
+            if ( sync.m_Connecting == false )
+            {
+                manifest = sync.m_Manifest;
+                break;
+            }
+        }
+    }
+    if ( manifest == nullptr )
+    {
+        return false;
+    }
+
+    PROFILE_FUNCTION
+
+    // ask the coordinator which workers have this toolchain
+    Array< uint32_t > peers( 0, true );
+    m_WorkerBrokerage->FindToolPeers( manifest->GetToolId(), peers );
+
+    // connect to the first one we can
+    // (OnConnected requests the files from it)
+    for ( const uint32_t peer : peers )
+    {
+        if ( AtomicLoadRelaxed( &m_ShouldExit ) )
+        {
+            break;
+        }
+
+        // flag first, as OnConnected may happen before Connect returns
+        {
+            MutexHolder manifestMH( m_ToolManifestsMutex );
+            m_PendingPeerSyncs.Find( manifest )->m_Connecting = true;
+        }
+        if ( Connect( peer, m_PeerPort, 2000, manifest ) ) // 2000ms connection timeout
+        {
+            return true;
+        }
+        {
+            MutexHolder manifestMH( m_ToolManifestsMutex );
+            m_PendingPeerSyncs.Find( manifest )->m_Connecting = false;
+        }
+    }
+
+    // no other worker has it - synchronize from the Client as usual
+    MutexHolder mh( m_ClientListMutex );
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+        PeerSync * sync = m_PendingPeerSyncs.Find( manifest );
+        const ConnectionInfo * client = sync->m_Client;
+        m_PendingPeerSyncs.Erase( sync );
+        if ( client )
+        {
+            RequestMissingFiles( client, manifest );
+            return true;
+        }
+    }
+
+    // Client which sent the manifest has gone, so use any other which is waiting for it
+    for ( ClientState * cs : m_ClientList )
+    {
+        MutexHolder mh2( cs->m_Mutex );
+        for ( const Job * job : cs->m_WaitingJobs )
+        {
+            if ( job->GetToolManifest() == manifest )
+            {
+                MutexHolder manifestMH( m_ToolManifestsMutex );
+                RequestMissingFiles( cs->m_Connection, manifest );
+                return true;
+            }
+        }
+    }
+    return true;
 }
 
 
@@ -541,10 +983,10 @@ void Server::FindNeedyClients()
     {
         return;
     }
-    ++availableJobs; // over request to parallelize building/network transfers
 
     ClientState ** iter = m_ClientList.Begin();
     const ClientState * const * end = m_ClientList.End();
+    uint32_t jobWindow = 1;
     for ( ; iter != end; ++iter )
     {
         ClientState * cs = *iter;
@@ -554,10 +996,16 @@ void Server::FindNeedyClients()
         // any jobs requested or in progress reduce the available count
         int32_t reservedJobs = (int32_t)( cs->m_NumJobsRequested + cs->m_NumJobsActive );
         availableJobs -= reservedJobs;
-        if ( availableJobs <= 0 )
-        {
-            return;
-        }
+
+        jobWindow = Math::Max( jobWindow, cs->m_JobWindow );
+    }
+
+    // over request to parallelize building/network transfers
+    // (clients can widen this to hide network latency)
+    availableJobs += (int)jobWindow;
+    if ( availableJobs <= 0 )
+    {
+        return;
     }
 
     // we have some jobs available
@@ -565,8 +1013,10 @@ void Server::FindNeedyClients()
     // sort clients to find neediest first
     m_ClientList.SortDeref();
 
-    Protocol::MsgRequestJob msg;
-
+    // share the available jobs between the clients
+    Array< uint32_t > numJobsToRequest( m_ClientList.GetSize(), false );
+    numJobsToRequest.SetSize( m_ClientList.GetSize() );
+    memset( numJobsToRequest.Begin(), 0, numJobsToRequest.GetSize() * sizeof( uint32_t ) );
     while ( availableJobs > 0 )
     {
         bool anyJobsRequested = false;
@@ -586,8 +1036,8 @@ void Server::FindNeedyClients()
             }
 
             // request job from this client
-            msg.Send( cs->m_Connection );
             cs->m_NumJobsRequested++;
+            numJobsToRequest[ (size_t)( iter - m_ClientList.Begin() ) ]++;
             availableJobs--;
             anyJobsRequested = true;
         }
@@ -598,6 +1048,80 @@ void Server::FindNeedyClients()
             break;
         }
     }
+
+    // send the requests
+    for ( size_t i = 0; i < m_ClientList.GetSize(); ++i )
+    {
+        const uint32_t numJobs = numJobsToRequest[ i ];
+        if ( numJobs == 0 )
+        {
+            continue;
+        }
+
+        ClientState * cs = m_ClientList[ i ];
+        MutexHolder mh2( cs->m_Mutex );
+        if ( cs->m_ProtocolVersion >= Protocol::PROTOCOL_VERSION_BATCHING )
+        {
+            // accept deduplicated job data (if we have space for it) and any compression we can decode
+            const bool acceptsChunkedData = ReserveChunkBudget( cs );
+            Protocol::MsgRequestJobs msg( numJobs, acceptsChunkedData, Compressor::GetSupportedTypes(), true, true );
+            msg.Send( cs->m_Connection );
+        }
+        else
+        {
+            // older clients need one message per job
+            Protocol::MsgRequestJob msg;
+            for ( uint32_t j = 0; j < numJobs; ++j )
+            {
+                msg.Send( cs->m_Connection );
+            }
+        }
+    }
+}
+
+// ReserveChunkBudget
+//------------------------------------------------------------------------------
+bool Server::ReserveChunkBudget( ClientState * cs )
+{
+    if ( cs->m_ChunkBudget > 0 )
+    {
+        return true; // already reserved
+    }
+    if ( cs->m_ProtocolVersion < Protocol::PROTOCOL_VERSION_CHUNKING )
+    {
+        return false; // client can't send chunked data
+    }
+
+    // share the budget between clients as they start sending jobs, so
+    // the memory used doesn't grow with the number of clients
+    uint64_t budget;
+    if ( cs->m_ProtocolVersion >= Protocol::PROTOCOL_VERSION_CHUNK_BUDGET )
+    {
+        // leave some for later clients
+        budget = Math::Min( m_ChunkBudgetFree / 2, (uint64_t)ChunkStore::DEFAULT_MAX_BYTES_STORED );
+        if ( budget < CHUNK_BUDGET_MIN )
+        {
+            return false;
+        }
+
+        // tell the client before requesting jobs, so it only sends chunks we will keep
+        Protocol::MsgChunkBudget msg( budget );
+        msg.Send( cs->m_Connection );
+    }
+    else
+    {
+        // older clients always assume the default
+        budget = ChunkStore::DEFAULT_MAX_BYTES_STORED;
+        if ( m_ChunkBudgetFree < budget )
+        {
+            return false;
+        }
+    }
+
+    m_ChunkBudgetFree -= budget;
+    cs->m_ChunkBudget = budget;
+    cs->m_ChunkStore.SetMaxBytesStored( budget );
+    return true;
 }
 
 // FinalizeCompletedJobs
@@ -607,54 +1131,227 @@ void Server::FinalizeCompletedJobs()
     PROFILE_FUNCTION
 
     JobQueueRemote & jcr = JobQueueRemote::Get();
+    Array< Job * > completedJobs( 32, true );
     while ( Job * job = jcr.GetCompletedJob() )
+    {
+        completedJobs.Append( job );
+    }
+
+    while ( completedJobs.IsEmpty() == false )
     {
         // get associated connection
-        ClientState * cs = (ClientState *)job->GetUserData();
+        ClientState * cs = (ClientState *)completedJobs[ 0 ]->GetUserData();
+        Job * jobs[ TCPConnectionPool::MAX_PAYLOAD_BUFFERS / 2 ];
+        uint32_t numJobs = 0;
+        bool connectionStillActive;
+        {
+            MutexHolder mh( m_ClientListMutex );
+            connectionStillActive = ( m_ClientList.Find( cs ) != nullptr ) && ( AtomicLoadRelaxed( &cs->m_Disconnecting ) == false );
 
-        MutexHolder mh( m_ClientListMutex );
+            // gather all results for the same connection
+            // (older clients take one result per message)
+            const uint32_t maxJobs = ( connectionStillActive && ( cs->m_ProtocolVersion >= Protocol::PROTOCOL_VERSION_BATCHING ) ) ? ( TCPConnectionPool::MAX_PAYLOAD_BUFFERS / 2 ) : 1;
+            for ( size_t i = 0; ( i < completedJobs.GetSize() ) && ( numJobs < maxJobs ); )
+            {
+                if ( completedJobs[ i ]->GetUserData() == cs )
+                {
+                    jobs[ numJobs++ ] = completedJobs[ i ];
+                    completedJobs.EraseIndex( i );
+                    continue;
+                }
+                ++i;
+            }
 
-        bool connectionStillActive = ( m_ClientList.Find( cs ) != nullptr );
+            if ( connectionStillActive )
+            {
+                MutexHolder mh2( cs->m_Mutex );
+                ASSERT( cs->m_NumJobsActive >= numJobs );
+                cs->m_NumJobsActive -= numJobs;
+
+                // keep the connection until the results are sent
+                AtomicIncU32( &cs->m_NumSendingResults );
+            }
+            else
+            {
+                // we might get here without finding the connection
+                // (if the connection was lost before we completed)
+            }
+        }
+
+        // large results can take a while to stream, so they're sent without the locks
         if ( connectionStillActive )
         {
-            Node::State result = job->GetNode()->GetState();
-            ASSERT( ( result == Node::UP_TO_DATE ) || ( result == Node::FAILED ) );
+            SendJobResults( cs, jobs, numJobs );
+            AtomicDecU32( &cs->m_NumSendingResults );
+        }
+
+        for ( uint32_t i = 0; i < numJobs; ++i )
+        {
+            FDELETE jobs[ i ];
+        }
+    }
+}
 
-            MemoryStream ms;
-            ms.Write( job->GetJobId() );
-            ms.Write( job->GetNode()->GetName() );
-            ms.Write( result == Node::UP_TO_DATE );
-            ms.Write( job->GetSystemErrorCount() > 0 );
-            ms.Write( job->GetMessages() );
-            ms.Write( job->GetNode()->GetLastBuildTime() );
-            ms.Write( job->IsDataCompressed() );
+// SendJobResults
+//------------------------------------------------------------------------------
+/*static*/ void Server::SendJobResults( ClientState * cs, Job ** jobs, uint32_t numJobs )
+{
+    ASSERT( ( numJobs > 0 ) && ( numJobs <= ( TCPConnectionPool::MAX_PAYLOAD_BUFFERS / 2 ) ) );
 
-            // write the data - build result for success, or output+errors for failure
-            ms.Write( (uint32_t)job->GetDataSize() );
-            ms.WriteBuffer( job->GetData(), job->GetDataSize() );
+    // stream large results first, so the Client has the files when the result arrives
+    bool resultFilesSent[ TCPConnectionPool::MAX_PAYLOAD_BUFFERS / 2 ];
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        resultFilesSent[ i ] = jobs[ i ]->GetStreamedResultFiles().IsEmpty() || SendResultFiles( cs, jobs[ i ] );
+    }
 
-            MutexHolder mh2( cs->m_Mutex );
-            ASSERT( cs->m_NumJobsActive );
-            cs->m_NumJobsActive--;
+    // serialize the results, recording where each one ends
+    // (the data for each job is sent directly from the job, without copying it into the stream)
+    MemoryStream ms;
+    if ( numJobs > 1 )
+    {
+        ms.Write( numJobs );
+    }
+    size_t resultEnd[ TCPConnectionPool::MAX_PAYLOAD_BUFFERS / 2 ];
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        const Job * job = jobs[ i ];
+
+        Node::State result = job->GetNode()->GetState();
+        ASSERT( ( result == Node::UP_TO_DATE ) || ( result == Node::FAILED ) );
+
+        ms.Write( job->GetJobId() );
+        ms.Write( job->GetNode()->GetName() );
+        ms.Write( ( result == Node::UP_TO_DATE ) && resultFilesSent[ i ] );
+        ms.Write( job->GetSystemErrorCount() > 0 );
+        ms.Write( job->GetMessages() );
+        ms.Write( job->GetNode()->GetLastBuildTime() );
+        ms.Write( job->IsDataCompressed() );
+
+        // write the data - build result for success, or output+errors for failure
+        ms.Write( (uint32_t)job->GetDataSize() );
+        resultEnd[ i ] = (size_t)ms.GetSize();
+    }
+
+    // interleave the serialized results with the data for each job
+    TCPConnectionPool::SendBuffer buffers[ TCPConnectionPool::MAX_PAYLOAD_BUFFERS ];
+    size_t resultStart = 0;
+    for ( uint32_t i = 0; i < numJobs; ++i )
+    {
+        buffers[ i * 2 ].size = (uint32_t)( resultEnd[ i ] - resultStart );
+        buffers[ i * 2 ].data = (const char *)ms.GetData() + resultStart;
+        buffers[ i * 2 + 1 ].size = (uint32_t)jobs[ i ]->GetDataSize();
+        buffers[ i * 2 + 1 ].data = jobs[ i ]->GetData();
+        resultStart = resultEnd[ i ];
+    }
+
+    // other messages to the client are sent with its lock held, so they can't interleave with ours
+    MutexHolder mh( cs->m_Mutex );
+    if ( numJobs > 1 )
+    {
+        Protocol::MsgJobResults msg;
+        msg.Send( cs->m_Connection, buffers, numJobs * 2 );
+    }
+    else
+    {
+        Protocol::MsgJobResult msg;
+        msg.Send( cs->m_Connection, buffers, 2 );
+    }
+}
 
-            Protocol::MsgJobResult msg;
-            msg.Send( cs->m_Connection, ms );
+// SendResultFiles
+//------------------------------------------------------------------------------
+/*static*/ bool Server::SendResultFiles( ClientState * cs, Job * job )
+{
+    PROFILE_FUNCTION
+
+    // send each file a chunk at a time, reading only as much as is being sent
+    const Array< AString > & fileNames = job->GetStreamedResultFiles();
+    AutoPtr< char > buffer( (char *)ALLOC( Compressor::BLOCK_SIZE ) );
+    for ( size_t i = 0; i < fileNames.GetSize(); ++i )
+    {
+        FileStream fs;
+        if ( fs.Open( fileNames[ i ].Get(), FileStream::READ_ONLY ) == false )
+        {
+            job->Error( "Error reading file: '%s'", fileNames[ i ].Get() );
+            return false;
         }
-        else
+
+        uint64_t remaining = fs.GetFileSize();
+        do
         {
-            // we might get here without finding the connection
-            // (if the connection was lost before we completed)
+            if ( AtomicLoadRelaxed( &cs->m_Disconnecting ) )
+            {
+                return false; // connection lost
+            }
+
+            uint32_t size = (uint32_t)Math::Min< uint64_t >( remaining, Compressor::BLOCK_SIZE );
+            bool readOK = true;
+            if ( fs.ReadBuffer( buffer.Get(), size ) != size )
+            {
+                // end the file with an empty chunk, so the Client isn't left waiting
+                // for the rest of it (it discards the file when the job fails)
+                job->Error( "Error reading file: '%s'", fileNames[ i ].Get() );
+                readOK = false;
+                size = 0;
+                remaining = 0;
+            }
+            else
+            {
+                remaining -= size;
+            }
+
+            Compressor c;
+            c.Compress( buffer.Get(), size );
+            TCPConnectionPool::SendBuffer payload;
+            payload.size = (uint32_t)c.GetResultSize();
+            payload.data = c.GetResult();
+            Protocol::MsgJobResultChunk msg( job->GetJobId(), (uint8_t)i, ( remaining == 0 ) );
+            MutexHolder mh( cs->m_Mutex ); // see SendJobResults
+            if ( ( msg.Send( cs->m_Connection, &payload, 1 ) == false ) || ( readOK == false ) )
+            {
+                return false; // connection lost, or failed to read
+            }
         }
+        while ( remaining > 0 );
+    }
+    return true;
+}
 
-        FDELETE job;
+// SynchronizeTool
+//------------------------------------------------------------------------------
+void Server::SynchronizeTool( const ConnectionInfo * connection, ToolManifest * manifest )
+{
+    MutexHolder manifestMH( m_ToolManifestsMutex );
+
+    // prefer copying the files from another worker, to leave the Client's
+    // bandwidth for jobs (the lookup happens in PeerSyncThreadFunc, as it can be slow)
+    if ( m_WorkerBrokerage )
+    {
+        if ( m_PendingPeerSyncs.Find( manifest ) == nullptr )
+        {
+            PeerSync sync;
+            sync.m_Manifest = manifest;
+            sync.m_Client = connection;
+            sync.m_Connecting = false;
+            m_PendingPeerSyncs.Append( sync );
+        }
+        m_PeerSyncSemaphore.Signal();
+        return;
     }
+
+    RequestMissingFiles( connection, manifest );
 }
 
 // RequestMissingFiles
 //------------------------------------------------------------------------------
 void Server::RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const
 {
-    MutexHolder manifestMH( m_ToolManifestsMutex );
+    // files will be requested once we know if another worker has them
+    if ( m_PendingPeerSyncs.Find( manifest ) )
+    {
+        return;
+    }
 
     const Array< ToolManifestFile > & files = manifest->GetFiles();
     const size_t numFiles = files.GetSize();
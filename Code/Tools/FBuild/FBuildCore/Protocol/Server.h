@@ -4,21 +4,30 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/ChunkStore.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+
 #include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Semaphore.h"
 #include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
 class Job;
 class JobQueueRemote;
+class WorkerBrokerage;
 namespace Protocol
 {
     class IMessage;
+    class MsgCancelJob;
     class MsgConnection;
+    class MsgDictionary;
     class MsgJob;
     class MsgManifest;
     class MsgNoJobAvailable;
+    class MsgNoJobsAvailable;
     class MsgStatus;
+    class MsgRequestFile;
     class MsgFile;
 }
 class ToolManifest;
@@ -34,6 +43,14 @@ public:
     static void GetHostForJob( const Job * job, AString & hostName );
 
     bool IsSynchingTool( AString & statusStr ) const;
+    void GetSynchronizedToolIds( Array< uint64_t > & outToolIds ) const;
+
+    // copy toolchains from other workers found through the coordinator
+    void SetWorkerBrokerage( WorkerBrokerage * brokerage );
+    inline void SetPeerPort( uint16_t port ) { m_PeerPort = port; } // port other workers listen on (tests use their own)
+
+    // stats
+    inline uint32_t GetNumToolchainsFromPeers() const { return m_NumToolchainsFromPeers; }
 
 private:
     // TCPConnection interface
@@ -45,9 +62,13 @@ private:
     void Process( const ConnectionInfo * connection, const Protocol::MsgConnection * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgStatus * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgNoJobAvailable * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgNoJobsAvailable * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgManifest * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgFile * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgDictionary * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgCancelJob * msg );
 
     static uint32_t ThreadFuncStatic( void * param );
     void            ThreadFunc();
@@ -56,11 +77,26 @@ private:
     void            FinalizeCompletedJobs();
     void            CheckWaitingJobs( const ToolManifest * manifest );
 
-    void            RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const;
+    // looking up and connecting to other workers can be slow, so it
+    // has its own thread
+    static uint32_t PeerSyncThreadFuncStatic( void * param );
+    void            PeerSyncThreadFunc();
+    bool            SyncToolsFromPeers();
+
+    void            SynchronizeTool( const ConnectionInfo * connection, ToolManifest * manifest );
+    void            RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const; // m_ToolManifestsMutex must be held
+
+    struct ToolDictionary
+    {
+        inline bool operator == ( uint64_t toolId ) const { return ( m_ToolId == toolId ); }
+
+        uint64_t                m_ToolId;
+        CompressionDictionary   m_Dictionary;
+    };
 
     struct ClientState
     {
-        explicit ClientState( const ConnectionInfo * ci ) : m_CurrentMessage( nullptr ), m_Connection( ci ), m_NumJobsAvailable( 0 ), m_NumJobsRequested( 0 ), m_NumJobsActive( 0 ), m_WaitingJobs( 16, true ) {}
+        explicit ClientState( const ConnectionInfo * ci ) : m_CurrentMessage( nullptr ), m_Connection( ci ), m_NumJobsAvailable( 0 ), m_NumJobsRequested( 0 ), m_NumJobsActive( 0 ), m_ProtocolVersion( 0 ), m_JobWindow( 1 ), m_IsPeer( false ), m_PeerClient( nullptr ), m_Disconnecting( false ), m_NumSendingResults( 0 ), m_WaitingJobs( 16, true ), m_ChunkStore( true ), m_ChunkBudget( 0 ), m_Dictionaries( 0, true ) {}
 
         inline bool operator < ( const ClientState & other ) const { return ( m_NumJobsAvailable > other.m_NumJobsAvailable ); }
 
@@ -71,23 +107,55 @@ private:
         uint32_t                m_NumJobsAvailable;
         uint32_t                m_NumJobsRequested;
         uint32_t                m_NumJobsActive;
+        uint32_t                m_ProtocolVersion;  // batched messages from PROTOCOL_VERSION_BATCHING onwards
+        uint32_t                m_JobWindow;        // jobs to request beyond those we can build right now
+        bool                    m_IsPeer;           // connection we made to copy a toolchain from another worker
+        const ConnectionInfo *  m_PeerClient;       // for a peer, the Client to fall back to if it drops (can be null, protected by m_ClientListMutex)
+        volatile bool           m_Disconnecting;    // set when OnDisconnected starts, so no more results are sent (set under m_ClientListMutex)
+        volatile uint32_t       m_NumSendingResults; // results being sent without the locks held (OnDisconnected waits for them)
 
         AString                 m_HostName;
 
         Array< Job * >          m_WaitingJobs; // jobs waiting for manifests/toolchains
 
+        ChunkStore              m_ChunkStore;  // job data chunks received from this client
+        uint64_t                m_ChunkBudget; // bytes of m_ChunkBudgetFree reserved for m_ChunkStore (0 = none yet, protected by m_ClientListMutex)
+        Array< ToolDictionary * > m_Dictionaries; // job data compression dictionaries received from this client
+
         Timer                   m_StatusTimer;
     };
 
+    static bool DecodeJobData( ClientState * cs, Job * job, const Protocol::MsgJob * msg );
+    static void SendJobResults( ClientState * cs, Job ** jobs, uint32_t numJobs );
+    static bool SendResultFiles( ClientState * cs, Job * job );
+    bool        ReserveChunkBudget( ClientState * cs ); // m_ClientListMutex and cs->m_Mutex must be held
+
     JobQueueRemote *        m_JobQueueRemote;
 
     volatile bool           m_ShouldExit;   // signal from main thread
     Thread::ThreadHandle    m_Thread;       // the thread to manage workload
     Mutex                   m_ClientListMutex;
     Array< ClientState * >  m_ClientList;
+    uint64_t                m_ChunkBudgetFree; // job data chunk bytes not reserved by any client (protected by m_ClientListMutex)
 
     mutable Mutex           m_ToolManifestsMutex;
     Array< ToolManifest * > m_Tools;
+
+    // toolchains waiting for the coordinator to tell us which workers have them
+    struct PeerSync
+    {
+        inline bool operator == ( const ToolManifest * manifest ) const { return ( m_Manifest == manifest ); }
+
+        ToolManifest *          m_Manifest;
+        const ConnectionInfo *  m_Client;       // to synchronize from if no worker has it (can be null)
+        bool                    m_Connecting;   // connected to a worker, which will be asked for the files
+    };
+    WorkerBrokerage *       m_WorkerBrokerage;
+    Array< PeerSync >       m_PendingPeerSyncs; // protected by m_ToolManifestsMutex
+    Thread::ThreadHandle    m_PeerSyncThread;
+    Semaphore               m_PeerSyncSemaphore; // signalled when a toolchain is added to m_PendingPeerSyncs
+    uint16_t                m_PeerPort;
+    uint32_t                m_NumToolchainsFromPeers; // toolchains copied entirely from other workers
 };
 
 //------------------------------------------------------------------------------
@@ -5,7 +5,9 @@
 //------------------------------------------------------------------------------
 #include "Job.h"
 
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 
 #include "Core/Env/Assert.h"
@@ -20,6 +22,7 @@
 //------------------------------------------------------------------------------
 static uint32_t s_LastJobId( 0 );
 /*static*/ int64_t Job::s_TotalLocalDataMemoryUsage( 0 );
+/*static*/ int64_t Job::s_TotalCachePrefetchMemoryUsage( 0 );
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -46,6 +49,20 @@ Job::~Job()
         OwnData( nullptr, 0, false );
     }
 
+    // prefetched cache results are unused if the job was never built
+    if ( m_CachePrefetchData )
+    {
+        size_t dataSize;
+        void * data = TakeCachePrefetchData( dataSize );
+        FBuild::Get().GetCache()->FreeMemory( data, dataSize );
+    }
+
+    // streamed results are no longer needed once sent (or if they can't be)
+    for ( const AString & fileName : m_StreamedResultFiles )
+    {
+        FileIO::FileDelete( fileName.Get() );
+    }
+
     if ( m_IsLocal == false )
     {
         FDELETE m_Node;
@@ -93,6 +110,37 @@ void Job::OwnData( void * data, size_t size, bool compressed )
     }
 }
 
+// SetCachePrefetchResult
+//------------------------------------------------------------------------------
+void Job::SetCachePrefetchResult( CachePrefetchState state, void * data, size_t dataSize )
+{
+    ASSERT( m_CachePrefetchData == nullptr ); // Invalid to set more than once
+    ASSERT( ( state == CACHE_PREFETCH_HIT ) == ( data != nullptr ) );
+
+    m_CachePrefetchState = state;
+    m_CachePrefetchData = data;
+    m_CachePrefetchDataSize = dataSize;
+    if ( data )
+    {
+        AtomicAdd64( &s_TotalCachePrefetchMemoryUsage, (int64_t)dataSize );
+    }
+}
+
+// TakeCachePrefetchData
+//------------------------------------------------------------------------------
+void * Job::TakeCachePrefetchData( size_t & outDataSize )
+{
+    void * data = m_CachePrefetchData;
+    outDataSize = m_CachePrefetchDataSize;
+    if ( data )
+    {
+        AtomicSub64( &s_TotalCachePrefetchMemoryUsage, (int64_t)outDataSize );
+    }
+    m_CachePrefetchData = nullptr;
+    m_CachePrefetchDataSize = 0;
+    return data;
+}
+
 // Error
 //------------------------------------------------------------------------------
 void Job::Error( MSVC_SAL_PRINTF const char * format, ... )
@@ -145,12 +193,21 @@ void Job::SetMessages( const Array< AString > & messages )
     m_Messages = messages;
 }
 
-// Serialize
+// SerializeHeader
+//------------------------------------------------------------------------------
+void Job::SerializeHeader( IOStream & stream )
+{
+    SerializeHeader( stream, m_DataSize, IsDataCompressed() );
+}
+
+// SerializeHeader
 //------------------------------------------------------------------------------
-void Job::Serialize( IOStream & stream )
+void Job::SerializeHeader( IOStream & stream, size_t dataSize, bool dataCompressed )
 {
     PROFILE_FUNCTION
 
+    ASSERT( dataSize <= 0xFFFFFFFF ); // only 32bit data supported
+
     // write jobid
     stream.Write( m_JobId );
     stream.Write( m_Node->GetName() );
@@ -161,10 +218,10 @@ void Job::Serialize( IOStream & stream )
     // write properties of node
     Node::SaveRemote( stream, m_Node );
 
-    stream.Write( IsDataCompressed() );
+    stream.Write( dataCompressed );
 
-    stream.Write( m_DataSize );
-    stream.Write( m_Data, m_DataSize );
+    stream.Write( (uint32_t)dataSize );
+    // data follows (see Deserialize)
 }
 
 // Deserialize
@@ -244,4 +301,11 @@ void Job::GetMessagesForMonitorLog( AString & buffer ) const
     return (uint64_t)AtomicLoadRelaxed( &s_TotalLocalDataMemoryUsage );
 }
 
+// GetTotalCachePrefetchMemoryUsage
+//------------------------------------------------------------------------------
+/*static*/ uint64_t Job::GetTotalCachePrefetchMemoryUsage()
+{
+    return (uint64_t)AtomicLoadRelaxed( &s_TotalCachePrefetchMemoryUsage );
+}
+
 //------------------------------------------------------------------------------
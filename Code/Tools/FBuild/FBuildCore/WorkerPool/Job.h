@@ -7,6 +7,7 @@
 #include "Core/Env/MSVCStaticAnalysis.h"
 #include "Core/Env/Types.h"
 #include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -33,6 +34,18 @@ public:
     inline void SetCacheName( const AString & cacheName ) { m_CacheName = cacheName; }
     inline const AString & GetCacheName() const { return m_CacheName; }
 
+    // result of looking up the cache before the job is built (-cacheprefetch)
+    enum CachePrefetchState : uint8_t
+    {
+        CACHE_PREFETCH_NONE     = 0, // not prefetched - cache must be checked as normal
+        CACHE_PREFETCH_MISS     = 1, // not in the cache
+        CACHE_PREFETCH_EXISTS   = 2, // in the cache, but not retrieved (memory budget exceeded)
+        CACHE_PREFETCH_HIT      = 3, // retrieved (data is held by the job)
+    };
+    void                        SetCachePrefetchResult( CachePrefetchState state, void * data = nullptr, size_t dataSize = 0 );
+    inline CachePrefetchState   GetCachePrefetchState() const { return m_CachePrefetchState; }
+    void *                      TakeCachePrefetchData( size_t & outDataSize ); // caller must free with ICache::FreeMemory
+
     inline const volatile bool * GetAbortFlagPointer() const { return &m_Abort; }
     void Cancel();
 
@@ -48,9 +61,37 @@ public:
     inline void             SetToolManifest( ToolManifest * manifest )  { m_ToolManifest = manifest; }
     inline ToolManifest *   GetToolManifest() const                     { return m_ToolManifest; }
 
+    // worker thread which processed the job locally (0 if none)
+    inline void     SetWorkerThreadIndex( uint32_t index )  { m_WorkerThreadIndex = index; }
+    inline uint32_t GetWorkerThreadIndex() const            { return m_WorkerThreadIndex; }
+
+    // remote build timing, used to decide if racing locally is worthwhile
+    //  - expected time is from the history of the worker the job was sent to
+    //    (0 if unknown)
+    //  - only set with the JobQueue's distributed jobs lock held (see JobQueue::OnSentToRemote)
+    inline void     OnSentToRemote( uint32_t expectedTimeMS )   { m_RemoteTimer.Start(); m_ExpectedRemoteTimeMS = expectedTimeMS; }
+    inline uint32_t GetRemoteElapsedMS() const                  { return (uint32_t)m_RemoteTimer.GetElapsedMS(); }
+    inline uint32_t GetExpectedRemoteTimeMS() const             { return m_ExpectedRemoteTimeMS; }
+
+    // intrusive link for the list of completed jobs (see JobQueue)
+    inline void     SetNextCompletedJob( Job * job )    { m_NextCompletedJob = job; }
+    inline Job *    GetNextCompletedJob() const         { return m_NextCompletedJob; }
+
+    // position in the heap of the JobSubQueue holding the job (see JobQueueIndex)
+    inline void     SetQueueIndex( size_t index )   { m_QueueIndex = index; }
+    inline size_t   GetQueueIndex() const           { return m_QueueIndex; }
+
     inline bool     IsDataCompressed() const { return m_DataIsCompressed; }
     inline bool     IsLocal() const     { return m_IsLocal; }
 
+    // large results can be left on disk, to be streamed to the Client in chunks
+    // as they are read, instead of being read into the job's data
+    // (the files are deleted with the job)
+    inline void     SetResultStreamingAllowed( bool allowed )   { m_ResultStreamingAllowed = allowed; }
+    inline bool     IsResultStreamingAllowed() const            { return m_ResultStreamingAllowed; }
+    inline void                     SetStreamedResultFiles( Array< AString > && files ) { m_StreamedResultFiles = Move( files ); }
+    inline const Array< AString > & GetStreamedResultFiles() const                      { return m_StreamedResultFiles; }
+
     inline const Array< AString > & GetMessages() const { return m_Messages; }
 
     // logging interface
@@ -63,7 +104,9 @@ public:
     inline uint8_t GetSystemErrorCount() const { return m_SystemErrorCount; }
 
     // serialization for remote distribution
-    void Serialize( IOStream & stream );
+    // (SerializeHeader omits the data bytes, so they can be sent straight from GetData())
+    void SerializeHeader( IOStream & stream );
+    void SerializeHeader( IOStream & stream, size_t dataSize, bool dataCompressed ); // when sending data other than GetData()
     void Deserialize( IOStream & stream );
 
     void                GetMessagesForLog( AString & buffer ) const;
@@ -90,27 +133,39 @@ public:
 
     // Access total memory usage by job data
     static uint64_t             GetTotalLocalDataMemoryUsage();
+    static uint64_t             GetTotalCachePrefetchMemoryUsage();
 
 private:
     uint32_t            m_JobId             = 0;
     uint32_t            m_DataSize          = 0;
+    uint32_t            m_WorkerThreadIndex = 0;
+    uint32_t            m_ExpectedRemoteTimeMS = 0;
+    size_t              m_CachePrefetchDataSize = 0;
+    size_t              m_QueueIndex        = (size_t)-1;
+    void *              m_CachePrefetchData = nullptr;
     Node *              m_Node              = nullptr;
+    Job *               m_NextCompletedJob  = nullptr;
     void *              m_Data              = nullptr;
     void *              m_UserData          = nullptr;
     volatile bool       m_Abort             = false;
     bool                m_DataIsCompressed  = false;
     bool                m_IsLocal           = true;
+    bool                m_ResultStreamingAllowed = false;
     uint8_t             m_SystemErrorCount  = 0; // On client, the total error count, on the worker a flag for the current attempt
+    CachePrefetchState  m_CachePrefetchState = CACHE_PREFETCH_NONE;
     DistributionState   m_DistributionState = DIST_NONE;
     AString             m_RemoteName;
     AString             m_RemoteSourceRoot;
     AString             m_CacheName;
+    Timer               m_RemoteTimer;
 
     ToolManifest *      m_ToolManifest      = nullptr;
 
     Array< AString >    m_Messages;
+    Array< AString >    m_StreamedResultFiles;
 
     static int64_t s_TotalLocalDataMemoryUsage; // Total memory being managed by OwnData
+    static int64_t s_TotalCachePrefetchMemoryUsage; // Total memory held by prefetched cache results
 };
 
 //------------------------------------------------------------------------------
@@ -7,10 +7,14 @@
 #include "Job.h"
 #include "WorkerThread.h"
 
+#include "Tools/FBuild/FBuildCore/Cache/CachePrefetcher.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Graph/LinkerNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 
 #include "Core/Time/Timer.h"
 #include "Core/FileIO/FileIO.h"
@@ -18,22 +22,37 @@
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#define CACHE_PREFETCH_THREADS ( 4 ) // for calculating cache keys
+#define CACHE_PREFETCH_MAX_HELD_BYTES ( 256 * MEGABYTE ) // retrieved data not yet used by a job
+
 // JobCostSorter
 //------------------------------------------------------------------------------
-class JobCostSorter
+bool JobCostSorter::operator () ( const Job * job1, const Job * job2 ) const
 {
-public:
-    inline bool operator () ( const Job * job1, const Job * job2 ) const
-    {
-        return ( job1->GetNode()->GetRecursiveCost() < job2->GetNode()->GetRecursiveCost() );
-    }
-};
+    return ( job1->GetNode()->GetRecursiveCost() < job2->GetNode()->GetRecursiveCost() );
+}
+
+// JobQueueIndex::SetIndex
+//------------------------------------------------------------------------------
+void JobQueueIndex::SetIndex( Job * job, size_t index ) const
+{
+    job->SetQueueIndex( index );
+}
+
+// JobQueueIndex::GetIndex
+//------------------------------------------------------------------------------
+size_t JobQueueIndex::GetIndex( Job * job ) const
+{
+    return job->GetQueueIndex();
+}
 
 // JobSubQueue CONSTRUCTOR
 //------------------------------------------------------------------------------
 JobSubQueue::JobSubQueue()
     : m_Count( 0 )
-    , m_Jobs( 1024, true )
+    , m_Jobs( 1024 )
 {
 }
 
@@ -42,6 +61,12 @@ JobSubQueue::JobSubQueue()
 JobSubQueue::~JobSubQueue()
 {
     ASSERT( m_Jobs.IsEmpty() );
+    #if defined( ASSERTS_ENABLED )
+        for ( const Array< Job * > & blockedJobs : m_BlockedJobs )
+        {
+            ASSERT( blockedJobs.IsEmpty() );
+        }
+    #endif
     ASSERT( AtomicLoadRelaxed( &m_Count ) == 0 );
 }
 
@@ -64,29 +89,29 @@ void JobSubQueue::QueueJobs( Array< Node * > & nodes )
         jobs.Append( job );
     }
 
-    // Sort Jobs by cost
-    JobCostSorter sorter;
-    jobs.Sort( sorter );
-
-    // lock to add job
+    // lock to add jobs
+    //  - each insertion is O(log n) so there is no need to re-sort
+    //    everything already queued
     MutexHolder mh( m_Mutex );
-    const bool wasEmpty = m_Jobs.IsEmpty();
-
-    m_Jobs.Append( jobs );
-    AtomicAddU32( &m_Count, (int32_t)jobs.GetSize() );
-
-    if ( wasEmpty )
+    for ( Job * job : jobs )
     {
-        return; // skip re-sorting
+        m_Jobs.Push( job );
     }
+    AtomicAddU32( &m_Count, (int32_t)jobs.GetSize() );
+}
 
-    // sort merged lists
-    m_Jobs.Sort( sorter );
+// JobSubQueue:QueueJob
+//------------------------------------------------------------------------------
+void JobSubQueue::QueueJob( Job * job )
+{
+    MutexHolder mh( m_Mutex );
+    m_Jobs.Push( job );
+    AtomicIncU32( &m_Count );
 }
 
 // RemoveJob
 //------------------------------------------------------------------------------
-Job * JobSubQueue::RemoveJob()
+Job * JobSubQueue::RemoveJob( JobQueue * resourceOwner )
 {
     // lock-free early out if there are no jobs
     if ( AtomicLoadRelaxed( &m_Count ) == 0 )
@@ -97,36 +122,120 @@ Job * JobSubQueue::RemoveJob()
     // lock to remove job
     MutexHolder mh( m_Mutex );
 
+    Job * job = nullptr;
+    if ( ( resourceOwner == nullptr ) || ( resourceOwner->HasResourceLimits() == false ) )
+    {
+        if ( m_Jobs.IsEmpty() == false )
+        {
+            job = m_Jobs.Top();
+            m_Jobs.Pop();
+        }
+        else
+        {
+            // only blocked jobs remain (when draining the queue)
+            for ( Array< Job * > & blockedJobs : m_BlockedJobs )
+            {
+                if ( blockedJobs.IsEmpty() == false )
+                {
+                    job = blockedJobs.Top();
+                    blockedJobs.Pop();
+                    break;
+                }
+            }
+        }
+    }
+    else
+    {
+        // take the most expensive job which fits within the resource budgets,
+        // setting aside any that don't until the resource they need is released
+        while ( m_Jobs.IsEmpty() == false )
+        {
+            Job * candidate = m_Jobs.Top();
+            m_Jobs.Pop();
+            JobResource blockingResource;
+            if ( resourceOwner->AcquireJobResources( candidate->GetNode(), blockingResource ) )
+            {
+                job = candidate;
+                break;
+            }
+            m_BlockedJobs[ blockingResource ].Append( candidate );
+        }
+    }
+
     // possible that job has been removed between job count check and mutex lock
-    if ( m_Jobs.IsEmpty() )
+    // (or all jobs are waiting for resources)
+    if ( job == nullptr )
     {
         return nullptr;
     }
 
     VERIFY( AtomicDecU32( &m_Count ) != static_cast< uint32_t >( -1 ) );
 
-    Job * job = m_Jobs.Top();
-    m_Jobs.Pop();
-
     return job;
 }
 
+// UnblockJobs
+//------------------------------------------------------------------------------
+void JobSubQueue::UnblockJobs( JobResource resource )
+{
+    MutexHolder mh( m_Mutex );
+
+    // jobs waiting for the resource can be tried again
+    Array< Job * > & blockedJobs = m_BlockedJobs[ resource ];
+    for ( Job * job : blockedJobs )
+    {
+        m_Jobs.Push( job );
+    }
+    blockedJobs.Clear();
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-JobQueue::JobQueue( uint32_t numWorkerThreads ) :
+JobQueue::JobQueue( uint32_t numWorkerThreads, const SettingsNode * settings ) :
+    m_LocalJobs_NumStaged( 0 ),
+    m_LocalJobs_NextQueue( 0 ),
+    m_LocalJobs_Available( numWorkerThreads + 1, false ),
+    m_CachePrefetcher( nullptr ),
+    m_CachePrefetchJobs( 1024, true ),
+    m_CachePrefetchNextQueue( 0 ),
     m_NumLocalJobsActive( 0 ),
+    m_HasResourceLimits( false ),
+    m_LocalLinkJobLimit( settings ? settings->GetLocalLinkJobLimit() : 0 ),
+    m_LocalCopyJobLimit( settings ? settings->GetLocalCopyJobLimit() : 0 ),
+    m_LocalJobMemoryLimitMiB( settings ? settings->GetLocalJobMemoryLimitMiB() : 0 ),
+    m_LocalLinkJobsActive( 0 ),
+    m_LocalCopyJobsActive( 0 ),
+    m_LocalJobMemoryActiveMiB( 0 ),
+    m_LocalLinkJobsPeak( 0 ),
+    m_LocalCopyJobsPeak( 0 ),
+    m_LocalJobMemoryPeakMiB( 0 ),
     m_DistributableJobs_Available( 1024, true ),
     m_DistributableJobs_InProgress( 1024, true ),
+    m_RemoteJobsToCancel( 0, true ),
+    m_CompletedJobsHead( nullptr ),
+    m_CompletedJobsFailedHead( nullptr ),
     m_CompletedJobs( 1024, true ),
     m_CompletedJobsFailed( 1024, true ),
-    m_CompletedJobs2( 1024, true ),
-    m_CompletedJobsFailed2( 1024, true ),
     m_Workers( numWorkerThreads, false )
 {
     PROFILE_FUNCTION
 
     WorkerThread::InitTmpDir();
 
+    m_HasResourceLimits = ( ( m_LocalLinkJobLimit > 0 ) ||
+                            ( m_LocalCopyJobLimit > 0 ) ||
+                            ( m_LocalJobMemoryLimitMiB > 0 ) );
+
+    // a job queue for each thread (including the main thread, which only
+    // consumes jobs when there are no worker threads)
+    const uint32_t numQueues = ( numWorkerThreads + 1 );
+    m_LocalJobs_Staging.SetSize( numQueues );
+    for ( uint32_t i=0; i<numQueues; ++i )
+    {
+        m_LocalJobs_Staging[ i ].SetCapacity( 1024 );
+        m_LocalJobs_Available.Append( FNEW( JobSubQueue() ) );
+    }
+
     for ( uint32_t i=0; i<numWorkerThreads; ++i )
     {
         // identify each worker with an id starting from 1
@@ -136,19 +245,40 @@ JobQueue::JobQueue( uint32_t numWorkerThreads ) :
         wt->Init();
         m_Workers.Append( wt );
     }
+
+    m_LocalJobs_NextQueue = GetFirstLocalJobQueue();
+    m_CachePrefetchNextQueue = GetFirstLocalJobQueue();
+
+    // look up objects in the cache before they are built
+    // (only with worker threads, as the main thread would wait on itself)
+    if ( ( numWorkerThreads > 0 ) &&
+         FBuild::IsValid() &&
+         FBuild::Get().GetOptions().m_CachePrefetch &&
+         FBuild::Get().GetOptions().m_UseCacheRead &&
+         FBuild::Get().GetCache() )
+    {
+        m_CachePrefetcher = FNEW( CachePrefetcher( *this, FBuild::Get().GetCache(), CACHE_PREFETCH_THREADS, CACHE_PREFETCH_MAX_HELD_BYTES ) );
+    }
 }
 
 // DESTRUCTOR
 //------------------------------------------------------------------------------
 JobQueue::~JobQueue()
 {
+    // jobs still being prefetched are returned to the queues, to be deleted below
+    FDELETE m_CachePrefetcher;
+    m_CachePrefetcher = nullptr;
+
     // signal all workers to stop - ok if this has already been done
     SignalStopWorkers();
 
     // delete incomplete jobs
-    while ( Job * job = m_LocalJobs_Available.RemoveJob() )
+    for ( JobSubQueue * queue : m_LocalJobs_Available )
     {
-        FDELETE job;
+        while ( Job * job = queue->RemoveJob() )
+        {
+            FDELETE job;
+        }
     }
 
     // wait for workers to finish - ok if they stopped before this
@@ -158,6 +288,10 @@ JobQueue::~JobQueue()
         m_Workers[ i ]->WaitForStop();
         FDELETE m_Workers[ i ];
     }
+    for ( JobSubQueue * queue : m_LocalJobs_Available )
+    {
+        FDELETE queue;
+    }
 
     // free locally available distributed jobs
     {
@@ -172,9 +306,12 @@ JobQueue::~JobQueue()
         m_DistributableJobs_Available.Clear();
     }
 
-    ASSERT( m_CompletedJobs.IsEmpty() );
-    ASSERT( m_CompletedJobsFailed.IsEmpty() );
+    ASSERT( m_CompletedJobsHead == nullptr );
+    ASSERT( m_CompletedJobsFailedHead == nullptr );
     ASSERT( Job::GetTotalLocalDataMemoryUsage() == 0 );
+    ASSERT( m_LocalLinkJobsActive == 0 );
+    ASSERT( m_LocalCopyJobsActive == 0 );
+    ASSERT( m_LocalJobMemoryActiveMiB == 0 );
 }
 
 // SignalStopWorkers (Main Thread)
@@ -224,7 +361,11 @@ void JobQueue::GetJobStats( uint32_t & numJobs,
 {
     MutexHolder m( m_DistributedJobsMutex );
 
-    numJobs = m_LocalJobs_Available.GetCount();
+    numJobs = 0;
+    for ( const JobSubQueue * queue : m_LocalJobs_Available )
+    {
+        numJobs += queue->GetCount();
+    }
     numJobsDist = (uint32_t)m_DistributableJobs_Available.GetSize();
     numJobsActive = AtomicLoadRelaxed( &m_NumLocalJobsActive );
     numJobsDistActive = (uint32_t)m_DistributableJobs_InProgress.GetSize();
@@ -253,21 +394,128 @@ void JobQueue::AddJobToBatch( Node * node )
         return;
     }
 
-    m_LocalJobs_Staging.Append( node );
+    StageJob( node );
+}
+
+// AddDynamicDependenciesJobToBatch (Main Thread)
+//------------------------------------------------------------------------------
+void JobQueue::AddDynamicDependenciesJobToBatch( Node * node )
+{
+    ASSERT( node->GetState() == Node::STATIC_DEPS_READY );
+    ASSERT( node->GetControlFlags() & Node::FLAG_ASYNC_DYNAMIC_DEPS );
+
+    // mark as building (the job will be finalized by NodeGraph::FinishDynamicDependencies)
+    node->SetState( Node::BUILDING );
+    node->m_PreparingDynamicDependencies = true;
+
+    StageJob( node );
+}
+
+// StageJob (Main Thread)
+//------------------------------------------------------------------------------
+void JobQueue::StageJob( Node * node )
+{
+    // Jobs unblocked by a worker's own completion go to that worker's queue
+    // for locality. Others are spread across the queues.
+    const uint32_t numQueues = (uint32_t)m_LocalJobs_Available.GetSize();
+    uint32_t queueIndex = node->m_PreferredWorkerThread;
+    node->m_PreferredWorkerThread = 0;
+    if ( ( queueIndex < GetFirstLocalJobQueue() ) || ( queueIndex >= numQueues ) )
+    {
+        queueIndex = m_LocalJobs_NextQueue;
+        m_LocalJobs_NextQueue = ( ( queueIndex + 1 ) < numQueues ) ? ( queueIndex + 1 ) : GetFirstLocalJobQueue();
+    }
+
+    m_LocalJobs_Staging[ queueIndex ].Append( node );
+    ++m_LocalJobs_NumStaged;
 }
 
 // FlushJobBatch (Main Thread)
 //------------------------------------------------------------------------------
 void JobQueue::FlushJobBatch()
 {
-    if ( m_LocalJobs_Staging.IsEmpty() )
+    if ( m_LocalJobs_NumStaged == 0 )
     {
         return;
     }
 
-    m_LocalJobs_Available.QueueJobs( m_LocalJobs_Staging );
-    m_WorkerThreadSemaphore.Signal( (uint32_t)m_LocalJobs_Staging.GetSize() );
-    m_LocalJobs_Staging.Clear();
+    uint32_t numQueued = 0;
+    const size_t numQueues = m_LocalJobs_Available.GetSize();
+    for ( size_t i=0; i<numQueues; ++i )
+    {
+        Array< Node * > & staging = m_LocalJobs_Staging[ i ];
+
+        // objects which can be looked up in the cache ahead of time go via
+        // the prefetcher, which will queue them when done
+        if ( m_CachePrefetcher )
+        {
+            size_t numKept = 0;
+            for ( Node * node : staging )
+            {
+                if ( CanPrefetchFromCache( node ) )
+                {
+                    m_CachePrefetchJobs.Append( FNEW( Job( node ) ) );
+                }
+                else
+                {
+                    staging[ numKept++ ] = node;
+                }
+            }
+            staging.SetSize( numKept );
+        }
+
+        if ( staging.IsEmpty() == false )
+        {
+            numQueued += (uint32_t)staging.GetSize();
+            m_LocalJobs_Available[ i ]->QueueJobs( staging );
+            staging.Clear();
+        }
+    }
+    if ( m_CachePrefetcher )
+    {
+        m_CachePrefetcher->QueueJobs( m_CachePrefetchJobs );
+    }
+    if ( numQueued > 0 )
+    {
+        m_WorkerThreadSemaphore.Signal( numQueued );
+    }
+    m_LocalJobs_NumStaged = 0;
+}
+
+// QueuePrefetchedJobs (Prefetch Thread)
+//------------------------------------------------------------------------------
+void JobQueue::QueuePrefetchedJobs( Job * const * jobs, size_t numJobs )
+{
+    if ( numJobs == 0 )
+    {
+        return;
+    }
+
+    // Spread across the queues (the preferred worker was lost when prefetched)
+    const uint32_t numQueues = (uint32_t)m_LocalJobs_Available.GetSize();
+    for ( size_t i = 0; i < numJobs; ++i )
+    {
+        m_LocalJobs_Available[ m_CachePrefetchNextQueue ]->QueueJob( jobs[ i ] );
+        m_CachePrefetchNextQueue = ( ( m_CachePrefetchNextQueue + 1 ) < numQueues ) ? ( m_CachePrefetchNextQueue + 1 ) : GetFirstLocalJobQueue();
+    }
+    m_WorkerThreadSemaphore.Signal( (uint32_t)numJobs );
+}
+
+// CanPrefetchFromCache
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueue::CanPrefetchFromCache( const Node * node )
+{
+    return ( node->GetType() == Node::OBJECT_NODE ) &&
+           ( node->m_PreparingDynamicDependencies == false ) &&
+           node->CastTo< ObjectNode >()->CanPrefetchFromCache();
+}
+
+// GetFirstLocalJobQueue
+//------------------------------------------------------------------------------
+uint32_t JobQueue::GetFirstLocalJobQueue() const
+{
+    // The main thread (queue 0) only consumes jobs if there are no workers
+    return m_Workers.IsEmpty() ? 0 : 1;
 }
 
 // QueueDistributableJob
@@ -287,10 +535,178 @@ void JobQueue::QueueDistributableJob( Job * job )
 
     ASSERT( m_NumLocalJobsActive > 0 );
     AtomicDecU32( &m_NumLocalJobsActive ); // job converts from active to pending remote
+    ReleaseJobResources( job->GetNode() );
 
     m_WorkerThreadSemaphore.Signal();
 }
 
+// GetJobResources
+//------------------------------------------------------------------------------
+/*static*/ void JobQueue::GetJobResources( const Node * node, uint32_t & outLinkSlots, uint32_t & outCopySlots, uint32_t & outMemoryMiB )
+{
+    outLinkSlots = 0;
+    outCopySlots = 0;
+    outMemoryMiB = 0;
+
+    // Preparing dynamic dependencies only expands inputs (such as the ObjectList
+    // of a Library), so it shouldn't wait behind real links. The flag is cleared
+    // on the main thread after the resources are released, so both agree.
+    if ( node->m_PreparingDynamicDependencies )
+    {
+        return;
+    }
+
+    switch ( node->GetType() )
+    {
+        case Node::OBJECT_NODE:
+        {
+            outMemoryMiB = node->CastTo< ObjectNode >()->GetCompilerJobMemoryMiB();
+            break;
+        }
+        case Node::EXE_NODE:
+        case Node::DLL_NODE:
+        {
+            outLinkSlots = 1;
+            outMemoryMiB = static_cast< const LinkerNode * >( node )->GetLinkerJobMemoryMiB(); // ExeNode or DLLNode
+            break;
+        }
+        case Node::LIBRARY_NODE:
+        {
+            outLinkSlots = 1; // librarian is as I/O heavy as a linker
+            break;
+        }
+        case Node::COPY_FILE_NODE:
+        {
+            outCopySlots = 1;
+            break;
+        }
+        default: break;
+    }
+}
+
+// AcquireResource
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueue::AcquireResource( volatile uint32_t * active, volatile uint32_t * peak, uint32_t amount, uint32_t limit )
+{
+    if ( ( amount == 0 ) || ( limit == 0 ) )
+    {
+        return true; // not used or unlimited
+    }
+
+    // Optimistically take the resource and undo if over budget. A job is
+    // always allowed if nothing else is using the resource, so a job larger
+    // than the entire budget can't stall the build.
+    const uint32_t newTotal = AtomicAddU32( active, (int32_t)amount );
+    if ( ( newTotal > limit ) && ( newTotal != amount ) )
+    {
+        AtomicSubU32( active, (int32_t)amount );
+        return false;
+    }
+
+    // track the most used at once
+    uint32_t oldPeak = AtomicLoadRelaxed( peak );
+    while ( newTotal > oldPeak )
+    {
+        const uint32_t prevPeak = AtomicCompareExchange( peak, newTotal, oldPeak );
+        if ( prevPeak == oldPeak )
+        {
+            break;
+        }
+        oldPeak = prevPeak;
+    }
+    return true;
+}
+
+// ReleaseResource
+//------------------------------------------------------------------------------
+/*static*/ void JobQueue::ReleaseResource( volatile uint32_t * active, uint32_t amount, uint32_t limit )
+{
+    if ( ( amount == 0 ) || ( limit == 0 ) )
+    {
+        return; // not tracked
+    }
+    ASSERT( AtomicLoadRelaxed( active ) >= amount );
+    AtomicSubU32( active, (int32_t)amount );
+}
+
+// AcquireJobResources
+//------------------------------------------------------------------------------
+bool JobQueue::AcquireJobResources( const Node * node, JobResource & outBlockingResource )
+{
+    uint32_t linkSlots, copySlots, memoryMiB;
+    GetJobResources( node, linkSlots, copySlots, memoryMiB );
+
+    if ( AcquireResource( &m_LocalLinkJobsActive, &m_LocalLinkJobsPeak, linkSlots, m_LocalLinkJobLimit ) == false )
+    {
+        outBlockingResource = JOB_RESOURCE_LINK_SLOTS;
+        return false;
+    }
+    if ( AcquireResource( &m_LocalCopyJobsActive, &m_LocalCopyJobsPeak, copySlots, m_LocalCopyJobLimit ) == false )
+    {
+        ReleaseResource( &m_LocalLinkJobsActive, linkSlots, m_LocalLinkJobLimit );
+        outBlockingResource = JOB_RESOURCE_COPY_SLOTS;
+        return false;
+    }
+    if ( AcquireResource( &m_LocalJobMemoryActiveMiB, &m_LocalJobMemoryPeakMiB, memoryMiB, m_LocalJobMemoryLimitMiB ) == false )
+    {
+        ReleaseResource( &m_LocalLinkJobsActive, linkSlots, m_LocalLinkJobLimit );
+        ReleaseResource( &m_LocalCopyJobsActive, copySlots, m_LocalCopyJobLimit );
+        outBlockingResource = JOB_RESOURCE_MEMORY;
+        return false;
+    }
+    return true;
+}
+
+// ReleaseJobResources
+//------------------------------------------------------------------------------
+void JobQueue::ReleaseJobResources( const Node * node )
+{
+    if ( m_HasResourceLimits == false )
+    {
+        return;
+    }
+
+    uint32_t linkSlots, copySlots, memoryMiB;
+    GetJobResources( node, linkSlots, copySlots, memoryMiB );
+    ReleaseResource( &m_LocalLinkJobsActive, linkSlots, m_LocalLinkJobLimit );
+    ReleaseResource( &m_LocalCopyJobsActive, copySlots, m_LocalCopyJobLimit );
+    ReleaseResource( &m_LocalJobMemoryActiveMiB, memoryMiB, m_LocalJobMemoryLimitMiB );
+
+    // jobs may have been blocked waiting for these resources
+    //  - this must happen after the release, so a job blocked concurrently
+    //    is either unblocked here or will see the released resource
+    bool unblocked = false;
+    if ( ( linkSlots > 0 ) && ( m_LocalLinkJobLimit > 0 ) )
+    {
+        UnblockJobs( JOB_RESOURCE_LINK_SLOTS );
+        unblocked = true;
+    }
+    if ( ( copySlots > 0 ) && ( m_LocalCopyJobLimit > 0 ) )
+    {
+        UnblockJobs( JOB_RESOURCE_COPY_SLOTS );
+        unblocked = true;
+    }
+    if ( ( memoryMiB > 0 ) && ( m_LocalJobMemoryLimitMiB > 0 ) )
+    {
+        UnblockJobs( JOB_RESOURCE_MEMORY );
+        unblocked = true;
+    }
+    if ( unblocked )
+    {
+        m_WorkerThreadSemaphore.Signal();
+    }
+}
+
+// UnblockJobs
+//------------------------------------------------------------------------------
+void JobQueue::UnblockJobs( JobResource resource )
+{
+    for ( JobSubQueue * queue : m_LocalJobs_Available )
+    {
+        queue->UnblockJobs( resource );
+    }
+}
+
 // GetDistributableJobToProcess
 //------------------------------------------------------------------------------
 Job * JobQueue::GetDistributableJobToProcess( bool remote )
@@ -302,22 +718,55 @@ Job * JobQueue::GetDistributableJobToProcess( bool remote )
         return nullptr;
     }
 
-    // building jobs in the order they are queued
-    Job * job = m_DistributableJobs_Available[ 0 ];
-    m_DistributableJobs_Available.PopFront();
+    // building jobs in the order they are queued, or most critical first
+    size_t jobIndex = 0;
+    if ( FBuild::Get().GetOptions().m_CriticalPathScheduling )
+    {
+        JobCostSorter sorter;
+        const size_t numJobs = m_DistributableJobs_Available.GetSize();
+        for ( size_t i = 1; i < numJobs; ++i )
+        {
+            if ( sorter( m_DistributableJobs_Available[ jobIndex ], m_DistributableJobs_Available[ i ] ) )
+            {
+                jobIndex = i;
+            }
+        }
+    }
+    Job * job = m_DistributableJobs_Available[ jobIndex ];
+    m_DistributableJobs_Available.EraseIndex( jobIndex );
 
     ASSERT( job->GetDistributionState() == Job::DIST_AVAILABLE );
 
     // Tag job as in-use
     job->SetDistributionState( remote ? Job::DIST_BUILDING_REMOTELY : Job::DIST_BUILDING_LOCALLY );
     m_DistributableJobs_InProgress.Append( job );
+
+    // start timing now, as the job can be raced before it is sent
+    if ( remote )
+    {
+        job->OnSentToRemote( 0 );
+    }
     return job;
 }
 
+// OnSentToRemote
+//------------------------------------------------------------------------------
+void JobQueue::OnSentToRemote( Job * job, uint32_t expectedTimeMS )
+{
+    // remote timing is read by GetDistributableJobToRaceAdaptive
+    MutexHolder m( m_DistributedJobsMutex );
+    job->OnSentToRemote( expectedTimeMS );
+}
+
 // GetDistributableJobToRace
 //------------------------------------------------------------------------------
 Job * JobQueue::GetDistributableJobToRace()
 {
+    if ( FBuild::Get().GetOptions().m_AdaptiveLocalRace )
+    {
+        return GetDistributableJobToRaceAdaptive();
+    }
+
     MutexHolder m( m_DistributedJobsMutex );
     if ( m_DistributableJobs_InProgress.IsEmpty() )
     {
@@ -343,6 +792,64 @@ Job * JobQueue::GetDistributableJobToRace()
     return nullptr; // No job found to race (all were local or races already)
 }
 
+// GetDistributableJobToRaceAdaptive
+//------------------------------------------------------------------------------
+Job * JobQueue::GetDistributableJobToRaceAdaptive()
+{
+    // Fallback estimate for jobs we have no history for
+    const uint32_t typicalLocalMS = m_LocalCompileTimes.GetPercentile( 0.5f );
+
+    MutexHolder m( m_DistributedJobsMutex );
+
+    // Race the job expected to gain the most, if any
+    Job * bestJob = nullptr;
+    uint32_t bestBenefitMS = 0;
+    for ( Job * job : m_DistributableJobs_InProgress )
+    {
+        // Don't Race jobs already building locally
+        if ( job->GetDistributionState() != Job::DIST_BUILDING_REMOTELY )
+        {
+            continue;
+        }
+
+        const uint32_t lastBuildTimeMS = job->GetNode()->GetLastBuildTime();
+        const uint32_t localEstimateMS = lastBuildTimeMS ? lastBuildTimeMS : typicalLocalMS;
+        const uint32_t benefitMS = GetLocalRaceBenefitMS( job->GetExpectedRemoteTimeMS(),
+                                                          job->GetRemoteElapsedMS(),
+                                                          localEstimateMS );
+        if ( benefitMS > bestBenefitMS )
+        {
+            bestJob = job;
+            bestBenefitMS = benefitMS;
+        }
+    }
+
+    if ( bestJob )
+    {
+        bestJob->SetDistributionState( Job::DIST_RACING );
+    }
+    return bestJob;
+}
+
+// GetLocalRaceBenefitMS
+//------------------------------------------------------------------------------
+/*static*/ uint32_t JobQueue::GetLocalRaceBenefitMS( uint32_t expectedRemoteMS, uint32_t elapsedRemoteMS, uint32_t localEstimateMS )
+{
+    // How much longer will the remote job take?
+    //  - If we don't know, or it's already taking longer than expected, assume
+    //    it will take about as long again as it has taken so far
+    const uint32_t remainingRemoteMS = ( elapsedRemoteMS < expectedRemoteMS ) ? ( expectedRemoteMS - elapsedRemoteMS )
+                                                                              : elapsedRemoteMS;
+
+    // With no local history, race anything (as with non-adaptive racing)
+    if ( localEstimateMS == 0 )
+    {
+        return ( remainingRemoteMS + 1 );
+    }
+
+    return ( remainingRemoteMS > localEstimateMS ) ? ( remainingRemoteMS - localEstimateMS ) : 0;
+}
+
 // OnReturnRemoteJob
 //------------------------------------------------------------------------------
 Job * JobQueue::OnReturnRemoteJob( uint32_t jobId )
@@ -460,22 +967,37 @@ void JobQueue::ReturnUnfinishedDistributableJob( Job * job )
     m_WorkerThreadSemaphore.Signal();
 }
 
+// TakeRemoteJobsToCancel
+//------------------------------------------------------------------------------
+void JobQueue::TakeRemoteJobsToCancel( Array< uint32_t > & outJobIds )
+{
+    MutexHolder m( m_DistributedJobsMutex );
+    outJobIds.Swap( m_RemoteJobsToCancel );
+}
+
 // FinalizeCompletedJobs (Main Thread)
 //------------------------------------------------------------------------------
 void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
 {
     PROFILE_FUNCTION
 
-    {
-        MutexHolder m( m_CompletedJobsMutex );
-        m_CompletedJobs2.Swap( m_CompletedJobs );
-        m_CompletedJobsFailed2.Swap( m_CompletedJobsFailed );
-    }
+    TakeCompletedJobs( &m_CompletedJobsHead, m_CompletedJobs );
+    TakeCompletedJobs( &m_CompletedJobsFailedHead, m_CompletedJobsFailed );
 
     // completed jobs
-    for ( Job * job : m_CompletedJobs2 )
+    for ( Job * job : m_CompletedJobs )
     {
         Node * n = job->GetNode();
+
+        // prepared dynamic dependencies are merged into the graph
+        if ( n->m_PreparingDynamicDependencies )
+        {
+            nodeGraph.FinishDynamicDependencies( n, true, job->GetWorkerThreadIndex() );
+            FDELETE job;
+            continue;
+        }
+
+        FBuild::Get().GetFileStampTable().OnNodeBuilt( n );
         if ( n->Finalize( nodeGraph ) )
         {
             n->SetState( Node::UP_TO_DATE );
@@ -484,6 +1006,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
         {
             n->SetState( Node::FAILED );
         }
+        nodeGraph.ReleaseDependents( n, job->GetWorkerThreadIndex() );
 
         // Free normal jobs
         if ( job->GetDistributionState() == Job::DIST_NONE )
@@ -510,17 +1033,27 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
             // Local race, won locally
             ASSERT( distState == Job::DIST_RACING );
             job->SetDistributionState( Job::DIST_RACE_WON_LOCALLY );
+            m_RemoteJobsToCancel.Append( job->GetJobId() );
 
             // We can't delete the job yet, because it's still in use by the remote
-            // job. It will be freed when the remote job completes
+            // job. It will be freed when the remote job completes (or is cancelled)
         }
     }
-    m_CompletedJobs2.Clear();
+    m_CompletedJobs.Clear();
 
     // failed jobs
-    for ( Job * job : m_CompletedJobsFailed2 )
+    for ( Job * job : m_CompletedJobsFailed )
     {
+        if ( job->GetNode()->m_PreparingDynamicDependencies )
+        {
+            nodeGraph.FinishDynamicDependencies( job->GetNode(), false, job->GetWorkerThreadIndex() );
+            FDELETE job;
+            continue;
+        }
+
+        FBuild::Get().GetFileStampTable().OnNodeBuilt( job->GetNode() );
         job->GetNode()->SetState( Node::FAILED );
+        nodeGraph.ReleaseDependents( job->GetNode(), job->GetWorkerThreadIndex() );
 
         // Free normal jobs
         if ( job->GetDistributionState() == Job::DIST_NONE )
@@ -547,12 +1080,57 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
             // Local race, won locally
             ASSERT( distState == Job::DIST_RACING );
             job->SetDistributionState( Job::DIST_RACE_WON_LOCALLY );
+            m_RemoteJobsToCancel.Append( job->GetJobId() );
 
             // We can't delete the job yet, because it's still in use by the remote
-            // job. It will be freed when the remote job completes
+            // job. It will be freed when the remote job completes (or is cancelled)
+        }
+    }
+    m_CompletedJobsFailed.Clear();
+}
+
+// PushCompletedJob
+//  - returns true if the list was previously empty
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueue::PushCompletedJob( Job * volatile * head, Job * job )
+{
+    Job * oldHead = AtomicLoadRelaxed( head );
+    for ( ;; )
+    {
+        job->SetNextCompletedJob( oldHead );
+        Job * prevHead = AtomicCompareExchange( head, job, oldHead );
+        if ( prevHead == oldHead )
+        {
+            return ( oldHead == nullptr );
         }
+        oldHead = prevHead; // another thread pushed a job - try again
+    }
+}
+
+// TakeCompletedJobs (Main Thread)
+//------------------------------------------------------------------------------
+/*static*/ void JobQueue::TakeCompletedJobs( Job * volatile * head, Array< Job * > & outJobs )
+{
+    ASSERT( outJobs.IsEmpty() );
+
+    // take the entire list, leaving it empty for the workers
+    Job * job = AtomicExchange( head, (Job *)nullptr );
+    while ( job )
+    {
+        outJobs.Append( job );
+        Job * next = job->GetNextCompletedJob();
+        job->SetNextCompletedJob( nullptr );
+        job = next;
+    }
+
+    // list is most recent first, so restore the order of completion
+    const size_t numJobs = outJobs.GetSize();
+    for ( size_t i = 0; i < ( numJobs / 2 ); ++i )
+    {
+        Job * tmp = outJobs[ i ];
+        outJobs[ i ] = outJobs[ numJobs - 1 - i ];
+        outJobs[ numJobs - 1 - i ] = tmp;
     }
-    m_CompletedJobsFailed2.Clear();
 }
 
 // MainThreadWait
@@ -576,11 +1154,19 @@ void JobQueue::WorkerThreadWait( uint32_t maxWaitMS )
 //------------------------------------------------------------------------------
 Job * JobQueue::GetJobToProcess()
 {
-    Job * job = m_LocalJobs_Available.RemoveJob();
-    if ( job )
+    // Take from our own queue first, then try to steal from the others
+    const uint32_t numQueues = (uint32_t)m_LocalJobs_Available.GetSize();
+    const uint32_t threadIndex = WorkerThread::GetThreadIndex();
+    const uint32_t ownQueue = ( threadIndex < numQueues ) ? threadIndex : 0;
+    for ( uint32_t i=0; i<numQueues; ++i )
     {
-        AtomicIncU32( &m_NumLocalJobsActive );
-        return job;
+        const uint32_t queueIndex = ( ( ownQueue + i ) % numQueues );
+        Job * job = m_LocalJobs_Available[ queueIndex ]->RemoveJob( this );
+        if ( job )
+        {
+            AtomicIncU32( &m_NumLocalJobsActive );
+            return job;
+        }
     }
 
     return nullptr;
@@ -592,6 +1178,9 @@ void JobQueue::FinishedProcessingJob( Job * job, bool success, bool wasARemoteJo
 {
     ASSERT( job->GetNode()->GetState() == Node::BUILDING );
 
+    // note which thread did the work, so dependent jobs can prefer it
+    job->SetWorkerThreadIndex( WorkerThread::GetThreadIndex() );
+
     if ( wasARemoteJob )
     {
         MutexHolder mh( m_DistributedJobsMutex );
@@ -648,22 +1237,16 @@ void JobQueue::FinishedProcessingJob( Job * job, bool success, bool wasARemoteJo
     {
         ASSERT( m_NumLocalJobsActive > 0 );
         AtomicDecU32( &m_NumLocalJobsActive );
+        ReleaseJobResources( job->GetNode() );
     }
 
+    // Wake main thread to process completed jobs, but only if the list was
+    // empty (the main thread takes all completed jobs at once, so it's already
+    // due to process any others)
+    if ( PushCompletedJob( success ? &m_CompletedJobsHead : &m_CompletedJobsFailedHead, job ) )
     {
-        MutexHolder m( m_CompletedJobsMutex );
-        if ( success )
-        {
-            m_CompletedJobs.Append( job );
-        }
-        else
-        {
-            m_CompletedJobsFailed.Append( job );
-        }
+        WakeMainThread();
     }
-
-    // Wake main thread to process completed jobs
-    WakeMainThread();
 }
 
 // DoBuild
@@ -674,6 +1257,15 @@ void JobQueue::FinishedProcessingJob( Job * job, bool success, bool wasARemoteJo
 
     Node * node = job->GetNode();
 
+    // preparing dynamic dependencies, rather than building?
+    if ( node->m_PreparingDynamicDependencies )
+    {
+        PROFILE_SECTION( "DynamicDeps" );
+        const bool prepared = node->PrepareDynamicDependencies( job );
+        node->AddProcessingTime( uint32_t( timer.GetElapsedMS() ) );
+        return prepared ? Node::NODE_RESULT_OK : Node::NODE_RESULT_FAILED;
+    }
+
     bool nodeRelevantToMonitorLog = false;
 
     const AString & nodeName = job->GetNode()->GetName();
@@ -729,6 +1321,12 @@ void JobQueue::FinishedProcessingJob( Job * job, bool success, bool wasARemoteJo
         // does not represent how long it takes to create this resource)
         node->SetLastBuildTime( timeTakenMS );
         node->SetStatFlag( Node::STATS_BUILT );
+
+        // track local build times of distributable jobs to decide when racing is worthwhile
+        if ( job->GetDistributionState() != Job::DIST_NONE )
+        {
+            JobQueue::Get().m_LocalCompileTimes.Record( timeTakenMS );
+        }
         FLOG_INFO( "-Build: %u ms\t%s", timeTakenMS, node->GetName().Get() );
     }
 
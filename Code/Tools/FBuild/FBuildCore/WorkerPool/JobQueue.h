@@ -5,18 +5,51 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Core/Containers/Array.h"
+#include "Core/Containers/PriorityQueue.h"
 #include "Core/Containers/Singleton.h"
 
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Helpers/LatencyHistogram.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/Semaphore.h"
 #include "Core/Process/Mutex.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CachePrefetcher;
 class Node;
 class Job;
+class JobQueue;
+class SettingsNode;
 class WorkerThread;
 
+// JobCostSorter
+//------------------------------------------------------------------------------
+class JobCostSorter
+{
+public:
+    bool operator () ( const Job * job1, const Job * job2 ) const;
+};
+
+// JobQueueIndex - tracks the position of each Job in a JobSubQueue's heap
+//------------------------------------------------------------------------------
+class JobQueueIndex
+{
+public:
+    void    SetIndex( Job * job, size_t index ) const;
+    size_t  GetIndex( Job * job ) const;
+};
+
+// JobResource - local resources which jobs can be limited by (see Settings)
+//------------------------------------------------------------------------------
+enum JobResource : uint32_t
+{
+    JOB_RESOURCE_LINK_SLOTS,
+    JOB_RESOURCE_COPY_SLOTS,
+    JOB_RESOURCE_MEMORY,
+
+    NUM_JOB_RESOURCES
+};
 
 // JobSubQueue
 //------------------------------------------------------------------------------
@@ -31,12 +64,20 @@ public:
     // jobs pushed by the main thread
     void QueueJobs( Array< Node * > & nodes );
 
+    // jobs pushed by the CachePrefetcher
+    void QueueJob( Job * job );
+
     // jobs consumed by workers
-    Job * RemoveJob();
+    //  - if a JobQueue is provided, jobs which would exceed one of its local
+    //    resource budgets are set aside (but remain queued) until UnblockJobs
+    //    is called for that resource
+    Job * RemoveJob( JobQueue * resourceOwner = nullptr );
+    void  UnblockJobs( JobResource resource );
 private:
-    uint32_t    m_Count;    // access the current count
+    uint32_t    m_Count;    // access the current count (including blocked jobs)
     Mutex       m_Mutex;    // lock to add/remove jobs
-    Array< Job * > m_Jobs;  // Sorted, most expensive at end
+    PriorityQueue< Job *, JobCostSorter, JobQueueIndex > m_Jobs; // Heap, most expensive at top
+    Array< Job * > m_BlockedJobs[ NUM_JOB_RESOURCES ]; // Jobs waiting for a resource (protected by m_Mutex)
 };
 
 // JobQueue
@@ -44,12 +85,13 @@ private:
 class JobQueue : public Singleton< JobQueue >
 {
 public:
-    explicit JobQueue( uint32_t numWorkerThreads );
+    explicit JobQueue( uint32_t numWorkerThreads, const SettingsNode * settings = nullptr );
     ~JobQueue();
 
     // main thread calls these
     void AddJobToBatch( Node * node );  // Add new job to the staging queue
-    void FlushJobBatch();               // Sort and flush the staging queue
+    void AddDynamicDependenciesJobToBatch( Node * node ); // Add job to PrepareDynamicDependencies
+    void FlushJobBatch();               // Flush the staging queues
     void FinalizeCompletedJobs( NodeGraph & nodeGraph );
     void MainThreadWait( uint32_t maxWaitMS );
 
@@ -66,50 +108,109 @@ public:
     void GetJobStats( uint32_t & numJobs, uint32_t & numJobsActive,
                       uint32_t & numJobsDist, uint32_t & numJobsDistActive ) const;
 
+    // Expected time saved by racing a remote job locally (0 if not worthwhile)
+    static uint32_t GetLocalRaceBenefitMS( uint32_t expectedRemoteMS, uint32_t elapsedRemoteMS, uint32_t localEstimateMS );
+
+    // cache lookups done before jobs are queued (-cacheprefetch) - may be null
+    inline const CachePrefetcher * GetCachePrefetcher() const { return m_CachePrefetcher; }
+
+    // most of each local resource in use at once (0 if the resource is unlimited)
+    inline uint32_t GetLocalLinkJobsPeak() const        { return AtomicLoadRelaxed( &m_LocalLinkJobsPeak ); }
+    inline uint32_t GetLocalCopyJobsPeak() const        { return AtomicLoadRelaxed( &m_LocalCopyJobsPeak ); }
+    inline uint32_t GetLocalJobMemoryPeakMiB() const    { return AtomicLoadRelaxed( &m_LocalJobMemoryPeakMiB ); }
+
 private:
     // worker threads call these
     friend class WorkerThread;
     void        WorkerThreadWait( uint32_t maxWaitMS );
     Job *       GetJobToProcess();
     Job *       GetDistributableJobToRace();
+    Job *       GetDistributableJobToRaceAdaptive();
     static Node::BuildResult DoBuild( Job * job );
     void        FinishedProcessingJob( Job * job, bool result, bool wasARemoteJob );
 
     void        QueueDistributableJob( Job * job );
 
+    // CachePrefetcher calls this once jobs have been looked up
+    friend class CachePrefetcher;
+    void        QueuePrefetchedJobs( Job * const * jobs, size_t numJobs );
+    static bool CanPrefetchFromCache( const Node * node );
+
+    uint32_t    GetFirstLocalJobQueue() const;
+    void        StageJob( Node * node );
+
+    // local resource budgets (see Settings)
+    friend class JobSubQueue;
+    inline bool HasResourceLimits() const { return m_HasResourceLimits; }
+    bool        AcquireJobResources( const Node * node, JobResource & outBlockingResource );
+    void        ReleaseJobResources( const Node * node );
+    void        UnblockJobs( JobResource resource );
+    static void GetJobResources( const Node * node, uint32_t & outLinkSlots, uint32_t & outCopySlots, uint32_t & outMemoryMiB );
+    static bool AcquireResource( volatile uint32_t * active, volatile uint32_t * peak, uint32_t amount, uint32_t limit );
+    static void ReleaseResource( volatile uint32_t * active, uint32_t amount, uint32_t limit );
+
     // client side of protocol consumes jobs via this interface
     friend class Client;
     Job *       GetDistributableJobToProcess( bool remote );
+    void        OnSentToRemote( Job * job, uint32_t expectedTimeMS );
     Job *       OnReturnRemoteJob( uint32_t jobId );
     void        ReturnUnfinishedDistributableJob( Job * job );
+    void        TakeRemoteJobsToCancel( Array< uint32_t > & outJobIds );
 
     // Semaphore to manage work
     Semaphore           m_WorkerThreadSemaphore;
 
     // Jobs available for local processing
-    Array< Node * >     m_LocalJobs_Staging;
-    JobSubQueue         m_LocalJobs_Available;
+    //  - each thread has its own queue (indexed by thread index, with the main
+    //    thread at 0) and steals from the others when its own queue is empty
+    Array< Array< Node * > >    m_LocalJobs_Staging;    // Per queue, pending flush
+    uint32_t                    m_LocalJobs_NumStaged;
+    uint32_t                    m_LocalJobs_NextQueue;  // Round-robin for jobs without a preferred queue
+    Array< JobSubQueue * >      m_LocalJobs_Available;
+
+    // Jobs being looked up in the cache before being made available
+    CachePrefetcher *           m_CachePrefetcher;
+    Array< Job * >              m_CachePrefetchJobs;        // Pending handover to the prefetcher (main thread only)
+    uint32_t                    m_CachePrefetchNextQueue;   // Round-robin for prefetched jobs (prefetch thread only)
 
     // Jobs in progress locally
     uint32_t            m_NumLocalJobsActive;
 
+    // Resources used by jobs in progress locally
+    //  - a limit of 0 means unlimited (and usage is not tracked)
+    bool                m_HasResourceLimits;
+    uint32_t            m_LocalLinkJobLimit;
+    uint32_t            m_LocalCopyJobLimit;
+    uint32_t            m_LocalJobMemoryLimitMiB;
+    uint32_t            m_LocalLinkJobsActive;
+    uint32_t            m_LocalCopyJobsActive;
+    uint32_t            m_LocalJobMemoryActiveMiB;
+    uint32_t            m_LocalLinkJobsPeak;
+    uint32_t            m_LocalCopyJobsPeak;
+    uint32_t            m_LocalJobMemoryPeakMiB;
+
     // Jobs available for distributed processing (can also be done locally)
     mutable Mutex       m_DistributedJobsMutex;
     Array< Job * >      m_DistributableJobs_Available;  // Available, not in progress anywhere
     Array< Job * >      m_DistributableJobs_InProgress; // In progress remotely, locally or both
+    Array< uint32_t >   m_RemoteJobsToCancel;           // Won by a local race, pending cancellation on the worker
+
+    // Time taken to build distributable jobs locally (see -adaptiverace)
+    LatencyHistogram    m_LocalCompileTimes;
 
     // Semaphore to manage thread idle
     Semaphore           m_MainThreadSemaphore;
 
     // completed jobs
-    mutable Mutex       m_CompletedJobsMutex;
+    //  - pushed by any thread onto lock-free lists (most recent first)
+    //  - taken by the main thread in bulk for finalization
+    static bool         PushCompletedJob( Job * volatile * head, Job * job );
+    static void         TakeCompletedJobs( Job * volatile * head, Array< Job * > & outJobs );
+    Job * volatile      m_CompletedJobsHead;
+    Job * volatile      m_CompletedJobsFailedHead;
     Array< Job * >      m_CompletedJobs;
     Array< Job * >      m_CompletedJobsFailed;
 
-    // we have pair of arrays to enable a swap, avoiding locking the mutex too long
-    Array< Job * >      m_CompletedJobs2;
-    Array< Job * >      m_CompletedJobsFailed2;
-
     Array< WorkerThread * > m_Workers;
 };
 
@@ -20,10 +20,19 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#define RESULT_STREAMING_THRESHOLD ( 4 * Compressor::BLOCK_SIZE ) // results larger than this are streamed to the Client
+
+// Static Data
+//------------------------------------------------------------------------------
+static volatile uint32_t s_StreamedResultCount = 0; // makes names of streamed result files unique
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 JobQueueRemote::JobQueueRemote( uint32_t numWorkerThreads ) :
@@ -95,6 +104,22 @@ void JobQueueRemote::GetWorkerStatus( size_t index, AString & hostName, AString
     ( (WorkerThreadRemote *)m_Workers[ index ] )->GetStatus( hostName, status, isIdle );
 }
 
+// GetNumPendingJobs
+//------------------------------------------------------------------------------
+size_t JobQueueRemote::GetNumPendingJobs() const
+{
+    MutexHolder m( m_PendingJobsMutex );
+    return m_PendingJobs.GetSize();
+}
+
+// GetNumInFlightJobs
+//------------------------------------------------------------------------------
+size_t JobQueueRemote::GetNumInFlightJobs() const
+{
+    MutexHolder m( m_InFlightJobsMutex );
+    return m_InFlightJobs.GetSize();
+}
+
 // MainThreadWait
 //------------------------------------------------------------------------------
 void JobQueueRemote::MainThreadWait( uint32_t timeoutMS )
@@ -215,6 +240,24 @@ void JobQueueRemote::CancelJobsWithUserData( void * userData )
     }
 }
 
+// CancelPendingJob
+//------------------------------------------------------------------------------
+Job * JobQueueRemote::CancelPendingJob( void * userData, uint32_t jobId )
+{
+    MutexHolder m( m_PendingJobsMutex );
+    for ( Job ** it = m_PendingJobs.Begin(); it != m_PendingJobs.End(); ++it )
+    {
+        // job ids are only unique per client
+        if ( ( ( *it )->GetJobId() == jobId ) && ( ( *it )->GetUserData() == userData ) )
+        {
+            Job * job = *it;
+            m_PendingJobs.Erase( it );
+            return job;
+        }
+    }
+    return nullptr;
+}
+
 // GetJobToProcess (Worker Thread)
 //------------------------------------------------------------------------------
 Job * JobQueueRemote::GetJobToProcess()
@@ -431,6 +474,12 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
         fileNames.Append( xmlFileName );
     }
 
+    // Large results are left on disk for the Server to stream to the Client
+    if ( job->IsResultStreamingAllowed() && StreamResults( job, fileNames ) )
+    {
+        return true;
+    }
+
     MultiBuffer mb;
     size_t problemFileIndex = 0;
     if ( !mb.CreateFromFiles( fileNames, &problemFileIndex ) )
@@ -441,14 +490,56 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
 
     // transfer data to job
     size_t memSize;
-    void * mem = mb.Release( memSize );
+    AutoPtr< char > mem( (char *)mb.Release( memSize ) );
     //job->OwnData( mem, memSize );
 
     Compressor c;
-    c.Compress( mem, memSize );
+    c.Compress( mem.Get(), memSize );
     job->OwnData( c.ReleaseResult(), c.GetResultSize(), true );
     
     return true;
 }
 
+// StreamResults
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::StreamResults( Job * job, const Array< AString > & fileNames )
+{
+    uint64_t totalSize = 0;
+    for ( const AString & fileName : fileNames )
+    {
+        FileIO::FileInfo info;
+        if ( FileIO::GetFileInfo( fileName, info ) == false )
+        {
+            return false; // let ReadResults report the error
+        }
+        totalSize += info.m_Size;
+    }
+    if ( totalSize <= RESULT_STREAMING_THRESHOLD )
+    {
+        return false;
+    }
+
+    // move the files aside, so later jobs on this thread can't overwrite
+    // them before they have been sent (and the normal cleanup skips them)
+    const uint32_t id = AtomicIncU32( &s_StreamedResultCount );
+    Array< AString > streamedFileNames( fileNames.GetSize(), false );
+    for ( const AString & fileName : fileNames )
+    {
+        AStackString<> streamedFileName;
+        streamedFileName.Format( "%s.%u.result", fileName.Get(), id );
+        if ( FileIO::FileMove( fileName, streamedFileName ) == false )
+        {
+            for ( const AString & moved : streamedFileNames )
+            {
+                FileIO::FileDelete( moved.Get() );
+            }
+            return false;
+        }
+        streamedFileNames.Append( streamedFileName );
+    }
+
+    job->SetStreamedResultFiles( Move( streamedFileNames ) );
+    return true;
+}
+
 //------------------------------------------------------------------------------
@@ -29,6 +29,7 @@ public:
     void QueueJob( Job * job );
     Job * GetCompletedJob();
     void CancelJobsWithUserData( void * userData );
+    Job * CancelPendingJob( void * userData, uint32_t jobId ); // returns the job if it hadn't started
 
     // handle shutting down
     void SignalStopWorkers();
@@ -36,6 +37,8 @@ public:
 
     inline size_t GetNumWorkers() const { return m_Workers.GetSize(); }
     void          GetWorkerStatus( size_t index, AString & hostName, AString & status, bool & isIdle ) const;
+    size_t        GetNumPendingJobs() const;
+    size_t        GetNumInFlightJobs() const;
 
     void MainThreadWait( uint32_t timeoutMS );
     void WakeMainThread();
@@ -52,6 +55,7 @@ private:
 
     // internal helpers
     static bool ReadResults( Job * job );
+    static bool StreamResults( Job * job, const Array< AString > & fileNames );
 
     mutable Mutex       m_PendingJobsMutex;
     Array< Job * >      m_PendingJobs;
@@ -14,13 +14,19 @@
 #include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Network/Network.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Process/Thread.h"
 #include "Core/Tracing/Tracing.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#define TOOL_PEERS_TIMEOUT ( 2.0f ) // seconds to wait for the coordinator to list toolchain peers
+
 #if defined( __APPLE__ )
 
 #include <sys/socket.h>
@@ -70,6 +76,12 @@ WorkerBrokerage::WorkerBrokerage()
     , m_ConnectionPool( nullptr )
     , m_Connection( nullptr )
     , m_WorkerListUpdateReady( false )
+    , m_NumCPUsFree( 0 )
+    , m_NumJobsQueued( 0 )
+    , m_ToolIds( 0, true )
+    , m_ToolPeersConnection( nullptr )
+    , m_ToolPeers( 0, true )
+    , m_ToolPeersReady( false )
 {
 }
 
@@ -153,7 +165,7 @@ WorkerBrokerage::~WorkerBrokerage()
 
 // FindWorkers
 //------------------------------------------------------------------------------
-void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
+void WorkerBrokerage::FindWorkers( Array< AString > & workerList, uint32_t maxWorkers, const Array< uint64_t > & toolIds )
 {
     PROFILE_FUNCTION
 
@@ -171,8 +183,12 @@ void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
 
         OUTPUT( "Requesting worker list\n");
 
-        Protocol::MsgRequestWorkerList msg;
-        msg.Send( m_Connection );
+        // the coordinator returns the best workers for us, preferring
+        // those which already have our toolchains
+        MemoryStream ms;
+        ms.Write( toolIds );
+        Protocol::MsgRequestWorkerList msg( maxWorkers );
+        msg.Send( m_Connection, ms );
 
         while ( m_WorkerListUpdateReady == false )
         {
@@ -247,8 +263,16 @@ void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
 
 // UpdateWorkerList
 //------------------------------------------------------------------------------
-void WorkerBrokerage::UpdateWorkerList( Array< uint32_t > &workerListUpdate )
+void WorkerBrokerage::UpdateWorkerList( const ConnectionInfo * connection, Array< uint32_t > &workerListUpdate )
 {
+    // reply to FindToolPeers?
+    if ( connection == AtomicLoadAcquire( &m_ToolPeersConnection ) )
+    {
+        m_ToolPeers.Swap( workerListUpdate );
+        AtomicStoreRelease( &m_ToolPeersReady, true );
+        return;
+    }
+
     m_WorkerListUpdate.Swap( workerListUpdate );
     m_WorkerListUpdateReady = true;
 }
@@ -257,6 +281,8 @@ void WorkerBrokerage::UpdateWorkerList( Array< uint32_t > &workerListUpdate )
 //------------------------------------------------------------------------------
 void WorkerBrokerage::SetAvailability(bool available)
 {
+    MutexHolder mh( m_CoordinatorMutex );
+
     Init();
 
     // ignore if brokerage not configured
@@ -273,9 +299,12 @@ void WorkerBrokerage::SetAvailability(bool available)
         {
             if ( ConnectToCoordinator() )
             {
-                Protocol::MsgSetWorkerStatus msg( available );
-                msg.Send( m_Connection );
+                // periodic status is also the coordinator's heartbeat
+                SendWorkerStatus( available );
                 DisconnectFromCoordinator();
+
+                // Restart the timer
+                m_TimerLastUpdate.Start();
             }
             else
             {
@@ -300,8 +329,7 @@ void WorkerBrokerage::SetAvailability(bool available)
     {
         if ( ConnectToCoordinator() )
         {
-            Protocol::MsgSetWorkerStatus msg( available );
-            msg.Send( m_Connection );
+            SendWorkerStatus( available );
             DisconnectFromCoordinator();
         }
         else
@@ -316,6 +344,84 @@ void WorkerBrokerage::SetAvailability(bool available)
     m_Availability = available;
 }
 
+// SetWorkerLoad
+//------------------------------------------------------------------------------
+void WorkerBrokerage::SetWorkerLoad( uint32_t numCPUsFree, uint32_t numJobsQueued, const Array< uint64_t > & toolIds )
+{
+    // read by SendWorkerStatus, which can happen in another thread
+    MutexHolder mh( m_CoordinatorMutex );
+
+    m_NumCPUsFree = numCPUsFree;
+    m_NumJobsQueued = numJobsQueued;
+    m_ToolIds = toolIds;
+}
+
+// FindToolPeers
+//------------------------------------------------------------------------------
+void WorkerBrokerage::FindToolPeers( uint64_t toolId, Array< uint32_t > & outPeers )
+{
+    PROFILE_FUNCTION
+
+    outPeers.Clear();
+
+    AStackString<> coordinatorAddress;
+    {
+        MutexHolder mh( m_CoordinatorMutex );
+        Init();
+        coordinatorAddress = m_CoordinatorAddress;
+    }
+
+    // only the coordinator knows which toolchains workers have
+    if ( coordinatorAddress.IsEmpty() )
+    {
+        return;
+    }
+
+    MutexHolder mh( m_ToolPeersMutex );
+    {
+        WorkerConnectionPool connectionPool;
+        const ConnectionInfo * connection = connectionPool.Connect( coordinatorAddress, Protocol::COORDINATOR_PORT, 2000, this ); // 2000ms connection timeout
+        if ( connection == nullptr )
+        {
+            OUTPUT( "Failed to connect to the coordinator at %s\n", coordinatorAddress.Get() );
+            return;
+        }
+
+        AtomicStoreRelaxed( &m_ToolPeersReady, false );
+        AtomicStoreRelease( &m_ToolPeersConnection, connection );
+
+        Protocol::MsgRequestToolPeers msg( toolId );
+        msg.Send( connection );
+
+        // older coordinators drop the connection, so don't wait forever
+        Timer timer;
+        while ( ( AtomicLoadAcquire( &m_ToolPeersReady ) == false ) && ( timer.GetElapsed() < TOOL_PEERS_TIMEOUT ) )
+        {
+            Thread::Sleep( 1 );
+        }
+    } // disconnect (so a late reply can't arrive after this)
+    AtomicStoreRelaxed( &m_ToolPeersConnection, (const ConnectionInfo *)nullptr );
+
+    if ( AtomicLoadRelaxed( &m_ToolPeersReady ) )
+    {
+        outPeers.Swap( m_ToolPeers );
+        m_ToolPeers.Clear();
+    }
+}
+
+// SendWorkerStatus
+//------------------------------------------------------------------------------
+void WorkerBrokerage::SendWorkerStatus( bool available )
+{
+    MemoryStream ms;
+    ms.Write( m_ToolIds );
+
+    Protocol::MsgSetWorkerStatus msg( available, m_NumCPUsFree, m_NumJobsQueued );
+    msg.Send( m_Connection, ms );
+}
+
+// SetIPAsHostName
+//------------------------------------------------------------------------------
 void WorkerBrokerage::SetIPAsHostName(const AString& ipAsHostName)
 {
 	m_IPAsHostName = ipAsHostName;
@@ -4,6 +4,8 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Process/Mutex.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 
@@ -23,11 +25,13 @@ public:
     inline const AString & GetBrokerageRoot() const { return m_BrokerageRoot; }
 
     // client interface
-    void FindWorkers( Array< AString > & workerList );
-    void UpdateWorkerList( Array< uint32_t > &workerListUpdate );
+    void FindWorkers( Array< AString > & workerList, uint32_t maxWorkers, const Array< uint64_t > & toolIds );
+    void UpdateWorkerList( const ConnectionInfo * connection, Array< uint32_t > &workerListUpdate );
 
     // server interface
     void SetAvailability( bool available );
+    void SetWorkerLoad( uint32_t numCPUsFree, uint32_t numJobsQueued, const Array< uint64_t > & toolIds );
+    void FindToolPeers( uint64_t toolId, Array< uint32_t > & outPeers ); // workers which have a toolchain (thread-safe)
 
     void SetIPAsHostName( const AString & ipAsHostName );
 private:
@@ -35,6 +39,7 @@ private:
 
     bool ConnectToCoordinator();
     void DisconnectFromCoordinator();
+    void SendWorkerStatus( bool available );
 
     AString             m_BrokerageRoot;
     bool                m_Availability;
@@ -43,11 +48,24 @@ private:
     AString             m_IPAsHostName;
     AString             m_BrokerageFilePath;
     AString             m_CoordinatorAddress;
+    Mutex               m_CoordinatorMutex;     // SetAvailability and SetWorkerLoad are called from different threads
     WorkerConnectionPool * m_ConnectionPool;
     const ConnectionInfo * m_Connection;
     Timer               m_TimerLastUpdate;      // Throttle network access
     Array< uint32_t >   m_WorkerListUpdate;
     bool                m_WorkerListUpdateReady;
+
+    // load reported to the coordinator (protected by m_CoordinatorMutex)
+    uint32_t            m_NumCPUsFree;
+    uint32_t            m_NumJobsQueued;
+    Array< uint64_t >   m_ToolIds;
+
+    // FindToolPeers has its own connection, so waiting for the reply doesn't
+    // hold up SetAvailability and SetWorkerLoad
+    Mutex               m_ToolPeersMutex;       // one lookup at a time
+    const ConnectionInfo * volatile m_ToolPeersConnection;
+    Array< uint32_t >   m_ToolPeers;
+    volatile bool       m_ToolPeersReady;
 };
 
 //------------------------------------------------------------------------------
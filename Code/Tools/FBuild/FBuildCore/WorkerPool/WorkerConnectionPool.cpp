@@ -13,13 +13,46 @@
 #include "Core/Strings/AStackString.h"
 #include "Core/Tracing/Tracing.h"
 #include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/IOStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Time/Time.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define ASSIGNED_CLIENT_CPU_COST    ( 2 )   // cpus a client is expected to use on a worker it has been sent to
+#define TOOLCHAIN_BONUS_CPUS        ( 2 )   // preference for workers which already have a client's toolchain
+#define SNAPSHOT_VERSION            ( 2 )   // format of worker registry saved by SaveWorkers
+#define MAX_TOOL_PEERS              ( 4 )   // workers offered as a source for a toolchain
+#define WORKER_LIST_HEADROOM        ( 2 )   // workers sent to a client, as a multiple of its connection limit
+#if defined( __WINDOWS__ )
+    #define ONE_SECOND ( (uint64_t)10000000 )
+#else
+    #define ONE_SECOND ( (uint64_t)1000000000 )
+#endif
+
+// TimerToFileTime - when a timer was started, as a file time
+//------------------------------------------------------------------------------
+static uint64_t TimerToFileTime( const Timer & timer, uint64_t currentTime )
+{
+    const uint64_t elapsed = (uint64_t)( (double)timer.GetElapsed() * (double)ONE_SECOND );
+    return ( currentTime > elapsed ) ? ( currentTime - elapsed ) : 0;
+}
+
+// FileTimeToElapsed - seconds since a file time
+//------------------------------------------------------------------------------
+static float FileTimeToElapsed( uint64_t fileTime, uint64_t currentTime )
+{
+    // clock may have gone backwards
+    const uint64_t elapsed = ( currentTime > fileTime ) ? ( currentTime - fileTime ) : 0;
+    return (float)( (double)elapsed / (double)ONE_SECOND );
+}
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 WorkerConnectionPool::WorkerConnectionPool()
     : TCPConnectionPool()
-    , m_CurrentMessage( nullptr )
 {
 }
 
@@ -30,20 +63,148 @@ WorkerConnectionPool::~WorkerConnectionPool()
     ShutdownAllConnections();
 }
 
+// EvictExpiredWorkers
+//------------------------------------------------------------------------------
+uint32_t WorkerConnectionPool::EvictExpiredWorkers( float expiryTime )
+{
+    MutexHolder mh( m_Mutex );
+
+    uint32_t numEvicted = 0;
+    for ( size_t i = m_Workers.GetSize(); i > 0; --i )
+    {
+        const WorkerInfo & worker = m_Workers[ i - 1 ];
+        const float lastSeen = worker.m_LastSeen.GetElapsed();
+        if ( lastSeen > expiryTime )
+        {
+            AStackString<> remoteAddr;
+            TCPConnectionPool::GetAddressAsString( worker.m_Address, remoteAddr );
+            OUTPUT( "Worker expired: %s (last seen %us ago)\n", remoteAddr.Get(), (uint32_t)lastSeen );
+            m_Workers.EraseIndex( i - 1 );
+            ++numEvicted;
+        }
+    }
+    return numEvicted;
+}
+
+// SaveWorkers
+//------------------------------------------------------------------------------
+void WorkerConnectionPool::SaveWorkers( IOStream & stream, uint64_t currentTime ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    stream.Write( (uint32_t)SNAPSHOT_VERSION );
+    stream.Write( (uint32_t)m_Workers.GetSize() );
+    for ( const WorkerInfo & worker : m_Workers )
+    {
+        stream.Write( worker.m_Address );
+        stream.Write( worker.m_ProtocolVersion );
+        stream.Write( worker.m_Platform );
+        stream.Write( worker.m_NumCPUsFree );
+        stream.Write( worker.m_NumJobsQueued );
+        stream.Write( worker.m_ToolIds );
+
+        // times are saved (rather than ages), so restored workers have also
+        // aged by however long the coordinator was down, and expire if they
+        // have gone away
+        stream.Write( TimerToFileTime( worker.m_Registered, currentTime ) );
+        stream.Write( TimerToFileTime( worker.m_LastSeen, currentTime ) );
+    }
+}
+
+// LoadWorkers
+//------------------------------------------------------------------------------
+bool WorkerConnectionPool::LoadWorkers( IOStream & stream, uint64_t currentTime )
+{
+    uint32_t version = 0;
+    uint32_t numWorkers = 0;
+    if ( ( stream.Read( version ) == false ) ||
+         ( version != SNAPSHOT_VERSION ) ||
+         ( stream.Read( numWorkers ) == false ) )
+    {
+        return false;
+    }
+
+    MutexHolder mh( m_Mutex );
+
+    for ( uint32_t i = 0; i < numWorkers; ++i )
+    {
+        uint32_t address = 0;
+        uint32_t protocolVersion = 0;
+        uint8_t platform = 0;
+        if ( ( stream.Read( address ) == false ) ||
+             ( stream.Read( protocolVersion ) == false ) ||
+             ( stream.Read( platform ) == false ) )
+        {
+            return false;
+        }
+
+        WorkerInfo worker( address, protocolVersion, platform );
+        uint64_t registered = 0;
+        uint64_t lastSeen = 0;
+        if ( ( stream.Read( worker.m_NumCPUsFree ) == false ) ||
+             ( stream.Read( worker.m_NumJobsQueued ) == false ) ||
+             ( stream.Read( worker.m_ToolIds ) == false ) ||
+             ( stream.Read( registered ) == false ) ||
+             ( stream.Read( lastSeen ) == false ) )
+        {
+            return false;
+        }
+        worker.m_Registered.Start( FileTimeToElapsed( registered, currentTime ) );
+        worker.m_LastSeen.Start( FileTimeToElapsed( lastSeen, currentTime ) );
+
+        // a worker may have reported in already
+        if ( m_Workers.Find( address ) == nullptr )
+        {
+            m_Workers.Append( worker );
+        }
+    }
+    return true;
+}
+
+// GetStatus
+//------------------------------------------------------------------------------
+void WorkerConnectionPool::GetStatus( AString & outStatus ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    outStatus.Format( "Workers: %u\n", (uint32_t)m_Workers.GetSize() );
+    if ( m_Workers.IsEmpty() )
+    {
+        return;
+    }
+    outStatus += " Address          Protocol  CPUs Free  Queued  Toolchains  Registered  Last Seen\n";
+    for ( const WorkerInfo & worker : m_Workers )
+    {
+        AStackString<> remoteAddr;
+        TCPConnectionPool::GetAddressAsString( worker.m_Address, remoteAddr );
+        outStatus.AppendFormat( " %-16s %-9u %-10u %-7u %-11u %9us  %8us\n",
+                                remoteAddr.Get(),
+                                worker.m_ProtocolVersion,
+                                worker.m_NumCPUsFree,
+                                worker.m_NumJobsQueued,
+                                (uint32_t)worker.m_ToolIds.GetSize(),
+                                (uint32_t)worker.m_Registered.GetElapsed(),
+                                (uint32_t)worker.m_LastSeen.GetElapsed() );
+    }
+}
+
 // OnReceive
 //------------------------------------------------------------------------------
 void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
 {
     keepMemory = true; // we'll take care of freeing the memory
 
+    ConnectionState * cs = (ConnectionState *)connection->GetUserData();
+    ASSERT( cs );
+
     // are we expecting a msg, or the payload for a msg?
     void * payload = nullptr;
     size_t payloadSize = 0;
-    if ( m_CurrentMessage == nullptr )
+    if ( cs->m_CurrentMessage == nullptr )
     {
         // message
-        m_CurrentMessage = static_cast< const Protocol::IMessage * >( data );
-        if ( m_CurrentMessage->HasPayload() )
+        cs->m_CurrentMessage = static_cast< const Protocol::IMessage * >( data );
+        if ( cs->m_CurrentMessage->HasPayload() )
         {
             return;
         }
@@ -51,12 +212,12 @@ void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void *
     else
     {
         // payload
-        ASSERT( m_CurrentMessage->HasPayload() );
+        ASSERT( cs->m_CurrentMessage->HasPayload() );
         payload = data;
         payloadSize = size;
     }
 
-    const Protocol::IMessage * imsg = m_CurrentMessage;
+    const Protocol::IMessage * imsg = cs->m_CurrentMessage;
     Protocol::MessageType messageType = imsg->GetType();
 
     PROTOCOL_DEBUG( "Coordinator : %u (%s)\n", messageType, GetProtocolMessageDebugName( messageType ) );
@@ -66,7 +227,7 @@ void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void *
         case Protocol::MSG_REQUEST_WORKER_LIST:
         {
             const Protocol::MsgRequestWorkerList * msg = static_cast< const Protocol::MsgRequestWorkerList * >( imsg );
-            Process( connection, msg );
+            Process( connection, msg, payload, payloadSize );
             break;
         }
         case Protocol::MSG_WORKER_LIST:
@@ -78,6 +239,12 @@ void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void *
         case Protocol::MSG_SET_WORKER_STATUS:
         {
             const Protocol::MsgSetWorkerStatus * msg = static_cast< const Protocol::MsgSetWorkerStatus * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_REQUEST_TOOL_PEERS:
+        {
+            const Protocol::MsgRequestToolPeers * msg = static_cast< const Protocol::MsgRequestToolPeers * >( imsg );
             Process( connection, msg );
             break;
         }
@@ -94,9 +261,9 @@ void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void *
     }
 
     // free everything
-    FREE( (void *)( m_CurrentMessage ) );
+    FREE( (void *)( cs->m_CurrentMessage ) );
     FREE( payload );
-    m_CurrentMessage = nullptr;
+    cs->m_CurrentMessage = nullptr;
 }
 
 // OnConnected
@@ -106,37 +273,140 @@ void WorkerConnectionPool::OnConnected( const ConnectionInfo * connection )
     AStackString<> remoteAddr;
     TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
     OUTPUT( "OnConnected %s\n", remoteAddr.Get() );
+
+    // connections to the coordinator are made with the brokerage as user data
+    ConnectionState * cs = FNEW( ConnectionState( (WorkerBrokerage *)connection->GetUserData() ) );
+    connection->SetUserData( cs );
 }
 
 // OnDisconnected
 //------------------------------------------------------------------------------
-void WorkerConnectionPool::OnDisconnected( const ConnectionInfo * )
+void WorkerConnectionPool::OnDisconnected( const ConnectionInfo * connection )
 {
+    ConnectionState * cs = (ConnectionState *)connection->GetUserData();
+    ASSERT( cs );
+
+    // free partially received message
+    FREE( (void *)( cs->m_CurrentMessage ) );
+    FDELETE cs;
 }
 
 // Process ( MsgRequestWorkerList )
 //------------------------------------------------------------------------------
-void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkerList * msg )
+void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkerList * msg, const void * payload, size_t payloadSize )
 {
     OUTPUT( "Process ( MsgRequestWorkerList )\n");
 
+    // toolchains the client uses
+    Array< uint64_t > clientToolIds( 0, true );
+    if ( payload )
+    {
+        ConstMemoryStream ms( payload, payloadSize );
+        ms.Read( clientToolIds );
+    }
+
     MutexHolder mh( m_Mutex );
-    
+
+    Array< WorkerInfo * > workers( m_Workers.GetSize(), false );
+    RankWorkers( msg->GetProtocolVersion(), msg->GetPlatform(), connection->GetRemoteAddress(), clientToolIds, workers );
+
+    AssignWorkers( msg->GetMaxWorkers(), workers );
+
     MemoryStream ms;
-    const size_t numWorkers( m_Workers.GetSize() );
-    ms.Write( (uint32_t)numWorkers );
-    for ( size_t i = 0; i < numWorkers; ++i )
+    ms.Write( (uint32_t)workers.GetSize() );
+    for ( const WorkerInfo * worker : workers )
     {
-        if ( m_Workers[ i ].m_ProtocolVersion == msg->GetProtocolVersion() && m_Workers[ i ].m_Platform == msg->GetPlatform() )
-        {
-            ms.Write( m_Workers[ i ].m_Address );
-        }
+        ms.Write( worker->m_Address );
     }
 
+    OUTPUT( "%u of %u workers sent\n", (uint32_t)workers.GetSize(), (uint32_t)m_Workers.GetSize() );
+
     Protocol::MsgWorkerList resultMsg;
     resultMsg.Send( connection, ms );
 }
 
+// AssignWorkers
+//------------------------------------------------------------------------------
+void WorkerConnectionPool::AssignWorkers( uint32_t maxWorkers, Array< WorkerInfo * > & inOutWorkers )
+{
+    // give each client its own shard of the best workers, with some spares
+    // in case any of them can't be connected to or turn the client away (the
+    // client's own connection limit decides how many it uses)
+    if ( maxWorkers > 0 )
+    {
+        const size_t numWorkers = Math::Min( inOutWorkers.GetSize(), (size_t)maxWorkers * WORKER_LIST_HEADROOM );
+        inOutWorkers.SetSize( numWorkers );
+    }
+
+    // account for this client until each worker next reports its load,
+    // so many clients asking at once are spread across workers
+    for ( WorkerInfo * worker : inOutWorkers )
+    {
+        ++worker->m_NumClientsAssigned;
+    }
+}
+
+// RankWorkers
+//------------------------------------------------------------------------------
+void WorkerConnectionPool::RankWorkers( uint32_t protocolVersion,
+                                        uint8_t platform,
+                                        uint32_t clientAddress,
+                                        const Array< uint64_t > & clientToolIds,
+                                        Array< WorkerInfo * > & outWorkers )
+{
+    struct Candidate
+    {
+        inline bool operator < ( const Candidate & other ) const
+        {
+            // best score first, then a per-client order between equally loaded workers
+            return ( m_Score != other.m_Score ) ? ( m_Score > other.m_Score ) : ( m_TieBreak < other.m_TieBreak );
+        }
+
+        int64_t         m_Score;
+        uint32_t        m_TieBreak;
+        WorkerInfo *    m_Worker;
+    };
+
+    Array< Candidate > candidates( m_Workers.GetSize(), false );
+    for ( WorkerInfo & worker : m_Workers )
+    {
+        if ( ( worker.m_ProtocolVersion != protocolVersion ) || ( worker.m_Platform != platform ) )
+        {
+            continue;
+        }
+
+        // spare capacity, less what clients recently sent here are expected to use
+        int64_t score = (int64_t)worker.m_NumCPUsFree -
+                        (int64_t)worker.m_NumJobsQueued -
+                        (int64_t)worker.m_NumClientsAssigned * ASSIGNED_CLIENT_CPU_COST;
+
+        // avoid synchronizing toolchains where possible
+        for ( const uint64_t toolId : clientToolIds )
+        {
+            if ( worker.m_ToolIds.Find( toolId ) )
+            {
+                score += TOOLCHAIN_BONUS_CPUS;
+                break;
+            }
+        }
+
+        const uint32_t addresses[ 2 ] = { clientAddress, worker.m_Address };
+
+        Candidate candidate;
+        candidate.m_Score = score;
+        candidate.m_TieBreak = xxHash::Calc32( addresses, sizeof( addresses ) );
+        candidate.m_Worker = &worker;
+        candidates.Append( candidate );
+    }
+    candidates.Sort();
+
+    outWorkers.Clear();
+    for ( const Candidate & candidate : candidates )
+    {
+        outWorkers.Append( candidate.m_Worker );
+    }
+}
+
 // Process ( MsgWorkerList )
 //------------------------------------------------------------------------------
 void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgWorkerList * /*msg*/, const void * payload, size_t payloadSize )
@@ -160,26 +430,40 @@ void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Pro
         workers.Append( workerAddress );
     }
 
-    WorkerBrokerage * brokerage = ( WorkerBrokerage *)connection->GetUserData();
-    ASSERT( brokerage );
-    brokerage->UpdateWorkerList( workers );
+    const ConnectionState * cs = (const ConnectionState *)connection->GetUserData();
+    ASSERT( cs && cs->m_Brokerage );
+    cs->m_Brokerage->UpdateWorkerList( connection, workers );
 }
 
 // Process ( MsgSetWorkerStatus )
 //------------------------------------------------------------------------------
-void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgSetWorkerStatus * msg )
+void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgSetWorkerStatus * msg, const void * payload, size_t payloadSize )
 {
     MutexHolder mh( m_Mutex );
 
     const uint32_t workerAddress = connection->GetRemoteAddress();
     if ( msg->IsAvailable() )
     {
-        if ( m_Workers.Find( workerAddress ) == nullptr )
+        WorkerInfo * worker = m_Workers.Find( workerAddress );
+        if ( worker == nullptr )
         {
             AStackString<> remoteAddr;
             TCPConnectionPool::GetAddressAsString( workerAddress, remoteAddr );
             OUTPUT( "New worker available: %s\n", remoteAddr.Get() );
             m_Workers.Append( WorkerInfo( workerAddress, msg->GetProtocolVersion(), msg->GetPlatform() ) );
+            worker = &m_Workers.Top();
+        }
+
+        // update load
+        worker->m_LastSeen.Start();
+        worker->m_NumCPUsFree = msg->GetNumCPUsFree();
+        worker->m_NumJobsQueued = msg->GetNumJobsQueued();
+        worker->m_NumClientsAssigned = 0; // now reflected in the reported load
+        worker->m_ToolIds.Clear();
+        if ( payload )
+        {
+            ConstMemoryStream ms( payload, payloadSize );
+            ms.Read( worker->m_ToolIds );
         }
     }
     else
@@ -188,4 +472,45 @@ void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Pro
     }
 }
 
+// Process ( MsgRequestToolPeers )
+//------------------------------------------------------------------------------
+void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgRequestToolPeers * msg )
+{
+    const uint32_t workerAddress = connection->GetRemoteAddress();
+    const uint64_t toolId = msg->GetToolId();
+
+    MutexHolder mh( m_Mutex );
+
+    // least loaded workers which have the toolchain, other than the one asking
+    Array< uint64_t > toolIds( 1, false );
+    toolIds.Append( toolId );
+    Array< WorkerInfo * > workers( m_Workers.GetSize(), false );
+    RankWorkers( msg->GetProtocolVersion(), msg->GetPlatform(), workerAddress, toolIds, workers );
+
+    Array< uint32_t > peers( MAX_TOOL_PEERS, false );
+    for ( const WorkerInfo * worker : workers )
+    {
+        if ( peers.GetSize() == MAX_TOOL_PEERS )
+        {
+            break;
+        }
+        if ( ( worker->m_Address != workerAddress ) && worker->m_ToolIds.Find( toolId ) )
+        {
+            peers.Append( worker->m_Address );
+        }
+    }
+
+    MemoryStream ms;
+    ms.Write( (uint32_t)peers.GetSize() );
+    for ( const uint32_t peer : peers )
+    {
+        ms.Write( peer );
+    }
+
+    OUTPUT( "%u workers with toolchain 0x%016" PRIx64 " sent\n", (uint32_t)peers.GetSize(), toolId );
+
+    Protocol::MsgWorkerList resultMsg;
+    resultMsg.Send( connection, ms );
+}
+
 //------------------------------------------------------------------------------
@@ -6,16 +6,21 @@
 //------------------------------------------------------------------------------
 
 // Core
+#include "Core/Containers/Array.h"
 #include "Core/Network/TCPConnectionPool.h"
+#include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class IOStream;
+class WorkerBrokerage;
 namespace Protocol
 {
     class IMessage;
     class MsgRequestWorkerList;
     class MsgWorkerList;
     class MsgSetWorkerStatus;
+    class MsgRequestToolPeers;
 }
 
 // WorkerInfo
@@ -26,6 +31,10 @@ struct WorkerInfo
         : m_Address( address )
         , m_ProtocolVersion( protocolVersion )
         , m_Platform( platform )
+        , m_NumCPUsFree( 0 )
+        , m_NumJobsQueued( 0 )
+        , m_NumClientsAssigned( 0 )
+        , m_ToolIds( 0, true )
     {}
 
     bool operator == ( uint32_t address ) const { return address == m_Address; }
@@ -33,6 +42,15 @@ struct WorkerInfo
     uint32_t    m_Address;
     uint32_t    m_ProtocolVersion;
     uint8_t     m_Platform;
+
+    // load, as last reported by the worker
+    uint32_t            m_NumCPUsFree;
+    uint32_t            m_NumJobsQueued;
+    uint32_t            m_NumClientsAssigned;   // clients sent to this worker since it last reported
+    Array< uint64_t >   m_ToolIds;              // toolchains synchronized on the worker
+
+    Timer               m_Registered;           // time since the worker first became available
+    Timer               m_LastSeen;             // time since the last status (heartbeat) from the worker
 };
 
 // WorkerConnectionPool
@@ -43,19 +61,47 @@ public:
     WorkerConnectionPool();
     virtual ~WorkerConnectionPool();
 
+    // coordinator interface
+    //  - currentTime is a file time (see Time::GetCurrentFileTime)
+    uint32_t    EvictExpiredWorkers( float expiryTime );
+    void        SaveWorkers( IOStream & stream, uint64_t currentTime ) const;
+    bool        LoadWorkers( IOStream & stream, uint64_t currentTime );
+    void        GetStatus( AString & outStatus ) const;
+
 private:
+    friend class TestWorkerConnectionPool;
+
     // network events - NOTE: these happen in another thread! (but never at the same time)
     virtual void OnReceive( const ConnectionInfo *, void * /*data*/, uint32_t /*size*/, bool & /*keepMemory*/ ) override;
     virtual void OnConnected( const ConnectionInfo * ) override;
     virtual void OnDisconnected( const ConnectionInfo * ) override;
 
-    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkerList * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkerList * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgWorkerList * msg, const void * payload, size_t payloadSize );
-    void Process( const ConnectionInfo * connection, const Protocol::MsgSetWorkerStatus * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgSetWorkerStatus * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestToolPeers * msg );
+
+    // rank workers for a client, with the least loaded first
+    void RankWorkers( uint32_t protocolVersion,
+                      uint8_t platform,
+                      uint32_t clientAddress,
+                      const Array< uint64_t > & clientToolIds,
+                      Array< WorkerInfo * > & outWorkers );
+
+    // choose which of the ranked workers to send to a client
+    static void AssignWorkers( uint32_t maxWorkers, Array< WorkerInfo * > & inOutWorkers );
+
+    // messages with payloads arrive in two parts, so track them per connection
+    struct ConnectionState
+    {
+        explicit ConnectionState( WorkerBrokerage * brokerage ) : m_CurrentMessage( nullptr ), m_Brokerage( brokerage ) {}
+
+        const Protocol::IMessage *  m_CurrentMessage;
+        WorkerBrokerage *           m_Brokerage;    // for connections to the coordinator
+    };
 
-    Mutex                       m_Mutex;
+    mutable Mutex               m_Mutex;
     Array< WorkerInfo >         m_Workers;
-    const Protocol::IMessage    * m_CurrentMessage;
 };
 
 //------------------------------------------------------------------------------
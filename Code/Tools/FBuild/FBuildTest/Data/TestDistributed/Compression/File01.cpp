@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File01()
+{
+    SharedStruct01 s = { 1, 2, 0.0f, "File01" };
+    return SharedFunction01( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File02()
+{
+    SharedStruct02 s = { 2, 4, 0.0f, "File02" };
+    return SharedFunction02( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File03()
+{
+    SharedStruct03 s = { 3, 6, 0.0f, "File03" };
+    return SharedFunction03( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File04()
+{
+    SharedStruct04 s = { 4, 8, 0.0f, "File04" };
+    return SharedFunction04( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File05()
+{
+    SharedStruct05 s = { 5, 10, 0.0f, "File05" };
+    return SharedFunction05( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File06()
+{
+    SharedStruct06 s = { 6, 12, 0.0f, "File06" };
+    return SharedFunction06( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File07()
+{
+    SharedStruct07 s = { 7, 14, 0.0f, "File07" };
+    return SharedFunction07( s );
+}
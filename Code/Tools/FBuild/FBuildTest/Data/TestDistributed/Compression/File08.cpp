@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File08()
+{
+    SharedStruct08 s = { 8, 16, 0.0f, "File08" };
+    return SharedFunction08( s );
+}
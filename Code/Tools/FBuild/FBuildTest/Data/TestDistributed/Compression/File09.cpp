@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File09()
+{
+    SharedStruct09 s = { 9, 18, 0.0f, "File09" };
+    return SharedFunction09( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File10()
+{
+    SharedStruct10 s = { 10, 20, 0.0f, "File10" };
+    return SharedFunction10( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File11()
+{
+    SharedStruct11 s = { 11, 22, 0.0f, "File11" };
+    return SharedFunction11( s );
+}
@@ -0,0 +1,7 @@
+#include "Shared.h"
+
+int File12()
+{
+    SharedStruct12 s = { 12, 24, 0.0f, "File12" };
+    return SharedFunction12( s );
+}
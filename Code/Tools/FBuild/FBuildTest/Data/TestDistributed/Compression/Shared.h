@@ -0,0 +1,132 @@
+// Shared.h - Included by every file, so their preprocessed output has content
+// in common to deduplicate, and to train a compression dictionary on
+#pragma once
+
+struct SharedStruct00 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction00( const SharedStruct00 & s ) { return ( s.m_A * 1 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct01 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction01( const SharedStruct01 & s ) { return ( s.m_A * 2 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct02 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction02( const SharedStruct02 & s ) { return ( s.m_A * 3 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct03 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction03( const SharedStruct03 & s ) { return ( s.m_A * 4 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct04 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction04( const SharedStruct04 & s ) { return ( s.m_A * 5 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct05 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction05( const SharedStruct05 & s ) { return ( s.m_A * 6 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct06 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction06( const SharedStruct06 & s ) { return ( s.m_A * 7 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct07 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction07( const SharedStruct07 & s ) { return ( s.m_A * 8 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct08 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction08( const SharedStruct08 & s ) { return ( s.m_A * 9 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct09 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction09( const SharedStruct09 & s ) { return ( s.m_A * 10 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct10 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction10( const SharedStruct10 & s ) { return ( s.m_A * 11 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct11 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction11( const SharedStruct11 & s ) { return ( s.m_A * 12 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct12 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction12( const SharedStruct12 & s ) { return ( s.m_A * 13 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct13 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction13( const SharedStruct13 & s ) { return ( s.m_A * 14 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct14 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction14( const SharedStruct14 & s ) { return ( s.m_A * 15 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct15 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction15( const SharedStruct15 & s ) { return ( s.m_A * 16 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct16 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction16( const SharedStruct16 & s ) { return ( s.m_A * 17 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct17 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction17( const SharedStruct17 & s ) { return ( s.m_A * 18 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct18 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction18( const SharedStruct18 & s ) { return ( s.m_A * 19 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct19 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction19( const SharedStruct19 & s ) { return ( s.m_A * 20 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct20 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction20( const SharedStruct20 & s ) { return ( s.m_A * 21 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct21 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction21( const SharedStruct21 & s ) { return ( s.m_A * 22 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct22 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction22( const SharedStruct22 & s ) { return ( s.m_A * 23 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct23 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction23( const SharedStruct23 & s ) { return ( s.m_A * 24 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct24 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction24( const SharedStruct24 & s ) { return ( s.m_A * 25 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct25 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction25( const SharedStruct25 & s ) { return ( s.m_A * 26 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct26 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction26( const SharedStruct26 & s ) { return ( s.m_A * 27 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct27 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction27( const SharedStruct27 & s ) { return ( s.m_A * 28 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct28 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction28( const SharedStruct28 & s ) { return ( s.m_A * 29 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct29 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction29( const SharedStruct29 & s ) { return ( s.m_A * 30 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct30 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction30( const SharedStruct30 & s ) { return ( s.m_A * 31 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct31 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction31( const SharedStruct31 & s ) { return ( s.m_A * 32 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct32 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction32( const SharedStruct32 & s ) { return ( s.m_A * 33 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct33 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction33( const SharedStruct33 & s ) { return ( s.m_A * 34 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct34 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction34( const SharedStruct34 & s ) { return ( s.m_A * 35 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct35 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction35( const SharedStruct35 & s ) { return ( s.m_A * 36 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct36 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction36( const SharedStruct36 & s ) { return ( s.m_A * 37 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct37 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction37( const SharedStruct37 & s ) { return ( s.m_A * 38 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct38 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction38( const SharedStruct38 & s ) { return ( s.m_A * 39 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct39 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction39( const SharedStruct39 & s ) { return ( s.m_A * 40 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct40 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction40( const SharedStruct40 & s ) { return ( s.m_A * 41 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct41 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction41( const SharedStruct41 & s ) { return ( s.m_A * 42 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct42 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction42( const SharedStruct42 & s ) { return ( s.m_A * 43 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct43 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction43( const SharedStruct43 & s ) { return ( s.m_A * 44 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct44 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction44( const SharedStruct44 & s ) { return ( s.m_A * 45 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct45 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction45( const SharedStruct45 & s ) { return ( s.m_A * 46 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct46 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction46( const SharedStruct46 & s ) { return ( s.m_A * 47 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct47 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction47( const SharedStruct47 & s ) { return ( s.m_A * 48 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct48 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction48( const SharedStruct48 & s ) { return ( s.m_A * 49 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct49 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction49( const SharedStruct49 & s ) { return ( s.m_A * 50 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct50 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction50( const SharedStruct50 & s ) { return ( s.m_A * 51 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct51 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction51( const SharedStruct51 & s ) { return ( s.m_A * 52 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct52 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction52( const SharedStruct52 & s ) { return ( s.m_A * 53 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct53 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction53( const SharedStruct53 & s ) { return ( s.m_A * 54 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct54 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction54( const SharedStruct54 & s ) { return ( s.m_A * 55 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct55 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction55( const SharedStruct55 & s ) { return ( s.m_A * 56 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct56 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction56( const SharedStruct56 & s ) { return ( s.m_A * 57 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct57 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction57( const SharedStruct57 & s ) { return ( s.m_A * 58 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct58 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction58( const SharedStruct58 & s ) { return ( s.m_A * 59 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct59 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction59( const SharedStruct59 & s ) { return ( s.m_A * 60 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct60 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction60( const SharedStruct60 & s ) { return ( s.m_A * 61 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct61 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction61( const SharedStruct61 & s ) { return ( s.m_A * 62 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct62 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction62( const SharedStruct62 & s ) { return ( s.m_A * 63 ) + s.m_B + (int)s.m_C; }
+struct SharedStruct63 { int m_A; int m_B; float m_C; const char * m_Name; };
+inline int SharedFunction63( const SharedStruct63 & s ) { return ( s.m_A * 64 ) + s.m_B + (int)s.m_C; }
@@ -0,0 +1,3 @@
+// Initialized data is stored in the object, making it big enough
+// for the result to be streamed back from the worker in chunks
+char g_LargeObjectData[ 6 * 1024 * 1024 ] = { 1 };
@@ -10,12 +10,14 @@
 int main(int , char * [])
 {
     // tests to run
+    REGISTER_TESTGROUP( TestAdaptiveRace )
     REGISTER_TESTGROUP( TestAlias )
     REGISTER_TESTGROUP( TestBFFParsing )
     REGISTER_TESTGROUP( TestBuildAndLinkLibrary )
     REGISTER_TESTGROUP( TestBuildFBuild )
     REGISTER_TESTGROUP( TestCache )
     REGISTER_TESTGROUP( TestCachePlugin )
+    REGISTER_TESTGROUP( TestChunkStore )
     REGISTER_TESTGROUP( TestCompilationDatabase )
     REGISTER_TESTGROUP( TestCompiler )
     REGISTER_TESTGROUP( TestCompressor )
@@ -40,6 +42,7 @@ int main(int , char * [])
     REGISTER_TESTGROUP( TestUnity )
     REGISTER_TESTGROUP( TestVariableStack )
     REGISTER_TESTGROUP( TestWarnings )
+    REGISTER_TESTGROUP( TestWorkerConnectionPool )
 
     // Windows-specific tests
     #if defined( __WINDOWS__ )
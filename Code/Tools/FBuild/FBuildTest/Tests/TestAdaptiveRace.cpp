@@ -0,0 +1,114 @@
+// TestAdaptiveRace.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Helpers/LatencyHistogram.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+
+// TestAdaptiveRace
+//------------------------------------------------------------------------------
+class TestAdaptiveRace : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void HistogramEmpty() const;
+    void HistogramPercentiles() const;
+    void HistogramAccuracy() const;
+    void RaceBenefit() const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestAdaptiveRace )
+    REGISTER_TEST( HistogramEmpty )
+    REGISTER_TEST( HistogramPercentiles )
+    REGISTER_TEST( HistogramAccuracy )
+    REGISTER_TEST( RaceBenefit )
+REGISTER_TESTS_END
+
+// HistogramEmpty
+//------------------------------------------------------------------------------
+void TestAdaptiveRace::HistogramEmpty() const
+{
+    LatencyHistogram h;
+    TEST_ASSERT( h.GetCount() == 0 );
+    TEST_ASSERT( h.GetPercentile( 0.0f ) == 0 );
+    TEST_ASSERT( h.GetPercentile( 0.5f ) == 0 );
+    TEST_ASSERT( h.GetPercentile( 1.0f ) == 0 );
+}
+
+// HistogramPercentiles
+//------------------------------------------------------------------------------
+void TestAdaptiveRace::HistogramPercentiles() const
+{
+    // small values are exact
+    LatencyHistogram h;
+    h.Record( 1 );
+    h.Record( 2 );
+    h.Record( 3 );
+    TEST_ASSERT( h.GetCount() == 3 );
+    TEST_ASSERT( h.GetPercentile( 0.0f ) == 1 );
+    TEST_ASSERT( h.GetPercentile( 0.5f ) == 2 );
+    TEST_ASSERT( h.GetPercentile( 1.0f ) == 3 );
+
+    // outliers only affect the upper percentiles
+    LatencyHistogram h2;
+    for ( uint32_t i = 0; i < 99; ++i )
+    {
+        h2.Record( 100 );
+    }
+    h2.Record( 60000 );
+    TEST_ASSERT( h2.GetPercentile( 0.5f ) < 120 );
+    TEST_ASSERT( h2.GetPercentile( 0.9f ) < 120 );
+    TEST_ASSERT( h2.GetPercentile( 1.0f ) > 50000 );
+
+    // extreme values
+    LatencyHistogram h3;
+    h3.Record( 0 );
+    h3.Record( 0xFFFFFFFF );
+    TEST_ASSERT( h3.GetPercentile( 0.0f ) == 0 );
+    TEST_ASSERT( h3.GetPercentile( 1.0f ) > 0x80000000 );
+}
+
+// HistogramAccuracy
+//------------------------------------------------------------------------------
+void TestAdaptiveRace::HistogramAccuracy() const
+{
+    // A single sample should be reported within the bucket precision
+    for ( uint32_t value = 1; value < 10000000; value = ( value * 3 ) + 1 )
+    {
+        LatencyHistogram h;
+        h.Record( value );
+        const uint32_t reported = h.GetPercentile( 0.5f );
+        TEST_ASSERT( (double)reported >= ( (double)value * 0.87 ) );
+        TEST_ASSERT( (double)reported <= ( (double)value * 1.13 ) );
+    }
+}
+
+// RaceBenefit
+//------------------------------------------------------------------------------
+void TestAdaptiveRace::RaceBenefit() const
+{
+    // Remote expected to return soon - not worth racing
+    TEST_ASSERT( JobQueue::GetLocalRaceBenefitMS( 1000, 900, 500 ) == 0 );
+
+    // Remote expected to take much longer than a local build
+    TEST_ASSERT( JobQueue::GetLocalRaceBenefitMS( 5000, 1000, 500 ) == 3500 );
+
+    // No remote history - race once in flight longer than a local build
+    TEST_ASSERT( JobQueue::GetLocalRaceBenefitMS( 0, 100, 500 ) == 0 );
+    TEST_ASSERT( JobQueue::GetLocalRaceBenefitMS( 0, 800, 500 ) == 300 );
+
+    // Remote is overdue - as above
+    TEST_ASSERT( JobQueue::GetLocalRaceBenefitMS( 1000, 1200, 500 ) == 700 );
+
+    // No local history - always race
+    TEST_ASSERT( JobQueue::GetLocalRaceBenefitMS( 1000, 900, 0 ) > 0 );
+    TEST_ASSERT( JobQueue::GetLocalRaceBenefitMS( 0, 0, 0 ) > 0 );
+}
+
+//------------------------------------------------------------------------------
@@ -6,16 +6,22 @@
 #include "FBuildTest.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 
 // Core
+#include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
+// system
+#include <memory.h> // for memcmp, memset
+
 // TestCache
 //------------------------------------------------------------------------------
 class TestCache : public FBuildTest
@@ -26,7 +32,12 @@ private:
     void Write() const;
     void Read() const;
     void ReadWrite() const;
+    void WriteAsync() const;
+    void ReadPrefetch() const;
     void ConsistentCacheKeysWithDist() const;
+    void Index() const;
+    void Mapped() const;
+    void Tiered() const;
 
     void LightCache_IncludeUsingMacro() const;
     void LightCache_IncludeHierarchy() const;
@@ -44,6 +55,7 @@ private:
 
     // Helpers
     void CheckForDependencies( const FBuildForTest & fBuild, const char * files[], size_t numFiles ) const;
+    void ClearCache( const char * cachePath ) const;
 
     TestCache & operator = ( TestCache & other ) = delete; // Avoid warnings about implicit deletion of operators
 };
@@ -54,7 +66,14 @@ REGISTER_TESTS_BEGIN( TestCache )
     REGISTER_TEST( Write )
     REGISTER_TEST( Read )
     REGISTER_TEST( ReadWrite )
+    REGISTER_TEST( WriteAsync )
+    #if defined( __WINDOWS__ )
+        REGISTER_TEST( ReadPrefetch ) // Prefetch requires the LightCache
+    #endif
     REGISTER_TEST( ConsistentCacheKeysWithDist )
+    REGISTER_TEST( Index )
+    REGISTER_TEST( Mapped )
+    REGISTER_TEST( Tiered )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( LightCache_IncludeUsingMacro )
         REGISTER_TEST( LightCache_IncludeHierarchy )
@@ -246,6 +265,93 @@ void TestCache::ReadWrite() const
     #endif
 }
 
+// WriteAsync
+//------------------------------------------------------------------------------
+void TestCache::WriteAsync() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/cache.bff";
+
+    // Write from background threads
+    {
+        options.m_UseCacheWrite = true;
+        options.m_CacheAsync = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        // Ensure cache was written to, in the background
+        const FBuildStats & stats = fBuild.GetStats();
+        const FBuildStats::Stats & objStats = stats.GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_NumAsyncCacheStores == objStats.m_NumCacheStores );
+        TEST_ASSERT( stats.m_NumAsyncCacheStoreFails == 0 );
+    }
+
+    // Everything was published before the build completed
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+        options.m_CacheAsync = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == 0 );
+    }
+}
+
+// ReadPrefetch
+//------------------------------------------------------------------------------
+void TestCache::ReadPrefetch() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_NumWorkerThreads = 4;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/lightcache.bff";
+
+    // Ensure the cache is populated
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+    }
+
+    // Read with lookups done before the jobs are built
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+        options.m_CachePrefetch = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        // Ensure everything was retrieved from the cache, via the prefetcher
+        const FBuildStats & stats = fBuild.GetStats();
+        const FBuildStats::Stats & objStats = stats.GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == 0 );
+        TEST_ASSERT( stats.GetLightCacheCount() == objStats.m_NumCacheHits );
+        TEST_ASSERT( stats.m_NumCachePrefetches == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_NumCachePrefetchHits == objStats.m_NumCacheHits );
+    }
+}
+
 // ConsistentCacheKeysWithDist
 //------------------------------------------------------------------------------
 void TestCache::ConsistentCacheKeysWithDist() const
@@ -312,6 +418,216 @@ void TestCache::ConsistentCacheKeysWithDist() const
     TEST_ASSERT( storeKey == hitKey );
 }
 
+// Index
+//------------------------------------------------------------------------------
+void TestCache::Index() const
+{
+    const AStackString<> cachePath( "../tmp/Test/Cache/Index/" );
+    const char * const cacheIds[] =
+    {
+        "0123456789ABCDEF_01234567_0123456789ABCDEF-0123456789ABCDEF.A",
+        "0123456789ABCDEF_01234567_FEDCBA9876543210-0123456789ABCDEF.A",
+        "FEDCBA9876543210_01234567_0123456789ABCDEF-0123456789ABCDEF.A",
+    };
+    char data[ 1024 ] = { 0 };
+
+    // Publish some entries (to an empty cache) and hit one of them
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+        for ( const char * cacheId : cacheIds )
+        {
+            TEST_ASSERT( cache.Publish( AStackString<>( cacheId ), data, sizeof( data ) ) );
+        }
+        void * retrievedData = nullptr;
+        size_t retrievedSize = 0;
+        TEST_ASSERT( cache.Retrieve( AStackString<>( cacheIds[ 0 ] ), retrievedData, retrievedSize ) );
+        TEST_ASSERT( retrievedSize == sizeof( data ) );
+        cache.FreeMemory( retrievedData, retrievedSize );
+        cache.Shutdown();
+    }
+
+    // Entries are found via the index
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.OutputInfo( false ) );
+        TEST_ASSERT( GetRecordedOutput().Find( " Total      |        3 |" ) );
+
+        // Nothing to trim
+        TEST_ASSERT( cache.Trim( false, 1 ) );
+        TEST_ASSERT( GetRecordedOutput().Find( " - After: 3 Files" ) );
+
+        // Trim everything
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+        TEST_ASSERT( GetRecordedOutput().Find( " - After: 0 Files" ) );
+        cache.Shutdown();
+    }
+    AStackString<> path;
+    for ( const char * cacheId : cacheIds )
+    {
+        path.Format( "%s%c%c/%c%c/%s", cachePath.Get(), cacheId[ 0 ], cacheId[ 1 ], cacheId[ 2 ], cacheId[ 3 ], cacheId );
+        TEST_ASSERT( FileIO::FileExists( path.Get() ) == false );
+    }
+
+    // Entries published by versions which don't use the index are found once
+    // their directories have changed since the journals were written
+    Thread::Sleep( 100 ); // ensure the directory times are later
+    for ( const char * cacheId : cacheIds )
+    {
+        path.Format( "%s%c%c/%c%c/%s", cachePath.Get(), cacheId[ 0 ], cacheId[ 1 ], cacheId[ 2 ], cacheId[ 3 ], cacheId );
+        FileStream f;
+        TEST_ASSERT( FileIO::EnsurePathExistsForFile( path ) && f.Open( path.Get(), FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( f.WriteBuffer( data, sizeof( data ) ) == sizeof( data ) );
+    }
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+        cache.Shutdown();
+    }
+    for ( const char * cacheId : cacheIds )
+    {
+        path.Format( "%s%c%c/%c%c/%s", cachePath.Get(), cacheId[ 0 ], cacheId[ 1 ], cacheId[ 2 ], cacheId[ 3 ], cacheId );
+        TEST_ASSERT( FileIO::FileExists( path.Get() ) == false );
+    }
+
+    // Entries published without the index are found when it's rebuilt
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty() ) );
+        for ( const char * cacheId : cacheIds )
+        {
+            TEST_ASSERT( cache.Publish( AStackString<>( cacheId ), data, sizeof( data ) ) );
+        }
+        cache.Shutdown();
+    }
+    for ( uint32_t shard = 0; shard < CacheIndex::NUM_SHARDS; ++shard )
+    {
+        path.Format( "%sindex/%02X.fbi", cachePath.Get(), shard );
+        FileIO::FileDelete( path.Get() );
+    }
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+        cache.Shutdown();
+    }
+    for ( const char * cacheId : cacheIds )
+    {
+        path.Format( "%s%c%c/%c%c/%s", cachePath.Get(), cacheId[ 0 ], cacheId[ 1 ], cacheId[ 2 ], cacheId[ 3 ], cacheId );
+        TEST_ASSERT( FileIO::FileExists( path.Get() ) == false );
+    }
+}
+
+// Mapped
+//------------------------------------------------------------------------------
+void TestCache::Mapped() const
+{
+    const AStackString<> cachePath( "../tmp/Test/Cache/Mapped/" );
+    const AStackString<> cacheId( "0123456789ABCDEF_01234567_0123456789ABCDEF-0123456789ABCDEF.A" );
+    char data[ 1024 ];
+    memset( data, 'x', sizeof( data ) );
+
+    Cache cache;
+    TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty() ) );
+    TEST_ASSERT( cache.Publish( cacheId, data, sizeof( data ) ) );
+
+    // Entries are copied from a cache which could be on a network share
+    const void * retrievedData = nullptr;
+    size_t retrievedSize = 0;
+    bool isMapped = true;
+    TEST_ASSERT( cache.RetrieveMapped( cacheId, retrievedData, retrievedSize, isMapped ) );
+    TEST_ASSERT( isMapped == false );
+    TEST_ASSERT( ( retrievedSize == sizeof( data ) ) && ( memcmp( retrievedData, data, sizeof( data ) ) == 0 ) );
+    cache.ReleaseMapped( retrievedData, retrievedSize, isMapped );
+
+    // Entries are read in place from a local cache
+    cache.SetIsLocal( true );
+    TEST_ASSERT( cache.RetrieveMapped( cacheId, retrievedData, retrievedSize, isMapped ) );
+    TEST_ASSERT( isMapped );
+    TEST_ASSERT( ( retrievedSize == sizeof( data ) ) && ( memcmp( retrievedData, data, sizeof( data ) ) == 0 ) );
+    cache.ReleaseMapped( retrievedData, retrievedSize, isMapped );
+
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    cache.Shutdown();
+}
+
+// Tiered
+//------------------------------------------------------------------------------
+void TestCache::Tiered() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Tiered/fbuild.bff";
+
+    const char * const localCachePath = "../tmp/Test/Cache/Tiered/LocalCache/";
+
+    // Write to both caches
+    ClearCache( localCachePath );
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+    }
+
+    // Read from the local cache
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats & stats = fBuild.GetStats();
+        const FBuildStats::Stats & objStats = stats.GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_NumLocalCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_NumSharedCacheHits == 0 );
+    }
+
+    // Read from the shared cache when the local cache is empty, which copies
+    // the entries to the local cache
+    ClearCache( localCachePath );
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats & stats = fBuild.GetStats();
+        const FBuildStats::Stats & objStats = stats.GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_NumLocalCacheHits == 0 );
+        TEST_ASSERT( stats.m_NumSharedCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_NumLocalCachePromotions == objStats.m_NumProcessed );
+    }
+
+    // Read the promoted entries from the local cache
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats & stats = fBuild.GetStats();
+        const FBuildStats::Stats & objStats = stats.GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_NumLocalCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_NumSharedCacheHits == 0 );
+    }
+}
+
 // LightCache_IncludeUsingMacro
 //------------------------------------------------------------------------------
 // Files can be included via a macro
@@ -762,4 +1078,14 @@ void TestCache::CheckForDependencies( const FBuildForTest & fBuild, const char *
     }
 }
 
+// ClearCache
+//------------------------------------------------------------------------------
+void TestCache::ClearCache( const char * cachePath ) const
+{
+    Cache cache;
+    TEST_ASSERT( cache.Init( AStackString<>( cachePath ), AString::GetEmpty() ) );
+    TEST_ASSERT( cache.Trim( false, 0 ) );
+    cache.Shutdown();
+}
+
 //------------------------------------------------------------------------------
@@ -0,0 +1,316 @@
+// TestChunkStore.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Helpers/ChunkStore.h"
+
+#include "Core/Containers/AutoPtr.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Strings/AString.h"
+#include "Core/Tracing/Tracing.h"
+
+#include <memory.h>
+
+// TestChunkStore
+//------------------------------------------------------------------------------
+class TestChunkStore : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void Split() const;
+    void RoundTrip() const;
+    void Modified() const;
+    void MissingChunk() const;
+    void BadHash() const;
+    void DuplicateChunk() const;
+    void Budget() const;
+
+    void LoadFile( const char * fileName, AutoPtr< char > & outData, uint32_t & outDataSize ) const;
+    void EncodeDecode( ChunkStore & clientStore,
+                       ChunkStore & serverStore,
+                       const char * data,
+                       uint32_t dataSize,
+                       uint32_t & outEncodedSize ) const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestChunkStore )
+    REGISTER_TEST( Split )
+    REGISTER_TEST( RoundTrip )
+    REGISTER_TEST( Modified )
+    REGISTER_TEST( MissingChunk )
+    REGISTER_TEST( BadHash )
+    REGISTER_TEST( DuplicateChunk )
+    REGISTER_TEST( Budget )
+REGISTER_TESTS_END
+
+// Split
+//------------------------------------------------------------------------------
+void TestChunkStore::Split() const
+{
+    // Build data with line directives in both MSVC and GCC/Clang styles
+    AString data;
+    AString padding;
+    padding.SetLength( 300 );
+    memset( padding.Get(), 'x', padding.GetLength() );
+    data += "#line 1 \"a.h\"\n";
+    data += padding;
+    data += "\n#line 1 \"b.h\"\n";      // chunk boundary
+    data += padding;
+    data += "\n# 1 \"c.h\"\n";          // chunk boundary
+    data += "int c;\n";
+    data += "#line 3 \"c.h\"\n";        // too close to the previous and next boundaries
+    data += "int d;\n";
+    data += "#line 5 \"c.h\"\n";        // chunk boundary (before a large section)
+    data += padding;
+    data += "\n#pragma once\n";         // not a line directive
+    data += padding;
+    data += "\n";
+
+    Array< uint32_t > chunkEnds( 0, true );
+    ChunkStore::Split( data.Get(), data.GetLength(), chunkEnds );
+    TEST_ASSERT( chunkEnds.GetSize() == 4 );
+    TEST_ASSERT( AString::StrNCmp( data.Get() + chunkEnds[ 0 ], "#line 1 \"b.h\"", 13 ) == 0 );
+    TEST_ASSERT( AString::StrNCmp( data.Get() + chunkEnds[ 1 ], "# 1 \"c.h\"", 9 ) == 0 );
+    TEST_ASSERT( AString::StrNCmp( data.Get() + chunkEnds[ 2 ], "#line 5 \"c.h\"", 13 ) == 0 );
+    TEST_ASSERT( chunkEnds[ 3 ] == data.GetLength() );
+
+    // Directives at the start of a file are kept out of the first large section
+    // (they name the translation unit, so would stop it matching in others)
+    AString prelude;
+    prelude += "# 1 \"File01.cpp\"\n";
+    prelude += "# 1 \"<built-in>\"\n";
+    prelude += "# 1 \"Shared.h\" 1\n";   // chunk boundary
+    prelude += padding;
+    prelude += "\n# 2 \"File01.cpp\" 2\n"; // chunk boundary
+    prelude += "int a;\n";
+    ChunkStore::Split( prelude.Get(), prelude.GetLength(), chunkEnds );
+    TEST_ASSERT( chunkEnds.GetSize() == 3 );
+    TEST_ASSERT( AString::StrNCmp( prelude.Get() + chunkEnds[ 0 ], "# 1 \"Shared.h\"", 14 ) == 0 );
+    TEST_ASSERT( AString::StrNCmp( prelude.Get() + chunkEnds[ 1 ], "# 2 \"File01.cpp\"", 16 ) == 0 );
+    TEST_ASSERT( chunkEnds[ 2 ] == prelude.GetLength() );
+
+    // Empty data has no chunks
+    ChunkStore::Split( data.Get(), 0, chunkEnds );
+    TEST_ASSERT( chunkEnds.IsEmpty() );
+}
+
+// RoundTrip
+//------------------------------------------------------------------------------
+void TestChunkStore::RoundTrip() const
+{
+    AutoPtr< char > data;
+    uint32_t dataSize;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data, dataSize );
+
+    ChunkStore clientStore( false );
+    ChunkStore serverStore( true );
+
+    // First time, everything is sent
+    uint32_t firstSize;
+    EncodeDecode( clientStore, serverStore, data.Get(), dataSize, firstSize );
+    TEST_ASSERT( firstSize > dataSize );
+    TEST_ASSERT( clientStore.GetNumChunks() > 1 );
+    TEST_ASSERT( clientStore.GetNumChunks() == serverStore.GetNumChunks() );
+    TEST_ASSERT( clientStore.GetBytesStored() == serverStore.GetBytesStored() );
+
+    // Second time, only references are sent
+    uint32_t secondSize;
+    EncodeDecode( clientStore, serverStore, data.Get(), dataSize, secondSize );
+    TEST_ASSERT( clientStore.GetBytesReferenced() >= dataSize );
+    TEST_ASSERT( secondSize < ( dataSize / 20 ) );
+
+    OUTPUT( "Size           : %u\n", dataSize );
+    OUTPUT( "Chunks         : %u\n", clientStore.GetNumChunks() );
+    OUTPUT( "Encoded (1st)  : %u\n", firstSize );
+    OUTPUT( "Encoded (2nd)  : %u\n", secondSize );
+}
+
+// Modified
+//------------------------------------------------------------------------------
+void TestChunkStore::Modified() const
+{
+    AutoPtr< char > data;
+    uint32_t dataSize;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data, dataSize );
+
+    ChunkStore clientStore( false );
+    ChunkStore serverStore( true );
+
+    uint32_t firstSize;
+    EncodeDecode( clientStore, serverStore, data.Get(), dataSize, firstSize );
+
+    // Change a byte near the end, as if the main file was edited
+    data.Get()[ dataSize - 2 ] = ( data.Get()[ dataSize - 2 ] == 'A' ) ? 'B' : 'A';
+
+    // Only the modified chunk is sent again
+    uint32_t secondSize;
+    EncodeDecode( clientStore, serverStore, data.Get(), dataSize, secondSize );
+    TEST_ASSERT( secondSize < ( dataSize / 2 ) );
+    TEST_ASSERT( clientStore.GetNumChunks() == serverStore.GetNumChunks() );
+}
+
+// MissingChunk
+//------------------------------------------------------------------------------
+void TestChunkStore::MissingChunk() const
+{
+    AutoPtr< char > data;
+    uint32_t dataSize;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data, dataSize );
+
+    // Client believes the server has the chunks
+    ChunkStore clientStore( false );
+    MemoryStream first;
+    clientStore.Encode( data.Get(), dataSize, first );
+    MemoryStream second;
+    clientStore.Encode( data.Get(), dataSize, second );
+
+    // A server which has not seen the chunks must fail gracefully
+    ChunkStore serverStore( true );
+    ConstMemoryStream ms( second.GetData(), second.GetSize() );
+    void * decoded = nullptr;
+    uint32_t decodedSize = 0;
+    TEST_ASSERT( serverStore.Decode( ms, decoded, decodedSize ) == false );
+    TEST_ASSERT( decoded == nullptr );
+
+    // Truncated data must also fail gracefully
+    ConstMemoryStream truncated( first.GetData(), first.GetSize() / 2 );
+    TEST_ASSERT( serverStore.Decode( truncated, decoded, decodedSize ) == false );
+    TEST_ASSERT( decoded == nullptr );
+}
+
+// BadHash
+//------------------------------------------------------------------------------
+void TestChunkStore::BadHash() const
+{
+    AutoPtr< char > data;
+    uint32_t dataSize;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data, dataSize );
+
+    ChunkStore clientStore( false );
+    MemoryStream encoded;
+    clientStore.Encode( data.Get(), dataSize, encoded );
+
+    // Corrupt the hash of the first chunk (after dataSize, numChunks and type)
+    char * hash = (char *)encoded.GetData() + sizeof( uint32_t ) + sizeof( uint32_t ) + sizeof( uint8_t );
+    TEST_ASSERT( *( (const uint8_t *)hash - 1 ) == 1 ); // CHUNK_STORE
+    hash[ 0 ] ^= 0xFF;
+
+    // The chunk must not be stored under the wrong hash
+    ChunkStore serverStore( true );
+    ConstMemoryStream ms( encoded.GetData(), encoded.GetSize() );
+    void * decoded = nullptr;
+    uint32_t decodedSize = 0;
+    TEST_ASSERT( serverStore.Decode( ms, decoded, decodedSize ) == false );
+    TEST_ASSERT( decoded == nullptr );
+}
+
+// DuplicateChunk
+//------------------------------------------------------------------------------
+void TestChunkStore::DuplicateChunk() const
+{
+    AutoPtr< char > data;
+    uint32_t dataSize;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data, dataSize );
+
+    ChunkStore clientStore( false );
+    ChunkStore serverStore( true );
+    uint32_t encodedSize;
+    EncodeDecode( clientStore, serverStore, data.Get(), dataSize, encodedSize );
+
+    // A client out of sync with the server sends the same chunks to store again
+    ChunkStore otherClientStore( false );
+    MemoryStream encoded;
+    otherClientStore.Encode( data.Get(), dataSize, encoded );
+    ConstMemoryStream ms( encoded.GetData(), encoded.GetSize() );
+    void * decoded = nullptr;
+    uint32_t decodedSize = 0;
+    TEST_ASSERT( serverStore.Decode( ms, decoded, decodedSize ) == false );
+    TEST_ASSERT( decoded == nullptr );
+}
+
+// Budget
+//------------------------------------------------------------------------------
+void TestChunkStore::Budget() const
+{
+    AutoPtr< char > data;
+    uint32_t dataSize;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data, dataSize );
+
+    // Chunks beyond the budget are sent inline
+    {
+        ChunkStore clientStore( false );
+        ChunkStore serverStore( true );
+        clientStore.SetMaxBytesStored( dataSize / 2 );
+        serverStore.SetMaxBytesStored( dataSize / 2 );
+
+        uint32_t encodedSize;
+        EncodeDecode( clientStore, serverStore, data.Get(), dataSize, encodedSize );
+        TEST_ASSERT( clientStore.GetBytesStored() > 0 );
+        TEST_ASSERT( clientStore.GetBytesStored() <= ( dataSize / 2 ) );
+        TEST_ASSERT( clientStore.GetNumChunks() == serverStore.GetNumChunks() );
+        TEST_ASSERT( clientStore.GetBytesStored() == serverStore.GetBytesStored() );
+
+        // Stored chunks are still referenced
+        EncodeDecode( clientStore, serverStore, data.Get(), dataSize, encodedSize );
+        TEST_ASSERT( clientStore.GetBytesReferenced() >= clientStore.GetBytesStored() );
+    }
+
+    // A client sending more than the server's budget fails to decode
+    {
+        ChunkStore clientStore( false );
+        ChunkStore serverStore( true );
+        serverStore.SetMaxBytesStored( dataSize / 2 );
+
+        MemoryStream encoded;
+        clientStore.Encode( data.Get(), dataSize, encoded );
+        ConstMemoryStream ms( encoded.GetData(), encoded.GetSize() );
+        void * decoded = nullptr;
+        uint32_t decodedSize = 0;
+        TEST_ASSERT( serverStore.Decode( ms, decoded, decodedSize ) == false );
+        TEST_ASSERT( decoded == nullptr );
+        TEST_ASSERT( serverStore.GetBytesStored() <= ( dataSize / 2 ) );
+    }
+}
+
+// LoadFile
+//------------------------------------------------------------------------------
+void TestChunkStore::LoadFile( const char * fileName, AutoPtr< char > & outData, uint32_t & outDataSize ) const
+{
+    FileStream fs;
+    TEST_ASSERT( fs.Open( fileName ) );
+    outDataSize = (uint32_t)fs.GetFileSize();
+    outData = (char *)ALLOC( outDataSize );
+    TEST_ASSERT( (uint32_t)fs.Read( outData.Get(), outDataSize ) == outDataSize );
+}
+
+// EncodeDecode
+//------------------------------------------------------------------------------
+void TestChunkStore::EncodeDecode( ChunkStore & clientStore,
+                                   ChunkStore & serverStore,
+                                   const char * data,
+                                   uint32_t dataSize,
+                                   uint32_t & outEncodedSize ) const
+{
+    MemoryStream encoded;
+    clientStore.Encode( data, dataSize, encoded );
+    outEncodedSize = (uint32_t)encoded.GetSize();
+
+    ConstMemoryStream ms( encoded.GetData(), encoded.GetSize() );
+    void * decoded = nullptr;
+    uint32_t decodedSize = 0;
+    TEST_ASSERT( serverStore.Decode( ms, decoded, decodedSize ) );
+    AutoPtr< char > decodedData( (char *)decoded );
+    TEST_ASSERT( decodedSize == dataSize );
+    TEST_ASSERT( memcmp( data, decodedData.Get(), dataSize ) == 0 );
+    TEST_ASSERT( ms.Tell() == ms.GetSize() );
+}
+
+//------------------------------------------------------------------------------
@@ -5,10 +5,13 @@
 //------------------------------------------------------------------------------
 #include "FBuildTest.h"
 
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 
 #include "Core/Containers/AutoPtr.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
@@ -25,13 +28,15 @@ private:
     void CompressSimple() const;
     void CompressPreprocessedFile() const;
     void CompressObjFile() const;
+    void CompressWithDictionary() const;
+    void CompressBlocks() const;
     void TestHeaderValidity() const;
 
     void CompressSimpleHelper( const char * data,
                                size_t size,
                                size_t expectedCompressedSize,
                                bool shouldCompress ) const;
-    void CompressHelper( const char * fileName ) const;
+    void CompressHelper( const char * fileName, Compressor::CompressionType type ) const;
 };
 
 // Register Tests
@@ -40,6 +45,8 @@ REGISTER_TESTS_BEGIN( TestCompressor )
     REGISTER_TEST( CompressSimple );
     REGISTER_TEST( CompressPreprocessedFile )
     REGISTER_TEST( CompressObjFile )
+    REGISTER_TEST( CompressWithDictionary )
+    REGISTER_TEST( CompressBlocks )
     REGISTER_TEST( TestHeaderValidity )
 REGISTER_TESTS_END
 
@@ -109,18 +116,20 @@ void TestCompressor::CompressSimpleHelper( const char * data,
 //------------------------------------------------------------------------------
 void TestCompressor::CompressPreprocessedFile() const
 {
-    CompressHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" );
+    CompressHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", Compressor::COMPRESSION_TYPE_LZ4 );
+    CompressHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", Compressor::COMPRESSION_TYPE_LZ4HC );
 }
 
 //------------------------------------------------------------------------------
 void TestCompressor::CompressObjFile() const
 {
-    CompressHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestObjFile.o" );
+    CompressHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestObjFile.o", Compressor::COMPRESSION_TYPE_LZ4 );
+    CompressHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestObjFile.o", Compressor::COMPRESSION_TYPE_LZ4HC );
 }
 
 // CompressHelper
 //------------------------------------------------------------------------------
-void TestCompressor::CompressHelper( const char * fileName ) const
+void TestCompressor::CompressHelper( const char * fileName, Compressor::CompressionType type ) const
 {
     // read some test data into a file
     AutoPtr< void > data;
@@ -134,11 +143,12 @@ void TestCompressor::CompressHelper( const char * fileName ) const
     }
 
     OUTPUT( "File           : %s\n", fileName );
+    OUTPUT( "Type           : %s\n", ( type == Compressor::COMPRESSION_TYPE_LZ4HC ) ? "LZ4HC" : "LZ4" );
     OUTPUT( "Size           : %u\n", (uint32_t)dataSize );
 
     // compress the data to obtain size
     Compressor comp;
-    comp.Compress( data.Get(), dataSize );
+    comp.Compress( data.Get(), dataSize, type );
     size_t compressedSize = comp.GetResultSize();
     AutoPtr< char > compressedData( (char *)ALLOC( compressedSize ) );
     memcpy( compressedData.Get(), comp.GetResult(), compressedSize );
@@ -154,14 +164,14 @@ void TestCompressor::CompressHelper( const char * fileName ) const
 
     // speed checks
     //--------------
-    const uint32_t numRepeats = 50;
+    const uint32_t numRepeats = ( type == Compressor::COMPRESSION_TYPE_LZ4HC ) ? 5 : 50; // LZ4HC is much slower to compress
 
     // compress the data several times to get more stable throughput value
     Timer t;
     for ( uint32_t i = 0; i < numRepeats; ++i )
     {
         Compressor c;
-        c.Compress( data.Get(), dataSize );
+        c.Compress( data.Get(), dataSize, type );
         TEST_ASSERT( c.GetResultSize() == compressedSize );
     }
     float compressTimeTaken = t.GetElapsed();
@@ -193,6 +203,172 @@ void TestCompressor::CompressHelper( const char * fileName ) const
     OUTPUT( "   MemCpy Speed: %2.1f MB/s - %2.3fs (%u repeats)\n", (double)memcpyThroughputMBs, (double)memcpyTimeTaken, numRepeats );
 }
 
+// CompressWithDictionary
+//------------------------------------------------------------------------------
+void TestCompressor::CompressWithDictionary() const
+{
+    // read some test data into a file
+    AutoPtr< char > data;
+    size_t dataSize;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" ) );
+        dataSize = (size_t)fs.GetFileSize();
+        data = (char *)ALLOC( dataSize );
+        TEST_ASSERT( (uint32_t)fs.Read( data.Get(), dataSize ) == dataSize );
+    }
+
+    // train on blocks from the first half, as if they were separate jobs
+    const uint32_t blockSize = ( 32 * 1024 );
+    const size_t half = ( dataSize / 2 );
+    Array< uint32_t > sampleSizes( 0, true );
+    for ( size_t pos = 0; ( pos + blockSize ) <= half; pos += blockSize )
+    {
+        sampleSizes.Append( blockSize );
+    }
+    Timer trainTimer;
+    CompressionDictionary dictionary;
+    dictionary.Train( data.Get(), sampleSizes );
+    const float trainTimeTaken = trainTimer.GetElapsed();
+    TEST_ASSERT( dictionary.IsEmpty() == false );
+    TEST_ASSERT( dictionary.GetSize() <= CompressionDictionary::MAX_SIZE );
+    OUTPUT( "Dictionary     : %u bytes from %u samples - %2.3fs\n", dictionary.GetSize(), (uint32_t)sampleSizes.GetSize(), (double)trainTimeTaken );
+
+    // compress blocks from the second half, with and without the dictionary
+    for ( uint32_t i = 0; i < 4; ++i )
+    {
+        const Compressor::CompressionType type = ( i & 1 ) ? Compressor::COMPRESSION_TYPE_LZ4HC : Compressor::COMPRESSION_TYPE_LZ4;
+        const CompressionDictionary * dict = ( i & 2 ) ? &dictionary : nullptr;
+
+        size_t uncompressedSize = 0;
+        size_t compressedSize = 0;
+        Timer t;
+        for ( size_t pos = half; ( pos + blockSize ) <= dataSize; pos += blockSize )
+        {
+            Compressor c;
+            c.Compress( data.Get() + pos, blockSize, type, dict );
+            uncompressedSize += blockSize;
+            compressedSize += c.GetResultSize();
+
+            // check we get the original data back
+            Compressor d;
+            TEST_ASSERT( d.Decompress( c.GetResult(), dict ) );
+            TEST_ASSERT( d.GetResultSize() == blockSize );
+            TEST_ASSERT( memcmp( data.Get() + pos, d.GetResult(), blockSize ) == 0 );
+        }
+        const float timeTaken = t.GetElapsed();
+        const double throughputMBs = ( ( (double)uncompressedSize / 1024.0 ) / (double)timeTaken ) / 1024.0;
+        OUTPUT( "%-5s %-9s: %u -> %u (%2.1f%% of original) - %2.1f MB/s (inc. decompression)\n",
+                ( type == Compressor::COMPRESSION_TYPE_LZ4HC ) ? "LZ4HC" : "LZ4",
+                dict ? "(dict)" : "",
+                (uint32_t)uncompressedSize,
+                (uint32_t)compressedSize,
+                (double)( ( (float)compressedSize / (float)uncompressedSize ) * 100.0f ),
+                throughputMBs );
+    }
+
+    // data compressed with a dictionary can't be decompressed without it
+    Compressor c;
+    TEST_ASSERT( c.Compress( data.Get() + half, blockSize, Compressor::COMPRESSION_TYPE_LZ4, &dictionary ) );
+    Compressor d;
+    TEST_ASSERT( d.Decompress( c.GetResult() ) == false );
+}
+
+// CompressBlocks
+//------------------------------------------------------------------------------
+void TestCompressor::CompressBlocks() const
+{
+    // build a buffer spanning many blocks (and ending in a partial one) from some test data
+    AutoPtr< char > data;
+    const size_t dataSize = ( ( 32 * Compressor::BLOCK_SIZE ) + 12345 );
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" ) );
+        const size_t fileSize = (size_t)fs.GetFileSize();
+        data = (char *)ALLOC( dataSize );
+        for ( size_t pos = 0; pos < dataSize; pos += fileSize )
+        {
+            const size_t size = Math::Min( fileSize, dataSize - pos );
+            TEST_ASSERT( fs.Seek( 0 ) );
+            TEST_ASSERT( (size_t)fs.Read( data.Get() + pos, size ) == size );
+        }
+    }
+
+    // output doesn't depend on the number of threads
+    Compressor reference;
+    reference.CompressBlocks( data.Get(), dataSize, Compressor::COMPRESSION_TYPE_LZ4, 1 );
+    TEST_ASSERT( reference.IsValidData( reference.GetResult(), reference.GetResultSize() ) );
+    TEST_ASSERT( reference.IsValidData( reference.GetResult(), reference.GetResultSize() - 1 ) == false );
+    const uint32_t threadCounts[] = { 2, 4, 0 };
+    for ( const uint32_t numThreads : threadCounts )
+    {
+        Timer t;
+        Compressor c;
+        c.CompressBlocks( data.Get(), dataSize, Compressor::COMPRESSION_TYPE_LZ4, numThreads );
+        const float timeTaken = t.GetElapsed();
+        TEST_ASSERT( c.GetResultSize() == reference.GetResultSize() );
+        TEST_ASSERT( memcmp( c.GetResult(), reference.GetResult(), c.GetResultSize() ) == 0 );
+        const double throughputMBs = ( ( (double)dataSize / 1024.0 ) / (double)timeTaken ) / 1024.0;
+        OUTPUT( "Blocks (%u threads): %u -> %u - %2.1f MB/s\n", numThreads, (uint32_t)dataSize, (uint32_t)c.GetResultSize(), throughputMBs );
+    }
+
+    // decompress in memory
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( reference.GetResult() ) );
+        TEST_ASSERT( d.GetResultSize() == dataSize );
+        TEST_ASSERT( memcmp( d.GetResult(), data.Get(), dataSize ) == 0 );
+    }
+
+    // compress and decompress via streams
+    {
+        MemoryStream compressed;
+        TEST_ASSERT( Compressor::CompressBlocks( data.Get(), dataSize, compressed, Compressor::COMPRESSION_TYPE_LZ4HC ) );
+        ConstMemoryStream input( compressed.GetData(), compressed.GetSize() );
+        MemoryStream output;
+        TEST_ASSERT( Compressor::Decompress( input, output ) );
+        TEST_ASSERT( output.GetSize() == dataSize );
+        TEST_ASSERT( memcmp( output.GetData(), data.Get(), dataSize ) == 0 );
+    }
+
+    // streaming decompression of data from Compress
+    {
+        Compressor c;
+        c.Compress( data.Get(), Compressor::BLOCK_SIZE );
+        ConstMemoryStream input( c.GetResult(), c.GetResultSize() );
+        MemoryStream output;
+        TEST_ASSERT( Compressor::Decompress( input, output ) );
+        TEST_ASSERT( output.GetSize() == Compressor::BLOCK_SIZE );
+        TEST_ASSERT( memcmp( output.GetData(), data.Get(), Compressor::BLOCK_SIZE ) == 0 );
+    }
+
+    // truncated stream
+    {
+        ConstMemoryStream input( reference.GetResult(), reference.GetResultSize() - 1 );
+        MemoryStream output;
+        TEST_ASSERT( Compressor::Decompress( input, output ) == false );
+    }
+
+    // decompression from memory to a stream (block frames and data from Compress)
+    {
+        MemoryStream output;
+        TEST_ASSERT( Compressor::Decompress( reference.GetResult(), reference.GetResultSize(), output ) );
+        TEST_ASSERT( output.GetSize() == dataSize );
+        TEST_ASSERT( memcmp( output.GetData(), data.Get(), dataSize ) == 0 );
+
+        Compressor c;
+        c.Compress( data.Get(), Compressor::BLOCK_SIZE );
+        MemoryStream output2;
+        TEST_ASSERT( Compressor::Decompress( c.GetResult(), c.GetResultSize(), output2 ) );
+        TEST_ASSERT( output2.GetSize() == Compressor::BLOCK_SIZE );
+        TEST_ASSERT( memcmp( output2.GetData(), data.Get(), Compressor::BLOCK_SIZE ) == 0 );
+
+        // truncated
+        MemoryStream output3;
+        TEST_ASSERT( Compressor::Decompress( reference.GetResult(), reference.GetResultSize() - 1, output3 ) == false );
+    }
+}
+
 // TestHeaderValidity
 //------------------------------------------------------------------------------
 void TestCompressor::TestHeaderValidity() const
@@ -221,6 +397,45 @@ void TestCompressor::TestHeaderValidity() const
     data[1] = 8; // uncompressed
     data[2] = 32; // compressed
     TEST_ASSERT( c.IsValidData( buffer.Get(), 44 ) == false );
+
+    // LZ4HC compressed data
+    data[0] = 2;
+    data[1] = 32; // uncompressed
+    data[2] = 8; // compressed
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 20 ) );
+
+    // compressed with a dictionary
+    data[0] = ( 1 | ( 1 << 8 ) );
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 20 ) );
+
+    // INVALID data - unknown compression type
+    data[0] = 3;
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 20 ) == false );
+
+    // INVALID data - unknown flags
+    data[0] = ( 1 | ( 4 << 8 ) );
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 20 ) == false );
+
+    // block frame - 2 blocks of 8 bytes, one compressed and one stored
+    data[0] = ( 1 | ( 2 << 8 ) );
+    data[1] = 16; // uncompressed
+    data[2] = 8; // block size
+    data[3] = 4; // first block compressed
+    data[5] = 8; // second block stored
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 32 ) );
+
+    // INVALID data - block frame with missing or trailing data
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 28 ) == false );
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 36 ) == false );
+
+    // INVALID data - block bigger than block size
+    data[5] = 9;
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 33 ) == false );
+
+    // INVALID data - block frame with a dictionary
+    data[5] = 8;
+    data[0] = ( 1 | ( 3 << 8 ) );
+    TEST_ASSERT( c.IsValidData( buffer.Get(), 32 ) == false );
 }
 
 //------------------------------------------------------------------------------
@@ -39,6 +39,7 @@ private:
     void MissingTrailingSlash() const;
     void ObjectListChaining() const;
     void ObjectListChaining2() const;
+    void ResourceLimits() const;
 };
 
 // Register Tests
@@ -65,6 +66,7 @@ REGISTER_TESTS_BEGIN( TestCopy )
     REGISTER_TEST( MissingTrailingSlash )
     REGISTER_TEST( ObjectListChaining )
     REGISTER_TEST( ObjectListChaining2 )
+    REGISTER_TEST( ResourceLimits )
 REGISTER_TESTS_END
 
 // TestCopyFunction_FileToFile
@@ -719,4 +721,32 @@ void TestCopy::ObjectListChaining2() const
     TEST_ASSERT( depGraphText1 == depGraphText2 );
 }
 
+// ResourceLimits
+//------------------------------------------------------------------------------
+void TestCopy::ResourceLimits() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCopy/ResourceLimits/fbuild.bff";
+    options.m_NumWorkerThreads = 4;
+
+    // Jobs exceeding the budgets must wait rather than stall the build
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( "All" ) );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode( 1, 1, Node::OBJECT_LIST_NODE );
+    CheckStatsNode( 8, 8, Node::OBJECT_NODE );
+    CheckStatsNode( 3, 3, Node::LIBRARY_NODE );
+    CheckStatsNode( 1, 1, Node::COPY_DIR_NODE );
+    CheckStatsNode( 2, 2, Node::COPY_FILE_NODE );
+
+    // Budgets were never exceeded (but were used)
+    const FBuildStats & stats = fBuild.GetStats();
+    TEST_ASSERT( stats.m_PeakLocalLinkJobs == 1 );
+    TEST_ASSERT( stats.m_PeakLocalCopyJobs == 1 );
+    TEST_ASSERT( stats.m_PeakLocalJobMemoryMiB == 60 );
+}
+
 //------------------------------------------------------------------------------
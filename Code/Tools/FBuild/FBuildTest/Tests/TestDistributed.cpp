@@ -6,22 +6,236 @@
 #include "Tools/FBuild/FBuildTest/Tests/FBuildTest.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/LibraryNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerage.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
+#include "Core/Env/Env.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
 
 // Defines
 //------------------------------------------------------------------------------
 #define TEST_PROTOCOL_PORT ( Protocol::PROTOCOL_PORT + 1 ) // Avoid conflict with real worker
+#define TEST_PEER_PORT ( Protocol::PROTOCOL_PORT + 2 ) // Second worker, to copy toolchains from
 
 #if !defined( __has_feature )
     #define __has_feature( ... ) 0
 #endif
 
+// TestDistributedClient - Emulates a Client, to control when jobs are sent and cancelled
+//------------------------------------------------------------------------------
+class TestDistributedClient : public TCPConnectionPool
+{
+public:
+    ~TestDistributedClient() { ShutdownAllConnections(); }
+    virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t, bool & )
+    {
+        // none of the messages we expect have a payload
+        const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+        if ( msg->GetType() == Protocol::MSG_REQUEST_JOBS )
+        {
+            const Protocol::MsgRequestJobs * request = static_cast< const Protocol::MsgRequestJobs * >( msg );
+            m_AcceptsCancellation = request->AcceptsCancellation();
+            AtomicAddU32( &m_NumJobsRequested, (int32_t)request->GetNumJobs() );
+            AtomicIncU32( &m_NumRequestMessages );
+        }
+        else if ( msg->GetType() == Protocol::MSG_CANCEL_JOB )
+        {
+            AtomicStoreRelaxed( &m_CancelledJobId, static_cast< const Protocol::MsgCancelJob * >( msg )->GetJobId() );
+        }
+    }
+    volatile uint32_t   m_NumJobsRequested = 0;
+    volatile uint32_t   m_NumRequestMessages = 0;
+    volatile uint32_t   m_CancelledJobId = 0;
+    bool                m_AcceptsCancellation = false;
+};
+
+// TestDistributedStreamingServer - Emulates a Server which streams results, failing part way through the first
+//------------------------------------------------------------------------------
+class TestDistributedStreamingServer : public TCPConnectionPool
+{
+public:
+    ~TestDistributedStreamingServer() { ShutdownAllConnections(); }
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & )
+    {
+        if ( m_ExpectingJobPayload )
+        {
+            // payload starts with the job id and name
+            m_ExpectingJobPayload = false;
+            ConstMemoryStream ms( data, size );
+            uint32_t jobId = 0;
+            AStackString<> name;
+            ms.Read( jobId );
+            ms.Read( name );
+            SendResult( connection, jobId, name );
+            RequestJob( connection );
+            return;
+        }
+
+        const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+        switch ( msg->GetType() )
+        {
+            case Protocol::MSG_CONNECTION:
+            {
+                RequestJob( connection );
+                break;
+            }
+            case Protocol::MSG_NO_JOB_AVAILABLE:
+            {
+                // keep asking until the jobs are ready to be distributed
+                Thread::Sleep( 10 );
+                RequestJob( connection );
+                break;
+            }
+            case Protocol::MSG_JOB:
+            {
+                m_ExpectingJobPayload = true;
+                break;
+            }
+            default: break;
+        }
+    }
+    static void RequestJob( const ConnectionInfo * connection )
+    {
+        Protocol::MsgRequestJob msg;
+        msg.Send( connection );
+    }
+    void SendResult( const ConnectionInfo * connection, uint32_t jobId, const AString & name )
+    {
+        // the first job fails after the start of the object file is sent
+        const bool fail = ( m_FailedJobId == 0 );
+        if ( fail )
+        {
+            m_FailedJobId = jobId;
+            m_FailedJobName = name;
+        }
+        else
+        {
+            ++m_NumJobsStreamed;
+        }
+
+        char buffer[ 1024 ] = { 0 };
+        Compressor c;
+        c.Compress( buffer, sizeof( buffer ) );
+        TCPConnectionPool::SendBuffer payload;
+        payload.size = (uint32_t)c.GetResultSize();
+        payload.data = c.GetResult();
+        Protocol::MsgJobResultChunk chunkMsg( jobId, 0, ( fail == false ) );
+        chunkMsg.Send( connection, &payload, 1 );
+
+        Array< AString > messages( 1, false );
+        if ( fail )
+        {
+            messages.Append( AStackString<>( "Error reading file" ) );
+        }
+        MemoryStream ms;
+        ms.Write( jobId );
+        ms.Write( name );
+        ms.Write( ( fail == false ) ); // result
+        ms.Write( false ); // system error
+        ms.Write( messages );
+        ms.Write( (uint32_t)0 ); // build time
+        ms.Write( false ); // data compressed
+        ms.Write( (uint32_t)0 ); // data size (object file was streamed)
+        Protocol::MsgJobResult resultMsg;
+        resultMsg.Send( connection, ms );
+    }
+    bool        m_ExpectingJobPayload = false;
+    uint32_t    m_FailedJobId = 0;
+    AString     m_FailedJobName;
+    uint32_t    m_NumJobsStreamed = 0;
+};
+
+// TestDistributedCoordinator - Emulates a Coordinator, which says every toolchain is on the worker asking
+//  (workers in the same process all have the same address, so a real one never lists them for each other)
+//------------------------------------------------------------------------------
+class TestDistributedCoordinator : public TCPConnectionPool
+{
+public:
+    ~TestDistributedCoordinator() { ShutdownAllConnections(); }
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t, bool & )
+    {
+        // payloads (worker status) are ignored
+        const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+        if ( msg->GetType() == Protocol::MSG_REQUEST_TOOL_PEERS )
+        {
+            AtomicIncU32( &m_NumToolPeerRequests );
+            MemoryStream ms;
+            ms.Write( (uint32_t)1 );
+            ms.Write( connection->GetRemoteAddress() );
+            Protocol::MsgWorkerList reply;
+            reply.Send( connection, ms );
+        }
+    }
+    volatile uint32_t   m_NumToolPeerRequests = 0;
+};
+
+// TestDistributedPeer - Emulates a worker which already has the toolchain, serving it like a Server
+//  would (the data is the Client's own copy, from the build's CompilerNode), or dropping the connection
+//------------------------------------------------------------------------------
+class TestDistributedPeer : public TCPConnectionPool
+{
+public:
+    explicit TestDistributedPeer( const FBuildForTest * fBuild ) : m_FBuild( fBuild ) {}
+    ~TestDistributedPeer() { ShutdownAllConnections(); }
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t, bool & )
+    {
+        // other messages (the connection handshake) are ignored
+        const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+        if ( msg->GetType() != Protocol::MSG_REQUEST_FILE )
+        {
+            return;
+        }
+        AtomicIncU32( &m_NumFilesRequested );
+
+        const Protocol::MsgRequestFile * request = static_cast< const Protocol::MsgRequestFile * >( msg );
+        const ToolManifest * manifest = m_FBuild ? FindManifest( request->GetToolId() ) : nullptr;
+        size_t dataSize( 0 );
+        const void * fileData = manifest ? manifest->GetFileData( request->GetFileId(), dataSize ) : nullptr;
+        if ( fileData == nullptr )
+        {
+            Disconnect( connection );
+            return;
+        }
+
+        ConstMemoryStream ms( fileData, dataSize );
+        Protocol::MsgFile reply( request->GetToolId(), request->GetFileId() );
+        reply.Send( connection, ms );
+        AtomicIncU32( &m_NumFilesSent );
+    }
+    const ToolManifest * FindManifest( uint64_t toolId ) const
+    {
+        Array< const Node * > compilerNodes;
+        m_FBuild->GetNodesOfType( Node::COMPILER_NODE, compilerNodes );
+        for ( const Node * node : compilerNodes )
+        {
+            const ToolManifest & manifest = node->CastTo< CompilerNode >()->GetManifest();
+            if ( manifest.GetToolId() == toolId )
+            {
+                return &manifest;
+            }
+        }
+        return nullptr;
+    }
+    const FBuildForTest *   m_FBuild;           // nullptr to drop every connection instead
+    volatile uint32_t       m_NumFilesRequested = 0;
+    volatile uint32_t       m_NumFilesSent = 0;
+};
+
 // TestDistributed
 //------------------------------------------------------------------------------
 class TestDistributed : public FBuildTest
@@ -31,10 +245,18 @@ private:
 
     void TestWith1RemoteWorkerThread() const;
     void TestWith4RemoteWorkerThreads() const;
+    void TestJobWindow() const;
+    void TestJobDataDedup() const;
+    void TestToolchainPreseed() const;
+    void TestToolchainFromPeer() const;
+    void TestJobDataCompression() const;
+    void TestResultStreaming() const;
+    void TestResultStreamingFailure() const;
     void WithPCH() const;
     void RegressionTest_RemoteCrashOnErrorFormatting();
     void TestLocalRace();
     void RemoteRaceWinRemote();
+    void LostRaceFreesWorkerSlot() const;
     void AnonymousNamespaces();
     void ErrorsAreCorrectlyReported_MSVC() const;
     void ErrorsAreCorrectlyReported_Clang() const;
@@ -46,10 +268,19 @@ private:
     void TestZiDebugFormat_Local() const;
     void D8049_ToolLongDebugRecord() const;
 
-    void TestHelper( const char * target,
-                     uint32_t numRemoteWorkers,
-                     bool shouldFail = false,
-                     bool allowRace = false ) const;
+    struct HelperOptions
+    {
+        uint32_t    m_NumRemoteWorkers  = 1;
+        bool        m_ShouldFail        = false;
+        bool        m_AllowRace         = false;
+        uint32_t    m_JobWindow         = 1;
+        bool        m_Dedup             = false;
+        bool        m_Preseed           = false;
+        bool        m_HighCompression   = false;
+        bool        m_Dictionary        = false;
+    };
+    void        TestHelper( const char * target, uint32_t numRemoteWorkers, bool shouldFail = false, bool allowRace = false ) const;
+    FBuildStats TestHelper( const char * target, const HelperOptions & helperOptions ) const;
 };
 
 // Register Tests
@@ -57,10 +288,18 @@ private:
 REGISTER_TESTS_BEGIN( TestDistributed )
     REGISTER_TEST( TestWith1RemoteWorkerThread )
     REGISTER_TEST( TestWith4RemoteWorkerThreads )
+    REGISTER_TEST( TestJobWindow )
+    REGISTER_TEST( TestJobDataDedup )
+    REGISTER_TEST( TestToolchainPreseed )
+    REGISTER_TEST( TestToolchainFromPeer )
+    REGISTER_TEST( TestJobDataCompression )
+    REGISTER_TEST( TestResultStreaming )
+    REGISTER_TEST( TestResultStreamingFailure )
     REGISTER_TEST( WithPCH )
     REGISTER_TEST( RegressionTest_RemoteCrashOnErrorFormatting )
     REGISTER_TEST( TestLocalRace )
     REGISTER_TEST( RemoteRaceWinRemote )
+    REGISTER_TEST( LostRaceFreesWorkerSlot )
     REGISTER_TEST( AnonymousNamespaces )
     REGISTER_TEST( ShutdownMemoryLeak )
     #if defined( __WINDOWS__ )
@@ -78,21 +317,37 @@ REGISTER_TESTS_END
 // Test
 //------------------------------------------------------------------------------
 void TestDistributed::TestHelper( const char * target, uint32_t numRemoteWorkers, bool shouldFail, bool allowRace ) const
+{
+    HelperOptions helperOptions;
+    helperOptions.m_NumRemoteWorkers = numRemoteWorkers;
+    helperOptions.m_ShouldFail = shouldFail;
+    helperOptions.m_AllowRace = allowRace;
+    TestHelper( target, helperOptions );
+}
+
+// TestHelper
+//------------------------------------------------------------------------------
+FBuildStats TestDistributed::TestHelper( const char * target, const HelperOptions & helperOptions ) const
 {
     FBuildTestOptions options;
     options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
     options.m_AllowDistributed = true;
     options.m_NumWorkerThreads = 1;
     options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
-    options.m_AllowLocalRace = allowRace;
+    options.m_AllowLocalRace = helperOptions.m_AllowRace;
     options.m_EnableMonitor = true; // make sure monitor code paths are tested as well
     options.m_DistributionPort = TEST_PROTOCOL_PORT;
+    options.m_DistributionJobWindow = helperOptions.m_JobWindow;
+    options.m_DistributionDedup = helperOptions.m_Dedup;
+    options.m_DistributionPreseed = helperOptions.m_Preseed;
+    options.m_DistributionHighCompression = helperOptions.m_HighCompression;
+    options.m_DistributionDictionary = helperOptions.m_Dictionary;
     FBuild fBuild( options );
 
     TEST_ASSERT( fBuild.Initialize() );
 
     // start a client to emulate the other end
-    Server s( numRemoteWorkers );
+    Server s( helperOptions.m_NumRemoteWorkers );
     s.Listen( TEST_PROTOCOL_PORT );
 
     // clean up anything left over from previous runs
@@ -105,19 +360,21 @@ void TestDistributed::TestHelper( const char * target, uint32_t numRemoteWorkers
         FileIO::FileDelete( iter->Get() );
     }
 
-    if ( !shouldFail )
+    if ( !helperOptions.m_ShouldFail )
     {
         TEST_ASSERT( FileIO::FileExists( target ) == false );
     }
 
     bool pass = fBuild.Build( target );
-    if ( !shouldFail )
+    if ( !helperOptions.m_ShouldFail )
     {
         TEST_ASSERT( pass );
 
         // make sure all output files are as expected
         TEST_ASSERT( FileIO::FileExists( target ) );
     }
+
+    return fBuild.GetStats();
 }
 
 // TestWith1RemoteWorkerThread
@@ -136,6 +393,224 @@ void TestDistributed::TestWith4RemoteWorkerThreads() const
     TestHelper( target, 4 );
 }
 
+// TestJobWindow
+//------------------------------------------------------------------------------
+void TestDistributed::TestJobWindow() const
+{
+    // worker requests (and returns) several jobs at a time
+    {
+        const char * target( "../tmp/Test/Distributed/dist.lib" );
+        HelperOptions helperOptions;
+        helperOptions.m_NumRemoteWorkers = 4;
+        helperOptions.m_JobWindow = 8;
+        TestHelper( target, helperOptions );
+    }
+
+    // with 1 CPU, a job for it and 8 beyond it are requested in one message
+    const uint32_t numCPUsToUse = WorkerThreadRemote::GetNumCPUsToUse();
+    WorkerThreadRemote::SetNumCPUsToUse( 1 );
+    {
+        Server s( 1 );
+        TEST_ASSERT( s.Listen( TEST_PROTOCOL_PORT ) );
+
+        TestDistributedClient client;
+        const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), TEST_PROTOCOL_PORT );
+        TEST_ASSERT( ci );
+        Protocol::MsgConnection connectionMsg( 20, 8 );
+        TEST_ASSERT( connectionMsg.Send( ci ) );
+
+        Timer t;
+        while ( AtomicLoadRelaxed( &client.m_NumJobsRequested ) < 9 )
+        {
+            TEST_ASSERT( t.GetElapsed() < 5.0f );
+            Thread::Sleep( 1 );
+        }
+
+        // and no more than that
+        Thread::Sleep( 500 );
+        TEST_ASSERT( AtomicLoadRelaxed( &client.m_NumJobsRequested ) == 9 );
+        TEST_ASSERT( AtomicLoadRelaxed( &client.m_NumRequestMessages ) == 1 );
+
+        client.ShutdownAllConnections();
+    }
+    WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
+}
+
+// TestJobDataDedup
+//------------------------------------------------------------------------------
+void TestDistributed::TestJobDataDedup() const
+{
+    // headers shared between jobs are only sent once
+    const char * target( "../tmp/Test/Distributed/Compression/Compression.lib" );
+    HelperOptions helperOptions;
+    helperOptions.m_NumRemoteWorkers = 4;
+    helperOptions.m_Dedup = true;
+    const FBuildStats stats = TestHelper( target, helperOptions );
+    TEST_ASSERT( stats.m_DistBytesDeduplicated > 0 );
+}
+
+// TestToolchainPreseed
+//------------------------------------------------------------------------------
+void TestDistributed::TestToolchainPreseed() const
+{
+    // compiler is pushed to the worker before jobs which need it
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+    HelperOptions helperOptions;
+    helperOptions.m_NumRemoteWorkers = 4;
+    helperOptions.m_Preseed = true;
+    const FBuildStats stats = TestHelper( target, helperOptions );
+    TEST_ASSERT( stats.m_NumDistToolchainsPreseeded > 0 );
+}
+
+// TestToolchainFromPeer
+//------------------------------------------------------------------------------
+void TestDistributed::TestToolchainFromPeer() const
+{
+    // JobQueueRemote is a singleton, so only one Server can run in this process:
+    // the worker the toolchain is copied from and the coordinator are emulated
+    AStackString<> oldCoordinator;
+    const bool hadCoordinator = Env::GetEnvVariable( "FASTBUILD_COORDINATOR", oldCoordinator );
+    Env::SetEnvVariable( "FASTBUILD_COORDINATOR", AString( "127.0.0.1" ) );
+    {
+        TestDistributedCoordinator coordinator;
+        TEST_ASSERT( coordinator.Listen( Protocol::COORDINATOR_PORT ) );
+
+        // first the toolchain is copied from the peer rather than the Client, then the
+        // peer drops the connection, and the Client sends it as usual
+        for ( uint32_t i = 0; i < 2; ++i )
+        {
+            const bool peerDrops = ( i == 1 );
+
+            FBuildTestOptions options;
+            options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+            options.m_AllowDistributed = true;
+            options.m_NumWorkerThreads = 1;
+            options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+            options.m_DistributionPort = TEST_PROTOCOL_PORT;
+            options.m_ForceCleanBuild = true;
+            FBuildForTest fBuild( options );
+            TEST_ASSERT( fBuild.Initialize() );
+
+            // the worker must not have the toolchain from earlier tests
+            // (build the compiler to learn its id, and delete the worker's copy)
+            const char * target( "../tmp/Test/Distributed/dist.lib" );
+            const CompilerNode * compiler = fBuild.GetNode( target )->CastTo< LibraryNode >()->GetCompiler();
+            TEST_ASSERT( fBuild.Build( compiler->GetName() ) );
+            AStackString<> toolchainPath;
+            ToolManifest( compiler->GetManifest().GetToolId() ).GetRemotePath( toolchainPath );
+            Array< AString > files;
+            FileIO::GetFiles( toolchainPath, AStackString<>( "*" ), true, &files );
+            for ( const AString & file : files )
+            {
+                FileIO::FileDelete( file.Get() );
+            }
+
+            TestDistributedPeer peer( peerDrops ? nullptr : &fBuild );
+            TEST_ASSERT( peer.Listen( TEST_PEER_PORT ) );
+
+            WorkerBrokerage brokerage;
+            Server s( 1 );
+            s.SetWorkerBrokerage( &brokerage );
+            s.SetPeerPort( TEST_PEER_PORT );
+            TEST_ASSERT( s.Listen( TEST_PROTOCOL_PORT ) );
+
+            TEST_ASSERT( fBuild.Build( target ) );
+
+            TEST_ASSERT( AtomicLoadRelaxed( &peer.m_NumFilesRequested ) > 0 );
+            if ( peerDrops )
+            {
+                TEST_ASSERT( AtomicLoadRelaxed( &peer.m_NumFilesSent ) == 0 );
+                TEST_ASSERT( s.GetNumToolchainsFromPeers() == 0 );
+            }
+            else
+            {
+                TEST_ASSERT( AtomicLoadRelaxed( &peer.m_NumFilesSent ) == AtomicLoadRelaxed( &peer.m_NumFilesRequested ) );
+                TEST_ASSERT( s.GetNumToolchainsFromPeers() == 1 );
+            }
+        }
+        TEST_ASSERT( AtomicLoadRelaxed( &coordinator.m_NumToolPeerRequests ) == 2 );
+    }
+    if ( hadCoordinator )
+    {
+        Env::SetEnvVariable( "FASTBUILD_COORDINATOR", oldCoordinator );
+    }
+    else
+    {
+        Env::SetEnvVariable( "FASTBUILD_COORDINATOR", AString::GetEmpty() );
+    }
+}
+
+// TestJobDataCompression
+//------------------------------------------------------------------------------
+void TestDistributed::TestJobDataCompression() const
+{
+    // job data is recompressed with LZ4HC and a dictionary trained on the first jobs
+    const char * target( "../tmp/Test/Distributed/Compression/Compression.lib" );
+    HelperOptions helperOptions;
+    helperOptions.m_NumRemoteWorkers = 4;
+    helperOptions.m_HighCompression = true;
+    helperOptions.m_Dictionary = true;
+    {
+        const FBuildStats stats = TestHelper( target, helperOptions );
+        TEST_ASSERT( stats.m_NumDistJobsHighCompression > 0 );
+        TEST_ASSERT( stats.m_NumDistJobsWithDictionary > 0 );
+    }
+
+    // and after deduplication
+    helperOptions.m_Dedup = true;
+    {
+        const FBuildStats stats = TestHelper( target, helperOptions );
+        TEST_ASSERT( stats.m_DistBytesDeduplicated > 0 );
+        TEST_ASSERT( stats.m_NumDistJobsHighCompression > 0 );
+    }
+}
+
+// TestResultStreaming
+//------------------------------------------------------------------------------
+void TestDistributed::TestResultStreaming() const
+{
+    // object is large enough to be sent back from the worker in chunks
+    const char * target( "../tmp/Test/Distributed/LargeObject/LargeObject.lib" );
+    HelperOptions helperOptions;
+    const FBuildStats stats = TestHelper( target, helperOptions );
+    TEST_ASSERT( stats.m_NumDistResultChunks >= 6 ); // object is over 6 MiB
+}
+
+// TestResultStreamingFailure
+//------------------------------------------------------------------------------
+void TestDistributed::TestResultStreamingFailure() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_DistributionPort = TEST_PROTOCOL_PORT;
+    options.m_DistVerbose = true;
+    options.m_StopOnFirstError = false; // keep distributing after the failure
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // a worker that fails after streaming part of the first result
+    TestDistributedStreamingServer s;
+    TEST_ASSERT( s.Listen( TEST_PROTOCOL_PORT ) );
+
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+    TEST_ASSERT( fBuild.Build( target ) == false );
+
+    // the partially streamed file is discarded with the failed result...
+    TEST_ASSERT( s.m_FailedJobId != 0 );
+    AStackString<> streamedFileName;
+    streamedFileName.Format( "%s.%u.tmp", s.m_FailedJobName.Get(), s.m_FailedJobId );
+    TEST_ASSERT( FileIO::FileExists( streamedFileName.Get() ) == false );
+    TEST_ASSERT( GetRecordedOutput().Find( "Error reading file" ) );
+
+    // ...so the results streamed after it are received from the same worker
+    TEST_ASSERT( s.m_NumJobsStreamed == 2 );
+    TEST_ASSERT( fBuild.GetStats().m_NumDistResultChunks == 3 );
+    TEST_ASSERT( GetRecordedOutput().Find( "Failed to write streamed result" ) == nullptr );
+}
+
 // WithPCH
 //------------------------------------------------------------------------------
 void TestDistributed::WithPCH() const
@@ -197,6 +672,80 @@ void TestDistributed::RemoteRaceWinRemote()
     TEST_ASSERT( fBuild.Build( "RemoteRaceWinRemote" ) );
 }
 
+// LostRaceFreesWorkerSlot
+//------------------------------------------------------------------------------
+void TestDistributed::LostRaceFreesWorkerSlot() const
+{
+    // 1 CPU and a job window of 1 gives the client 2 slots
+    const uint32_t numCPUsToUse = WorkerThreadRemote::GetNumCPUsToUse();
+    WorkerThreadRemote::SetNumCPUsToUse( 1 );
+    {
+        Server s( 1 );
+        TEST_ASSERT( s.Listen( TEST_PROTOCOL_PORT ) );
+
+        TestDistributedClient client;
+        const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), TEST_PROTOCOL_PORT );
+        TEST_ASSERT( ci );
+        Protocol::MsgConnection connectionMsg( 10, 1 );
+        TEST_ASSERT( connectionMsg.Send( ci ) );
+
+        Timer t;
+        while ( AtomicLoadRelaxed( &client.m_NumJobsRequested ) < 2 )
+        {
+            TEST_ASSERT( t.GetElapsed() < 5.0f );
+            Thread::Sleep( 1 );
+        }
+        TEST_ASSERT( client.m_AcceptsCancellation );
+
+        // fill both slots with jobs for a toolchain the server will never
+        // receive, so the jobs stay queued
+        const uint64_t toolId = 0x1234;
+        for ( uint32_t jobId = 1; jobId <= 2; ++jobId )
+        {
+            AStackString<> name;
+            name.Format( "%u.obj", jobId );
+            MemoryStream ms;
+            ms.Write( jobId );
+            ms.Write( name );
+            ms.Write( AStackString<>( "." ) ); // working dir
+            ms.Write( (uint32_t)Node::OBJECT_NODE );
+            ms.Write( name );
+            ms.Write( AStackString<>( "file.cpp" ) );
+            ms.Write( (uint32_t)0 ); // flags
+            ms.Write( AStackString<>( "args" ) );
+            ms.Write( false ); // data compressed
+            ms.Write( (uint32_t)0 ); // data size
+            Protocol::MsgJob jobMsg( toolId );
+            TEST_ASSERT( jobMsg.Send( ci, ms ) );
+        }
+
+        // no more jobs are requested while both slots are in use
+        Thread::Sleep( 500 );
+        TEST_ASSERT( AtomicLoadRelaxed( &client.m_NumJobsRequested ) == 2 );
+
+        // a job won by a local race is dropped...
+        Protocol::MsgCancelJob cancelMsg( 1 );
+        TEST_ASSERT( cancelMsg.Send( ci ) );
+        t.Start();
+        while ( AtomicLoadRelaxed( &client.m_CancelledJobId ) != 1 )
+        {
+            TEST_ASSERT( t.GetElapsed() < 5.0f );
+            Thread::Sleep( 1 );
+        }
+
+        // ...and its slot is used to request another
+        t.Start();
+        while ( AtomicLoadRelaxed( &client.m_NumJobsRequested ) < 3 )
+        {
+            TEST_ASSERT( t.GetElapsed() < 5.0f );
+            Thread::Sleep( 1 );
+        }
+
+        client.ShutdownAllConnections();
+    }
+    WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
+}
+
 // AnonymousNamespaces
 //------------------------------------------------------------------------------
 void TestDistributed::AnonymousNamespaces()
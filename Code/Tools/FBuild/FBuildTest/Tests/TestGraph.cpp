@@ -48,6 +48,11 @@ private:
     void TestSerialization() const;
     void TestDeepGraph() const;
     void TestNoStopOnFirstError() const;
+    void TestEventDrivenScheduling() const;
+    void TestCriticalPathScheduling() const;
+    void TestBuildSnapshot() const;
+    void TestStatPrePass() const;
+    void TestAsyncDynamicDependencies() const;
     void DBLocationChanged() const;
     void BFFDirtied() const;
     void DBVersionChanged() const;
@@ -66,6 +71,11 @@ REGISTER_TESTS_BEGIN( TestGraph )
     REGISTER_TEST( TestSerialization )
     REGISTER_TEST( TestDeepGraph )
     REGISTER_TEST( TestNoStopOnFirstError )
+    REGISTER_TEST( TestEventDrivenScheduling )
+    REGISTER_TEST( TestCriticalPathScheduling )
+    REGISTER_TEST( TestBuildSnapshot )
+    REGISTER_TEST( TestStatPrePass )
+    REGISTER_TEST( TestAsyncDynamicDependencies )
     REGISTER_TEST( DBLocationChanged )
     REGISTER_TEST( BFFDirtied )
     REGISTER_TEST( DBVersionChanged )
@@ -618,6 +628,279 @@ void TestGraph::TestNoStopOnFirstError() const
     }
 }
 
+// TestEventDrivenScheduling
+//------------------------------------------------------------------------------
+void TestGraph::TestEventDrivenScheduling() const
+{
+    // Deep graph with many common sub trees
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DeepGraph.bff";
+        options.m_EventDrivenScheduling = true;
+        options.m_ForceCleanBuild = true;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 1,     1,      Node::OBJECT_NODE );
+        CheckStatsNode ( 31,    31,     Node::OBJECT_LIST_NODE );
+    }
+
+    // Failures must propagate in the same way as when sweeping the graph
+    FBuildTestOptions options;
+    options.m_NumWorkerThreads = 0; // ensure test behaves deterministically
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/NoStopOnFirstError/fbuild.bff";
+    options.m_FastCancel = true;
+    options.m_EventDrivenScheduling = true;
+
+    // "Stop On First Error" build (default behaviour)
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) == false ); // Expect build to fail
+
+        const FBuildStats::Stats & nodeStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( nodeStats.m_NumFailed == 1 );
+    }
+
+    // "No Stop On First Error" build
+    options.m_StopOnFirstError = false;
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) == false ); // Expect build to fail
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 4,     0,      Node::OBJECT_NODE );
+        CheckStatsNode ( 2,     0,      Node::LIBRARY_NODE );
+        CheckStatsNode ( 1,     0,      Node::ALIAS_NODE );
+
+        const FBuildStats::Stats & nodeStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( nodeStats.m_NumFailed == 4 );
+    }
+}
+
+// TestCriticalPathScheduling
+//------------------------------------------------------------------------------
+void TestGraph::TestCriticalPathScheduling() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DeepGraph.bff";
+    options.m_CriticalPathScheduling = true;
+    options.m_ForceCleanBuild = true;
+    const char * dbFile = "../tmp/Test/Graph/DeepGraph/CriticalPath.fdb";
+
+    // Build twice, the second time using the build times recorded by the first
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( ( i == 0 ) ? nullptr : dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 1,     1,      Node::OBJECT_NODE );
+        CheckStatsNode ( 31,    31,     Node::OBJECT_LIST_NODE );
+
+        // The critical path must be a chain of dependencies through the object
+        const Array< const Node * > & path = fBuild.GetStats().m_CriticalPath;
+        TEST_ASSERT( path.IsEmpty() == false );
+        bool foundObject = false;
+        for ( size_t j = 0; j < path.GetSize(); ++j )
+        {
+            foundObject |= ( path[ j ]->GetType() == Node::OBJECT_NODE );
+            if ( ( j + 1 ) < path.GetSize() )
+            {
+                const Node * dependent = path[ j + 1 ];
+                const Dependencies * dependencyLists[] = { &dependent->GetPreBuildDependencies(),
+                                                           &dependent->GetStaticDependencies(),
+                                                           &dependent->GetDynamicDependencies() };
+                bool isDependency = false;
+                for ( const Dependencies * dependencies : dependencyLists )
+                {
+                    for ( const Dependency & dep : *dependencies )
+                    {
+                        isDependency |= ( dep.GetNode() == path[ j ] );
+                    }
+                }
+                TEST_ASSERT( isDependency );
+            }
+        }
+        TEST_ASSERT( foundObject );
+        TEST_ASSERT( path.Top()->GetName() == "all" );
+    }
+}
+
+// TestBuildSnapshot
+//------------------------------------------------------------------------------
+void TestGraph::TestBuildSnapshot() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/BuildSnapshot/fbuild.bff";
+    options.m_UseBuildSnapshot = true;
+    options.m_SaveDBOnCompletion = true;
+    options.m_Targets.Append( AStackString<>( "CopyDir" ) );
+    const char * dbFile = "../tmp/Test/Graph/BuildSnapshot/fbuild.fdb";
+    const char * snapshotFile = "../tmp/Test/Graph/BuildSnapshot/fbuild.fdb.snapshot";
+    const char * inputA = "../tmp/Test/Graph/BuildSnapshot/Input/a.txt";
+    const char * inputB = "../tmp/Test/Graph/BuildSnapshot/Input/b.txt";
+    const char * outputA = "../tmp/Test/Graph/BuildSnapshot/Output/a.txt";
+
+    // Start from a clean state, with one input file
+    EnsureFileDoesNotExist( dbFile );
+    EnsureFileDoesNotExist( snapshotFile );
+    EnsureFileDoesNotExist( inputB );
+    EnsureDirExists( "../tmp/Test/Graph/BuildSnapshot/Input/" );
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( inputA, FileStream::WRITE_ONLY ) );
+    }
+
+    // Build, recording a snapshot
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( options.m_Targets ) );
+        EnsureFileExists( snapshotFile );
+        CheckStatsNode ( 1,     1,      Node::COPY_FILE_NODE );
+    }
+
+    // Nothing changed - build is skipped without doing any work
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( options.m_Targets ) );
+        CheckStatsTotal( 0,     0 );
+    }
+
+    // Add a file to the input dir - snapshot is invalidated by the directory listing
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( inputB, FileStream::WRITE_ONLY ) );
+    }
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( options.m_Targets ) );
+        CheckStatsNode ( 2,     1,      Node::COPY_FILE_NODE );
+    }
+
+    // Delete an output - snapshot is invalidated by the file stamp
+    EnsureFileDoesNotExist( outputA );
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( options.m_Targets ) );
+        CheckStatsNode ( 2,     1,      Node::COPY_FILE_NODE );
+    }
+
+    // Different targets - DB is loaded and build proceeds normally
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        Array< AString > targets( 1, false );
+        targets.Append( AStackString<>( outputA ) );
+        TEST_ASSERT( fBuild.Build( targets ) );
+        CheckStatsNode ( 1,     0,      Node::COPY_FILE_NODE );
+    }
+}
+
+// TestStatPrePass
+//------------------------------------------------------------------------------
+void TestGraph::TestStatPrePass() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/BuildSnapshot/fbuild.bff";
+    options.m_StatPrePass = true;
+    const char * dbFile = "../tmp/Test/Graph/StatPrePass/fbuild.fdb";
+    const char * outputA = "../tmp/Test/Graph/BuildSnapshot/Output/a.txt";
+
+    // Make sure there is something to copy
+    EnsureDirExists( "../tmp/Test/Graph/BuildSnapshot/Input/" );
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( "../tmp/Test/Graph/BuildSnapshot/Input/a.txt", FileStream::WRITE_ONLY ) );
+    }
+
+    // Initial build
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+
+    // Nothing changed - stamps all come from the pre-pass
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        TEST_ASSERT( fBuild.GetStats().m_StatPrePassFiles > 0 );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::COPY_FILE_NODE ).m_NumBuilt == 0 );
+    }
+
+    // Missing output is detected from the pre-pass stamp
+    EnsureFileDoesNotExist( outputA );
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "CopyDir" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::COPY_FILE_NODE ).m_NumBuilt == 1 );
+        EnsureFileExists( outputA );
+    }
+}
+
+// TestAsyncDynamicDependencies
+//------------------------------------------------------------------------------
+void TestGraph::TestAsyncDynamicDependencies() const
+{
+    // Deep graph with many object lists, with and without event driven scheduling
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DeepGraph.bff";
+        options.m_AsyncDynamicDependencies = true;
+        options.m_EventDrivenScheduling = ( i == 1 );
+        options.m_ForceCleanBuild = true;
+
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 1,     1,      Node::OBJECT_NODE );
+        CheckStatsNode ( 31,    31,     Node::OBJECT_LIST_NODE );
+    }
+
+    // Failures must propagate in the same way as when done on the main thread
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/NoStopOnFirstError/fbuild.bff";
+    options.m_FastCancel = true;
+    options.m_AsyncDynamicDependencies = true;
+    options.m_StopOnFirstError = false;
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) == false ); // Expect build to fail
+
+        // Check stats
+        //               Seen,  Built,  Type
+        CheckStatsNode ( 4,     0,      Node::OBJECT_NODE );
+        CheckStatsNode ( 2,     0,      Node::LIBRARY_NODE );
+        CheckStatsNode ( 1,     0,      Node::ALIAS_NODE );
+
+        const FBuildStats::Stats & nodeStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( nodeStats.m_NumFailed == 4 );
+    }
+}
+
 // DBLocationChanged
 //------------------------------------------------------------------------------
 void TestGraph::DBLocationChanged() const
@@ -0,0 +1,344 @@
+// TestWorkerConnectionPool.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerConnectionPool.h"
+
+#include "Core/Env/Env.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Time.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#if defined( __WINDOWS__ )
+    #define ONE_SECOND ( (uint64_t)10000000 )
+#else
+    #define ONE_SECOND ( (uint64_t)1000000000 )
+#endif
+
+// TestWorkerConnectionPool
+//------------------------------------------------------------------------------
+class TestWorkerConnectionPool : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void SaveLoad() const;
+    void SaveLoadExpiry() const;
+    void SaveLoadStatus() const;
+    void RankByLoad() const;
+    void RankToolchainBonus() const;
+    void RankAssignedClients() const;
+    void RankTieBreak() const;
+    void AssignHeadroom() const;
+
+    // helpers
+    static void AddWorker( WorkerConnectionPool & pool, uint32_t address, float registered, float lastSeen );
+    static void AddWorker( WorkerConnectionPool & pool, uint32_t address, uint32_t numCPUsFree, uint32_t numJobsQueued );
+    static void Rank( WorkerConnectionPool & pool, uint32_t clientAddress, const Array< uint64_t > & clientToolIds, Array< uint32_t > & outAddresses );
+    static void SaveAndLoad( const WorkerConnectionPool & source, uint64_t saveTime, WorkerConnectionPool & dest, uint64_t loadTime );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestWorkerConnectionPool )
+    REGISTER_TEST( SaveLoad )
+    REGISTER_TEST( SaveLoadExpiry )
+    REGISTER_TEST( SaveLoadStatus )
+    REGISTER_TEST( RankByLoad )
+    REGISTER_TEST( RankToolchainBonus )
+    REGISTER_TEST( RankAssignedClients )
+    REGISTER_TEST( RankTieBreak )
+    REGISTER_TEST( AssignHeadroom )
+REGISTER_TESTS_END
+
+// SaveLoad
+//------------------------------------------------------------------------------
+void TestWorkerConnectionPool::SaveLoad() const
+{
+    WorkerConnectionPool source;
+    AddWorker( source, 0x0100007F, 100.0f, 5.0f );
+    source.m_Workers[ 0 ].m_NumCPUsFree = 6;
+    source.m_Workers[ 0 ].m_NumJobsQueued = 2;
+    source.m_Workers[ 0 ].m_ToolIds.Append( 0x1234 );
+
+    // loaded straight away, nothing has aged
+    const uint64_t now = Time::GetCurrentFileTime();
+    WorkerConnectionPool dest;
+    SaveAndLoad( source, now, dest, now );
+
+    TEST_ASSERT( dest.m_Workers.GetSize() == 1 );
+    const WorkerInfo & worker = dest.m_Workers[ 0 ];
+    TEST_ASSERT( worker.m_Address == 0x0100007F );
+    TEST_ASSERT( worker.m_ProtocolVersion == Protocol::PROTOCOL_VERSION );
+    TEST_ASSERT( worker.m_NumCPUsFree == 6 );
+    TEST_ASSERT( worker.m_NumJobsQueued == 2 );
+    TEST_ASSERT( ( worker.m_ToolIds.GetSize() == 1 ) && ( worker.m_ToolIds[ 0 ] == 0x1234 ) );
+    TEST_ASSERT( ( worker.m_Registered.GetElapsed() >= 100.0f ) && ( worker.m_Registered.GetElapsed() < 101.0f ) );
+    TEST_ASSERT( ( worker.m_LastSeen.GetElapsed() >= 5.0f ) && ( worker.m_LastSeen.GetElapsed() < 6.0f ) );
+
+    // a worker which reported in before the snapshot was loaded is kept
+    WorkerConnectionPool dest2;
+    AddWorker( dest2, 0x0100007F, 1.0f, 1.0f );
+    SaveAndLoad( source, now, dest2, now );
+    TEST_ASSERT( dest2.m_Workers.GetSize() == 1 );
+    TEST_ASSERT( dest2.m_Workers[ 0 ].m_LastSeen.GetElapsed() < 5.0f );
+}
+
+// SaveLoadExpiry
+//------------------------------------------------------------------------------
+void TestWorkerConnectionPool::SaveLoadExpiry() const
+{
+    WorkerConnectionPool source;
+    AddWorker( source, 0x0100007F, 100.0f, 40.0f );
+    AddWorker( source, 0x0200007F, 100.0f, 10.0f );
+
+    // coordinator was down for 30s, so the first worker hasn't been seen
+    // for 70s and the second for 40s
+    const uint64_t saveTime = Time::GetCurrentFileTime();
+    WorkerConnectionPool dest;
+    SaveAndLoad( source, saveTime, dest, saveTime + ( 30 * ONE_SECOND ) );
+    TEST_ASSERT( dest.m_Workers.GetSize() == 2 );
+
+    TEST_ASSERT( dest.EvictExpiredWorkers( 60.0f ) == 1 );
+    TEST_ASSERT( dest.m_Workers.GetSize() == 1 );
+    TEST_ASSERT( dest.m_Workers[ 0 ].m_Address == 0x0200007F );
+
+    // a snapshot from the future (clock went backwards) is not aged
+    WorkerConnectionPool dest2;
+    SaveAndLoad( source, saveTime + ( 30 * ONE_SECOND ), dest2, saveTime );
+    TEST_ASSERT( dest2.m_Workers.GetSize() == 2 );
+    TEST_ASSERT( dest2.m_Workers[ 1 ].m_LastSeen.GetElapsed() < 1.0f );
+    TEST_ASSERT( dest2.EvictExpiredWorkers( 60.0f ) == 0 );
+}
+
+// SaveLoadStatus
+//------------------------------------------------------------------------------
+void TestWorkerConnectionPool::SaveLoadStatus() const
+{
+    WorkerConnectionPool source;
+    AddWorker( source, 0x0100007F, 100.0f, 5.0f );
+
+    // -status shows the ages as of when it is run, not when the snapshot was saved
+    const uint64_t saveTime = Time::GetCurrentFileTime();
+    WorkerConnectionPool dest;
+    SaveAndLoad( source, saveTime, dest, saveTime + ( 30 * ONE_SECOND ) );
+
+    AString status;
+    dest.GetStatus( status );
+    TEST_ASSERT( status.Find( "Workers: 1\n" ) != nullptr );
+    TEST_ASSERT( status.Find( "127.0.0.1" ) != nullptr );
+    TEST_ASSERT( status.Find( " 130s" ) != nullptr );  // Registered
+    TEST_ASSERT( status.Find( " 35s" ) != nullptr );   // Last Seen
+}
+
+// RankByLoad
+//------------------------------------------------------------------------------
+void TestWorkerConnectionPool::RankByLoad() const
+{
+    WorkerConnectionPool pool;
+    AddWorker( pool, 1, 4u, 0u );   // 4
+    AddWorker( pool, 2, 8u, 0u );   // 8
+    AddWorker( pool, 3, 8u, 6u );   // 2 (queued jobs count against free CPUs)
+    AddWorker( pool, 4, 0u, 3u );   // -3 (overloaded)
+
+    // incompatible workers are never offered
+    AddWorker( pool, 5, 16u, 0u );
+    pool.m_Workers.Top().m_ProtocolVersion = ( Protocol::PROTOCOL_VERSION - 1 );
+    AddWorker( pool, 6, 16u, 0u );
+    pool.m_Workers.Top().m_Platform = (uint8_t)( Env::GetPlatform() + 1 );
+
+    Array< uint32_t > ranked;
+    Rank( pool, 100, Array< uint64_t >(), ranked );
+    TEST_ASSERT( ranked.GetSize() == 4 );
+    TEST_ASSERT( ranked[ 0 ] == 2 );
+    TEST_ASSERT( ranked[ 1 ] == 1 );
+    TEST_ASSERT( ranked[ 2 ] == 3 );
+    TEST_ASSERT( ranked[ 3 ] == 4 );
+}
+
+// RankToolchainBonus
+//------------------------------------------------------------------------------
+void TestWorkerConnectionPool::RankToolchainBonus() const
+{
+    WorkerConnectionPool pool;
+    AddWorker( pool, 1, 4u, 0u );
+    AddWorker( pool, 2, 3u, 0u );
+    pool.m_Workers.Top().m_ToolIds.Append( 0xAAAA );
+    AddWorker( pool, 3, 7u, 0u );
+
+    // a worker which already has one of the client's toolchains is preferred
+    // over one which is slightly less loaded...
+    Array< uint64_t > toolIds;
+    toolIds.Append( 0xBBBB );
+    toolIds.Append( 0xAAAA );
+    Array< uint32_t > ranked;
+    Rank( pool, 100, toolIds, ranked );
+    TEST_ASSERT( ranked.GetSize() == 3 );
+    TEST_ASSERT( ranked[ 0 ] == 3 ); // 7 beats 3 + bonus
+    TEST_ASSERT( ranked[ 1 ] == 2 ); // 3 + bonus beats 4
+    TEST_ASSERT( ranked[ 2 ] == 1 );
+
+    // ...but not if the client doesn't use it
+    toolIds.Clear();
+    toolIds.Append( 0xBBBB );
+    Rank( pool, 100, toolIds, ranked );
+    TEST_ASSERT( ranked[ 1 ] == 1 );
+    TEST_ASSERT( ranked[ 2 ] == 2 );
+}
+
+// RankAssignedClients
+//------------------------------------------------------------------------------
+void TestWorkerConnectionPool::RankAssignedClients() const
+{
+    WorkerConnectionPool pool;
+    AddWorker( pool, 1, 8u, 0u );
+    AddWorker( pool, 2, 5u, 0u );
+
+    Array< uint32_t > ranked;
+    Rank( pool, 100, Array< uint64_t >(), ranked );
+    TEST_ASSERT( ranked[ 0 ] == 1 );
+
+    // clients sent to a worker since it last reported are expected to use
+    // some of its CPUs, so the next client goes elsewhere
+    pool.m_Workers[ 0 ].m_NumClientsAssigned = 2;
+    Rank( pool, 100, Array< uint64_t >(), ranked );
+    TEST_ASSERT( ranked[ 0 ] == 2 );
+    TEST_ASSERT( ranked[ 1 ] == 1 );
+}
+
+// RankTieBreak
+//------------------------------------------------------------------------------
+void TestWorkerConnectionPool::RankTieBreak() const
+{
+    // equally loaded workers
+    WorkerConnectionPool pool;
+    for ( uint32_t address = 1; address <= 8; ++address )
+    {
+        AddWorker( pool, address, 4u, 0u );
+    }
+
+    bool anyOrderDiffers = false;
+    Array< uint32_t > firstRanked;
+    for ( uint32_t client = 100; client < 108; ++client )
+    {
+        // order is the same every time for a given client...
+        Array< uint32_t > ranked;
+        Array< uint32_t > rankedAgain;
+        Rank( pool, client, Array< uint64_t >(), ranked );
+        Rank( pool, client, Array< uint64_t >(), rankedAgain );
+        TEST_ASSERT( ranked.GetSize() == 8 );
+        for ( size_t i = 0; i < 8; ++i )
+        {
+            TEST_ASSERT( ranked[ i ] == rankedAgain[ i ] );
+        }
+
+        // ...and is the order of the hash of the client and worker addresses
+        for ( size_t i = 1; i < 8; ++i )
+        {
+            const uint32_t prev[ 2 ] = { client, ranked[ i - 1 ] };
+            const uint32_t curr[ 2 ] = { client, ranked[ i ] };
+            TEST_ASSERT( xxHash::Calc32( prev, sizeof( prev ) ) <= xxHash::Calc32( curr, sizeof( curr ) ) );
+        }
+
+        // ...but differs between clients, so they are spread across workers
+        if ( firstRanked.IsEmpty() )
+        {
+            firstRanked = ranked;
+        }
+        else if ( ranked[ 0 ] != firstRanked[ 0 ] )
+        {
+            anyOrderDiffers = true;
+        }
+    }
+    TEST_ASSERT( anyOrderDiffers );
+}
+
+// AssignHeadroom
+//------------------------------------------------------------------------------
+void TestWorkerConnectionPool::AssignHeadroom() const
+{
+    WorkerConnectionPool pool;
+    for ( uint32_t address = 1; address <= 8; ++address )
+    {
+        AddWorker( pool, address, 8u - address, 0u );
+    }
+
+    // a client limited to 3 connections gets spares, in case some of its
+    // workers can't be used, and they are the next best ones
+    Array< WorkerInfo * > workers;
+    pool.RankWorkers( Protocol::PROTOCOL_VERSION, (uint8_t)Env::GetPlatform(), 100, Array< uint64_t >(), workers );
+    WorkerConnectionPool::AssignWorkers( 3, workers );
+    TEST_ASSERT( workers.GetSize() == 6 );
+    for ( size_t i = 0; i < workers.GetSize(); ++i )
+    {
+        TEST_ASSERT( workers[ i ]->m_Address == ( i + 1 ) );
+    }
+
+    // every worker sent counts against the next client
+    for ( const WorkerInfo & worker : pool.m_Workers )
+    {
+        TEST_ASSERT( worker.m_NumClientsAssigned == ( ( worker.m_Address <= 6 ) ? 1u : 0u ) );
+    }
+
+    // with no limit, or a limit near the number of workers, all are sent
+    pool.RankWorkers( Protocol::PROTOCOL_VERSION, (uint8_t)Env::GetPlatform(), 100, Array< uint64_t >(), workers );
+    WorkerConnectionPool::AssignWorkers( 0, workers );
+    TEST_ASSERT( workers.GetSize() == 8 );
+    pool.RankWorkers( Protocol::PROTOCOL_VERSION, (uint8_t)Env::GetPlatform(), 100, Array< uint64_t >(), workers );
+    WorkerConnectionPool::AssignWorkers( 5, workers );
+    TEST_ASSERT( workers.GetSize() == 8 );
+}
+
+// AddWorker
+//------------------------------------------------------------------------------
+/*static*/ void TestWorkerConnectionPool::AddWorker( WorkerConnectionPool & pool, uint32_t address, float registered, float lastSeen )
+{
+    WorkerInfo worker( address, Protocol::PROTOCOL_VERSION, (uint8_t)Env::GetPlatform() );
+    worker.m_Registered.Start( registered );
+    worker.m_LastSeen.Start( lastSeen );
+    pool.m_Workers.Append( worker );
+}
+
+// AddWorker
+//------------------------------------------------------------------------------
+/*static*/ void TestWorkerConnectionPool::AddWorker( WorkerConnectionPool & pool, uint32_t address, uint32_t numCPUsFree, uint32_t numJobsQueued )
+{
+    AddWorker( pool, address, 0.0f, 0.0f );
+    pool.m_Workers.Top().m_NumCPUsFree = numCPUsFree;
+    pool.m_Workers.Top().m_NumJobsQueued = numJobsQueued;
+}
+
+// Rank
+//------------------------------------------------------------------------------
+/*static*/ void TestWorkerConnectionPool::Rank( WorkerConnectionPool & pool, uint32_t clientAddress, const Array< uint64_t > & clientToolIds, Array< uint32_t > & outAddresses )
+{
+    Array< WorkerInfo * > workers;
+    pool.RankWorkers( Protocol::PROTOCOL_VERSION, (uint8_t)Env::GetPlatform(), clientAddress, clientToolIds, workers );
+
+    outAddresses.Clear();
+    for ( const WorkerInfo * worker : workers )
+    {
+        outAddresses.Append( worker->m_Address );
+    }
+}
+
+// SaveAndLoad
+//------------------------------------------------------------------------------
+/*static*/ void TestWorkerConnectionPool::SaveAndLoad( const WorkerConnectionPool & source, uint64_t saveTime, WorkerConnectionPool & dest, uint64_t loadTime )
+{
+    MemoryStream ms;
+    source.SaveWorkers( ms, saveTime );
+
+    ConstMemoryStream cms( ms.GetData(), ms.GetSize() );
+    TEST_ASSERT( dest.LoadWorkers( cms, loadTime ) );
+}
+
+//------------------------------------------------------------------------------
@@ -28,7 +28,8 @@ FBuildWorkerOptions::FBuildWorkerOptions() :
     m_CPUAllocation( 0 ),
     m_OverrideWorkMode( false ),
     m_WorkMode( WorkerSettings::WHEN_IDLE ),
-    m_ConsoleMode( false )
+    m_ConsoleMode( false ),
+    m_EventLoop( false )
 {
     #ifdef __LINUX__
         m_ConsoleMode = true; // Only console mode supported on Linux
@@ -56,6 +57,13 @@ bool FBuildWorkerOptions::ProcessCommandLine( const AString & commandLine )
             #endif
             continue;
         }
+        #if defined( __LINUX__ )
+            else if ( token == "-eventloop" )
+            {
+                m_EventLoop = true;
+                continue;
+            }
+        #endif
         else if ( token.BeginsWith( "-cpus=" ) )
         {
             int32_t numCPUs = (int32_t)Env::GetNumProcessors();
@@ -150,6 +158,11 @@ void FBuildWorkerOptions::ShowUsageError()
                        "                -n : NUMBER_OF_PROCESSORS-n.\n"
                        "                n% : % of NUMBER_OF_PROCESSORS.\n"
                        "\n"
+                       #if defined( __LINUX__ )
+                       "-eventloop : Service client connections from a small pool of\n"
+                       "             threads instead of a thread per connection.\n"
+                       "\n"
+                       #endif
                        "-mode=[disabled|idle|dedicated|proportional] : Set work mode.\n"
                        "                disabled : Don't accept any work.\n"
                        "                idle : Accept work when PC is idle.\n"
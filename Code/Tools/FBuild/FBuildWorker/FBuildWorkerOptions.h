@@ -39,6 +39,9 @@ public:
     // Console mode
     bool m_ConsoleMode;
 
+    // Networking
+    bool m_EventLoop;   // Service connections from event loop threads (Linux only)
+
     AString m_IPAsHostName;
 
 private:
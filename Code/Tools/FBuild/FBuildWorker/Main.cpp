@@ -140,7 +140,7 @@ int MainCommon( const AString & args )
     // start the worker and wait for it to be closed
     int ret;
     {
-        Worker worker( args, options.m_ConsoleMode, options.m_IPAsHostName );
+        Worker worker( args, options.m_ConsoleMode, options.m_IPAsHostName, options.m_EventLoop );
         if ( options.m_OverrideCPUAllocation )
         {
             WorkerSettings::Get().SetNumCPUsToUse( options.m_CPUAllocation );
@@ -33,7 +33,7 @@
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-Worker::Worker( const AString & args, bool consoleMode, const AString& ipAsHostName )
+Worker::Worker( const AString & args, bool consoleMode, const AString& ipAsHostName, bool useEventLoop )
     : m_ConsoleMode( consoleMode )
     , m_MainWindow( nullptr )
     , m_ConnectionPool( nullptr )
@@ -48,8 +48,13 @@ Worker::Worker( const AString & args, bool consoleMode, const AString& ipAsHostN
     m_WorkerSettings = FNEW( WorkerSettings );
     m_NetworkStartupHelper = FNEW( NetworkStartupHelper );
     m_ConnectionPool = FNEW( Server );
+    if ( useEventLoop )
+    {
+        m_ConnectionPool->UseEventLoop();
+    }
 
     m_WorkerBrokerage.SetIPAsHostName( ipAsHostName );
+    m_ConnectionPool->SetWorkerBrokerage( &m_WorkerBrokerage ); // copy toolchains from other workers
 
     Env::GetExePath( m_BaseExeName );
     #if defined( __WINDOWS__ )
@@ -310,6 +315,14 @@ void Worker::UpdateAvailability()
 
     WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
 
+    // report load so the coordinator can direct clients to less busy workers
+    const JobQueueRemote & jqr = JobQueueRemote::Get();
+    const uint32_t numJobsInFlight = (uint32_t)jqr.GetNumInFlightJobs();
+    const uint32_t numCPUsFree = ( numCPUsToUse > numJobsInFlight ) ? ( numCPUsToUse - numJobsInFlight ) : 0;
+    Array< uint64_t > toolIds( 0, true );
+    m_ConnectionPool->GetSynchronizedToolIds( toolIds );
+    m_WorkerBrokerage.SetWorkerLoad( numCPUsFree, (uint32_t)jqr.GetNumPendingJobs(), toolIds );
+
     m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0);
 }
 
@@ -27,7 +27,7 @@ class WorkerSettings;
 class Worker
 {
 public:
-    explicit Worker( const AString & args, bool consoleMode, const AString& ipAsHostName );
+    explicit Worker( const AString & args, bool consoleMode, const AString& ipAsHostName, bool useEventLoop = false );
     ~Worker();
 
     int32_t Work();